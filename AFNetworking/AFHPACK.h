@@ -0,0 +1,87 @@
+// AFHPACK.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ `AFHPACKEncoder` compresses HTTP/2 header blocks, as specified by RFC 7541. Fields are represented by their index in the static or dynamic table when an identical field has been sent before, and literal names and values are Huffman-coded when that makes them shorter.
+ 
+ @discussion Header fields are passed as an array of two-element arrays, each containing a lowercase field name and its value. Fields that repeat from request to request, such as default headers, are added to the dynamic table, and cost a single byte after the first request on a connection. The `:path` and `content-length` fields, which rarely repeat, are not indexed, and neither are credentials, which are marked as never to be indexed by intermediaries.
+ 
+ An encoder keeps state between header blocks, and must encode every header block of a connection in the order in which they are sent. Encoders are not thread-safe.
+ */
+@interface AFHPACKEncoder : NSObject {
+@private
+    NSMutableArray *_dynamicTable;
+    NSUInteger _dynamicTableSize;
+    NSUInteger _maximumTableSize;
+    BOOL _needsTableSizeUpdate;
+}
+
+/**
+ The maximum size of the dynamic table, in bytes, as defined by RFC 7541. This is 4096 by default. Set it to the `SETTINGS_HEADER_TABLE_SIZE` of the peer when that is lower, and the change is signaled at the start of the next header block.
+ */
+@property (nonatomic, assign) NSUInteger maximumTableSize;
+
+/**
+ Encodes a header block.
+ 
+ @param headerFields The header fields, as arrays of a lowercase name and a value.
+ 
+ @return The encoded header block.
+ */
+- (NSData *)dataByEncodingHeaderFields:(NSArray *)headerFields;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFHPACKDecoder` decompresses HTTP/2 header blocks, as specified by RFC 7541.
+ 
+ @discussion A decoder keeps state between header blocks, and must decode every header block received on a connection, in order, including those of streams that have been reset. Decoders are not thread-safe.
+ */
+@interface AFHPACKDecoder : NSObject {
+@private
+    NSMutableArray *_dynamicTable;
+    NSUInteger _dynamicTableSize;
+    NSUInteger _maximumTableSize;
+    NSUInteger _tableSizeLimit;
+}
+
+/**
+ The maximum size of the dynamic table that the peer may use, in bytes. This is 4096 by default, and must match the `SETTINGS_HEADER_TABLE_SIZE` sent to the peer.
+ */
+@property (nonatomic, assign) NSUInteger maximumTableSize;
+
+/**
+ Decodes a header block.
+ 
+ @param data The encoded header block.
+ @param error If the header block could not be decoded, upon return contains an error describing the problem. A decoding error leaves the decoder's state undefined, and is fatal to the connection.
+ 
+ @return The header fields, as arrays of a name and a value, or `nil` if the header block could not be decoded.
+ */
+- (NSArray *)headerFieldsByDecodingData:(NSData *)data 
+                                  error:(NSError **)error;
+
+@end
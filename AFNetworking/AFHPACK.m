@@ -0,0 +1,620 @@
+// AFHPACK.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHPACK.h"
+#import "AFHTTPRequestOperation.h"
+
+static NSUInteger const kAFHPACKDefaultTableSize = 4096;
+static NSUInteger const kAFHPACKEntryOverhead = 32;
+static NSUInteger const kAFHPACKStaticTableLength = 61;
+
+// See http://tools.ietf.org/html/rfc7541#appendix-A
+static const char * const kAFHPACKStaticTable[61][2] = {
+    {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"}, {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"}, {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""}, {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""}, {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""}, {"date", ""}, {"etag", ""}, {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""}, {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""}, {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""}, {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""}, {"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""}, {"www-authenticate", ""},
+};
+
+#pragma mark - Huffman Coding
+
+// See http://tools.ietf.org/html/rfc7541#appendix-B
+static const uint32_t kAFHPACKHuffmanCodes[257] = {
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff,
+};
+
+static const uint8_t kAFHPACKHuffmanCodeLengths[257] = {
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+};
+
+// Internal nodes of the decoding tree, indexed by node and then by bit. A positive child is the index of another internal node, and a negative child `-(symbol + 1)` is a leaf.
+static int16_t _AFHPACKHuffmanTree[256][2];
+
+static void AFHPACKBuildHuffmanTree(void) {
+    int16_t numberOfNodes = 1;
+    for (int16_t symbol = 0; symbol < 257; symbol++) {
+        uint32_t code = kAFHPACKHuffmanCodes[symbol];
+        uint8_t codeLength = kAFHPACKHuffmanCodeLengths[symbol];
+        
+        int16_t node = 0;
+        for (uint8_t bit = codeLength - 1; bit > 0; bit--) {
+            uint8_t branch = (code >> bit) & 1;
+            if (_AFHPACKHuffmanTree[node][branch] == 0) {
+                _AFHPACKHuffmanTree[node][branch] = numberOfNodes++;
+            }
+            
+            node = _AFHPACKHuffmanTree[node][branch];
+        }
+        
+        _AFHPACKHuffmanTree[node][code & 1] = -(symbol + 1);
+    }
+}
+
+static size_t AFHPACKHuffmanEncodedLength(const uint8_t *bytes, size_t length) {
+    unsigned long long numberOfBits = 0;
+    for (size_t idx = 0; idx < length; idx++) {
+        numberOfBits += kAFHPACKHuffmanCodeLengths[bytes[idx]];
+    }
+    
+    return (size_t)((numberOfBits + 7) / 8);
+}
+
+// `output` must have room for `AFHPACKHuffmanEncodedLength` bytes
+static void AFHPACKHuffmanEncode(const uint8_t *bytes, size_t length, uint8_t *output) {
+    uint64_t accumulator = 0;
+    uint8_t numberOfAccumulatedBits = 0;
+    for (size_t idx = 0; idx < length; idx++) {
+        uint8_t codeLength = kAFHPACKHuffmanCodeLengths[bytes[idx]];
+        accumulator = (accumulator << codeLength) | kAFHPACKHuffmanCodes[bytes[idx]];
+        numberOfAccumulatedBits += codeLength;
+        
+        while (numberOfAccumulatedBits >= 8) {
+            numberOfAccumulatedBits -= 8;
+            *output++ = (uint8_t)(accumulator >> numberOfAccumulatedBits);
+        }
+        
+        accumulator &= (1 << numberOfAccumulatedBits) - 1;
+    }
+    
+    // The last byte is padded with the most significant bits of the end-of-string code, which are all ones
+    if (numberOfAccumulatedBits > 0) {
+        *output = (uint8_t)((accumulator << (8 - numberOfAccumulatedBits)) | (0xff >> numberOfAccumulatedBits));
+    }
+}
+
+// `output` must have room for `length * 8 / 5 + 1` bytes, since the shortest code is 5 bits long
+static BOOL AFHPACKHuffmanDecode(const uint8_t *bytes, size_t length, uint8_t *output, size_t *outputLength) {
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        AFHPACKBuildHuffmanTree();
+    });
+    
+    int16_t node = 0;
+    uint8_t numberOfPendingBits = 0;
+    BOOL pendingBitsAreOnes = YES;
+    size_t numberOfDecodedBytes = 0;
+    for (size_t idx = 0; idx < length; idx++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            uint8_t branch = (bytes[idx] >> bit) & 1;
+            int16_t child = _AFHPACKHuffmanTree[node][branch];
+            if (child < 0) {
+                // A decoded end-of-string symbol is an error
+                if (child == -257) {
+                    return NO;
+                }
+                
+                output[numberOfDecodedBytes++] = (uint8_t)(-child - 1);
+                node = 0;
+                numberOfPendingBits = 0;
+                pendingBitsAreOnes = YES;
+            } else {
+                node = child;
+                numberOfPendingBits++;
+                pendingBitsAreOnes = pendingBitsAreOnes && branch;
+            }
+        }
+    }
+    
+    // Padding must be shorter than 8 bits, and match the end-of-string code
+    if (numberOfPendingBits > 7 || !pendingBitsAreOnes) {
+        return NO;
+    }
+    
+    *outputLength = numberOfDecodedBytes;
+    
+    return YES;
+}
+
+#pragma mark - Primitive Types
+
+static void AFHPACKAppendInteger(NSMutableData *data, uint8_t flags, uint8_t prefixLength, NSUInteger value) {
+    NSUInteger maximumPrefixValue = (1 << prefixLength) - 1;
+    uint8_t byte = flags | (uint8_t)MIN(value, maximumPrefixValue);
+    [data appendBytes:&byte length:1];
+    if (value < maximumPrefixValue) {
+        return;
+    }
+    
+    value -= maximumPrefixValue;
+    while (value >= 0x80) {
+        byte = (uint8_t)((value & 0x7f) | 0x80);
+        [data appendBytes:&byte length:1];
+        value >>= 7;
+    }
+    
+    byte = (uint8_t)value;
+    [data appendBytes:&byte length:1];
+}
+
+static void AFHPACKAppendString(NSMutableData *data, NSString *string) {
+    NSData *octets = [string dataUsingEncoding:NSUTF8StringEncoding] ?: [NSData data];
+    size_t huffmanEncodedLength = AFHPACKHuffmanEncodedLength([octets bytes], [octets length]);
+    if (huffmanEncodedLength < [octets length]) {
+        AFHPACKAppendInteger(data, 0x80, 7, huffmanEncodedLength);
+        
+        NSUInteger offset = [data length];
+        [data increaseLengthBy:huffmanEncodedLength];
+        AFHPACKHuffmanEncode([octets bytes], [octets length], (uint8_t *)[data mutableBytes] + offset);
+    } else {
+        AFHPACKAppendInteger(data, 0x00, 7, [octets length]);
+        [data appendData:octets];
+    }
+}
+
+static BOOL AFHPACKReadInteger(const uint8_t *bytes, NSUInteger length, NSUInteger *offset, uint8_t prefixLength, NSUInteger *value) {
+    if (*offset >= length) {
+        return NO;
+    }
+    
+    NSUInteger maximumPrefixValue = (1 << prefixLength) - 1;
+    NSUInteger result = bytes[(*offset)++] & maximumPrefixValue;
+    if (result < maximumPrefixValue) {
+        *value = result;
+        return YES;
+    }
+    
+    // Values are limited to 28 bits, which is far more than any header block needs
+    for (NSUInteger shift = 0; *offset < length && shift <= 21; shift += 7) {
+        uint8_t byte = bytes[(*offset)++];
+        result += (NSUInteger)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+static NSString * AFHPACKReadString(const uint8_t *bytes, NSUInteger length, NSUInteger *offset) {
+    if (*offset >= length) {
+        return nil;
+    }
+    
+    BOOL isHuffmanEncoded = (bytes[*offset] & 0x80) != 0;
+    NSUInteger stringLength = 0;
+    if (!AFHPACKReadInteger(bytes, length, offset, 7, &stringLength) || stringLength > length - *offset) {
+        return nil;
+    }
+    
+    const uint8_t *stringBytes = bytes + *offset;
+    *offset += stringLength;
+    
+    // Field values are octets, which Latin-1 maps to characters one-to-one
+    if (!isHuffmanEncoded) {
+        return [[[NSString alloc] initWithBytes:stringBytes length:stringLength encoding:NSISOLatin1StringEncoding] autorelease];
+    }
+    
+    NSString *string = nil;
+    uint8_t *decodedBytes = malloc(stringLength * 8 / 5 + 1);
+    size_t decodedLength = 0;
+    if (AFHPACKHuffmanDecode(stringBytes, stringLength, decodedBytes, &decodedLength)) {
+        string = [[[NSString alloc] initWithBytes:decodedBytes length:decodedLength encoding:NSISOLatin1StringEncoding] autorelease];
+    }
+    free(decodedBytes);
+    
+    return string;
+}
+
+#pragma mark - Tables
+
+@interface AFHPACKTableEntry : NSObject {
+@private
+    NSString *_name;
+    NSString *_value;
+    NSUInteger _size;
+}
+
+@property (readonly, nonatomic, copy) NSString *name;
+@property (readonly, nonatomic, copy) NSString *value;
+@property (readonly, nonatomic, assign) NSUInteger size;
+
+- (id)initWithName:(NSString *)name 
+             value:(NSString *)value 
+              size:(NSUInteger)size;
+@end
+
+@implementation AFHPACKTableEntry
+@synthesize name = _name;
+@synthesize value = _value;
+@synthesize size = _size;
+
+- (id)initWithName:(NSString *)name 
+             value:(NSString *)value 
+              size:(NSUInteger)size
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _name = [name copy];
+    _value = [value copy];
+    _size = size;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_name release];
+    [_value release];
+    [super dealloc];
+}
+
+@end
+
+static NSArray * AFHPACKStaticTableEntries(void) {
+    static NSArray *_staticTableEntries = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        NSMutableArray *mutableEntries = [NSMutableArray arrayWithCapacity:kAFHPACKStaticTableLength];
+        for (NSUInteger idx = 0; idx < kAFHPACKStaticTableLength; idx++) {
+            NSString *name = [NSString stringWithUTF8String:kAFHPACKStaticTable[idx][0]];
+            NSString *value = [NSString stringWithUTF8String:kAFHPACKStaticTable[idx][1]];
+            [mutableEntries addObject:[[[AFHPACKTableEntry alloc] initWithName:name value:value size:([name length] + [value length] + kAFHPACKEntryOverhead)] autorelease]];
+        }
+        
+        _staticTableEntries = [mutableEntries copy];
+    });
+    
+    return _staticTableEntries;
+}
+
+// The dynamic table is ordered from the newest entry to the oldest, which is evicted first
+static void AFHPACKEvictEntries(NSMutableArray *table, NSUInteger *tableSize, NSUInteger maximumTableSize) {
+    while (*tableSize > maximumTableSize && [table count] > 0) {
+        *tableSize -= [(AFHPACKTableEntry *)[table lastObject] size];
+        [table removeLastObject];
+    }
+}
+
+static void AFHPACKAddEntry(NSMutableArray *table, NSUInteger *tableSize, NSUInteger maximumTableSize, AFHPACKTableEntry *entry) {
+    if (entry.size > maximumTableSize) {
+        [table removeAllObjects];
+        *tableSize = 0;
+        return;
+    }
+    
+    AFHPACKEvictEntries(table, tableSize, maximumTableSize - entry.size);
+    [table insertObject:entry atIndex:0];
+    *tableSize += entry.size;
+}
+
+static AFHPACKTableEntry * AFHPACKEntryAtIndex(NSArray *dynamicTable, NSUInteger index) {
+    if (index == 0) {
+        return nil;
+    } else if (index <= kAFHPACKStaticTableLength) {
+        return [AFHPACKStaticTableEntries() objectAtIndex:(index - 1)];
+    } else if (index - kAFHPACKStaticTableLength <= [dynamicTable count]) {
+        return [dynamicTable objectAtIndex:(index - kAFHPACKStaticTableLength - 1)];
+    }
+    
+    return nil;
+}
+
+#pragma mark -
+
+// Credentials are never indexed, nor are short cookies, which could be guessed from the size of header blocks; see http://tools.ietf.org/html/rfc7541#section-7.1.3
+static inline BOOL AFHPACKHeaderFieldIsSensitive(NSString *name, NSString *value) {
+    return [name isEqualToString:@"authorization"] || [name isEqualToString:@"proxy-authorization"] || ([name isEqualToString:@"cookie"] && [value length] < 20);
+}
+
+// Fields whose values differ from request to request would only evict fields that repeat
+static inline BOOL AFHPACKHeaderFieldIsUnique(NSString *name) {
+    return [name isEqualToString:@":path"] || [name isEqualToString:@"content-length"];
+}
+
+@interface AFHPACKEncoder ()
+@property (readwrite, nonatomic, retain) NSMutableArray *dynamicTable;
+
+- (NSUInteger)indexOfHeaderFieldWithName:(NSString *)name 
+                                   value:(NSString *)value 
+                               nameIndex:(NSUInteger *)nameIndex;
+@end
+
+@implementation AFHPACKEncoder
+@synthesize dynamicTable = _dynamicTable;
+@synthesize maximumTableSize = _maximumTableSize;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.dynamicTable = [NSMutableArray array];
+    _maximumTableSize = kAFHPACKDefaultTableSize;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_dynamicTable release];
+    [super dealloc];
+}
+
+- (void)setMaximumTableSize:(NSUInteger)maximumTableSize {
+    if (maximumTableSize == _maximumTableSize) {
+        return;
+    }
+    
+    _maximumTableSize = maximumTableSize;
+    _needsTableSizeUpdate = YES;
+    
+    AFHPACKEvictEntries(self.dynamicTable, &_dynamicTableSize, maximumTableSize);
+}
+
+- (NSUInteger)indexOfHeaderFieldWithName:(NSString *)name 
+                                   value:(NSString *)value 
+                               nameIndex:(NSUInteger *)nameIndex
+{
+    static NSDictionary *_staticTableIndexesByName = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        NSMutableDictionary *mutableIndexesByName = [NSMutableDictionary dictionaryWithCapacity:kAFHPACKStaticTableLength];
+        [AFHPACKStaticTableEntries() enumerateObjectsWithOptions:NSEnumerationReverse usingBlock:^(id entry, NSUInteger idx, __unused BOOL *stop) {
+            [mutableIndexesByName setObject:[NSNumber numberWithUnsignedInteger:(idx + 1)] forKey:[(AFHPACKTableEntry *)entry name]];
+        }];
+        
+        _staticTableIndexesByName = [mutableIndexesByName copy];
+    });
+    
+    *nameIndex = 0;
+    
+    NSNumber *staticIndex = [_staticTableIndexesByName objectForKey:name];
+    if (staticIndex) {
+        *nameIndex = [staticIndex unsignedIntegerValue];
+        
+        for (NSUInteger index = *nameIndex; index <= kAFHPACKStaticTableLength; index++) {
+            AFHPACKTableEntry *entry = AFHPACKEntryAtIndex(nil, index);
+            if (![entry.name isEqualToString:name]) {
+                break;
+            } else if ([entry.value isEqualToString:value]) {
+                return index;
+            }
+        }
+    }
+    
+    NSUInteger index = kAFHPACKStaticTableLength;
+    for (AFHPACKTableEntry *entry in self.dynamicTable) {
+        index++;
+        if ([entry.name isEqualToString:name]) {
+            if ([entry.value isEqualToString:value]) {
+                return index;
+            } else if (*nameIndex == 0) {
+                *nameIndex = index;
+            }
+        }
+    }
+    
+    return NSNotFound;
+}
+
+- (NSData *)dataByEncodingHeaderFields:(NSArray *)headerFields {
+    NSMutableData *mutableData = [NSMutableData dataWithCapacity:([headerFields count] * 8)];
+    
+    if (_needsTableSizeUpdate) {
+        AFHPACKAppendInteger(mutableData, 0x20, 5, self.maximumTableSize);
+        _needsTableSizeUpdate = NO;
+    }
+    
+    for (NSArray *headerField in headerFields) {
+        NSString *name = [headerField objectAtIndex:0];
+        NSString *value = [headerField objectAtIndex:1];
+        
+        NSUInteger nameIndex = 0;
+        NSUInteger index = [self indexOfHeaderFieldWithName:name value:value nameIndex:&nameIndex];
+        if (index != NSNotFound && !AFHPACKHeaderFieldIsSensitive(name, value)) {
+            AFHPACKAppendInteger(mutableData, 0x80, 7, index);
+            continue;
+        }
+        
+        if (AFHPACKHeaderFieldIsSensitive(name, value)) {
+            AFHPACKAppendInteger(mutableData, 0x10, 4, nameIndex);
+        } else if (AFHPACKHeaderFieldIsUnique(name)) {
+            AFHPACKAppendInteger(mutableData, 0x00, 4, nameIndex);
+        } else {
+            AFHPACKAppendInteger(mutableData, 0x40, 6, nameIndex);
+            
+            NSUInteger size = [name lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + [value lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + kAFHPACKEntryOverhead;
+            AFHPACKAddEntry(self.dynamicTable, &_dynamicTableSize, self.maximumTableSize, [[[AFHPACKTableEntry alloc] initWithName:name value:value size:size] autorelease]);
+        }
+        
+        if (nameIndex == 0) {
+            AFHPACKAppendString(mutableData, name);
+        }
+        
+        AFHPACKAppendString(mutableData, value);
+    }
+    
+    return mutableData;
+}
+
+@end
+
+#pragma mark -
+
+static id AFHPACKDecodingFailed(NSError **error) {
+    if (error) {
+        NSDictionary *userInfo = [NSDictionary dictionaryWithObject:NSLocalizedString(@"The HTTP/2 header block could not be decoded", nil) forKey:NSLocalizedDescriptionKey];
+        *error = [[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorCannotDecodeRawData userInfo:userInfo] autorelease];
+    }
+    
+    return nil;
+}
+
+@interface AFHPACKDecoder ()
+@property (readwrite, nonatomic, retain) NSMutableArray *dynamicTable;
+@end
+
+@implementation AFHPACKDecoder
+@synthesize dynamicTable = _dynamicTable;
+@synthesize maximumTableSize = _maximumTableSize;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.dynamicTable = [NSMutableArray array];
+    _maximumTableSize = kAFHPACKDefaultTableSize;
+    _tableSizeLimit = kAFHPACKDefaultTableSize;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_dynamicTable release];
+    [super dealloc];
+}
+
+- (void)setMaximumTableSize:(NSUInteger)maximumTableSize {
+    _maximumTableSize = maximumTableSize;
+    _tableSizeLimit = MIN(_tableSizeLimit, maximumTableSize);
+    
+    AFHPACKEvictEntries(self.dynamicTable, &_dynamicTableSize, _tableSizeLimit);
+}
+
+- (NSArray *)headerFieldsByDecodingData:(NSData *)data 
+                                  error:(NSError **)error
+{
+    const uint8_t *bytes = [data bytes];
+    NSUInteger length = [data length];
+    NSUInteger offset = 0;
+    
+    NSMutableArray *mutableHeaderFields = [NSMutableArray array];
+    while (offset < length) {
+        uint8_t byte = bytes[offset];
+        NSUInteger index = 0;
+        
+        if (byte & 0x80) {
+            // Indexed header field
+            AFHPACKTableEntry *entry = nil;
+            if (AFHPACKReadInteger(bytes, length, &offset, 7, &index)) {
+                entry = AFHPACKEntryAtIndex(self.dynamicTable, index);
+            }
+            
+            if (!entry) {
+                return AFHPACKDecodingFailed(error);
+            }
+            
+            [mutableHeaderFields addObject:[NSArray arrayWithObjects:entry.name, entry.value, nil]];
+        } else if ((byte & 0xe0) == 0x20) {
+            // Dynamic table size update, which may only precede the header fields of a block
+            NSUInteger tableSizeLimit = 0;
+            if ([mutableHeaderFields count] > 0 || !AFHPACKReadInteger(bytes, length, &offset, 5, &tableSizeLimit) || tableSizeLimit > self.maximumTableSize) {
+                return AFHPACKDecodingFailed(error);
+            }
+            
+            _tableSizeLimit = tableSizeLimit;
+            AFHPACKEvictEntries(self.dynamicTable, &_dynamicTableSize, _tableSizeLimit);
+        } else {
+            // Literal header field, with incremental indexing, without indexing, or never indexed
+            BOOL isIndexed = (byte & 0xc0) == 0x40;
+            if (!AFHPACKReadInteger(bytes, length, &offset, (isIndexed ? 6 : 4), &index)) {
+                return AFHPACKDecodingFailed(error);
+            }
+            
+            NSString *name = index == 0 ? AFHPACKReadString(bytes, length, &offset) : AFHPACKEntryAtIndex(self.dynamicTable, index).name;
+            NSString *value = name ? AFHPACKReadString(bytes, length, &offset) : nil;
+            if (!name || !value) {
+                return AFHPACKDecodingFailed(error);
+            }
+            
+            if (isIndexed) {
+                AFHPACKAddEntry(self.dynamicTable, &_dynamicTableSize, _tableSizeLimit, [[[AFHPACKTableEntry alloc] initWithName:name value:value size:([name length] + [value length] + kAFHPACKEntryOverhead)] autorelease]);
+            }
+            
+            [mutableHeaderFields addObject:[NSArray arrayWithObjects:name, value, nil]];
+        }
+    }
+    
+    return mutableHeaderFields;
+}
+
+@end
@@ -0,0 +1,127 @@
+// AFHTTP2Transport.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "AFHTTPTransport.h"
+
+/**
+ `AFHTTP2Transport` loads requests over HTTP/2, as specified by RFC 7540. Concurrent requests to a host are multiplexed as streams of a single connection, so that they pay for neither a connection each nor for waiting on one another, as they do over HTTP/1.1.
+ 
+ @discussion Connections are made over cleartext TCP with prior knowledge of HTTP/2 support ("h2c"), as described in RFC 7540 section 3.4, which makes the transport usable against a local server. HTTP/2 over TLS is negotiated with ALPN, which `CFStream` does not expose, so `https` requests are loaded by the `fallbackTransport`. A host that does not answer the connection preface with HTTP/2 settings is remembered as not supporting HTTP/2; the requests waiting on it, and all later requests to it, are loaded by the fallback transport.
+ 
+ Header blocks are compressed with HPACK, so that header fields repeated on every request, such as the default headers of an `AFHTTPClient`, are sent as a single byte each after the first request on a connection. Each stream is given a weight from the `queuePriority` of the operation that loads it, from 256 for `NSOperationQueuePriorityVeryHigh` down to 16 for `NSOperationQueuePriorityVeryLow`. Response data is acknowledged to the server as the operation consumes it, so that a paused operation stops the flow of its own stream without holding up the others on its connection.
+ 
+ Request bodies are sent as DATA frames, as far as the flow control windows of the server allow. An `HTTPBodyStream` is read on the network thread as the windows open, and is sent with the `Content-Length` header of the request if it has one, and otherwise ends with the last frame of the stream. A request that is sent again, after the server refuses its stream or goes away, or that falls back to HTTP/1.1 after its body has been read, is sent with a new stream from `AFHTTPBodyStreamForResendingRequest`, and fails with `NSURLErrorRequestBodyStreamExhausted` when none can be made.
+ 
+ Connections are driven by the run loop of a network thread of their own, and deliver callbacks to the run loops in which each request is scheduled. Since the number of operations in flight for a host is limited by the `AFHTTPOperationScheduler`, the budget of a host loaded over HTTP/2 should be raised with `-[AFHTTPOperationScheduler setMaximumConcurrentOperationCount:forHost:]`. As with `AFHTTPSocketTransport`, response bodies are delivered without decoding their content coding, requests without an `Accept-Encoding` header are sent with `Accept-Encoding: identity`, and redirects are delivered as responses rather than followed.
+ */
+@interface AFHTTP2Transport : NSObject <AFHTTPTransport> {
+@private
+    id <AFHTTPTransport> _fallbackTransport;
+    NSMutableDictionary *_connectionsByKey;
+    NSMutableSet *_drainingConnections;
+    NSMutableSet *_HTTP1HostKeys;
+    NSUInteger _maximumConcurrentStreamsPerConnection;
+    uint32_t _initialStreamWindowSize;
+    uint32_t _connectionWindowSize;
+    NSTimeInterval _idleConnectionTimeout;
+    NSUInteger _openedConnectionCount;
+    NSUInteger _openedStreamCount;
+    unsigned long long _encodedHeaderByteCount;
+    unsigned long long _unencodedHeaderByteCount;
+}
+
+///--------------------------------
+/// @name Configuring the Transport
+///--------------------------------
+
+/**
+ The transport that loads requests which cannot be loaded over HTTP/2. This is the shared `AFHTTPSocketTransport` by default.
+ */
+@property (nonatomic, retain) id <AFHTTPTransport> fallbackTransport;
+
+/**
+ The maximum number of streams open at once on a connection. Servers usually set a lower limit with `SETTINGS_MAX_CONCURRENT_STREAMS`, in which case the server's limit applies. Requests beyond the limit wait for a stream to close. This is 100 by default.
+ */
+@property (nonatomic, assign) NSUInteger maximumConcurrentStreamsPerConnection;
+
+/**
+ The flow-control window of each stream, which is the amount of response data the server may send on a stream before the operation has consumed it. This is 1 MB by default, which keeps a stream from stalling on the acknowledgement of data on links with a large bandwidth-delay product. It applies to connections opened after it is set.
+ */
+@property (nonatomic, assign) uint32_t initialStreamWindowSize;
+
+/**
+ The flow-control window of each connection, shared by all of its streams. This is 16 MB by default. It applies to connections opened after it is set.
+ */
+@property (nonatomic, assign) uint32_t connectionWindowSize;
+
+/**
+ The time after which a connection with no open streams is closed. This is 30 seconds by default.
+ */
+@property (nonatomic, assign) NSTimeInterval idleConnectionTimeout;
+
+///-----------------------------------
+/// @name Getting Transport Statistics
+///-----------------------------------
+
+/**
+ The number of connections the transport has opened.
+ */
+@property (readonly, nonatomic, assign) NSUInteger openedConnectionCount;
+
+/**
+ The number of streams the transport has opened. Each request is loaded on its own stream, so the number of requests that shared a connection with an earlier request is the difference between this and `openedConnectionCount`.
+ */
+@property (readonly, nonatomic, assign) NSUInteger openedStreamCount;
+
+/**
+ The number of bytes of header blocks sent, after HPACK compression.
+ */
+@property (readonly, nonatomic, assign) unsigned long long encodedHeaderByteCount;
+
+/**
+ The number of bytes the header fields sent would have taken in HTTP/1.1. Divided by `encodedHeaderByteCount`, this is the compression ratio of request headers.
+ */
+@property (readonly, nonatomic, assign) unsigned long long unencodedHeaderByteCount;
+
+///---------------------------
+/// @name Managing Connections
+///---------------------------
+
+/**
+ Returns the shared HTTP/2 transport.
+ */
++ (AFHTTP2Transport *)sharedTransport;
+
+/**
+ Opens a connection to the host of the specified URL and exchanges the connection preface with it, so that the first request to the host can be sent at once. The connection is closed if no stream is opened on it within `idleConnectionTimeout`.
+ 
+ @param url The URL whose host is to be connected to. URLs whose requests would be loaded by the `fallbackTransport` are passed on to it, if it implements this method.
+ */
+- (void)prewarmConnectionToURL:(NSURL *)url;
+
+/**
+ Closes all connections with no open streams.
+ */
+- (void)closeIdleConnections;
+
+@end
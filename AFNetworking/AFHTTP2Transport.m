@@ -0,0 +1,1889 @@
+// AFHTTP2Transport.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTP2Transport.h"
+#import "AFHTTPSocketTransport.h"
+#import "AFHTTPResponseCache.h"
+#import "AFHTTPBodyCompressionPolicy.h"
+#import "AFHPACK.h"
+
+static NSUInteger const kAFHTTP2TransportDefaultMaximumConcurrentStreamsPerConnection = 100;
+static uint32_t const kAFHTTP2TransportDefaultInitialStreamWindowSize = 1024 * 1024;
+static uint32_t const kAFHTTP2TransportDefaultConnectionWindowSize = 16 * 1024 * 1024;
+static NSTimeInterval const kAFHTTP2TransportDefaultIdleConnectionTimeout = 30.0;
+
+static uint32_t const kAFHTTP2DefaultWindowSize = 65535;
+static uint32_t const kAFHTTP2MaximumWindowSize = 0x7fffffff;
+static uint32_t const kAFHTTP2DefaultMaximumFrameSize = 16384;
+static uint32_t const kAFHTTP2MaximumFrameSize = 16777215;
+static NSUInteger const kAFHTTP2FrameHeaderLength = 9;
+static NSUInteger const kAFHTTP2ReadBufferLength = 32 * 1024;
+static NSUInteger const kAFHTTP2MaximumHeaderBlockLength = 256 * 1024;
+static uint32_t const kAFHTTP2DefaultHeaderTableSize = 4096;
+
+// See http://tools.ietf.org/html/rfc7540#section-3.5
+static char const kAFHTTP2ConnectionPreface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+typedef enum {
+    AFHTTP2DataFrameType            = 0x0,
+    AFHTTP2HeadersFrameType         = 0x1,
+    AFHTTP2PriorityFrameType        = 0x2,
+    AFHTTP2ResetStreamFrameType     = 0x3,
+    AFHTTP2SettingsFrameType        = 0x4,
+    AFHTTP2PushPromiseFrameType     = 0x5,
+    AFHTTP2PingFrameType            = 0x6,
+    AFHTTP2GoAwayFrameType          = 0x7,
+    AFHTTP2WindowUpdateFrameType    = 0x8,
+    AFHTTP2ContinuationFrameType    = 0x9,
+} AFHTTP2FrameType;
+
+enum {
+    AFHTTP2EndStreamFlag    = 0x1,
+    AFHTTP2AckFlag          = 0x1,
+    AFHTTP2EndHeadersFlag   = 0x4,
+    AFHTTP2PaddedFlag       = 0x8,
+    AFHTTP2PriorityFlag     = 0x20,
+};
+
+enum {
+    AFHTTP2HeaderTableSizeSetting       = 0x1,
+    AFHTTP2EnablePushSetting            = 0x2,
+    AFHTTP2MaximumConcurrentStreamsSetting = 0x3,
+    AFHTTP2InitialWindowSizeSetting     = 0x4,
+    AFHTTP2MaximumFrameSizeSetting      = 0x5,
+};
+
+typedef enum {
+    AFHTTP2NoError                  = 0x0,
+    AFHTTP2ProtocolError            = 0x1,
+    AFHTTP2FlowControlError         = 0x3,
+    AFHTTP2FrameSizeError           = 0x6,
+    AFHTTP2RefusedStreamError       = 0x7,
+    AFHTTP2CancelError              = 0x8,
+    AFHTTP2CompressionError         = 0x9,
+} AFHTTP2ErrorCode;
+
+static inline uint32_t AFHTTP2ReadUInt32(const uint8_t *bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+static void AFHTTP2AppendUInt32(NSMutableData *data, uint32_t value) {
+    uint8_t bytes[4] = {(uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value};
+    [data appendBytes:bytes length:4];
+}
+
+static void AFHTTP2AppendFrameHeader(NSMutableData *data, uint32_t length, AFHTTP2FrameType type, uint8_t flags, uint32_t streamID) {
+    uint8_t bytes[5] = {(uint8_t)(length >> 16), (uint8_t)(length >> 8), (uint8_t)length, (uint8_t)type, flags};
+    [data appendBytes:bytes length:5];
+    AFHTTP2AppendUInt32(data, streamID & kAFHTTP2MaximumWindowSize);
+}
+
+static NSString * AFHTTP2ConnectionKeyForURL(NSURL *url) {
+    NSInteger port = [url port] ? [[url port] integerValue] : 80;
+    
+    return [NSString stringWithFormat:@"%@://%@:%ld", [[url scheme] lowercaseString], [[url host] lowercaseString], (long)port];
+}
+
+// Stream weights range from 1 to 256; see http://tools.ietf.org/html/rfc7540#section-5.3.2
+static NSUInteger AFHTTP2WeightForQueuePriority(NSOperationQueuePriority queuePriority) {
+    if (queuePriority >= NSOperationQueuePriorityVeryHigh) {
+        return 256;
+    } else if (queuePriority >= NSOperationQueuePriorityHigh) {
+        return 128;
+    } else if (queuePriority >= NSOperationQueuePriorityNormal) {
+        return 64;
+    } else if (queuePriority >= NSOperationQueuePriorityLow) {
+        return 32;
+    } else {
+        return 16;
+    }
+}
+
+static NSArray * AFHTTP2HeaderFieldsForRequest(NSURLRequest *request) {
+    NSURL *url = [request URL];
+    NSString *method = [request HTTPMethod] ?: @"GET";
+    
+    // Unlike `-[NSURL path]`, `CFURLCopyPath` keeps percent escapes intact
+    NSString *path = [(NSString *)CFURLCopyPath((CFURLRef)url) autorelease];
+    if ([path length] == 0) {
+        path = @"/";
+    }
+    if ([url query]) {
+        path = [path stringByAppendingFormat:@"?%@", [url query]];
+    }
+    
+    // IPv6 literals are bracketed, as they are in the URL; see http://tools.ietf.org/html/rfc3986#section-3.2.2
+    NSString *host = [[url host] rangeOfString:@":"].location != NSNotFound ? [NSString stringWithFormat:@"[%@]", [url host]] : [url host];
+    NSString *authority = [url port] ? [NSString stringWithFormat:@"%@:%@", host, [url port]] : host;
+    
+    NSMutableArray *mutableHeaderFields = [NSMutableArray arrayWithObjects:[NSArray arrayWithObjects:@":method", method, nil], [NSArray arrayWithObjects:@":scheme", [[url scheme] lowercaseString], nil], [NSArray arrayWithObjects:@":authority", authority, nil], [NSArray arrayWithObjects:@":path", path, nil], nil];
+    
+    NSMutableDictionary *mutableRequestHeaderFields = [NSMutableDictionary dictionaryWithDictionary:[request allHTTPHeaderFields]];
+    if ([request HTTPShouldHandleCookies]) {
+        NSArray *cookies = [[NSHTTPCookieStorage sharedHTTPCookieStorage] cookiesForURL:url];
+        [mutableRequestHeaderFields addEntriesFromDictionary:[NSHTTPCookie requestHeaderFieldsWithCookies:cookies]];
+    }
+    
+    // Connection-specific fields are not allowed in HTTP/2; see http://tools.ietf.org/html/rfc7540#section-8.1.2.2
+    static NSSet *_excludedFieldNames = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _excludedFieldNames = [[NSSet alloc] initWithObjects:@"connection", @"keep-alive", @"proxy-connection", @"transfer-encoding", @"upgrade", @"te", @"host", @"content-length", nil];
+    });
+    
+    for (NSString *field in mutableRequestHeaderFields) {
+        NSString *name = [field lowercaseString];
+        if ([_excludedFieldNames containsObject:name]) {
+            continue;
+        }
+        
+        NSString *value = [mutableRequestHeaderFields objectForKey:field];
+        
+        // Cookies are sent as separate fields, so that each one can be indexed on its own; see http://tools.ietf.org/html/rfc7540#section-8.1.2.5
+        if ([name isEqualToString:@"cookie"]) {
+            for (NSString *cookie in [value componentsSeparatedByString:@"; "]) {
+                [mutableHeaderFields addObject:[NSArray arrayWithObjects:name, cookie, nil]];
+            }
+        } else {
+            [mutableHeaderFields addObject:[NSArray arrayWithObjects:name, value, nil]];
+        }
+    }
+    
+    // Encoded bodies are delivered as they were received, for the operation to decode
+    if (![request valueForHTTPHeaderField:@"Accept-Encoding"]) {
+        [mutableHeaderFields addObject:[NSArray arrayWithObjects:@"accept-encoding", @"identity", nil]];
+    }
+    
+    // The length of a body stream is only known from the request's own header, and is otherwise left to the END_STREAM flag of its last frame
+    NSData *body = [request HTTPBody];
+    if ([request HTTPBodyStream]) {
+        NSString *contentLength = [request valueForHTTPHeaderField:@"Content-Length"];
+        if (contentLength) {
+            [mutableHeaderFields addObject:[NSArray arrayWithObjects:@"content-length", contentLength, nil]];
+        }
+    } else if (body || [method isEqualToString:@"POST"] || [method isEqualToString:@"PUT"]) {
+        [mutableHeaderFields addObject:[NSArray arrayWithObjects:@"content-length", [NSString stringWithFormat:@"%lu", (unsigned long)[body length]], nil]];
+    }
+    
+    return mutableHeaderFields;
+}
+
+// Field names are lowercase in HTTP/2, and are given their conventional capitalization for `allHeaderFields`
+static NSString * AFHTTP2CanonicalFieldName(NSString *name) {
+    NSMutableArray *mutableComponents = [NSMutableArray array];
+    for (NSString *component in [name componentsSeparatedByString:@"-"]) {
+        if ([component length] > 0) {
+            [mutableComponents addObject:[[[component substringToIndex:1] uppercaseString] stringByAppendingString:[component substringFromIndex:1]]];
+        } else {
+            [mutableComponents addObject:component];
+        }
+    }
+    
+    return [mutableComponents componentsJoinedByString:@"-"];
+}
+
+static NSError * AFHTTP2ErrorWithCode(NSInteger code, NSURL *url, NSString *description, NSError *underlyingError) {
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+    [userInfo setValue:url forKey:NSURLErrorFailingURLErrorKey];
+    [userInfo setValue:description forKey:NSLocalizedDescriptionKey];
+    [userInfo setValue:underlyingError forKey:NSUnderlyingErrorKey];
+    
+    return [[[NSError alloc] initWithDomain:NSURLErrorDomain code:code userInfo:userInfo] autorelease];
+}
+
+#pragma mark -
+
+@class AFHTTP2Connection;
+@class AFHTTP2Stream;
+
+typedef void (^AFHTTP2StreamEventBlock)(id <AFHTTPTransportConnectionDelegate> delegate);
+
+@interface AFHTTP2Transport ()
+@property (readwrite, nonatomic, retain) NSMutableDictionary *connectionsByKey;
+@property (readwrite, nonatomic, retain) NSMutableSet *drainingConnections;
+@property (readwrite, nonatomic, retain) NSMutableSet *HTTP1HostKeys;
+@property (readwrite, nonatomic, assign) NSUInteger openedConnectionCount;
+@property (readwrite, nonatomic, assign) NSUInteger openedStreamCount;
+@property (readwrite, nonatomic, assign) unsigned long long encodedHeaderByteCount;
+@property (readwrite, nonatomic, assign) unsigned long long unencodedHeaderByteCount;
+
++ (void)networkThreadEntryPoint:(id)object;
++ (NSThread *)networkThread;
+- (void)closeIdleConnectionsOnNetworkThread;
+- (void)prewarmConnectionToURLOnNetworkThread:(NSURL *)url;
+- (void)openStream:(AFHTTP2Stream *)stream;
+- (void)connectionDidClose:(AFHTTP2Connection *)connection;
+- (void)connection:(AFHTTP2Connection *)connection 
+    didReturnStreams:(NSArray *)streams 
+    supportsHTTP2:(BOOL)supportsHTTP2;
+@end
+
+#pragma mark -
+
+@interface AFHTTP2Stream : NSObject <AFHTTPTransportConnection, NSStreamDelegate> {
+@private
+    AFHTTP2Transport *_transport;
+    NSURLRequest *_request;
+    NSUInteger _weight;
+    
+    // Accessed on any thread, while synchronized
+    id <AFHTTPTransportConnectionDelegate> _delegate;
+    NSRunLoop *_runLoop;
+    NSMutableSet *_runLoopModes;
+    NSMutableArray *_pendingEvents;
+    BOOL _deliveryScheduled;
+    BOOL _cancelled;
+    id <AFHTTPTransportConnection> _fallbackConnection;
+    
+    // Accessed on the network thread of the transport only
+    AFHTTP2Connection *_connection;
+    uint32_t _streamID;
+    int64_t _sendWindow;
+    int64_t _receiveWindow;
+    uint32_t _unacknowledgedLength;
+    NSUInteger _requestBodyOffset;
+    NSInputStream *_requestBodyStream;
+    BOOL _requestBodyStreamUsed;
+    BOOL _sentRequestBodyEnd;
+    BOOL _receivedResponse;
+    BOOL _retriedAfterRefusal;
+    CFAbsoluteTime _lastActivityTime;
+}
+
+@property (readonly, nonatomic, retain) AFHTTP2Transport *transport;
+@property (readonly, nonatomic, retain) NSURLRequest *request;
+@property (readonly, nonatomic, assign) NSUInteger weight;
+@property (readwrite, nonatomic, retain) id <AFHTTPTransportConnectionDelegate> delegate;
+@property (readwrite, nonatomic, retain) NSRunLoop *runLoop;
+@property (readwrite, nonatomic, retain) NSMutableSet *runLoopModes;
+@property (readwrite, nonatomic, retain) NSMutableArray *pendingEvents;
+@property (readwrite, nonatomic, retain) id <AFHTTPTransportConnection> fallbackConnection;
+
+@property (readwrite, nonatomic, assign) AFHTTP2Connection *connection;
+@property (readwrite, nonatomic, assign) uint32_t streamID;
+@property (readwrite, nonatomic, assign) int64_t sendWindow;
+@property (readwrite, nonatomic, assign) int64_t receiveWindow;
+@property (readwrite, nonatomic, assign) uint32_t unacknowledgedLength;
+@property (readwrite, nonatomic, assign) NSUInteger requestBodyOffset;
+@property (readwrite, nonatomic, retain) NSInputStream *requestBodyStream;
+@property (readwrite, nonatomic, assign) BOOL requestBodyStreamUsed;
+@property (readwrite, nonatomic, assign) BOOL sentRequestBodyEnd;
+@property (readwrite, nonatomic, assign) BOOL receivedResponse;
+@property (readwrite, nonatomic, assign) BOOL retriedAfterRefusal;
+@property (readwrite, nonatomic, assign) CFAbsoluteTime lastActivityTime;
+
+- (id)initWithRequest:(NSURLRequest *)request 
+            transport:(AFHTTP2Transport *)transport 
+             delegate:(id <AFHTTPTransportConnectionDelegate>)delegate;
+
+- (BOOL)isCancelled;
+- (BOOL)isPaused;
+- (BOOL)hasRequestBodyToSend;
+- (BOOL)openRequestBodyStream;
+- (void)closeRequestBodyStream;
+
+- (void)enqueueEvent:(AFHTTP2StreamEventBlock)block;
+- (void)scheduleDelivery;
+- (void)deliverPendingEvents;
+
+- (void)didReceiveResponse:(NSHTTPURLResponse *)response;
+- (void)didReceiveData:(NSData *)data;
+- (void)didSendBodyDataOfLength:(NSUInteger)length;
+- (void)didFinishLoading;
+- (void)didFailWithError:(NSError *)error;
+- (void)fallBack;
+- (void)acknowledgeDataOfLength:(NSNumber *)length;
+- (void)openOnNetworkThread;
+- (void)cancelOnNetworkThread;
+@end
+
+#pragma mark -
+
+@interface AFHTTP2Connection : NSObject <NSStreamDelegate> {
+@private
+    AFHTTP2Transport *_transport;
+    NSURL *_URL;
+    NSString *_key;
+    NSInputStream *_inputStream;
+    NSOutputStream *_outputStream;
+    NSTimer *_timer;
+    
+    AFHPACKEncoder *_encoder;
+    AFHPACKDecoder *_decoder;
+    NSMutableData *_outputBuffer;
+    NSMutableData *_inputBuffer;
+    uint8_t *_readBuffer;
+    uint8_t *_requestBodyBuffer;
+    
+    NSMutableDictionary *_streamsByID;
+    NSMutableArray *_waitingStreams;
+    uint32_t _nextStreamID;
+    
+    uint32_t _maximumConcurrentStreams;
+    int64_t _initialSendWindow;
+    uint32_t _maximumFrameSize;
+    int64_t _sendWindow;
+    uint32_t _streamWindowSize;
+    uint32_t _connectionWindowSize;
+    uint32_t _receivedLengthSinceWindowUpdate;
+    
+    NSMutableData *_headerBlock;
+    uint32_t _headerBlockStreamID;
+    BOOL _headerBlockEndsStream;
+    
+    BOOL _opened;
+    BOOL _receivedSettings;
+    BOOL _goingAway;
+    BOOL _closed;
+    CFAbsoluteTime _idleTime;
+}
+
+@property (readonly, nonatomic, retain) NSURL *URL;
+@property (readonly, nonatomic, copy) NSString *key;
+@property (readwrite, nonatomic, retain) NSInputStream *inputStream;
+@property (readwrite, nonatomic, retain) NSOutputStream *outputStream;
+@property (readwrite, nonatomic, retain) NSTimer *timer;
+@property (readwrite, nonatomic, retain) AFHPACKEncoder *encoder;
+@property (readwrite, nonatomic, retain) AFHPACKDecoder *decoder;
+@property (readwrite, nonatomic, retain) NSMutableData *outputBuffer;
+@property (readwrite, nonatomic, retain) NSMutableData *inputBuffer;
+@property (readwrite, nonatomic, retain) NSMutableDictionary *streamsByID;
+@property (readwrite, nonatomic, retain) NSMutableArray *waitingStreams;
+@property (readwrite, nonatomic, retain) NSMutableData *headerBlock;
+@property (readonly, nonatomic, assign, getter = isGoingAway) BOOL goingAway;
+
+- (id)initWithURL:(NSURL *)url 
+        transport:(AFHTTP2Transport *)transport;
+
+- (BOOL)isIdle;
+- (void)openStream:(AFHTTP2Stream *)stream;
+- (void)resetStream:(AFHTTP2Stream *)stream 
+          errorCode:(AFHTTP2ErrorCode)errorCode;
+- (void)acknowledgeDataOfLength:(uint32_t)length 
+                      forStream:(AFHTTP2Stream *)stream;
+- (void)closeWithErrorCode:(AFHTTP2ErrorCode)errorCode;
+
+- (void)openWaitingStreams;
+- (void)finishStream:(AFHTTP2Stream *)stream;
+- (void)failStream:(AFHTTP2Stream *)stream 
+     withErrorCode:(AFHTTP2ErrorCode)errorCode;
+- (void)failStreamsWithCode:(NSInteger)code 
+                description:(NSString *)description 
+            underlyingError:(NSError *)underlyingError;
+- (void)invalidate;
+- (void)sendHeadersForStream:(AFHTTP2Stream *)stream;
+- (void)sendRequestBodies;
+- (void)sendRequestBodyStreamOfStream:(AFHTTP2Stream *)stream;
+- (void)removeStream:(AFHTTP2Stream *)stream;
+- (void)sendWindowUpdateForStreamID:(uint32_t)streamID 
+                          increment:(uint32_t)increment;
+- (void)flushOutputBuffer;
+
+- (void)readAvailableBytes;
+- (BOOL)processFrameOfType:(uint8_t)type 
+                     flags:(uint8_t)flags 
+                  streamID:(uint32_t)streamID 
+                   payload:(const uint8_t *)payload 
+                    length:(uint32_t)length;
+- (BOOL)processHeaderBlock;
+- (BOOL)processSettings:(const uint8_t *)payload 
+                 length:(uint32_t)length;
+- (void)goAwayWithLastStreamID:(uint32_t)lastStreamID;
+- (void)didFailToNegotiateHTTP2;
+- (void)didCloseWithStreamError:(NSError *)streamError;
+- (void)timerDidFire:(NSTimer *)timer;
+@end
+
+#pragma mark -
+
+@implementation AFHTTP2Stream
+@synthesize transport = _transport;
+@synthesize request = _request;
+@synthesize weight = _weight;
+@synthesize delegate = _delegate;
+@synthesize runLoop = _runLoop;
+@synthesize runLoopModes = _runLoopModes;
+@synthesize pendingEvents = _pendingEvents;
+@synthesize fallbackConnection = _fallbackConnection;
+@synthesize connection = _connection;
+@synthesize streamID = _streamID;
+@synthesize sendWindow = _sendWindow;
+@synthesize receiveWindow = _receiveWindow;
+@synthesize unacknowledgedLength = _unacknowledgedLength;
+@synthesize requestBodyOffset = _requestBodyOffset;
+@synthesize requestBodyStream = _requestBodyStream;
+@synthesize requestBodyStreamUsed = _requestBodyStreamUsed;
+@synthesize sentRequestBodyEnd = _sentRequestBodyEnd;
+@synthesize receivedResponse = _receivedResponse;
+@synthesize retriedAfterRefusal = _retriedAfterRefusal;
+@synthesize lastActivityTime = _lastActivityTime;
+
+- (id)initWithRequest:(NSURLRequest *)request 
+            transport:(AFHTTP2Transport *)transport 
+             delegate:(id <AFHTTPTransportConnectionDelegate>)delegate
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _request = [request retain];
+    _transport = [transport retain];
+    
+    NSOperationQueuePriority queuePriority = [(NSObject *)delegate isKindOfClass:[NSOperation class]] ? [(NSOperation *)delegate queuePriority] : NSOperationQueuePriorityNormal;
+    _weight = AFHTTP2WeightForQueuePriority(queuePriority);
+    
+    self.delegate = delegate;
+    self.runLoopModes = [NSMutableSet set];
+    self.pendingEvents = [NSMutableArray array];
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_transport release];
+    [_request release];
+    [_delegate release];
+    [_runLoop release];
+    [_runLoopModes release];
+    [_pendingEvents release];
+    [_fallbackConnection release];
+    [_requestBodyStream setDelegate:nil];
+    [_requestBodyStream release];
+    [super dealloc];
+}
+
+- (BOOL)isCancelled {
+    BOOL isCancelled = NO;
+    @synchronized(self) {
+        isCancelled = _cancelled;
+    }
+    
+    return isCancelled;
+}
+
+- (BOOL)isPaused {
+    BOOL isPaused = NO;
+    @synchronized(self) {
+        isPaused = [self.runLoopModes count] == 0;
+    }
+    
+    return isPaused;
+}
+
+- (BOOL)hasRequestBodyToSend {
+    if ([self.request HTTPBodyStream]) {
+        return !self.sentRequestBodyEnd;
+    }
+    
+    return self.requestBodyOffset < [[self.request HTTPBody] length];
+}
+
+// A stream leaves its connection when it finishes, fails, or is returned to the transport, and stops reading its body stream then
+- (void)setConnection:(AFHTTP2Connection *)connection {
+    if (!connection) {
+        [self closeRequestBodyStream];
+    }
+    
+    _connection = connection;
+}
+
+// The body stream of the request is read on the network thread, from the start each time the request is sent. The request's own stream can only be read once, so later attempts read a new stream made by `AFHTTPBodyStreamForResendingRequest`.
+- (BOOL)openRequestBodyStream {
+    [self closeRequestBodyStream];
+    
+    NSInputStream *inputStream = nil;
+    if (!self.requestBodyStreamUsed) {
+        inputStream = [self.request HTTPBodyStream];
+        self.requestBodyStreamUsed = YES;
+    } else {
+        inputStream = AFHTTPBodyStreamForResendingRequest(self.request);
+    }
+    
+    if (!inputStream) {
+        return NO;
+    }
+    
+    self.requestBodyStream = inputStream;
+    self.sentRequestBodyEnd = NO;
+    [inputStream setDelegate:self];
+    [inputStream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    [inputStream open];
+    
+    return YES;
+}
+
+- (void)closeRequestBodyStream {
+    if (!self.requestBodyStream) {
+        return;
+    }
+    
+    [self.requestBodyStream setDelegate:nil];
+    [self.requestBodyStream removeFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    [self.requestBodyStream close];
+    self.requestBodyStream = nil;
+}
+
+#pragma mark - AFHTTPTransportConnection
+
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop 
+                  forMode:(NSString *)mode
+{
+    id <AFHTTPTransportConnection> fallbackConnection = nil;
+    @synchronized(self) {
+        self.runLoop = runLoop;
+        [self.runLoopModes addObject:mode];
+        fallbackConnection = [[self.fallbackConnection retain] autorelease];
+    }
+    
+    [fallbackConnection scheduleInRunLoop:runLoop forMode:mode];
+    [self scheduleDelivery];
+}
+
+- (void)unscheduleFromRunLoop:(NSRunLoop *)runLoop 
+                      forMode:(NSString *)mode
+{
+    id <AFHTTPTransportConnection> fallbackConnection = nil;
+    @synchronized(self) {
+        [self.runLoopModes removeObject:mode];
+        fallbackConnection = [[self.fallbackConnection retain] autorelease];
+    }
+    
+    [fallbackConnection unscheduleFromRunLoop:runLoop forMode:mode];
+}
+
+- (void)start {
+    [self performSelector:@selector(openOnNetworkThread) onThread:[AFHTTP2Transport networkThread] withObject:nil waitUntilDone:NO];
+}
+
+- (void)cancel {
+    id <AFHTTPTransportConnection> fallbackConnection = nil;
+    @synchronized(self) {
+        _cancelled = YES;
+        [self.pendingEvents removeAllObjects];
+        self.delegate = nil;
+        fallbackConnection = [[self.fallbackConnection retain] autorelease];
+    }
+    
+    [fallbackConnection cancel];
+    [self performSelector:@selector(cancelOnNetworkThread) onThread:[AFHTTP2Transport networkThread] withObject:nil waitUntilDone:NO];
+}
+
+#pragma mark - Delivering Events
+
+// Events are produced on the network thread of the transport, and queued until they can be delivered on the run loop of the delegate. While the delegate is unscheduled from every run loop mode, events stay queued, and the data they hold is not acknowledged to the server.
+- (void)enqueueEvent:(AFHTTP2StreamEventBlock)block {
+    @synchronized(self) {
+        if (!_cancelled && self.delegate) {
+            [self.pendingEvents addObject:[[block copy] autorelease]];
+        }
+    }
+    
+    [self scheduleDelivery];
+}
+
+- (void)scheduleDelivery {
+    NSRunLoop *runLoop = nil;
+    NSArray *runLoopModes = nil;
+    @synchronized(self) {
+        if (!_deliveryScheduled && [self.pendingEvents count] > 0 && [self.runLoopModes count] > 0 && self.runLoop) {
+            _deliveryScheduled = YES;
+            runLoop = [[self.runLoop retain] autorelease];
+            runLoopModes = [self.runLoopModes allObjects];
+        }
+    }
+    
+    if (!runLoop) {
+        return;
+    }
+    
+    CFRunLoopRef runLoopRef = [runLoop getCFRunLoop];
+    CFRunLoopPerformBlock(runLoopRef, (CFArrayRef)runLoopModes, ^{
+        [self deliverPendingEvents];
+    });
+    CFRunLoopWakeUp(runLoopRef);
+}
+
+- (void)deliverPendingEvents {
+    BOOL isDelivering = YES;
+    while (isDelivering) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        
+        AFHTTP2StreamEventBlock block = nil;
+        id <AFHTTPTransportConnectionDelegate> delegate = nil;
+        @synchronized(self) {
+            if (!_cancelled && [self.runLoopModes count] > 0 && [self.pendingEvents count] > 0) {
+                block = [[[self.pendingEvents objectAtIndex:0] retain] autorelease];
+                [self.pendingEvents removeObjectAtIndex:0];
+                delegate = [[self.delegate retain] autorelease];
+            } else {
+                _deliveryScheduled = NO;
+                isDelivering = NO;
+            }
+        }
+        
+        if (block) {
+            block(delegate);
+        }
+        
+        [pool drain];
+    }
+}
+
+- (void)didReceiveResponse:(NSHTTPURLResponse *)response {
+    [self enqueueEvent:^(id <AFHTTPTransportConnectionDelegate> delegate) {
+        [delegate transportConnection:self didReceiveResponse:response];
+    }];
+}
+
+- (void)didReceiveData:(NSData *)data {
+    NSNumber *length = [NSNumber numberWithUnsignedInteger:[data length]];
+    [self enqueueEvent:^(id <AFHTTPTransportConnectionDelegate> delegate) {
+        [delegate transportConnection:self didReceiveData:data];
+        [self performSelector:@selector(acknowledgeDataOfLength:) onThread:[AFHTTP2Transport networkThread] withObject:length waitUntilDone:NO];
+    }];
+}
+
+- (void)didSendBodyDataOfLength:(NSUInteger)length {
+    NSInteger totalBytesWritten = self.requestBodyOffset;
+    NSInteger totalBytesExpectedToWrite = [[self.request HTTPBody] length];
+    if ([self.request HTTPBodyStream]) {
+        NSString *contentLength = [self.request valueForHTTPHeaderField:@"Content-Length"];
+        totalBytesExpectedToWrite = contentLength ? [contentLength integerValue] : NSURLResponseUnknownLength;
+    }
+    [self enqueueEvent:^(id <AFHTTPTransportConnectionDelegate> delegate) {
+        [delegate transportConnection:self didSendBodyData:length totalBytesWritten:totalBytesWritten totalBytesExpectedToWrite:totalBytesExpectedToWrite];
+    }];
+}
+
+- (void)didFinishLoading {
+    [self enqueueEvent:^(id <AFHTTPTransportConnectionDelegate> delegate) {
+        @synchronized(self) {
+            self.delegate = nil;
+        }
+        
+        [delegate transportConnectionDidFinishLoading:self];
+    }];
+}
+
+- (void)didFailWithError:(NSError *)error {
+    [self enqueueEvent:^(id <AFHTTPTransportConnectionDelegate> delegate) {
+        @synchronized(self) {
+            self.delegate = nil;
+        }
+        
+        [delegate transportConnection:self didFailWithError:error];
+    }];
+}
+
+// Hands the request over to a connection of the fallback transport, scheduled in the same run loop modes, from then on
+- (void)fallBack {
+    // A body stream that has already been read from is replaced with a new one, read from the start
+    NSURLRequest *request = self.request;
+    if (self.requestBodyStreamUsed) {
+        NSInputStream *bodyStream = AFHTTPBodyStreamForResendingRequest(request);
+        if (!bodyStream) {
+            [self didFailWithError:AFHTTP2ErrorWithCode(NSURLErrorRequestBodyStreamExhausted, [request URL], nil, nil)];
+            return;
+        }
+        
+        NSMutableURLRequest *mutableRequest = [[request mutableCopy] autorelease];
+        [mutableRequest setHTTPBodyStream:bodyStream];
+        request = mutableRequest;
+    }
+    
+    [self enqueueEvent:^(id <AFHTTPTransportConnectionDelegate> delegate) {
+        id <AFHTTPTransportConnection> fallbackConnection = [self.transport.fallbackTransport connectionWithRequest:request delegate:delegate];
+        
+        NSRunLoop *runLoop = nil;
+        NSArray *runLoopModes = nil;
+        @synchronized(self) {
+            self.fallbackConnection = fallbackConnection;
+            self.delegate = nil;
+            runLoop = [[self.runLoop retain] autorelease];
+            runLoopModes = [self.runLoopModes allObjects];
+        }
+        
+        for (NSString *runLoopMode in runLoopModes) {
+            [fallbackConnection scheduleInRunLoop:runLoop forMode:runLoopMode];
+        }
+        
+        [fallbackConnection start];
+    }];
+}
+
+#pragma mark - Network Thread
+
+- (void)openOnNetworkThread {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    if (![self isCancelled]) {
+        self.lastActivityTime = CFAbsoluteTimeGetCurrent();
+        [self.transport openStream:self];
+    }
+    [pool drain];
+}
+
+- (void)cancelOnNetworkThread {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    [self.connection resetStream:self errorCode:AFHTTP2CancelError];
+    [pool drain];
+}
+
+- (void)acknowledgeDataOfLength:(NSNumber *)length {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    self.lastActivityTime = CFAbsoluteTimeGetCurrent();
+    [self.connection acknowledgeDataOfLength:[length unsignedIntValue] forStream:self];
+    [pool drain];
+}
+
+#pragma mark - NSStreamDelegate
+
+// Events of the request body stream are received on the network thread, where it is scheduled
+- (void)stream:(NSStream *)stream 
+   handleEvent:(NSStreamEvent)eventCode
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    [[self retain] autorelease];
+    
+    AFHTTP2Connection *connection = self.connection;
+    if (stream == self.requestBodyStream && connection) {
+        switch (eventCode) {
+            case NSStreamEventHasBytesAvailable:
+            case NSStreamEventEndEncountered:
+                [connection sendRequestBodies];
+                [connection flushOutputBuffer];
+                break;
+            case NSStreamEventErrorOccurred: {
+                NSError *error = [stream streamError] ?: AFHTTP2ErrorWithCode(NSURLErrorUnknown, [self.request URL], nil, nil);
+                [connection resetStream:self errorCode:AFHTTP2CancelError];
+                [self didFailWithError:error];
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    
+    [pool drain];
+}
+
+@end
+
+#pragma mark -
+
+static void AFHTTP2AppendSetting(NSMutableData *data, uint16_t identifier, uint32_t value) {
+    uint8_t bytes[2] = {(uint8_t)(identifier >> 8), (uint8_t)identifier};
+    [data appendBytes:bytes length:2];
+    AFHTTP2AppendUInt32(data, value);
+}
+
+@implementation AFHTTP2Connection
+@synthesize URL = _URL;
+@synthesize key = _key;
+@synthesize inputStream = _inputStream;
+@synthesize outputStream = _outputStream;
+@synthesize timer = _timer;
+@synthesize encoder = _encoder;
+@synthesize decoder = _decoder;
+@synthesize outputBuffer = _outputBuffer;
+@synthesize inputBuffer = _inputBuffer;
+@synthesize streamsByID = _streamsByID;
+@synthesize waitingStreams = _waitingStreams;
+@synthesize headerBlock = _headerBlock;
+@synthesize goingAway = _goingAway;
+
+- (id)initWithURL:(NSURL *)url 
+        transport:(AFHTTP2Transport *)transport
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    // The transport owns its connections
+    _transport = transport;
+    _URL = [url retain];
+    _key = [AFHTTP2ConnectionKeyForURL(url) copy];
+    
+    self.encoder = [[[AFHPACKEncoder alloc] init] autorelease];
+    self.decoder = [[[AFHPACKDecoder alloc] init] autorelease];
+    self.outputBuffer = [NSMutableData data];
+    self.inputBuffer = [NSMutableData data];
+    _readBuffer = malloc(kAFHTTP2ReadBufferLength);
+    _requestBodyBuffer = malloc(kAFHTTP2DefaultMaximumFrameSize);
+    
+    self.streamsByID = [NSMutableDictionary dictionary];
+    self.waitingStreams = [NSMutableArray array];
+    _nextStreamID = 1;
+    
+    _maximumConcurrentStreams = UINT32_MAX;
+    _initialSendWindow = kAFHTTP2DefaultWindowSize;
+    _maximumFrameSize = kAFHTTP2DefaultMaximumFrameSize;
+    _sendWindow = kAFHTTP2DefaultWindowSize;
+    _streamWindowSize = MIN(MAX(transport.initialStreamWindowSize, kAFHTTP2DefaultWindowSize), kAFHTTP2MaximumWindowSize);
+    _connectionWindowSize = MIN(MAX(transport.connectionWindowSize, kAFHTTP2DefaultWindowSize), kAFHTTP2MaximumWindowSize);
+    _idleTime = CFAbsoluteTimeGetCurrent();
+    
+    CFReadStreamRef readStream = NULL;
+    CFWriteStreamRef writeStream = NULL;
+    CFStreamCreatePairWithSocketToHost(kCFAllocatorDefault, (CFStringRef)[url host], ([url port] ? [[url port] unsignedIntValue] : 80), &readStream, &writeStream);
+    self.inputStream = [(NSInputStream *)readStream autorelease];
+    self.outputStream = [(NSOutputStream *)writeStream autorelease];
+    
+    for (NSStream *stream in [NSArray arrayWithObjects:self.inputStream, self.outputStream, nil]) {
+        [stream setDelegate:self];
+        [stream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+        [stream open];
+    }
+    
+    // The connection preface may be sent without waiting for the server's; see http://tools.ietf.org/html/rfc7540#section-3.5
+    [self.outputBuffer appendBytes:kAFHTTP2ConnectionPreface length:strlen(kAFHTTP2ConnectionPreface)];
+    
+    NSMutableData *mutableSettings = [NSMutableData data];
+    AFHTTP2AppendSetting(mutableSettings, AFHTTP2EnablePushSetting, 0);
+    AFHTTP2AppendSetting(mutableSettings, AFHTTP2InitialWindowSizeSetting, _streamWindowSize);
+    AFHTTP2AppendFrameHeader(self.outputBuffer, (uint32_t)[mutableSettings length], AFHTTP2SettingsFrameType, 0, 0);
+    [self.outputBuffer appendData:mutableSettings];
+    
+    if (_connectionWindowSize > kAFHTTP2DefaultWindowSize) {
+        [self sendWindowUpdateForStreamID:0 increment:(_connectionWindowSize - kAFHTTP2DefaultWindowSize)];
+    }
+    
+    self.timer = [NSTimer timerWithTimeInterval:1.0 target:self selector:@selector(timerDidFire:) userInfo:nil repeats:YES];
+    [[NSRunLoop currentRunLoop] addTimer:self.timer forMode:NSDefaultRunLoopMode];
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_timer invalidate];
+    [_timer release];
+    [_inputStream setDelegate:nil];
+    [_inputStream close];
+    [_inputStream release];
+    [_outputStream setDelegate:nil];
+    [_outputStream close];
+    [_outputStream release];
+    
+    [_URL release];
+    [_key release];
+    [_encoder release];
+    [_decoder release];
+    [_outputBuffer release];
+    [_inputBuffer release];
+    [_streamsByID release];
+    [_waitingStreams release];
+    [_headerBlock release];
+    
+    free(_readBuffer);
+    free(_requestBodyBuffer);
+    
+    [super dealloc];
+}
+
+- (BOOL)isIdle {
+    return [self.streamsByID count] == 0 && [self.waitingStreams count] == 0;
+}
+
+#pragma mark - Streams
+
+- (void)openStream:(AFHTTP2Stream *)stream {
+    stream.connection = self;
+    [self.waitingStreams addObject:stream];
+    
+    [self openWaitingStreams];
+}
+
+// Waiting streams are opened from the highest weight to the lowest, as the server's limit on concurrent streams allows
+- (void)openWaitingStreams {
+    NSUInteger maximumConcurrentStreams = MIN((NSUInteger)_maximumConcurrentStreams, _transport.maximumConcurrentStreamsPerConnection);
+    while (!_goingAway && !_closed && [self.waitingStreams count] > 0 && [self.streamsByID count] < maximumConcurrentStreams) {
+        if (_nextStreamID > kAFHTTP2MaximumWindowSize) {
+            [self goAwayWithLastStreamID:kAFHTTP2MaximumWindowSize];
+            return;
+        }
+        
+        AFHTTP2Stream *stream = [self.waitingStreams objectAtIndex:0];
+        for (AFHTTP2Stream *waitingStream in self.waitingStreams) {
+            if (waitingStream.weight > stream.weight) {
+                stream = waitingStream;
+            }
+        }
+        
+        [[stream retain] autorelease];
+        [self.waitingStreams removeObjectIdenticalTo:stream];
+        [self sendHeadersForStream:stream];
+    }
+    
+    [self sendRequestBodies];
+    [self flushOutputBuffer];
+}
+
+- (void)sendHeadersForStream:(AFHTTP2Stream *)stream {
+    if ([stream.request HTTPBodyStream] && ![stream openRequestBodyStream]) {
+        stream.connection = nil;
+        [stream didFailWithError:AFHTTP2ErrorWithCode(NSURLErrorRequestBodyStreamExhausted, [stream.request URL], nil, nil)];
+        return;
+    }
+    
+    stream.streamID = _nextStreamID;
+    _nextStreamID += 2;
+    
+    stream.sendWindow = _initialSendWindow;
+    stream.receiveWindow = _streamWindowSize;
+    stream.unacknowledgedLength = 0;
+    stream.requestBodyOffset = 0;
+    stream.receivedResponse = NO;
+    stream.lastActivityTime = CFAbsoluteTimeGetCurrent();
+    [self.streamsByID setObject:stream forKey:[NSNumber numberWithUnsignedInt:stream.streamID]];
+    
+    NSArray *headerFields = AFHTTP2HeaderFieldsForRequest(stream.request);
+    NSData *headerBlock = [self.encoder dataByEncodingHeaderFields:headerFields];
+    
+    // Each field would take its name and value, a separator, and a line break in HTTP/1.1
+    unsigned long long unencodedLength = 0;
+    for (NSArray *headerField in headerFields) {
+        unencodedLength += [[headerField objectAtIndex:0] length] + [[headerField objectAtIndex:1] length] + 4;
+    }
+    
+    _transport.openedStreamCount++;
+    _transport.encodedHeaderByteCount += [headerBlock length];
+    _transport.unencodedHeaderByteCount += unencodedLength;
+    
+    // The first fragment also carries the weight of the stream, which depends on no other stream
+    NSUInteger length = [headerBlock length];
+    NSUInteger fragmentLength = MIN(length, _maximumFrameSize - 5);
+    uint8_t flags = AFHTTP2PriorityFlag | ([stream hasRequestBodyToSend] ? 0 : AFHTTP2EndStreamFlag) | (fragmentLength == length ? AFHTTP2EndHeadersFlag : 0);
+    AFHTTP2AppendFrameHeader(self.outputBuffer, (uint32_t)(fragmentLength + 5), AFHTTP2HeadersFrameType, flags, stream.streamID);
+    AFHTTP2AppendUInt32(self.outputBuffer, 0);
+    uint8_t weight = (uint8_t)(stream.weight - 1);
+    [self.outputBuffer appendBytes:&weight length:1];
+    [self.outputBuffer appendBytes:[headerBlock bytes] length:fragmentLength];
+    
+    for (NSUInteger offset = fragmentLength; offset < length; offset += fragmentLength) {
+        fragmentLength = MIN(length - offset, _maximumFrameSize);
+        AFHTTP2AppendFrameHeader(self.outputBuffer, (uint32_t)fragmentLength, AFHTTP2ContinuationFrameType, (offset + fragmentLength == length ? AFHTTP2EndHeadersFlag : 0), stream.streamID);
+        [self.outputBuffer appendBytes:((const uint8_t *)[headerBlock bytes] + offset) length:fragmentLength];
+    }
+}
+
+// Request bodies are sent as far as flow control allows, from the stream with the highest weight to the lowest
+- (void)sendRequestBodies {
+    NSArray *streams = [[self.streamsByID allValues] sortedArrayUsingComparator:^NSComparisonResult(id obj1, id obj2) {
+        return [[NSNumber numberWithUnsignedInteger:[(AFHTTP2Stream *)obj2 weight]] compare:[NSNumber numberWithUnsignedInteger:[(AFHTTP2Stream *)obj1 weight]]];
+    }];
+    
+    for (AFHTTP2Stream *stream in streams) {
+        if ([stream.request HTTPBodyStream]) {
+            [self sendRequestBodyStreamOfStream:stream];
+            continue;
+        }
+        
+        NSData *body = [stream.request HTTPBody];
+        while ([stream hasRequestBodyToSend] && _sendWindow > 0 && stream.sendWindow > 0) {
+            int64_t length = MIN(MIN((int64_t)([body length] - stream.requestBodyOffset), (int64_t)_maximumFrameSize), MIN(_sendWindow, stream.sendWindow));
+            BOOL isLastFrame = stream.requestBodyOffset + (NSUInteger)length == [body length];
+            AFHTTP2AppendFrameHeader(self.outputBuffer, (uint32_t)length, AFHTTP2DataFrameType, (isLastFrame ? AFHTTP2EndStreamFlag : 0), stream.streamID);
+            [self.outputBuffer appendBytes:((const uint8_t *)[body bytes] + stream.requestBodyOffset) length:(NSUInteger)length];
+            
+            stream.requestBodyOffset += (NSUInteger)length;
+            stream.sendWindow -= length;
+            stream.lastActivityTime = CFAbsoluteTimeGetCurrent();
+            _sendWindow -= length;
+            
+            [stream didSendBodyDataOfLength:(NSUInteger)length];
+        }
+    }
+}
+
+// Body streams are read as flow control allows, and only while the output buffer is short, so that a slow connection holds back whatever produces the body. The end of the body is sent as an empty frame, which takes no window.
+- (void)sendRequestBodyStreamOfStream:(AFHTTP2Stream *)stream {
+    NSInputStream *inputStream = stream.requestBodyStream;
+    if (!inputStream) {
+        return;
+    }
+    
+    while (_sendWindow > 0 && stream.sendWindow > 0 && [self.outputBuffer length] < kAFHTTP2ReadBufferLength && [inputStream hasBytesAvailable]) {
+        NSUInteger maximumLength = (NSUInteger)MIN((int64_t)kAFHTTP2DefaultMaximumFrameSize, MIN(_sendWindow, stream.sendWindow));
+        NSInteger length = [inputStream read:_requestBodyBuffer maxLength:maximumLength];
+        if (length <= 0) {
+            break;
+        }
+        
+        AFHTTP2AppendFrameHeader(self.outputBuffer, (uint32_t)length, AFHTTP2DataFrameType, 0, stream.streamID);
+        [self.outputBuffer appendBytes:_requestBodyBuffer length:(NSUInteger)length];
+        
+        stream.requestBodyOffset += (NSUInteger)length;
+        stream.sendWindow -= length;
+        stream.lastActivityTime = CFAbsoluteTimeGetCurrent();
+        _sendWindow -= length;
+        
+        [stream didSendBodyDataOfLength:(NSUInteger)length];
+    }
+    
+    if ([inputStream streamStatus] == NSStreamStatusAtEnd) {
+        AFHTTP2AppendFrameHeader(self.outputBuffer, 0, AFHTTP2DataFrameType, AFHTTP2EndStreamFlag, stream.streamID);
+        stream.sentRequestBodyEnd = YES;
+        [stream closeRequestBodyStream];
+    }
+}
+
+- (void)removeStream:(AFHTTP2Stream *)stream {
+    if (stream.connection != self) {
+        return;
+    }
+    
+    stream.connection = nil;
+    [self.waitingStreams removeObjectIdenticalTo:stream];
+    
+    NSNumber *streamKey = [NSNumber numberWithUnsignedInt:stream.streamID];
+    if ([self.streamsByID objectForKey:streamKey] == stream) {
+        [self.streamsByID removeObjectForKey:streamKey];
+    }
+    
+    if ([self isIdle]) {
+        _idleTime = CFAbsoluteTimeGetCurrent();
+        
+        if (_goingAway) {
+            [self closeWithErrorCode:AFHTTP2NoError];
+            return;
+        }
+    }
+    
+    [self openWaitingStreams];
+}
+
+- (void)finishStream:(AFHTTP2Stream *)stream {
+    // A server may respond before the request body has been sent in full, in which case the rest of it is abandoned
+    if ([stream hasRequestBodyToSend]) {
+        [self resetStream:stream errorCode:AFHTTP2NoError];
+    } else {
+        [self removeStream:stream];
+    }
+    
+    [stream didFinishLoading];
+}
+
+- (void)failStream:(AFHTTP2Stream *)stream 
+     withErrorCode:(AFHTTP2ErrorCode)errorCode
+{
+    [self resetStream:stream errorCode:errorCode];
+    [stream didFailWithError:AFHTTP2ErrorWithCode(NSURLErrorBadServerResponse, [stream.request URL], [NSString stringWithFormat:NSLocalizedString(@"The HTTP/2 stream failed with error code %u", nil), (unsigned int)errorCode], nil)];
+}
+
+- (void)resetStream:(AFHTTP2Stream *)stream 
+          errorCode:(AFHTTP2ErrorCode)errorCode
+{
+    if (stream.connection != self) {
+        return;
+    }
+    
+    if ([self.streamsByID objectForKey:[NSNumber numberWithUnsignedInt:stream.streamID]] == stream && !_closed) {
+        AFHTTP2AppendFrameHeader(self.outputBuffer, 4, AFHTTP2ResetStreamFrameType, 0, stream.streamID);
+        AFHTTP2AppendUInt32(self.outputBuffer, errorCode);
+        [self flushOutputBuffer];
+    }
+    
+    [self removeStream:stream];
+}
+
+// Data is acknowledged as the delegate consumes it, in increments of half a window, so that a stream whose delegate is paused stops receiving data
+- (void)acknowledgeDataOfLength:(uint32_t)length 
+                      forStream:(AFHTTP2Stream *)stream
+{
+    if (stream.connection != self || [self.streamsByID objectForKey:[NSNumber numberWithUnsignedInt:stream.streamID]] != stream) {
+        return;
+    }
+    
+    stream.unacknowledgedLength += length;
+    if (stream.unacknowledgedLength >= _streamWindowSize / 2) {
+        [self sendWindowUpdateForStreamID:stream.streamID increment:stream.unacknowledgedLength];
+        stream.receiveWindow += stream.unacknowledgedLength;
+        stream.unacknowledgedLength = 0;
+        
+        [self flushOutputBuffer];
+    }
+}
+
+- (void)sendWindowUpdateForStreamID:(uint32_t)streamID 
+                          increment:(uint32_t)increment
+{
+    AFHTTP2AppendFrameHeader(self.outputBuffer, 4, AFHTTP2WindowUpdateFrameType, 0, streamID);
+    AFHTTP2AppendUInt32(self.outputBuffer, increment & kAFHTTP2MaximumWindowSize);
+}
+
+- (void)flushOutputBuffer {
+    while ([self.outputBuffer length] > 0 && [self.outputStream hasSpaceAvailable]) {
+        NSInteger numberOfBytesWritten = [self.outputStream write:[self.outputBuffer bytes] maxLength:[self.outputBuffer length]];
+        if (numberOfBytesWritten <= 0) {
+            break;
+        }
+        
+        [self.outputBuffer replaceBytesInRange:NSMakeRange(0, numberOfBytesWritten) withBytes:NULL length:0];
+    }
+}
+
+#pragma mark - Frames
+
+- (void)readAvailableBytes {
+    NSInteger numberOfBytesRead = [self.inputStream read:_readBuffer maxLength:kAFHTTP2ReadBufferLength];
+    if (numberOfBytesRead < 0) {
+        [self didCloseWithStreamError:[self.inputStream streamError]];
+        return;
+    } else if (numberOfBytesRead == 0) {
+        return;
+    }
+    
+    [self.inputBuffer appendBytes:_readBuffer length:numberOfBytesRead];
+    
+    const uint8_t *bytes = [self.inputBuffer bytes];
+    NSUInteger length = [self.inputBuffer length];
+    NSUInteger offset = 0;
+    while (!_closed && length - offset >= kAFHTTP2FrameHeaderLength) {
+        const uint8_t *frameHeader = bytes + offset;
+        uint32_t frameLength = ((uint32_t)frameHeader[0] << 16) | ((uint32_t)frameHeader[1] << 8) | (uint32_t)frameHeader[2];
+        uint8_t type = frameHeader[3];
+        uint8_t flags = frameHeader[4];
+        uint32_t streamID = AFHTTP2ReadUInt32(frameHeader + 5) & kAFHTTP2MaximumWindowSize;
+        
+        // The server's preface is a settings frame; a server that does not speak HTTP/2 answers with anything else, such as an HTTP/1.1 error response
+        if (!_receivedSettings && (type != AFHTTP2SettingsFrameType || (flags & AFHTTP2AckFlag))) {
+            [self didFailToNegotiateHTTP2];
+            return;
+        }
+        
+        // Frames are never larger than the default maximum, since no other is advertised
+        if (frameLength > kAFHTTP2DefaultMaximumFrameSize) {
+            [self closeWithErrorCode:AFHTTP2FrameSizeError];
+            return;
+        }
+        
+        if (length - offset < kAFHTTP2FrameHeaderLength + frameLength) {
+            break;
+        }
+        
+        if (![self processFrameOfType:type flags:flags streamID:streamID payload:(frameHeader + kAFHTTP2FrameHeaderLength) length:frameLength]) {
+            return;
+        }
+        
+        offset += kAFHTTP2FrameHeaderLength + frameLength;
+    }
+    
+    if (_closed) {
+        return;
+    }
+    
+    [self.inputBuffer replaceBytesInRange:NSMakeRange(0, offset) withBytes:NULL length:0];
+    [self flushOutputBuffer];
+}
+
+// Returns `NO` if the frame is a connection error, in which case the connection has been closed
+- (BOOL)processFrameOfType:(uint8_t)type 
+                     flags:(uint8_t)flags 
+                  streamID:(uint32_t)streamID 
+                   payload:(const uint8_t *)payload 
+                    length:(uint32_t)length
+{
+    // A header block must be followed by its continuations, with no other frames in between
+    if (self.headerBlock && (type != AFHTTP2ContinuationFrameType || streamID != _headerBlockStreamID)) {
+        [self closeWithErrorCode:AFHTTP2ProtocolError];
+        return NO;
+    }
+    
+    AFHTTP2Stream *stream = streamID ? [[[self.streamsByID objectForKey:[NSNumber numberWithUnsignedInt:streamID]] retain] autorelease] : nil;
+    stream.lastActivityTime = CFAbsoluteTimeGetCurrent();
+    
+    switch (type) {
+        case AFHTTP2DataFrameType: {
+            uint32_t paddingLength = (flags & AFHTTP2PaddedFlag) && length > 0 ? payload[0] + 1 : 0;
+            if (streamID == 0 || paddingLength > length) {
+                [self closeWithErrorCode:AFHTTP2ProtocolError];
+                return NO;
+            }
+            
+            // Flow control covers entire frames, including padding. The connection window is replenished as data is received, and the window of each stream as its delegate consumes the data.
+            _receivedLengthSinceWindowUpdate += length;
+            if (_receivedLengthSinceWindowUpdate >= _connectionWindowSize / 2) {
+                [self sendWindowUpdateForStreamID:0 increment:_receivedLengthSinceWindowUpdate];
+                _receivedLengthSinceWindowUpdate = 0;
+            }
+            
+            if (!stream) {
+                break;
+            } else if (length > stream.receiveWindow) {
+                [self failStream:stream withErrorCode:AFHTTP2FlowControlError];
+                break;
+            } else if (!stream.receivedResponse) {
+                [self failStream:stream withErrorCode:AFHTTP2ProtocolError];
+                break;
+            }
+            
+            stream.receiveWindow -= length;
+            
+            uint32_t dataLength = length - paddingLength;
+            if (dataLength > 0) {
+                [stream didReceiveData:[NSData dataWithBytes:(payload + (paddingLength > 0 ? 1 : 0)) length:dataLength]];
+            }
+            if (paddingLength > 0) {
+                [self acknowledgeDataOfLength:paddingLength forStream:stream];
+            }
+            
+            if (flags & AFHTTP2EndStreamFlag) {
+                [self finishStream:stream];
+            }
+            
+            break;
+        }
+        case AFHTTP2HeadersFrameType: {
+            NSUInteger offset = (flags & AFHTTP2PaddedFlag) ? 1 : 0;
+            NSUInteger paddingLength = (flags & AFHTTP2PaddedFlag) && length > 0 ? payload[0] : 0;
+            offset += (flags & AFHTTP2PriorityFlag) ? 5 : 0;
+            if (streamID == 0 || offset + paddingLength > length) {
+                [self closeWithErrorCode:AFHTTP2ProtocolError];
+                return NO;
+            }
+            
+            self.headerBlock = [NSMutableData dataWithBytes:(payload + offset) length:(length - offset - paddingLength)];
+            _headerBlockStreamID = streamID;
+            _headerBlockEndsStream = (flags & AFHTTP2EndStreamFlag) != 0;
+            
+            if (flags & AFHTTP2EndHeadersFlag) {
+                return [self processHeaderBlock];
+            }
+            
+            break;
+        }
+        case AFHTTP2ContinuationFrameType: {
+            if (!self.headerBlock || [self.headerBlock length] + length > kAFHTTP2MaximumHeaderBlockLength) {
+                [self closeWithErrorCode:AFHTTP2ProtocolError];
+                return NO;
+            }
+            
+            [self.headerBlock appendBytes:payload length:length];
+            
+            if (flags & AFHTTP2EndHeadersFlag) {
+                return [self processHeaderBlock];
+            }
+            
+            break;
+        }
+        case AFHTTP2ResetStreamFrameType: {
+            if (streamID == 0 || length != 4) {
+                [self closeWithErrorCode:(streamID == 0 ? AFHTTP2ProtocolError : AFHTTP2FrameSizeError)];
+                return NO;
+            } else if (!stream) {
+                break;
+            }
+            
+            // A refused stream was not processed, and is sent again
+            uint32_t errorCode = AFHTTP2ReadUInt32(payload);
+            [self removeStream:stream];
+            if (errorCode == AFHTTP2RefusedStreamError && !stream.retriedAfterRefusal) {
+                stream.retriedAfterRefusal = YES;
+                [_transport openStream:stream];
+            } else {
+                [stream didFailWithError:AFHTTP2ErrorWithCode(NSURLErrorNetworkConnectionLost, [stream.request URL], [NSString stringWithFormat:NSLocalizedString(@"The server reset the HTTP/2 stream with error code %u", nil), errorCode], nil)];
+            }
+            
+            break;
+        }
+        case AFHTTP2SettingsFrameType: {
+            if (streamID != 0) {
+                [self closeWithErrorCode:AFHTTP2ProtocolError];
+                return NO;
+            } else if ((flags & AFHTTP2AckFlag) ? length != 0 : length % 6 != 0) {
+                [self closeWithErrorCode:AFHTTP2FrameSizeError];
+                return NO;
+            } else if (flags & AFHTTP2AckFlag) {
+                break;
+            }
+            
+            if (![self processSettings:payload length:length]) {
+                return NO;
+            }
+            
+            _receivedSettings = YES;
+            AFHTTP2AppendFrameHeader(self.outputBuffer, 0, AFHTTP2SettingsFrameType, AFHTTP2AckFlag, 0);
+            [self openWaitingStreams];
+            
+            break;
+        }
+        case AFHTTP2PushPromiseFrameType:
+            // Server push is disabled in the client's settings
+            [self closeWithErrorCode:AFHTTP2ProtocolError];
+            return NO;
+        case AFHTTP2PingFrameType: {
+            if (streamID != 0 || length != 8) {
+                [self closeWithErrorCode:(streamID != 0 ? AFHTTP2ProtocolError : AFHTTP2FrameSizeError)];
+                return NO;
+            }
+            
+            if (!(flags & AFHTTP2AckFlag)) {
+                AFHTTP2AppendFrameHeader(self.outputBuffer, 8, AFHTTP2PingFrameType, AFHTTP2AckFlag, 0);
+                [self.outputBuffer appendBytes:payload length:8];
+            }
+            
+            break;
+        }
+        case AFHTTP2GoAwayFrameType: {
+            if (streamID != 0 || length < 8) {
+                [self closeWithErrorCode:(streamID != 0 ? AFHTTP2ProtocolError : AFHTTP2FrameSizeError)];
+                return NO;
+            }
+            
+            [self goAwayWithLastStreamID:(AFHTTP2ReadUInt32(payload) & kAFHTTP2MaximumWindowSize)];
+            
+            return !_closed;
+        }
+        case AFHTTP2WindowUpdateFrameType: {
+            if (length != 4) {
+                [self closeWithErrorCode:AFHTTP2FrameSizeError];
+                return NO;
+            }
+            
+            uint32_t increment = AFHTTP2ReadUInt32(payload) & kAFHTTP2MaximumWindowSize;
+            if (streamID == 0) {
+                _sendWindow += increment;
+                if (increment == 0 || _sendWindow > kAFHTTP2MaximumWindowSize) {
+                    [self closeWithErrorCode:(increment == 0 ? AFHTTP2ProtocolError : AFHTTP2FlowControlError)];
+                    return NO;
+                }
+            } else if (stream) {
+                stream.sendWindow += increment;
+                if (increment == 0 || stream.sendWindow > kAFHTTP2MaximumWindowSize) {
+                    [self failStream:stream withErrorCode:(increment == 0 ? AFHTTP2ProtocolError : AFHTTP2FlowControlError)];
+                    break;
+                }
+            }
+            
+            [self sendRequestBodies];
+            
+            break;
+        }
+        default:
+            // Priority frames, and frames of unknown types, are ignored
+            break;
+    }
+    
+    return YES;
+}
+
+- (BOOL)processSettings:(const uint8_t *)payload 
+                 length:(uint32_t)length
+{
+    for (uint32_t offset = 0; offset < length; offset += 6) {
+        uint16_t identifier = (uint16_t)((payload[offset] << 8) | payload[offset + 1]);
+        uint32_t value = AFHTTP2ReadUInt32(payload + offset + 2);
+        
+        switch (identifier) {
+            case AFHTTP2HeaderTableSizeSetting:
+                self.encoder.maximumTableSize = MIN(value, kAFHTTP2DefaultHeaderTableSize);
+                break;
+            case AFHTTP2MaximumConcurrentStreamsSetting:
+                _maximumConcurrentStreams = value;
+                break;
+            case AFHTTP2InitialWindowSizeSetting: {
+                if (value > kAFHTTP2MaximumWindowSize) {
+                    [self closeWithErrorCode:AFHTTP2FlowControlError];
+                    return NO;
+                }
+                
+                // A change to the initial window size applies to the windows of open streams too
+                int64_t delta = (int64_t)value - _initialSendWindow;
+                _initialSendWindow = value;
+                for (AFHTTP2Stream *stream in [self.streamsByID allValues]) {
+                    stream.sendWindow += delta;
+                }
+                
+                break;
+            }
+            case AFHTTP2MaximumFrameSizeSetting:
+                if (value < kAFHTTP2DefaultMaximumFrameSize || value > kAFHTTP2MaximumFrameSize) {
+                    [self closeWithErrorCode:AFHTTP2ProtocolError];
+                    return NO;
+                }
+                
+                _maximumFrameSize = value;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    return YES;
+}
+
+- (BOOL)processHeaderBlock {
+    NSData *headerBlock = [[self.headerBlock retain] autorelease];
+    self.headerBlock = nil;
+    
+    // Every header block is decoded, even those of closed streams, to keep the decoder in sync with the server's encoder
+    NSArray *headerFields = [self.decoder headerFieldsByDecodingData:headerBlock error:nil];
+    if (!headerFields) {
+        [self closeWithErrorCode:AFHTTP2CompressionError];
+        return NO;
+    }
+    
+    AFHTTP2Stream *stream = [[[self.streamsByID objectForKey:[NSNumber numberWithUnsignedInt:_headerBlockStreamID]] retain] autorelease];
+    if (!stream) {
+        return YES;
+    }
+    
+    // Trailers, which follow the body, are not delivered
+    if (!stream.receivedResponse) {
+        NSInteger statusCode = 0;
+        NSMutableDictionary *mutableHeaderFields = [NSMutableDictionary dictionaryWithCapacity:[headerFields count]];
+        NSMutableArray *mutableCookieValues = [NSMutableArray array];
+        for (NSArray *headerField in headerFields) {
+            NSString *name = [headerField objectAtIndex:0];
+            NSString *value = [headerField objectAtIndex:1];
+            if ([name isEqualToString:@":status"]) {
+                statusCode = [value integerValue];
+                continue;
+            } else if ([name hasPrefix:@":"]) {
+                continue;
+            } else if ([name isEqualToString:@"set-cookie"]) {
+                [mutableCookieValues addObject:value];
+            }
+            
+            // Repeated fields are combined into a comma-separated list; see http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4.2
+            NSString *field = AFHTTP2CanonicalFieldName(name);
+            NSString *existingValue = [mutableHeaderFields objectForKey:field];
+            [mutableHeaderFields setObject:(existingValue ? [NSString stringWithFormat:@"%@, %@", existingValue, value] : value) forKey:field];
+        }
+        
+        if (statusCode < 100) {
+            [self failStream:stream withErrorCode:AFHTTP2ProtocolError];
+            return YES;
+        } else if (statusCode < 200) {
+            // Interim responses are followed by the final response
+            return YES;
+        }
+        
+        stream.receivedResponse = YES;
+        
+        NSURL *url = [stream.request URL];
+        if ([stream.request HTTPShouldHandleCookies]) {
+            for (NSString *cookieValue in mutableCookieValues) {
+                NSArray *cookies = [NSHTTPCookie cookiesWithResponseHeaderFields:[NSDictionary dictionaryWithObject:cookieValue forKey:@"Set-Cookie"] forURL:url];
+                [[NSHTTPCookieStorage sharedHTTPCookieStorage] setCookies:cookies forURL:url mainDocumentURL:[stream.request mainDocumentURL]];
+            }
+        }
+        
+        [stream didReceiveResponse:AFHTTPURLResponseWithURL(url, statusCode, mutableHeaderFields)];
+    }
+    
+    if (_headerBlockEndsStream) {
+        [self finishStream:stream];
+    }
+    
+    return YES;
+}
+
+#pragma mark - Closing
+
+- (void)goAwayWithLastStreamID:(uint32_t)lastStreamID {
+    [[self retain] autorelease];
+    _goingAway = YES;
+    
+    // Waiting streams, and streams after the last one the server processed, can be sent again on a new connection. A stream is only sent again once, so that a server refusing every stream does not cause an endless loop.
+    NSMutableArray *mutableReturnedStreams = [NSMutableArray arrayWithArray:self.waitingStreams];
+    [self.waitingStreams removeAllObjects];
+    
+    for (AFHTTP2Stream *stream in [self.streamsByID allValues]) {
+        if (stream.streamID <= lastStreamID) {
+            continue;
+        }
+        
+        [self.streamsByID removeObjectForKey:[NSNumber numberWithUnsignedInt:stream.streamID]];
+        if (stream.retriedAfterRefusal) {
+            stream.connection = nil;
+            [stream didFailWithError:AFHTTP2ErrorWithCode(NSURLErrorNetworkConnectionLost, [stream.request URL], nil, nil)];
+        } else {
+            stream.retriedAfterRefusal = YES;
+            [mutableReturnedStreams addObject:stream];
+        }
+    }
+    
+    for (AFHTTP2Stream *stream in mutableReturnedStreams) {
+        stream.connection = nil;
+    }
+    
+    [_transport connection:self didReturnStreams:mutableReturnedStreams supportsHTTP2:YES];
+    
+    if ([self isIdle]) {
+        [self closeWithErrorCode:AFHTTP2NoError];
+    }
+}
+
+- (void)didFailToNegotiateHTTP2 {
+    [[self retain] autorelease];
+    
+    NSArray *streams = [[self.streamsByID allValues] arrayByAddingObjectsFromArray:self.waitingStreams];
+    [self.streamsByID removeAllObjects];
+    [self.waitingStreams removeAllObjects];
+    
+    for (AFHTTP2Stream *stream in streams) {
+        stream.connection = nil;
+    }
+    
+    [self invalidate];
+    [_transport connection:self didReturnStreams:streams supportsHTTP2:NO];
+}
+
+- (void)closeWithErrorCode:(AFHTTP2ErrorCode)errorCode {
+    if (_closed) {
+        return;
+    }
+    
+    // Streams are never initiated by the server, so none of them have been processed
+    AFHTTP2AppendFrameHeader(self.outputBuffer, 8, AFHTTP2GoAwayFrameType, 0, 0);
+    AFHTTP2AppendUInt32(self.outputBuffer, 0);
+    AFHTTP2AppendUInt32(self.outputBuffer, errorCode);
+    [self flushOutputBuffer];
+    
+    [self failStreamsWithCode:(errorCode == AFHTTP2NoError ? NSURLErrorNetworkConnectionLost : NSURLErrorBadServerResponse) description:[NSString stringWithFormat:NSLocalizedString(@"The HTTP/2 connection was closed with error code %u", nil), (unsigned int)errorCode] underlyingError:nil];
+    [self invalidate];
+}
+
+- (void)didCloseWithStreamError:(NSError *)streamError {
+    if (_closed) {
+        return;
+    }
+    
+    // A server that closes the connection in response to the preface does not speak HTTP/2
+    if (_opened && !_receivedSettings && !streamError) {
+        [self didFailToNegotiateHTTP2];
+        return;
+    }
+    
+    [self failStreamsWithCode:(_opened ? NSURLErrorNetworkConnectionLost : NSURLErrorCannotConnectToHost) description:nil underlyingError:streamError];
+    [self invalidate];
+}
+
+- (void)failStreamsWithCode:(NSInteger)code 
+                description:(NSString *)description 
+            underlyingError:(NSError *)underlyingError
+{
+    NSArray *streams = [[self.streamsByID allValues] arrayByAddingObjectsFromArray:self.waitingStreams];
+    [self.streamsByID removeAllObjects];
+    [self.waitingStreams removeAllObjects];
+    
+    for (AFHTTP2Stream *stream in streams) {
+        stream.connection = nil;
+        [stream didFailWithError:AFHTTP2ErrorWithCode(code, [stream.request URL], description, underlyingError)];
+    }
+}
+
+- (void)invalidate {
+    if (_closed) {
+        return;
+    }
+    
+    _closed = YES;
+    
+    // The transport may release the last reference to the connection
+    [[self retain] autorelease];
+    
+    [self.timer invalidate];
+    self.timer = nil;
+    
+    for (NSStream *stream in [NSArray arrayWithObjects:self.inputStream, self.outputStream, nil]) {
+        [stream setDelegate:nil];
+        [stream removeFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+        [stream close];
+    }
+    
+    [_transport connectionDidClose:self];
+}
+
+- (void)timerDidFire:(NSTimer *)__unused timer {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    [[self retain] autorelease];
+    
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    
+    // Streams time out after going without activity for the timeout interval of their request, except while their delegate is paused
+    for (AFHTTP2Stream *stream in [[self.streamsByID allValues] arrayByAddingObjectsFromArray:self.waitingStreams]) {
+        if ([stream isPaused]) {
+            stream.lastActivityTime = now;
+            continue;
+        }
+        
+        NSTimeInterval timeoutInterval = [stream.request timeoutInterval] > 0 ? [stream.request timeoutInterval] : 60.0;
+        if (now - stream.lastActivityTime >= timeoutInterval && stream.connection == self) {
+            [self resetStream:stream errorCode:AFHTTP2CancelError];
+            [stream didFailWithError:AFHTTP2ErrorWithCode(NSURLErrorTimedOut, [stream.request URL], nil, nil)];
+        }
+    }
+    
+    if (!_closed && [self isIdle] && now - _idleTime >= _transport.idleConnectionTimeout) {
+        [self closeWithErrorCode:AFHTTP2NoError];
+    }
+    
+    [pool drain];
+}
+
+#pragma mark - NSStreamDelegate
+
+- (void)stream:(NSStream *)stream 
+   handleEvent:(NSStreamEvent)eventCode
+{
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    [[self retain] autorelease];
+    
+    switch (eventCode) {
+        case NSStreamEventOpenCompleted:
+            if (stream == self.outputStream) {
+                _opened = YES;
+            }
+            break;
+        case NSStreamEventHasSpaceAvailable:
+            _opened = YES;
+            [self flushOutputBuffer];
+            [self sendRequestBodies];
+            [self flushOutputBuffer];
+            break;
+        case NSStreamEventHasBytesAvailable:
+            [self readAvailableBytes];
+            break;
+        case NSStreamEventEndEncountered:
+            [self didCloseWithStreamError:nil];
+            break;
+        case NSStreamEventErrorOccurred:
+            [self didCloseWithStreamError:[stream streamError]];
+            break;
+        default:
+            break;
+    }
+    
+    [pool drain];
+}
+
+@end
+
+#pragma mark -
+
+@implementation AFHTTP2Transport
+@synthesize fallbackTransport = _fallbackTransport;
+@synthesize connectionsByKey = _connectionsByKey;
+@synthesize drainingConnections = _drainingConnections;
+@synthesize HTTP1HostKeys = _HTTP1HostKeys;
+@synthesize maximumConcurrentStreamsPerConnection = _maximumConcurrentStreamsPerConnection;
+@synthesize initialStreamWindowSize = _initialStreamWindowSize;
+@synthesize connectionWindowSize = _connectionWindowSize;
+@synthesize idleConnectionTimeout = _idleConnectionTimeout;
+@synthesize openedConnectionCount = _openedConnectionCount;
+@synthesize openedStreamCount = _openedStreamCount;
+@synthesize encodedHeaderByteCount = _encodedHeaderByteCount;
+@synthesize unencodedHeaderByteCount = _unencodedHeaderByteCount;
+
++ (void)networkThreadEntryPoint:(id)__unused object {
+    NSAutoreleasePool *setupPool = [[NSAutoreleasePool alloc] init];
+    [[NSThread currentThread] setName:@"AFHTTP2Transport"];
+    
+    // A run loop without input sources would return immediately
+    [[NSRunLoop currentRunLoop] addPort:[NSMachPort port] forMode:NSDefaultRunLoopMode];
+    [setupPool drain];
+    
+    do {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        [[NSRunLoop currentRunLoop] run];
+        [pool drain];
+    } while (YES);
+}
+
++ (NSThread *)networkThread {
+    static NSThread *_networkThread = nil;
+    static dispatch_once_t oncePredicate;
+    
+    dispatch_once(&oncePredicate, ^{
+        _networkThread = [[NSThread alloc] initWithTarget:self selector:@selector(networkThreadEntryPoint:) object:nil];
+        [_networkThread start];
+    });
+    
+    return _networkThread;
+}
+
++ (AFHTTP2Transport *)sharedTransport {
+    static AFHTTP2Transport *_sharedTransport = nil;
+    static dispatch_once_t oncePredicate;
+    
+    dispatch_once(&oncePredicate, ^{
+        _sharedTransport = [[self alloc] init];
+    });
+    
+    return _sharedTransport;
+}
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.fallbackTransport = [AFHTTPSocketTransport sharedTransport];
+    self.connectionsByKey = [NSMutableDictionary dictionary];
+    self.drainingConnections = [NSMutableSet set];
+    self.HTTP1HostKeys = [NSMutableSet set];
+    
+    self.maximumConcurrentStreamsPerConnection = kAFHTTP2TransportDefaultMaximumConcurrentStreamsPerConnection;
+    self.initialStreamWindowSize = kAFHTTP2TransportDefaultInitialStreamWindowSize;
+    self.connectionWindowSize = kAFHTTP2TransportDefaultConnectionWindowSize;
+    self.idleConnectionTimeout = kAFHTTP2TransportDefaultIdleConnectionTimeout;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_fallbackTransport release];
+    [_connectionsByKey release];
+    [_drainingConnections release];
+    [_HTTP1HostKeys release];
+    [super dealloc];
+}
+
+- (id <AFHTTPTransportConnection>)connectionWithRequest:(NSURLRequest *)request 
+                                               delegate:(id <AFHTTPTransportConnectionDelegate>)delegate
+{
+    NSURL *url = [request URL];
+    BOOL usesHTTP2 = [[[url scheme] lowercaseString] isEqualToString:@"http"] && [url host];
+    if (usesHTTP2) {
+        @synchronized(self.HTTP1HostKeys) {
+            usesHTTP2 = ![self.HTTP1HostKeys containsObject:AFHTTP2ConnectionKeyForURL(url)];
+        }
+    }
+    
+    if (!usesHTTP2) {
+        return [self.fallbackTransport connectionWithRequest:request delegate:delegate];
+    }
+    
+    return [[[AFHTTP2Stream alloc] initWithRequest:request transport:self delegate:delegate] autorelease];
+}
+
+- (void)closeIdleConnections {
+    [self performSelector:@selector(closeIdleConnectionsOnNetworkThread) onThread:[AFHTTP2Transport networkThread] withObject:nil waitUntilDone:NO];
+}
+
+- (void)prewarmConnectionToURL:(NSURL *)url {
+    BOOL usesHTTP2 = [[[url scheme] lowercaseString] isEqualToString:@"http"] && [url host];
+    if (usesHTTP2) {
+        @synchronized(self.HTTP1HostKeys) {
+            usesHTTP2 = ![self.HTTP1HostKeys containsObject:AFHTTP2ConnectionKeyForURL(url)];
+        }
+    }
+    
+    if (!usesHTTP2) {
+        if ([self.fallbackTransport respondsToSelector:@selector(prewarmConnectionToURL:)]) {
+            [self.fallbackTransport prewarmConnectionToURL:url];
+        }
+        
+        return;
+    }
+    
+    [self performSelector:@selector(prewarmConnectionToURLOnNetworkThread:) onThread:[AFHTTP2Transport networkThread] withObject:url waitUntilDone:NO];
+}
+
+#pragma mark - Network Thread
+
+- (void)closeIdleConnectionsOnNetworkThread {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    for (AFHTTP2Connection *connection in [self.connectionsByKey allValues]) {
+        if ([connection isIdle]) {
+            [connection closeWithErrorCode:AFHTTP2NoError];
+        }
+    }
+    [pool drain];
+}
+
+- (void)prewarmConnectionToURLOnNetworkThread:(NSURL *)url {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    NSString *key = AFHTTP2ConnectionKeyForURL(url);
+    AFHTTP2Connection *connection = [self.connectionsByKey objectForKey:key];
+    
+    // The connection preface and settings are exchanged before the first stream is opened, and a host found not to support HTTP/2 is remembered
+    if (!connection || [connection isGoingAway]) {
+        connection = [[[AFHTTP2Connection alloc] initWithURL:url transport:self] autorelease];
+        [self.connectionsByKey setObject:connection forKey:key];
+        self.openedConnectionCount++;
+    }
+    [pool drain];
+}
+
+// Streams to a host share its current connection, and a new one is opened when there is none, or when the server is closing it
+- (void)openStream:(AFHTTP2Stream *)stream {
+    NSURL *url = [stream.request URL];
+    NSString *key = AFHTTP2ConnectionKeyForURL(url);
+    
+    BOOL usesHTTP2 = YES;
+    @synchronized(self.HTTP1HostKeys) {
+        usesHTTP2 = ![self.HTTP1HostKeys containsObject:key];
+    }
+    
+    if (!usesHTTP2) {
+        [stream fallBack];
+        return;
+    }
+    
+    AFHTTP2Connection *connection = [self.connectionsByKey objectForKey:key];
+    if (!connection || [connection isGoingAway]) {
+        connection = [[[AFHTTP2Connection alloc] initWithURL:url transport:self] autorelease];
+        [self.connectionsByKey setObject:connection forKey:key];
+        self.openedConnectionCount++;
+    }
+    
+    [connection openStream:stream];
+}
+
+- (void)connectionDidClose:(AFHTTP2Connection *)connection {
+    if ([self.connectionsByKey objectForKey:connection.key] == connection) {
+        [self.connectionsByKey removeObjectForKey:connection.key];
+    }
+    
+    [self.drainingConnections removeObject:connection];
+}
+
+// A connection that is going away keeps loading the streams the server has processed, until they finish
+- (void)connection:(AFHTTP2Connection *)connection 
+    didReturnStreams:(NSArray *)streams 
+    supportsHTTP2:(BOOL)supportsHTTP2
+{
+    if ([self.connectionsByKey objectForKey:connection.key] == connection) {
+        [self.connectionsByKey removeObjectForKey:connection.key];
+        
+        if (![connection isIdle]) {
+            [self.drainingConnections addObject:connection];
+        }
+    }
+    
+    if (!supportsHTTP2) {
+        @synchronized(self.HTTP1HostKeys) {
+            [self.HTTP1HostKeys addObject:connection.key];
+        }
+    }
+    
+    for (AFHTTP2Stream *stream in streams) {
+        [self openStream:stream];
+    }
+}
+
+@end
@@ -0,0 +1,116 @@
+// AFHTTPBodyCompressionPolicy.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ Returns a stream that sends the body of a request from the start, or `nil` if the request's `HTTPBodyStream` cannot be sent again. For a body compressed by an `AFHTTPBodyCompressionPolicy`, the first call returns the request's own stream if it has not been opened, and later calls return a new compressing stream. Other body streams that conform to `NSCopying` are copied.
+ */
+extern NSInputStream * AFHTTPBodyStreamForResendingRequest(NSURLRequest *request);
+
+/**
+ `AFHTTPBodyCompressionPolicy` decides whether the body of a request is compressed before it is sent, and compresses it with a content coding such as `gzip` or `zstd`.
+ 
+ A request body at least `minimumBodyLength` bytes long is replaced with an `HTTPBodyStream`, the read half of a bound stream pair. The original body is compressed into the write half on a background thread, one buffer at a time as the connection reads it, so the compressed body is never held in memory in full. The request is sent with a `Content-Encoding` header naming the coding, and without a `Content-Length`, which makes `NSURLConnection` send it with chunked transfer encoding.
+ 
+ @discussion Compressed bodies are only useful with servers that decode request content codings, so no policy is used unless one is set on an `AFHTTPClient`, or used directly on a request with `compressBodyOfRequest:`. Bodies that are already compressed, such as multipart forms of JPEG images, gain little and should be left uncompressed.
+ 
+ Requests with an `HTTPBodyStream` are loaded with `NSURLConnection` by `AFHTTPSocketTransport`, and sent as HTTP/2 DATA frames by `AFHTTP2Transport`. The request carries a token for its body in a property attached with `NSURLProtocol`. `AFHTTPBodyStreamForResendingRequest` uses the token to make a new stream that sends the body again from the start, for `AFHTTPClient` retries and hedges, for `NSURLConnection` redirects and authentication challenges, and for HTTP/2 streams that are sent again. The token is a string, so a compressed request can be archived, but the body is not archived with it, and is only kept while one of its streams exists. Upload progress is reported with an unknown total length.
+ 
+ `AFHTTPBodyCompressionPolicy` is thread-safe.
+ */
+@interface AFHTTPBodyCompressionPolicy : NSObject {
+@private
+    NSString *_contentCoding;
+    NSUInteger _minimumBodyLength;
+    NSInteger _compressionLevel;
+    NSUInteger _compressedBodyCount;
+    unsigned long long _uncompressedByteCount;
+    unsigned long long _compressedByteCount;
+}
+
+///------------------------------
+/// @name Configuring Compression
+///------------------------------
+
+/**
+ The content coding used to compress request bodies. This is `gzip` by default, and may be any of the `supportedContentCodings`.
+ */
+@property (nonatomic, copy) NSString *contentCoding;
+
+/**
+ The length in bytes a request body must have to be compressed. This is 16 KB by default.
+ */
+@property (nonatomic, assign) NSUInteger minimumBodyLength;
+
+/**
+ The compression level of the content coding, from 1 to 9 for `gzip` and `deflate`, or from 1 to 22 for `zstd`. This is `0` by default, which uses the content coding's default level.
+ */
+@property (nonatomic, assign) NSInteger compressionLevel;
+
+/**
+ The content codings that request bodies can be compressed with. These are `gzip` and `deflate`, and `zstd` when the zstd library is available.
+ */
++ (NSArray *)supportedContentCodings;
+
+///-------------------------------------
+/// @name Getting Compression Statistics
+///-------------------------------------
+
+/**
+ The number of request bodies that have been compressed and read to the end.
+ */
+@property (readonly, nonatomic, assign) NSUInteger compressedBodyCount;
+
+/**
+ The total length in bytes of those request bodies before compression.
+ */
+@property (readonly, nonatomic, assign) unsigned long long uncompressedByteCount;
+
+/**
+ The total length in bytes of those request bodies after compression.
+ */
+@property (readonly, nonatomic, assign) unsigned long long compressedByteCount;
+
+///---------------------------------
+/// @name Compressing Request Bodies
+///---------------------------------
+
+/**
+ Returns whether the body of a request would be compressed by `compressBodyOfRequest:`.
+ 
+ @param request The request.
+ 
+ @return `YES` if the request has an `HTTPBody` at least `minimumBodyLength` bytes long, no `Content-Encoding` header, and the `contentCoding` is supported. Otherwise `NO`.
+ */
+- (BOOL)shouldCompressBodyOfRequest:(NSURLRequest *)request;
+
+/**
+ Replaces the body of a request with a stream that compresses it as it is read, and sets the request's `Content-Encoding` header, if `shouldCompressBodyOfRequest:` returns `YES`.
+ 
+ @param request The request, which should have all of its other header fields set.
+ 
+ @return `YES` if the body will be compressed, or `NO` if the request was left unchanged.
+ */
+- (BOOL)compressBodyOfRequest:(NSMutableURLRequest *)request;
+
+@end
@@ -0,0 +1,667 @@
+// AFHTTPBodyCompressionPolicy.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPBodyCompressionPolicy.h"
+#import "AFHTTPContentDecoder.h"
+
+#import <objc/runtime.h>
+
+#include <zlib.h>
+
+#if AFNETWORKING_ZSTD_AVAILABLE
+#include <zstd.h>
+#endif
+
+static NSUInteger const kAFHTTPBodyCompressionPolicyDefaultMinimumBodyLength = 16 * 1024;
+static NSUInteger const kAFHTTPBodyCompressionBufferLength = 32 * 1024;
+
+static NSString * const kAFCompressedRequestBodyPropertyKey = @"AFCompressedRequestBody";
+static char kAFCompressedRequestBodyStreamReferenceKey;
+
+@interface AFHTTPBodyCompressionPolicy ()
+@property (readwrite, nonatomic, assign) NSUInteger compressedBodyCount;
+@property (readwrite, nonatomic, assign) unsigned long long uncompressedByteCount;
+@property (readwrite, nonatomic, assign) unsigned long long compressedByteCount;
+
+- (void)recordCompressedBodyOfLength:(unsigned long long)uncompressedLength 
+                    compressedLength:(unsigned long long)compressedLength;
+@end
+
+#pragma mark -
+
+// Compresses a body into the write half of a bound stream pair on the compression thread, one buffer at a time, as the read half is consumed
+@interface AFCompressedBodyProducer : NSObject <NSStreamDelegate> {
+@private
+    NSData *_data;
+    NSString *_contentCoding;
+    NSInteger _compressionLevel;
+    AFHTTPBodyCompressionPolicy *_policy;
+    NSOutputStream *_outputStream;
+    void *_compressor;
+    NSUInteger _offset;
+    uint8_t *_buffer;
+    NSUInteger _bufferOffset;
+    NSUInteger _bufferLength;
+    BOOL _compressorFinished;
+    unsigned long long _compressedLength;
+    BOOL _started;
+    BOOL _stopped;
+}
+
+@property (readwrite, nonatomic, retain) NSData *data;
+@property (readwrite, nonatomic, copy) NSString *contentCoding;
+@property (readwrite, nonatomic, assign) NSInteger compressionLevel;
+@property (readwrite, nonatomic, retain) AFHTTPBodyCompressionPolicy *policy;
+@property (readwrite, nonatomic, retain) NSOutputStream *outputStream;
+
+- (id)initWithData:(NSData *)data 
+     contentCoding:(NSString *)contentCoding 
+  compressionLevel:(NSInteger)compressionLevel 
+            policy:(AFHTTPBodyCompressionPolicy *)policy 
+      outputStream:(NSOutputStream *)outputStream;
+
++ (NSThread *)compressionThread;
+
+- (BOOL)isStopped;
+- (void)startOnCompressionThread;
+- (void)stopOnCompressionThread;
+@end
+
+@implementation AFCompressedBodyProducer
+@synthesize data = _data;
+@synthesize contentCoding = _contentCoding;
+@synthesize compressionLevel = _compressionLevel;
+@synthesize policy = _policy;
+@synthesize outputStream = _outputStream;
+
++ (void)compressionThreadEntryPoint:(id)__unused object {
+    NSAutoreleasePool *setupPool = [[NSAutoreleasePool alloc] init];
+    [[NSThread currentThread] setName:@"AFHTTPBodyCompressionPolicy"];
+    
+    // A run loop without input sources would return immediately
+    [[NSRunLoop currentRunLoop] addPort:[NSMachPort port] forMode:NSDefaultRunLoopMode];
+    [setupPool drain];
+    
+    do {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        [[NSRunLoop currentRunLoop] run];
+        [pool drain];
+    } while (YES);
+}
+
++ (NSThread *)compressionThread {
+    static NSThread *_compressionThread = nil;
+    static dispatch_once_t oncePredicate;
+    
+    dispatch_once(&oncePredicate, ^{
+        _compressionThread = [[NSThread alloc] initWithTarget:self selector:@selector(compressionThreadEntryPoint:) object:nil];
+        [_compressionThread start];
+    });
+    
+    return _compressionThread;
+}
+
+- (id)initWithData:(NSData *)data 
+     contentCoding:(NSString *)contentCoding 
+  compressionLevel:(NSInteger)compressionLevel 
+            policy:(AFHTTPBodyCompressionPolicy *)policy 
+      outputStream:(NSOutputStream *)outputStream
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.data = data;
+    self.contentCoding = contentCoding;
+    self.compressionLevel = compressionLevel;
+    self.policy = policy;
+    self.outputStream = outputStream;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [self closeCompressor];
+    free(_buffer);
+    [_data release];
+    [_contentCoding release];
+    [_policy release];
+    [_outputStream release];
+    [super dealloc];
+}
+
+- (BOOL)usesZstd {
+    return [self.contentCoding isEqualToString:@"zstd"];
+}
+
+- (BOOL)openCompressor {
+#if AFNETWORKING_ZSTD_AVAILABLE
+    if ([self usesZstd]) {
+        ZSTD_CCtx *context = ZSTD_createCCtx();
+        if (!context) {
+            return NO;
+        }
+        
+        ZSTD_CCtx_setParameter(context, ZSTD_c_compressionLevel, (int)self.compressionLevel);
+        ZSTD_CCtx_setPledgedSrcSize(context, [self.data length]);
+        _compressor = context;
+        
+        return YES;
+    }
+#endif
+    
+    z_stream *stream = calloc(1, sizeof(z_stream));
+    if (!stream) {
+        return NO;
+    }
+    
+    // Adding 16 to the window bits writes a gzip header and trailer instead of a zlib one
+    int windowBits = [self.contentCoding isEqualToString:@"deflate"] ? MAX_WBITS : MAX_WBITS + 16;
+    int level = self.compressionLevel > 0 ? (int)MIN(self.compressionLevel, (NSInteger)Z_BEST_COMPRESSION) : Z_DEFAULT_COMPRESSION;
+    if (deflateInit2(stream, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(stream);
+        return NO;
+    }
+    _compressor = stream;
+    
+    return YES;
+}
+
+- (void)closeCompressor {
+    if (!_compressor) {
+        return;
+    }
+    
+#if AFNETWORKING_ZSTD_AVAILABLE
+    if ([self usesZstd]) {
+        ZSTD_freeCCtx((ZSTD_CCtx *)_compressor);
+        _compressor = NULL;
+        return;
+    }
+#endif
+    
+    deflateEnd((z_stream *)_compressor);
+    free(_compressor);
+    _compressor = NULL;
+}
+
+// Returns the number of bytes written, or -1 on error, and sets `finished` once the compressed body has been written in full
+- (NSInteger)compressIntoBuffer:(uint8_t *)buffer 
+                      maxLength:(NSUInteger)length 
+                       finished:(BOOL *)finished
+{
+    const uint8_t *bytes = [self.data bytes];
+    NSUInteger dataLength = [self.data length];
+    
+#if AFNETWORKING_ZSTD_AVAILABLE
+    if ([self usesZstd]) {
+        ZSTD_outBuffer output = { buffer, length, 0 };
+        ZSTD_inBuffer input = { bytes + _offset, dataLength - _offset, 0 };
+        size_t remaining = ZSTD_compressStream2((ZSTD_CCtx *)_compressor, &output, &input, ZSTD_e_end);
+        _offset += input.pos;
+        if (ZSTD_isError(remaining)) {
+            return -1;
+        }
+        
+        *finished = remaining == 0;
+        
+        return (NSInteger)output.pos;
+    }
+#endif
+    
+    z_stream *stream = (z_stream *)_compressor;
+    uInt outputLength = (uInt)MIN(length, (NSUInteger)UINT_MAX);
+    stream->next_out = buffer;
+    stream->avail_out = outputLength;
+    
+    // Bodies longer than `avail_in` can describe are passed in pieces, and finished with the last one
+    while (stream->avail_out > 0 && !*finished) {
+        NSUInteger remainingLength = dataLength - _offset;
+        uInt inputLength = (uInt)MIN(remainingLength, (NSUInteger)UINT_MAX);
+        stream->next_in = (Bytef *)bytes + _offset;
+        stream->avail_in = inputLength;
+        
+        int status = deflate(stream, inputLength == remainingLength ? Z_FINISH : Z_NO_FLUSH);
+        _offset += inputLength - stream->avail_in;
+        if (status == Z_STREAM_END) {
+            *finished = YES;
+        } else if (status == Z_BUF_ERROR) {
+            break;
+        } else if (status != Z_OK) {
+            return -1;
+        }
+    }
+    
+    return (NSInteger)(outputLength - stream->avail_out);
+}
+
+// Read on the threads that make new streams of a body, while the producer runs on the compression thread
+- (BOOL)isStopped {
+    @synchronized(self) {
+        return _stopped;
+    }
+}
+
+#pragma mark - Compression Thread
+
+- (void)startOnCompressionThread {
+    if (_started || !self.outputStream) {
+        return;
+    }
+    _started = YES;
+    
+    // The output stream does not retain its delegate, so the producer keeps itself alive until it stops
+    [self retain];
+    [self.outputStream setDelegate:self];
+    [self.outputStream scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    [self.outputStream open];
+    
+    _buffer = malloc(kAFHTTPBodyCompressionBufferLength);
+    if (!_buffer || ![self openCompressor]) {
+        [self stopOnCompressionThread];
+    }
+}
+
+- (void)stopOnCompressionThread {
+    if (!self.outputStream) {
+        return;
+    }
+    
+    // Closing the output stream ends the body for the reader
+    BOOL wasStarted = _started;
+    [self.outputStream setDelegate:nil];
+    [self.outputStream removeFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    [self.outputStream close];
+    self.outputStream = nil;
+    
+    [self closeCompressor];
+    self.data = nil;
+    
+    @synchronized(self) {
+        _stopped = YES;
+    }
+    
+    if (wasStarted) {
+        [self autorelease];
+    }
+}
+
+- (void)writeCompressedData {
+    while (YES) {
+        if (_bufferOffset == _bufferLength) {
+            if (_compressorFinished) {
+                [self.policy recordCompressedBodyOfLength:[self.data length] compressedLength:_compressedLength];
+                [self stopOnCompressionThread];
+                return;
+            }
+            
+            // The compressor may have nothing to write until it has taken more input
+            NSInteger length = 0;
+            while (length == 0 && !_compressorFinished) {
+                length = [self compressIntoBuffer:_buffer maxLength:kAFHTTPBodyCompressionBufferLength finished:&_compressorFinished];
+            }
+            
+            // A body that cannot be compressed ends early, and is rejected by the server as a truncated content coding
+            if (length < 0) {
+                [self stopOnCompressionThread];
+                return;
+            }
+            
+            _bufferOffset = 0;
+            _bufferLength = (NSUInteger)length;
+            continue;
+        }
+        
+        if (![self.outputStream hasSpaceAvailable]) {
+            return;
+        }
+        
+        NSInteger bytesWritten = [self.outputStream write:_buffer + _bufferOffset maxLength:_bufferLength - _bufferOffset];
+        if (bytesWritten <= 0) {
+            [self stopOnCompressionThread];
+            return;
+        }
+        
+        _bufferOffset += (NSUInteger)bytesWritten;
+        _compressedLength += (unsigned long long)bytesWritten;
+    }
+}
+
+#pragma mark - NSStreamDelegate
+
+- (void)stream:(NSStream *)__unused stream 
+   handleEvent:(NSStreamEvent)eventCode
+{
+    switch (eventCode) {
+        case NSStreamEventHasSpaceAvailable:
+            [self writeCompressedData];
+            break;
+        case NSStreamEventErrorOccurred:
+        case NSStreamEventEndEncountered:
+            // The reader closed the stream before reading the whole body
+            [self stopOnCompressionThread];
+            break;
+        default:
+            break;
+    }
+}
+
+@end
+
+#pragma mark -
+
+// Requests carry the token of their compressed body, rather than the body itself, so that they can still be archived. Bodies are kept in this table for as long as any of their streams exists.
+static NSMutableDictionary * AFCompressedRequestBodiesByToken() {
+    static NSMutableDictionary *_compressedRequestBodiesByToken = nil;
+    static dispatch_once_t oncePredicate;
+    
+    dispatch_once(&oncePredicate, ^{
+        _compressedRequestBodiesByToken = [[NSMutableDictionary alloc] init];
+    });
+    
+    return _compressedRequestBodiesByToken;
+}
+
+// Describes a compressed body, so that a new stream can be made each time its request is sent
+@interface AFCompressedRequestBody : NSObject {
+@private
+    NSString *_token;
+    NSData *_data;
+    NSString *_contentCoding;
+    NSInteger _compressionLevel;
+    AFHTTPBodyCompressionPolicy *_policy;
+    NSMutableArray *_producers;
+    NSUInteger _streamCount;
+}
+
+@property (readwrite, nonatomic, copy) NSString *token;
+@property (readwrite, nonatomic, retain) NSData *data;
+@property (readwrite, nonatomic, copy) NSString *contentCoding;
+@property (readwrite, nonatomic, assign) NSInteger compressionLevel;
+@property (readwrite, nonatomic, retain) AFHTTPBodyCompressionPolicy *policy;
+@property (readwrite, nonatomic, retain) NSMutableArray *producers;
+@property (readwrite, nonatomic, assign) NSUInteger streamCount;
+
+- (id)initWithData:(NSData *)data 
+     contentCoding:(NSString *)contentCoding 
+  compressionLevel:(NSInteger)compressionLevel 
+            policy:(AFHTTPBodyCompressionPolicy *)policy;
+
+- (NSInputStream *)inputStream;
+@end
+
+#pragma mark -
+
+// Attached to each stream of a compressed body, to forget the body once its last stream is deallocated, and to hand the stream a request was made with to the first attempt that asks for one
+@interface AFCompressedRequestBodyStreamReference : NSObject {
+@private
+    NSString *_token;
+    BOOL _claimed;
+}
+
+@property (readwrite, nonatomic, copy) NSString *token;
+@property (readwrite, nonatomic, assign, getter = isClaimed) BOOL claimed;
+
+- (id)initWithToken:(NSString *)token;
+@end
+
+@implementation AFCompressedRequestBodyStreamReference
+@synthesize token = _token;
+@synthesize claimed = _claimed;
+
+- (id)initWithToken:(NSString *)token {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.token = token;
+    
+    return self;
+}
+
+- (void)dealloc {
+    NSMutableDictionary *compressedRequestBodies = AFCompressedRequestBodiesByToken();
+    @synchronized(compressedRequestBodies) {
+        AFCompressedRequestBody *body = [compressedRequestBodies objectForKey:_token];
+        if (body) {
+            body.streamCount = body.streamCount - 1;
+            if (body.streamCount == 0) {
+                [compressedRequestBodies removeObjectForKey:_token];
+            }
+        }
+    }
+    
+    [_token release];
+    [super dealloc];
+}
+
+@end
+
+#pragma mark -
+
+@implementation AFCompressedRequestBody
+@synthesize token = _token;
+@synthesize data = _data;
+@synthesize contentCoding = _contentCoding;
+@synthesize compressionLevel = _compressionLevel;
+@synthesize policy = _policy;
+@synthesize producers = _producers;
+@synthesize streamCount = _streamCount;
+
+- (id)initWithData:(NSData *)data 
+     contentCoding:(NSString *)contentCoding 
+  compressionLevel:(NSInteger)compressionLevel 
+            policy:(AFHTTPBodyCompressionPolicy *)policy
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.token = [[NSProcessInfo processInfo] globallyUniqueString];
+    self.data = data;
+    self.contentCoding = contentCoding;
+    self.compressionLevel = compressionLevel;
+    self.policy = policy;
+    self.producers = [NSMutableArray array];
+    
+    return self;
+}
+
+- (void)dealloc {
+    // Once the body's last stream is gone, no connection can read from the producers still waiting on a reader, so they are stopped
+    for (AFCompressedBodyProducer *producer in _producers) {
+        [producer performSelector:@selector(stopOnCompressionThread) onThread:[AFCompressedBodyProducer compressionThread] withObject:nil waitUntilDone:NO];
+    }
+    
+    [_token release];
+    [_data release];
+    [_contentCoding release];
+    [_policy release];
+    [_producers release];
+    [super dealloc];
+}
+
+- (NSInputStream *)inputStream {
+    CFReadStreamRef readStream = NULL;
+    CFWriteStreamRef writeStream = NULL;
+    CFStreamCreateBoundPair(kCFAllocatorDefault, &readStream, &writeStream, kAFHTTPBodyCompressionBufferLength);
+    if (!readStream || !writeStream) {
+        if (readStream) {
+            CFRelease(readStream);
+        }
+        if (writeStream) {
+            CFRelease(writeStream);
+        }
+        
+        return nil;
+    }
+    
+    AFCompressedBodyProducer *producer = [[[AFCompressedBodyProducer alloc] initWithData:self.data contentCoding:self.contentCoding compressionLevel:self.compressionLevel policy:self.policy outputStream:(NSOutputStream *)writeStream] autorelease];
+    CFRelease(writeStream);
+    
+    @synchronized(self) {
+        // Producers that have stopped hold nothing but themselves
+        NSMutableArray *runningProducers = [NSMutableArray arrayWithCapacity:[self.producers count] + 1];
+        for (AFCompressedBodyProducer *existingProducer in self.producers) {
+            if (![existingProducer isStopped]) {
+                [runningProducers addObject:existingProducer];
+            }
+        }
+        [runningProducers addObject:producer];
+        self.producers = runningProducers;
+    }
+    
+    NSMutableDictionary *compressedRequestBodies = AFCompressedRequestBodiesByToken();
+    @synchronized(compressedRequestBodies) {
+        if (self.streamCount == 0) {
+            [compressedRequestBodies setObject:self forKey:self.token];
+        }
+        self.streamCount = self.streamCount + 1;
+    }
+    
+    AFCompressedRequestBodyStreamReference *reference = [[[AFCompressedRequestBodyStreamReference alloc] initWithToken:self.token] autorelease];
+    objc_setAssociatedObject((id)readStream, &kAFCompressedRequestBodyStreamReferenceKey, reference, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    
+    [producer performSelector:@selector(startOnCompressionThread) onThread:[AFCompressedBodyProducer compressionThread] withObject:nil waitUntilDone:NO];
+    
+    return [(NSInputStream *)readStream autorelease];
+}
+
+@end
+
+NSInputStream * AFHTTPBodyStreamForResendingRequest(NSURLRequest *request) {
+    NSString *token = [NSURLProtocol propertyForKey:kAFCompressedRequestBodyPropertyKey inRequest:request];
+    if ([token isKindOfClass:[NSString class]]) {
+        NSInputStream *bodyStream = [request HTTPBodyStream];
+        NSMutableDictionary *compressedRequestBodies = AFCompressedRequestBodiesByToken();
+        AFCompressedRequestBody *body = nil;
+        @synchronized(compressedRequestBodies) {
+            // The stream the request was made with is sent by the first attempt that asks for a stream, if it has not been opened, rather than being replaced by a new one
+            AFCompressedRequestBodyStreamReference *reference = bodyStream ? objc_getAssociatedObject(bodyStream, &kAFCompressedRequestBodyStreamReferenceKey) : nil;
+            if ([reference.token isEqualToString:token] && ![reference isClaimed] && [bodyStream streamStatus] == NSStreamStatusNotOpen) {
+                reference.claimed = YES;
+                return bodyStream;
+            }
+            
+            body = [[[compressedRequestBodies objectForKey:token] retain] autorelease];
+        }
+        
+        return [body inputStream];
+    }
+    
+    NSInputStream *bodyStream = [request HTTPBodyStream];
+    if ([bodyStream conformsToProtocol:@protocol(NSCopying)]) {
+        return [[bodyStream copy] autorelease];
+    }
+    
+    return nil;
+}
+
+#pragma mark -
+
+@implementation AFHTTPBodyCompressionPolicy
+@synthesize contentCoding = _contentCoding;
+@synthesize minimumBodyLength = _minimumBodyLength;
+@synthesize compressionLevel = _compressionLevel;
+@synthesize compressedBodyCount = _compressedBodyCount;
+@synthesize uncompressedByteCount = _uncompressedByteCount;
+@synthesize compressedByteCount = _compressedByteCount;
+
++ (NSArray *)supportedContentCodings {
+#if AFNETWORKING_ZSTD_AVAILABLE
+    return [NSArray arrayWithObjects:@"gzip", @"deflate", @"zstd", nil];
+#else
+    return [NSArray arrayWithObjects:@"gzip", @"deflate", nil];
+#endif
+}
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.contentCoding = @"gzip";
+    self.minimumBodyLength = kAFHTTPBodyCompressionPolicyDefaultMinimumBodyLength;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_contentCoding release];
+    [super dealloc];
+}
+
+- (void)recordCompressedBodyOfLength:(unsigned long long)uncompressedLength 
+                    compressedLength:(unsigned long long)compressedLength
+{
+    @synchronized(self) {
+        self.compressedBodyCount = self.compressedBodyCount + 1;
+        self.uncompressedByteCount = self.uncompressedByteCount + uncompressedLength;
+        self.compressedByteCount = self.compressedByteCount + compressedLength;
+    }
+}
+
+- (BOOL)shouldCompressBodyOfRequest:(NSURLRequest *)request {
+    NSData *body = [request HTTPBody];
+    if (!body || [request HTTPBodyStream] || [body length] < self.minimumBodyLength) {
+        return NO;
+    }
+    
+    if ([request valueForHTTPHeaderField:@"Content-Encoding"]) {
+        return NO;
+    }
+    
+    return [[[self class] supportedContentCodings] containsObject:self.contentCoding];
+}
+
+- (BOOL)compressBodyOfRequest:(NSMutableURLRequest *)request {
+    NSString *contentCoding = nil;
+    NSInteger compressionLevel = 0;
+    @synchronized(self) {
+        if (![self shouldCompressBodyOfRequest:request]) {
+            return NO;
+        }
+        
+        contentCoding = [[self.contentCoding copy] autorelease];
+        compressionLevel = self.compressionLevel;
+    }
+    
+    // The body is retained rather than copied, and setting the stream replaces the request's `HTTPBody`
+    AFCompressedRequestBody *body = [[[AFCompressedRequestBody alloc] initWithData:[request HTTPBody] contentCoding:contentCoding compressionLevel:compressionLevel policy:self] autorelease];
+    NSInputStream *bodyStream = [body inputStream];
+    if (!bodyStream) {
+        return NO;
+    }
+    
+    [NSURLProtocol setProperty:body.token forKey:kAFCompressedRequestBodyPropertyKey inRequest:request];
+    [request setHTTPBodyStream:bodyStream];
+    [request setValue:contentCoding forHTTPHeaderField:@"Content-Encoding"];
+    [request setValue:nil forHTTPHeaderField:@"Content-Length"];
+    
+    return YES;
+}
+
+@end
@@ -22,6 +22,13 @@
 
 #import <Foundation/Foundation.h>
 #import "AFHTTPRequestOperation.h"
+#import "AFHTTPResponseCache.h"
+#import "AFHTTPRequestCoalescer.h"
+#import "AFHTTPOperationScheduler.h"
+#import "AFHTTPRetryPolicy.h"
+#import "AFHTTPHedgingPolicy.h"
+#import "AFHTTPBodyCompressionPolicy.h"
+#import "AFHTTPTransport.h"
 
 @protocol AFMultipartFormData;
 
@@ -31,11 +38,11 @@
  In its default implementation, `AFHTTPClient` sets the following HTTP headers:
  
  - `Accept: application/json`
- - `Accept-Encoding: gzip`
+ - `Accept-Encoding: #{[AFHTTPRequestOperation registeredContentCodings]}`, such as `gzip, deflate`
  - `Accept-Language: #{[NSLocale preferredLanguages]}, en-us;q=0.8`
  - `User-Agent: #{generated user agent}`
  
- You can override these HTTP headers or define new ones using `setDefaultHeader:value:`. 
+ You can override these HTTP headers or define new ones using `setDefaultHeader:value:`. Response bodies in any content coding with a decoder registered with `+[AFHTTPRequestOperation registerContentDecoderClass:forContentCoding:]` are decoded by the operation, so a content coding such as `zstd` is advertised by registering its decoder before the client is created, or by setting the `Accept-Encoding` header.
  
  # Subclassing Notes
  
@@ -51,6 +58,15 @@
     NSStringEncoding _stringEncoding;
     NSMutableDictionary *_defaultHeaders;
     NSOperationQueue *_operationQueue;
+    AFHTTPResponseCache *_responseCache;
+    AFHTTPRequestCoalescer *_requestCoalescer;
+    AFHTTPRequestPriority _requestPriority;
+    AFHTTPRetryPolicy *_retryPolicy;
+    AFHTTPHedgingPolicy *_hedgingPolicy;
+    AFHTTPBodyCompressionPolicy *_requestBodyCompressionPolicy;
+    id <AFHTTPTransport> _transport;
+    CFAbsoluteTime _firstRequestStartTime;
+    NSTimeInterval _firstRequestLatency;
 }
 
 ///---------------------------------------
@@ -68,10 +84,65 @@
 @property (nonatomic, assign) NSStringEncoding stringEncoding;
 
 /**
- The operation queue which manages operations enqueued by the HTTP client.
+ The operation queue which manages operations enqueued by the HTTP client. This is the operation queue of the shared `AFHTTPOperationScheduler`, which also runs image requests from `UIImageView+AFNetworking`. Operations for hosts that are at their budget of operations in flight are held by the scheduler until a slot frees up, and are only added to this queue then.
+ 
+ @warning This queue is shared by every HTTP client and image view in the process. Calling `cancelAllOperations` or `setMaxConcurrentOperationCount:` on it affects all of their operations, not only those of this client. Use `HTTPOperations`, `cancelAllHTTPOperations`, and `cancelHTTPOperationsWithMethod:andURL:` to act on the operations of this client, and the shared scheduler's per-host limits to bound concurrency.
  */
 @property (readonly, nonatomic, retain) NSOperationQueue *operationQueue;
 
+/**
+ The priority class of operations enqueued by the HTTP client. This is `AFHTTPRequestInteractivePriority` by default.
+ 
+ @discussion When a `GET` request is coalesced with an identical request that has not yet started, the operation is raised to this priority class if it is higher than its own. Operations that are already enqueued can be reprioritized with `-[AFHTTPOperationScheduler setPriority:forOperation:]`.
+ */
+@property (nonatomic, assign) AFHTTPRequestPriority requestPriority;
+
+/**
+ The policy deciding whether failed requests enqueued by the HTTP client are retried before their failure callback is called. By default, this is a new `AFHTTPRetryPolicy`, which retries requests with idempotent methods after transient errors. Set it to `nil` to disable retries.
+ 
+ @discussion Retries send the original request again, and are scheduled with the same priority class. While a retry is waiting for its delay to pass, it is included in the operations of the shared `AFHTTPOperationScheduler`, and can be cancelled with `cancelHTTPOperationsWithMethod:andURL:`.
+ */
+@property (nonatomic, retain) AFHTTPRetryPolicy *retryPolicy;
+
+/**
+ The policy deciding whether slow requests enqueued by the HTTP client are hedged with a second copy. This is `nil` by default, in which case requests are not hedged.
+ 
+ @discussion When the connection for an idempotent request has not received the first byte of a response within the policy's percentile of observed times to first byte, the same request is sent again. The first copy to finish successfully is delivered, and the other is cancelled; a copy that fails waits for the other to finish. The policy's `primaryWinCount` and `hedgeWinCount` report which copy won.
+ 
+ @see AFHTTPHedgingPolicy
+ */
+@property (nonatomic, retain) AFHTTPHedgingPolicy *hedgingPolicy;
+
+/**
+ The policy deciding whether the bodies of requests created by the HTTP client are compressed. This is `nil` by default, in which case request bodies are sent uncompressed.
+ 
+ @discussion The policy is applied to requests created with `requestWithMethod:path:parameters:` and `multipartFormRequestWithMethod:path:parameters:constructingBodyWithBlock:`, after their header fields are set. It should only be set for servers that decode the policy's content coding. A single request can instead be compressed with `-[AFHTTPBodyCompressionPolicy compressBodyOfRequest:]`.
+ 
+ @see AFHTTPBodyCompressionPolicy
+ */
+@property (nonatomic, retain) AFHTTPBodyCompressionPolicy *requestBodyCompressionPolicy;
+
+/**
+ The transport that loads requests for operations enqueued by the HTTP client. This is `nil` by default, in which case operations use their own default transport, the shared `AFURLConnectionTransport`.
+ 
+ @see AFHTTPSocketTransport
+ */
+@property (nonatomic, retain) id <AFHTTPTransport> transport;
+
+/**
+ The response cache used by operations enqueued by the HTTP client. This is `nil` by default, in which case responses are only cached by the shared `NSURLCache`.
+ 
+ @discussion Fresh cached responses to `GET` requests are returned without going to the network, and stale ones are revalidated with conditional requests. The cache's `hitCount`, `missCount`, `revalidationCount`, and `notModifiedCount` report how requests were answered.
+ 
+ @see AFHTTPResponseCache
+ */
+@property (nonatomic, retain) AFHTTPResponseCache *responseCache;
+
+/**
+ The table of in-flight `GET` requests. When a `GET` request is enqueued while an identical request is already loading, its callbacks are attached to the existing operation, and are called with the same decoded response object, rather than a new operation being created.
+ */
+@property (readonly, nonatomic, retain) AFHTTPRequestCoalescer *requestCoalescer;
+
 ///---------------------------------------------
 /// @name Creating and Initializing HTTP Clients
 ///---------------------------------------------
@@ -96,6 +167,26 @@
  */
 - (id)initWithBaseURL:(NSURL *)url;
 
+///---------------------------
+/// @name Prewarming the Client
+///---------------------------
+
+/**
+ Does ahead of time the setup that the first request enqueued by the HTTP client would otherwise wait on: it starts the network request threads, creates the JSON processing queues and their decoders, and has the client's transport connect to the host of `baseURL`. This returns immediately, and is typically called as early as possible after launch, before the first request is made.
+ 
+ @discussion How much of the connection can be made ahead of time depends on the transport. `AFHTTPSocketTransport` and `AFHTTP2Transport` open a connection, including the TLS handshake for `https`, and keep it alive for the first request, while the default `AFURLConnectionTransport` only resolves the host name. Transports that do not implement `prewarmConnectionToURL:` are not prewarmed.
+ 
+ @see firstRequestLatency
+ */
+- (void)prewarm;
+
+/**
+ The time from the first request being enqueued by the HTTP client until its callback was called, including any retries. This is `0` until the first request has finished.
+ 
+ @discussion Comparing this between launches that call `prewarm` and launches that do not measures the effect of prewarming. The `timingBreakdown` of operations, and the latency histograms of `AFHTTPRequestOperation`, show in which stage of the request the time was saved.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval firstRequestLatency;
+
 ///----------------------------------
 /// @name Managing HTTP Header Values
 ///----------------------------------
@@ -142,7 +233,7 @@
 ///-------------------------------
 
 /**
- Creates an `NSMutableURLRequest` object with the specified HTTP method and path. If the HTTP method is `GET`, the parameters will be used to construct a url-encoded query string that is appended to the request's URL. If `POST`, `PUT`, or `DELETE`, the parameters will be encoded into a `application/x-www-form-urlencoded` HTTP body.
+ Creates an `NSMutableURLRequest` object with the specified HTTP method and path. If the HTTP method is `GET`, the parameters will be used to construct a url-encoded query string that is appended to the request's URL. If `POST`, `PUT`, or `DELETE`, the parameters will be encoded into a `application/x-www-form-urlencoded` HTTP body, which is compressed if the `requestBodyCompressionPolicy` decides it should be.
  
  @param method The HTTP method for the request, such as `GET`, `POST`, `PUT`, or `DELETE`.
  @param path The path to be appended to the HTTP client's base URL and used as the request URL.
@@ -162,6 +253,8 @@
  @param parameters The parameters to be encoded and set in the request HTTP body.
  @param block A block that takes a single argument and appends data to the HTTP body. The block argument is an object adopting the `AFMultipartFormData` protocol. This can be used to upload files, encode HTTP body as JSON or XML, or specify multiple values for the same parameter, as one might for array values.
  
+ @discussion The body is compressed if the `requestBodyCompressionPolicy` decides it should be.
+ 
  @see AFMultipartFormData
  
  @return An `NSMutableURLRequest` object
@@ -187,18 +280,28 @@
                                 success:(void (^)(id object))success 
                                 failure:(void (^)(NSHTTPURLResponse *response, NSError *error))failure;
 
-///---------------------------------
-/// @name Cancelling HTTP Operations
-///---------------------------------
+///-------------------------------
+/// @name Managing HTTP Operations
+///-------------------------------
 
 /**
- Cancels all operations in the HTTP client's operation queue that match the specified HTTP method and URL.
+ Returns the operations enqueued by the HTTP client that have not yet finished, including retries waiting for their delay to pass, and operations waiting for their host to have a free slot.
+ */
+- (NSArray *)HTTPOperations;
+
+/**
+ Cancels all operations enqueued by the HTTP client that match the specified HTTP method and URL. Operations of other HTTP clients, and image requests, are not cancelled.
  
  @param method The HTTP method to match for the cancelled requests, such as `GET`, `POST`, `PUT`, or `DELETE`.
  @param url The URL to match for the cancelled requests.
  */
 - (void)cancelHTTPOperationsWithMethod:(NSString *)method andURL:(NSURL *)url;
 
+/**
+ Cancels all operations enqueued by the HTTP client. Operations of other HTTP clients, and image requests, are not cancelled.
+ */
+- (void)cancelAllHTTPOperations;
+
 ///---------------------------
 /// @name Making HTTP Requests
 ///---------------------------
@@ -23,9 +23,13 @@
 #import "AFHTTPClient.h"
 #import "AFJSONRequestOperation.h"
 
+#import <objc/runtime.h>
+
 static NSString * const kAFMultipartFormLineDelimiter = @"\r\n"; // CRLF
 static NSString * const kAFMultipartFormBoundary = @"Boundary+0xAbCdEfGbOuNdArY";
 
+static char kAFHTTPClientOperationClientKey;
+
 @interface AFMultipartFormData : NSObject <AFMultipartFormData> {
 @private
     NSStringEncoding _stringEncoding;
@@ -75,10 +79,204 @@ static NSString * AFURLEncodedStringFromStringWithEncoding(NSString *string, NSS
 	return [(NSString *)CFURLCreateStringByAddingPercentEscapes(kCFAllocatorDefault, (CFStringRef)string, NULL, (CFStringRef)kAFLegalCharactersToBeEscaped, CFStringConvertNSStringEncodingToEncoding(encoding)) autorelease];
 }
 
+typedef void (^AFHTTPClientCompletionBlock)(id JSON, NSHTTPURLResponse *response, NSError *error);
+typedef void (^AFHTTPClientOperationCompletionBlock)(BOOL isHedge, id JSON, NSHTTPURLResponse *response, NSError *error);
+
+static void * AFHTTPHedgedRequestObservationContext = &AFHTTPHedgedRequestObservationContext;
+
+@interface AFHTTPHedgedRequest : NSObject {
+@private
+    AFHTTPRequestOperation *_primaryOperation;
+    AFHTTPRequestOperation *_hedgeOperation;
+    AFHTTPRequestOperation *_losingOperation;
+    void (^_pendingFailureBlock)(void);
+    BOOL _primaryCompleted;
+    BOOL _hedgeCompleted;
+    BOOL _hedged;
+    BOOL _resolved;
+}
+
+@property (readonly, nonatomic, assign, getter = isHedged) BOOL hedged;
+
+- (AFHTTPRequestOperation *)primaryOperation;
+- (void)setPrimaryOperation:(AFHTTPRequestOperation *)operation;
+- (BOOL)setHedgeOperation:(AFHTTPRequestOperation *)operation;
+- (BOOL)resolveWithOperationIsHedge:(BOOL)isHedge 
+                             failed:(BOOL)failed 
+                pendingFailureBlock:(void (^)(void))block;
+- (void)cancelLosingOperation;
+@end
+
+@implementation AFHTTPHedgedRequest
+@synthesize hedged = _hedged;
+
+- (void)dealloc {
+    [_primaryOperation release];
+    [_hedgeOperation release];
+    [_losingOperation release];
+    [_pendingFailureBlock release];
+    [super dealloc];
+}
+
+- (AFHTTPRequestOperation *)primaryOperation {
+    @synchronized(self) {
+        return [[_primaryOperation retain] autorelease];
+    }
+}
+
+- (void)setPrimaryOperation:(AFHTTPRequestOperation *)operation {
+    @synchronized(self) {
+        [_primaryOperation autorelease];
+        _primaryOperation = [operation retain];
+    }
+    
+    [operation addObserver:self forKeyPath:@"isFinished" options:0 context:AFHTTPHedgedRequestObservationContext];
+}
+
+- (BOOL)setHedgeOperation:(AFHTTPRequestOperation *)operation {
+    @synchronized(self) {
+        if (_resolved || _hedged || _primaryCompleted || !_primaryOperation) {
+            return NO;
+        }
+        
+        _hedgeOperation = [operation retain];
+        _hedged = YES;
+    }
+    
+    [operation addObserver:self forKeyPath:@"isFinished" options:0 context:AFHTTPHedgedRequestObservationContext];
+    
+    return YES;
+}
+
+// Called from each copy's completion, which runs after the copy has finished. Operations finish before their completions run, so whether a copy is still loading is tracked here rather than from `isFinished`.
+- (BOOL)resolveWithOperationIsHedge:(BOOL)isHedge 
+                             failed:(BOOL)failed 
+                pendingFailureBlock:(void (^)(void))block
+{
+    @synchronized(self) {
+        if (isHedge) {
+            _hedgeCompleted = YES;
+            [_hedgeOperation autorelease];
+            _hedgeOperation = nil;
+        } else {
+            _primaryCompleted = YES;
+            [_primaryOperation autorelease];
+            _primaryOperation = nil;
+        }
+        
+        if (_resolved) {
+            return NO;
+        }
+        
+        // A failure waits for the other copy, and is delivered only if that copy fails too, or is cancelled
+        BOOL siblingIsLoading = isHedge ? !_primaryCompleted : (_hedged && !_hedgeCompleted);
+        if (failed && siblingIsLoading) {
+            [_pendingFailureBlock release];
+            _pendingFailureBlock = [block copy];
+            
+            return NO;
+        }
+        
+        _resolved = YES;
+        _losingOperation = [(isHedge ? _primaryOperation : _hedgeOperation) retain];
+        [_pendingFailureBlock release];
+        _pendingFailureBlock = nil;
+        
+        return YES;
+    }
+}
+
+- (void)cancelLosingOperation {
+    AFHTTPRequestOperation *losingOperation = nil;
+    @synchronized(self) {
+        losingOperation = [_losingOperation autorelease];
+        _losingOperation = nil;
+    }
+    
+    [losingOperation cancel];
+}
+
+#pragma mark - NSKeyValueObserving
+
+- (void)observeValueForKeyPath:(NSString *)keyPath 
+                      ofObject:(id)object 
+                        change:(NSDictionary *)change 
+                       context:(void *)context
+{
+    if (context != AFHTTPHedgedRequestObservationContext) {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+        return;
+    }
+    
+    AFHTTPRequestOperation *operation = (AFHTTPRequestOperation *)object;
+    if (![operation isFinished]) {
+        return;
+    }
+    
+    [operation removeObserver:self forKeyPath:@"isFinished"];
+    
+    // Cancelled operations never call their completion, so they are marked as completed here instead
+    if (![operation isCancelled]) {
+        return;
+    }
+    
+    AFHTTPRequestOperation *hedgeOperationToCancel = nil;
+    void (^pendingFailureBlock)(void) = nil;
+    @synchronized(self) {
+        if (operation == _primaryOperation) {
+            // Cancelling the original request, such as when its last caller goes away, cancels its hedge too, and a failed hedge is not delivered
+            hedgeOperationToCancel = [[_hedgeOperation retain] autorelease];
+            _primaryCompleted = YES;
+            [_primaryOperation autorelease];
+            _primaryOperation = nil;
+            
+            _resolved = YES;
+            [_pendingFailureBlock release];
+            _pendingFailureBlock = nil;
+        } else if (operation == _hedgeOperation) {
+            _hedgeCompleted = YES;
+            [_hedgeOperation autorelease];
+            _hedgeOperation = nil;
+            
+            // A cancelled hedge leaves the original request's failure as the result
+            if (!_resolved && _pendingFailureBlock) {
+                _resolved = YES;
+                pendingFailureBlock = [_pendingFailureBlock autorelease];
+                _pendingFailureBlock = nil;
+            }
+        }
+    }
+    
+    [hedgeOperationToCancel cancel];
+    
+    if (pendingFailureBlock) {
+        dispatch_async(dispatch_get_main_queue(), pendingFailureBlock);
+    }
+}
+
+@end
+
+#pragma mark -
+
 @interface AFHTTPClient ()
 @property (readwrite, nonatomic, retain) NSURL *baseURL;
 @property (readwrite, nonatomic, retain) NSMutableDictionary *defaultHeaders;
 @property (readwrite, nonatomic, retain) NSOperationQueue *operationQueue;
+@property (readwrite, nonatomic, retain) AFHTTPRequestCoalescer *requestCoalescer;
+@property (readwrite, nonatomic, assign) NSTimeInterval firstRequestLatency;
+
+- (AFHTTPRequestOperation *)JSONOperationWithRequest:(NSURLRequest *)urlRequest 
+                                          completion:(AFHTTPClientCompletionBlock)completion;
+- (AFHTTPRequestOperation *)enqueueJSONOperationWithRequest:(NSURLRequest *)urlRequest 
+                                                 retryCount:(NSUInteger)retryCount 
+                                                      delay:(NSTimeInterval)delay 
+                                                 completion:(AFHTTPClientCompletionBlock)completion 
+                                                 retryBlock:(BOOL (^)(AFHTTPRequestOperation *retryOperation))retryBlock;
+- (void)scheduleHedgeOfRequest:(NSURLRequest *)urlRequest 
+                 hedgedRequest:(AFHTTPHedgedRequest *)hedgedRequest 
+                  hedgingDelay:(NSTimeInterval)hedgingDelay 
+                    afterDelay:(NSTimeInterval)delay 
+                    completion:(AFHTTPClientOperationCompletionBlock)completion;
 @end
 
 @implementation AFHTTPClient
@@ -86,6 +284,14 @@ static NSString * AFURLEncodedStringFromStringWithEncoding(NSString *string, NSS
 @synthesize stringEncoding = _stringEncoding;
 @synthesize defaultHeaders = _defaultHeaders;
 @synthesize operationQueue = _operationQueue;
+@synthesize responseCache = _responseCache;
+@synthesize requestCoalescer = _requestCoalescer;
+@synthesize requestPriority = _requestPriority;
+@synthesize retryPolicy = _retryPolicy;
+@synthesize hedgingPolicy = _hedgingPolicy;
+@synthesize requestBodyCompressionPolicy = _requestBodyCompressionPolicy;
+@synthesize transport = _transport;
+@synthesize firstRequestLatency = _firstRequestLatency;
 
 + (AFHTTPClient *)clientWithBaseURL:(NSURL *)url {
     return [[[self alloc] initWithBaseURL:url] autorelease];
@@ -107,7 +313,7 @@ static NSString * AFURLEncodedStringFromStringWithEncoding(NSString *string, NSS
 	[self setDefaultHeader:@"Accept" value:@"application/json"];
     
 	// Accept-Encoding HTTP Header; see http://www.w3.org/Protocols/rfc2616/rfc2616-sec14.html#sec14.3
-	[self setDefaultHeader:@"Accept-Encoding" value:@"gzip"];
+	[self setDefaultHeader:@"Accept-Encoding" value:[[AFHTTPRequestOperation registeredContentCodings] componentsJoinedByString:@", "]];
 	
 	// Accept-Language HTTP Header; see http://www.w3.org/Protocols/rfc2616/rfc2616-sec14.html#sec14.4
 	NSString *preferredLanguageCodes = [[NSLocale preferredLanguages] componentsJoinedByString:@", "];
@@ -116,8 +322,11 @@ static NSString * AFURLEncodedStringFromStringWithEncoding(NSString *string, NSS
 	// User-Agent Header; see http://www.w3.org/Protocols/rfc2616/rfc2616-sec14.html#sec14.43
 	[self setDefaultHeader:@"User-Agent" value:[NSString stringWithFormat:@"%@/%@ (%@, %@ %@, %@, Scale/%f)", [[[NSBundle mainBundle] infoDictionary] objectForKey:(NSString *)kCFBundleIdentifierKey], [[[NSBundle mainBundle] infoDictionary] objectForKey:(NSString *)kCFBundleVersionKey], @"unknown", [[UIDevice currentDevice] systemName], [[UIDevice currentDevice] systemVersion], [[UIDevice currentDevice] model], ([[UIScreen mainScreen] respondsToSelector:@selector(scale)] ? [[UIScreen mainScreen] scale] : 1.0)]];
     
-    self.operationQueue = [[[NSOperationQueue alloc] init] autorelease];
-	[self.operationQueue setMaxConcurrentOperationCount:2];
+    self.operationQueue = [[AFHTTPOperationScheduler sharedScheduler] operationQueue];
+    self.requestPriority = AFHTTPRequestInteractivePriority;
+    
+    self.requestCoalescer = [[[AFHTTPRequestCoalescer alloc] init] autorelease];
+    self.retryPolicy = [[[AFHTTPRetryPolicy alloc] init] autorelease];
     
     return self;
 }
@@ -126,9 +335,25 @@ static NSString * AFURLEncodedStringFromStringWithEncoding(NSString *string, NSS
     [_baseURL release];
     [_defaultHeaders release];
     [_operationQueue release];
+    [_responseCache release];
+    [_requestCoalescer release];
+    [_retryPolicy release];
+    [_hedgingPolicy release];
+    [_requestBodyCompressionPolicy release];
+    [_transport release];
     [super dealloc];
 }
 
+- (void)prewarm {
+    [AFHTTPRequestOperation prewarmNetworkRequestThreads];
+    [AFJSONRequestOperation prewarmJSONProcessingQueues];
+    
+    id <AFHTTPTransport> transport = self.transport ? self.transport : [AFURLConnectionTransport sharedTransport];
+    if ([transport respondsToSelector:@selector(prewarmConnectionToURL:)]) {
+        [transport prewarmConnectionToURL:self.baseURL];
+    }
+}
+
 - (NSString *)defaultValueForHeader:(NSString *)header {
 	return [self.defaultHeaders valueForKey:header];
 }
@@ -180,6 +405,7 @@ static NSString * AFURLEncodedStringFromStringWithEncoding(NSString *string, NSS
 	[request setURL:url];
 	[request setHTTPMethod:method];
 	[request setAllHTTPHeaderFields:headers];
+    [self.requestBodyCompressionPolicy compressBodyOfRequest:request];
     
 	return request;
 }
@@ -218,6 +444,7 @@ static NSString * AFURLEncodedStringFromStringWithEncoding(NSString *string, NSS
     
     [request setValue:[NSString stringWithFormat:@"multipart/form-data; boundary=%@", kAFMultipartFormBoundary] forHTTPHeaderField:@"Content-Type"];
     [request setHTTPBody:[formData data]];
+    [self.requestBodyCompressionPolicy compressBodyOfRequest:request];
     
     [formData autorelease];
     
@@ -228,27 +455,203 @@ static NSString * AFURLEncodedStringFromStringWithEncoding(NSString *string, NSS
                                 success:(void (^)(id object))success 
                                 failure:(void (^)(NSHTTPURLResponse *response, NSError *error))failure 
 {
-    AFJSONRequestOperation *operation = [AFJSONRequestOperation operationWithRequest:urlRequest success:^(id JSON) {
-        if (success) {
-            success(JSON);
+    AFHTTPClientCompletionBlock handler = [[^(id JSON, NSHTTPURLResponse *response, NSError *error) {
+        if (error) {
+            if (failure) {
+                failure(response, error);
+            }
+        } else {
+            if (success) {
+                success(JSON);
+            }
         }
+    } copy] autorelease];
+    
+    if (![[urlRequest HTTPMethod] isEqualToString:@"GET"]) {
+        [self enqueueJSONOperationWithRequest:urlRequest retryCount:0 delay:0.0 completion:handler retryBlock:nil];
+        
+        return;
+    }
+    
+    AFHTTPOperationScheduler *scheduler = [AFHTTPOperationScheduler sharedScheduler];
+    AFHTTPRequestPriority requestPriority = self.requestPriority;
+    AFHTTPRequestCoalescer *requestCoalescer = self.requestCoalescer;
+    AFHTTPRequestOperation *coalescedOperation = [requestCoalescer addHandler:handler forRequest:urlRequest operationBlock:^AFHTTPRequestOperation *(id coalescedRequest) {
+        return [self enqueueJSONOperationWithRequest:urlRequest retryCount:0 delay:0.0 completion:^(id JSON, NSHTTPURLResponse *response, NSError *error) {
+            for (AFHTTPClientCompletionBlock coalescedHandler in [requestCoalescer handlersForFinishedCoalescedRequest:coalescedRequest]) {
+                coalescedHandler(JSON, response, error);
+            }
+        } retryBlock:^BOOL(AFHTTPRequestOperation *retryOperation) {
+            return [requestCoalescer setOperation:retryOperation forCoalescedRequest:coalescedRequest];
+        }];
+    }];
+    
+    // A higher-priority caller joining an operation that is still waiting raises its priority
+    if (requestPriority < [scheduler priorityForOperation:coalescedOperation]) {
+        [scheduler setPriority:requestPriority forOperation:coalescedOperation];
+    }
+}
+
+- (AFHTTPRequestOperation *)JSONOperationWithRequest:(NSURLRequest *)urlRequest 
+                                          completion:(AFHTTPClientCompletionBlock)completion
+{
+    // A body stream can only be read once, so each attempt sends its own stream, where one can be made. A compressed body gives the first attempt the stream the request was made with.
+    NSInputStream *bodyStream = AFHTTPBodyStreamForResendingRequest(urlRequest);
+    if (bodyStream) {
+        NSMutableURLRequest *mutableURLRequest = [[urlRequest mutableCopy] autorelease];
+        [mutableURLRequest setHTTPBodyStream:bodyStream];
+        urlRequest = mutableURLRequest;
+    }
+    
+    AFJSONRequestOperation *operation = [AFJSONRequestOperation operationWithRequest:urlRequest success:^(id JSON) {
+        completion(JSON, nil, nil);
     } failure:^(NSHTTPURLResponse *response, NSError *error) {
-        if (failure) {
-            failure(response, error);
+        completion(nil, response, error);
+    }];
+    operation.responseCache = self.responseCache;
+    
+    // Operations of every client share the scheduler's queue, and are tagged with the client that created them so that it only cancels its own
+    objc_setAssociatedObject(operation, &kAFHTTPClientOperationClientKey, self, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    
+    if (self.transport) {
+        operation.transport = self.transport;
+    }
+    
+    return operation;
+}
+
+- (AFHTTPRequestOperation *)enqueueJSONOperationWithRequest:(NSURLRequest *)urlRequest 
+                                                 retryCount:(NSUInteger)retryCount 
+                                                      delay:(NSTimeInterval)delay 
+                                                 completion:(AFHTTPClientCompletionBlock)completion 
+                                                 retryBlock:(BOOL (^)(AFHTTPRequestOperation *retryOperation))retryBlock
+{
+    AFHTTPRetryPolicy *retryPolicy = self.retryPolicy;
+    if (retryCount == 0) {
+        [retryPolicy recordRequest];
+    }
+    
+    // The latency of the first request is measured up to its callback, so that it includes any retries
+    if (retryCount == 0 && _firstRequestStartTime == 0) {
+        CFAbsoluteTime startTime = CFAbsoluteTimeGetCurrent();
+        _firstRequestStartTime = startTime;
+        
+        AFHTTPClientCompletionBlock requestCompletion = completion;
+        completion = [[^(id JSON, NSHTTPURLResponse *response, NSError *error) {
+            self.firstRequestLatency = CFAbsoluteTimeGetCurrent() - startTime;
+            requestCompletion(JSON, response, error);
+        } copy] autorelease];
+    }
+    
+    AFHTTPHedgingPolicy *hedgingPolicy = self.hedgingPolicy;
+    [hedgingPolicy recordRequest];
+    
+    AFHTTPHedgedRequest *hedgedRequest = [[[AFHTTPHedgedRequest alloc] init] autorelease];
+    AFHTTPClientOperationCompletionBlock operationCompletion = ^(BOOL isHedge, id JSON, NSHTTPURLResponse *response, NSError *error) {
+        void (^resolution)(void) = ^{
+            if ([hedgedRequest isHedged]) {
+                [hedgingPolicy recordWinnerOfHedgedRequest:isHedge];
+            }
+            
+            // Retries reuse the original request, rather than building it again with `requestWithMethod:path:parameters:`
+            NSTimeInterval retryDelay = 0.0;
+            if (error && [retryPolicy shouldRetryRequest:urlRequest response:response error:error retryCount:retryCount delay:&retryDelay] && [self enqueueJSONOperationWithRequest:urlRequest retryCount:(retryCount + 1) delay:retryDelay completion:completion retryBlock:retryBlock]) {
+                [hedgedRequest cancelLosingOperation];
+                return;
+            }
+            
+            completion(JSON, response, error);
+            
+            [hedgedRequest cancelLosingOperation];
+        };
+        
+        // The first copy of a hedged request to succeed is delivered, and the other is then cancelled. A failure is delivered only once the other copy has failed too.
+        if ([hedgedRequest resolveWithOperationIsHedge:isHedge failed:(error != nil) pendingFailureBlock:resolution]) {
+            resolution();
         }
+    };
+    
+    AFHTTPRequestOperation *operation = [self JSONOperationWithRequest:urlRequest completion:^(id JSON, NSHTTPURLResponse *response, NSError *error) {
+        operationCompletion(NO, JSON, response, error);
     }];
     
-    [self.operationQueue addOperation:operation];
+    // Callers that are no longer waiting for a coalesced request decline its retry
+    if (retryCount > 0 && retryBlock && !retryBlock(operation)) {
+        return nil;
+    }
+    
+    [hedgedRequest setPrimaryOperation:operation];
+    [[AFHTTPOperationScheduler sharedScheduler] enqueueOperation:operation priority:self.requestPriority afterDelay:delay];
+    
+    NSTimeInterval hedgingDelay = hedgingPolicy ? [hedgingPolicy hedgingDelayForRequest:urlRequest] : -1.0;
+    if (hedgingDelay >= 0.0) {
+        [self scheduleHedgeOfRequest:urlRequest hedgedRequest:hedgedRequest hedgingDelay:hedgingDelay afterDelay:(delay + hedgingDelay) completion:operationCompletion];
+    }
+    
+    return operation;
+}
+
+- (void)scheduleHedgeOfRequest:(NSURLRequest *)urlRequest 
+                 hedgedRequest:(AFHTTPHedgedRequest *)hedgedRequest 
+                  hedgingDelay:(NSTimeInterval)hedgingDelay 
+                    afterDelay:(NSTimeInterval)delay 
+                    completion:(AFHTTPClientOperationCompletionBlock)completion
+{
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+        AFHTTPRequestOperation *primaryOperation = [hedgedRequest primaryOperation];
+        if (!primaryOperation || [primaryOperation isCancelled] || [primaryOperation timeForTimingPoint:AFHTTPRequestOperationResponseReceivedTimingPoint] != 0) {
+            return;
+        }
+        
+        // The wait for the first byte is measured from when the connection started, so that a request still waiting for a free slot is not hedged into the same queue
+        CFAbsoluteTime connectionStartedTime = [primaryOperation timeForTimingPoint:AFHTTPRequestOperationConnectionStartedTimingPoint];
+        NSTimeInterval elapsedTime = connectionStartedTime > 0 ? CFAbsoluteTimeGetCurrent() - connectionStartedTime : 0.0;
+        if (connectionStartedTime == 0 || elapsedTime < hedgingDelay) {
+            [self scheduleHedgeOfRequest:urlRequest hedgedRequest:hedgedRequest hedgingDelay:hedgingDelay afterDelay:MAX(hedgingDelay - elapsedTime, 0.01) completion:completion];
+            return;
+        }
+        
+        if (![self.hedgingPolicy consumeHedgeToken]) {
+            return;
+        }
+        
+        AFHTTPRequestOperation *hedgeOperation = [self JSONOperationWithRequest:urlRequest completion:^(id JSON, NSHTTPURLResponse *response, NSError *error) {
+            completion(YES, JSON, response, error);
+        }];
+        
+        if ([hedgedRequest setHedgeOperation:hedgeOperation]) {
+            [[AFHTTPOperationScheduler sharedScheduler] enqueueOperation:hedgeOperation priority:self.requestPriority];
+        }
+    });
+}
+
+- (NSArray *)HTTPOperations {
+    NSMutableArray *mutableOperations = [NSMutableArray array];
+    for (AFHTTPRequestOperation *operation in [[AFHTTPOperationScheduler sharedScheduler] operations]) {
+        if (objc_getAssociatedObject(operation, &kAFHTTPClientOperationClientKey) == self) {
+            [mutableOperations addObject:operation];
+        }
+    }
+    
+    return mutableOperations;
 }
 
 - (void)cancelHTTPOperationsWithMethod:(NSString *)method andURL:(NSURL *)url {
-    for (AFHTTPRequestOperation *operation in [self.operationQueue operations]) {
+    for (AFHTTPRequestOperation *operation in [self HTTPOperations]) {
         if ([[[operation request] HTTPMethod] isEqualToString:method] && [[[operation request] URL] isEqual:url]) {
+            [self.requestCoalescer removeCoalescedRequestForOperation:operation];
             [operation cancel];
         }
     }
 }
 
+- (void)cancelAllHTTPOperations {
+    for (AFHTTPRequestOperation *operation in [self HTTPOperations]) {
+        [self.requestCoalescer removeCoalescedRequestForOperation:operation];
+        [operation cancel];
+    }
+}
+
 #pragma mark -
 
 - (void)getPath:(NSString *)path 
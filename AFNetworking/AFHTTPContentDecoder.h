@@ -0,0 +1,120 @@
+// AFHTTPContentDecoder.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import <Foundation/Foundation.h>
+
+// The zstd and brotli decoders are built when their libraries' headers can be found, and the libraries must then be linked by the application
+#ifndef AFNETWORKING_ZSTD_AVAILABLE
+#if defined(__has_include)
+#if __has_include(<zstd.h>)
+#define AFNETWORKING_ZSTD_AVAILABLE 1
+#endif
+#endif
+#endif
+
+#ifndef AFNETWORKING_BROTLI_AVAILABLE
+#if defined(__has_include)
+#if __has_include(<brotli/decode.h>)
+#define AFNETWORKING_BROTLI_AVAILABLE 1
+#endif
+#endif
+#endif
+
+/**
+ The `AFHTTPContentDecoder` protocol is adopted by objects that decode a response body sent with a content coding, such as `gzip`, incrementally as its chunks are received.
+ 
+ @discussion A decoder is created with `init` for each response, and is sent each chunk of the encoded body in order, followed by `finishDecoding:`. It is used on one serial queue at a time, and need not be thread-safe.
+ 
+ @see +[AFHTTPRequestOperation registerContentDecoderClass:forContentCoding:]
+ */
+@protocol AFHTTPContentDecoder <NSObject>
+
+/**
+ Decodes the next chunk of the encoded body.
+ 
+ @param data The encoded chunk.
+ @param error If the chunk could not be decoded, upon return contains an error describing the problem.
+ 
+ @return The decoded data that became available, which may be empty, or `nil` if the chunk could not be decoded.
+ */
+- (NSData *)decodeData:(NSData *)data 
+                 error:(NSError **)error;
+
+/**
+ Finishes decoding once the whole encoded body has been received.
+ 
+ @param error If the encoded body was truncated or invalid, upon return contains an error describing the problem.
+ 
+ @return Any remaining decoded data, which may be empty, or `nil` if the body could not be decoded.
+ */
+- (NSData *)finishDecoding:(NSError **)error;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFZlibContentDecoder` decodes the `gzip` and `deflate` content codings with zlib. Bodies sent as `deflate` are accepted both in the zlib format specified by RFC 1950 and as the raw deflate data sent by some servers.
+ */
+@interface AFZlibContentDecoder : NSObject <AFHTTPContentDecoder> {
+@private
+    void *_stream;
+    BOOL _receivedData;
+    BOOL _rawDeflate;
+    BOOL _finished;
+}
+
+@end
+
+#if AFNETWORKING_ZSTD_AVAILABLE
+
+#pragma mark -
+
+/**
+ `AFZstdContentDecoder` decodes the `zstd` content coding, as specified by RFC 8478.
+ */
+@interface AFZstdContentDecoder : NSObject <AFHTTPContentDecoder> {
+@private
+    void *_stream;
+    BOOL _finished;
+}
+
+@end
+
+#endif
+
+#if AFNETWORKING_BROTLI_AVAILABLE
+
+#pragma mark -
+
+/**
+ `AFBrotliContentDecoder` decodes the `br` content coding, as specified by RFC 7932.
+ */
+@interface AFBrotliContentDecoder : NSObject <AFHTTPContentDecoder> {
+@private
+    void *_state;
+}
+
+@end
+
+#endif
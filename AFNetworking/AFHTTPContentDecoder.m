@@ -0,0 +1,297 @@
+// AFHTTPContentDecoder.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import "AFHTTPContentDecoder.h"
+#import "AFHTTPRequestOperation.h"
+
+#include <zlib.h>
+
+#if AFNETWORKING_ZSTD_AVAILABLE
+#include <zstd.h>
+#endif
+
+#if AFNETWORKING_BROTLI_AVAILABLE
+#include <brotli/decode.h>
+#endif
+
+static NSUInteger const kAFContentDecoderBufferLength = 64 * 1024;
+
+static NSError * AFContentDecodingError(NSString *failureReason) {
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+    [userInfo setValue:NSLocalizedString(@"The response body could not be decoded", nil) forKey:NSLocalizedDescriptionKey];
+    [userInfo setValue:failureReason forKey:NSLocalizedFailureReasonErrorKey];
+    
+    return [[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorCannotDecodeContentData userInfo:userInfo] autorelease];
+}
+
+#pragma mark -
+
+@implementation AFZlibContentDecoder
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _stream = calloc(1, sizeof(z_stream));
+    
+    // Adding 32 to the window bits detects a gzip or zlib header automatically
+    if (inflateInit2((z_stream *)_stream, MAX_WBITS + 32) != Z_OK) {
+        free(_stream);
+        [self release];
+        return nil;
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    inflateEnd((z_stream *)_stream);
+    free(_stream);
+    [super dealloc];
+}
+
+- (NSData *)decodeData:(NSData *)data 
+                 error:(NSError **)error
+{
+    z_stream *stream = (z_stream *)_stream;
+    BOOL isFirstChunk = !_receivedData;
+    _receivedData = YES;
+    
+    NSMutableData *mutableData = [NSMutableData data];
+    uint8_t buffer[kAFContentDecoderBufferLength];
+    
+    stream->next_in = (Bytef *)[data bytes];
+    stream->avail_in = (uInt)[data length];
+    
+    BOOL hasPendingOutput = NO;
+    while (stream->avail_in > 0 || hasPendingOutput) {
+        stream->next_out = buffer;
+        stream->avail_out = sizeof(buffer);
+        
+        int status = inflate(stream, Z_NO_FLUSH);
+        
+        // Servers that send `deflate` as raw deflate data, without the zlib header, are detected by the header failing to parse
+        if (status == Z_DATA_ERROR && isFirstChunk && [mutableData length] == 0) {
+            isFirstChunk = NO;
+            _rawDeflate = YES;
+            inflateEnd(stream);
+            if (inflateInit2(stream, -MAX_WBITS) != Z_OK) {
+                break;
+            }
+            
+            stream->next_in = (Bytef *)[data bytes];
+            stream->avail_in = (uInt)[data length];
+            continue;
+        }
+        
+        if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) {
+            if (error) {
+                *error = AFContentDecodingError(stream->msg ? [NSString stringWithUTF8String:stream->msg] : nil);
+            }
+            
+            return nil;
+        }
+        
+        [mutableData appendBytes:buffer length:(sizeof(buffer) - stream->avail_out)];
+        
+        // A full output buffer may leave inflated data buffered in the stream, even once all of the input has been consumed
+        hasPendingOutput = stream->avail_out == 0 && status != Z_STREAM_END;
+        
+        // A gzip body may consist of several members, each of which ends the stream, and is complete if it ends with the end of a member
+        _finished = status == Z_STREAM_END;
+        if (_finished) {
+            isFirstChunk = NO;
+            if (_rawDeflate) {
+                break;
+            }
+            
+            inflateReset(stream);
+        }
+    }
+    
+    return mutableData;
+}
+
+- (NSData *)finishDecoding:(NSError **)error {
+    if (!_finished) {
+        if (error) {
+            *error = AFContentDecodingError(NSLocalizedString(@"The compressed data ended unexpectedly", nil));
+        }
+        
+        return nil;
+    }
+    
+    return [NSData data];
+}
+
+@end
+
+#if AFNETWORKING_ZSTD_AVAILABLE
+
+#pragma mark -
+
+@implementation AFZstdContentDecoder
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _stream = ZSTD_createDStream();
+    if (!_stream || ZSTD_isError(ZSTD_initDStream((ZSTD_DStream *)_stream))) {
+        [self release];
+        return nil;
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    if (_stream) {
+        ZSTD_freeDStream((ZSTD_DStream *)_stream);
+    }
+    
+    [super dealloc];
+}
+
+- (NSData *)decodeData:(NSData *)data 
+                 error:(NSError **)error
+{
+    NSMutableData *mutableData = [NSMutableData data];
+    uint8_t buffer[kAFContentDecoderBufferLength];
+    
+    ZSTD_inBuffer input = {[data bytes], [data length], 0};
+    BOOL hasPendingOutput = NO;
+    while (input.pos < input.size || hasPendingOutput) {
+        ZSTD_outBuffer output = {buffer, sizeof(buffer), 0};
+        size_t result = ZSTD_decompressStream((ZSTD_DStream *)_stream, &output, &input);
+        if (ZSTD_isError(result)) {
+            if (error) {
+                *error = AFContentDecodingError([NSString stringWithUTF8String:ZSTD_getErrorName(result)]);
+            }
+            
+            return nil;
+        }
+        
+        [mutableData appendBytes:buffer length:output.pos];
+        
+        // A full output buffer may leave decoded data buffered in the stream, even once all of the input has been consumed
+        hasPendingOutput = output.pos == output.size;
+        
+        // A result of 0 means that a frame has been decoded and flushed in full, and the body may go on with another frame
+        _finished = result == 0;
+    }
+    
+    return mutableData;
+}
+
+- (NSData *)finishDecoding:(NSError **)error {
+    if (!_finished) {
+        if (error) {
+            *error = AFContentDecodingError(NSLocalizedString(@"The compressed data ended unexpectedly", nil));
+        }
+        
+        return nil;
+    }
+    
+    return [NSData data];
+}
+
+@end
+
+#endif
+
+#if AFNETWORKING_BROTLI_AVAILABLE
+
+#pragma mark -
+
+@implementation AFBrotliContentDecoder
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _state = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+    if (!_state) {
+        [self release];
+        return nil;
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    if (_state) {
+        BrotliDecoderDestroyInstance((BrotliDecoderState *)_state);
+    }
+    
+    [super dealloc];
+}
+
+- (NSData *)decodeData:(NSData *)data 
+                 error:(NSError **)error
+{
+    NSMutableData *mutableData = [NSMutableData data];
+    uint8_t buffer[kAFContentDecoderBufferLength];
+    
+    size_t availableIn = [data length];
+    const uint8_t *nextIn = [data bytes];
+    BrotliDecoderResult result;
+    do {
+        size_t availableOut = sizeof(buffer);
+        uint8_t *nextOut = buffer;
+        result = BrotliDecoderDecompressStream((BrotliDecoderState *)_state, &availableIn, &nextIn, &availableOut, &nextOut, NULL);
+        if (result == BROTLI_DECODER_RESULT_ERROR) {
+            if (error) {
+                *error = AFContentDecodingError([NSString stringWithUTF8String:BrotliDecoderErrorString(BrotliDecoderGetErrorCode((BrotliDecoderState *)_state))]);
+            }
+            
+            return nil;
+        }
+        
+        [mutableData appendBytes:buffer length:(sizeof(buffer) - availableOut)];
+    } while (result == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT);
+    
+    return mutableData;
+}
+
+- (NSData *)finishDecoding:(NSError **)error {
+    if (!BrotliDecoderIsFinished((BrotliDecoderState *)_state)) {
+        if (error) {
+            *error = AFContentDecodingError(NSLocalizedString(@"The compressed data ended unexpectedly", nil));
+        }
+        
+        return nil;
+    }
+    
+    return [NSData data];
+}
+
+@end
+
+#endif
@@ -0,0 +1,138 @@
+// AFHTTPHedgingPolicy.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ `AFHTTPHedgingPolicy` decides when a second copy of a slow request should be sent, so that a request stuck on a slow connection does not dominate tail latency.
+ 
+ A request is hedged if its method is idempotent and its connection has not received the first byte of a response by the `hedgingPercentile` of the time to first byte observed for requests with the same host and path template, as recorded by `+[AFHTTPRequestOperation latencyHistogramForRequest:timingKey:]`. Requests for which fewer than `minimumSampleCount` responses have been observed are not hedged.
+ 
+ Hedges are limited by a token bucket. Each request deposits `hedgeBudgetRatio` tokens, up to `hedgeBudgetCapacity`, and each hedge withdraws one. Once the bucket is empty, slow requests are left to finish on their own, so that hedges never add more than that fraction of traffic.
+ 
+ @discussion `AFHTTPHedgingPolicy` is thread-safe.
+ */
+@interface AFHTTPHedgingPolicy : NSObject {
+@private
+    NSSet *_hedgeableHTTPMethods;
+    double _hedgingPercentile;
+    unsigned long long _minimumSampleCount;
+    double _hedgeBudgetRatio;
+    double _hedgeBudgetCapacity;
+    double _hedgeBudget;
+    NSUInteger _hedgeCount;
+    NSUInteger _primaryWinCount;
+    NSUInteger _hedgeWinCount;
+    NSUInteger _exhaustedHedgeBudgetCount;
+}
+
+///-------------------------------
+/// @name Configuring Hedging
+///-------------------------------
+
+/**
+ The HTTP methods of requests that may be hedged. This is `GET` and `HEAD` by default.
+ */
+@property (nonatomic, copy) NSSet *hedgeableHTTPMethods;
+
+/**
+ The percentile of observed times to first byte after which a request is hedged. This is `95.0` by default.
+ */
+@property (nonatomic, assign) double hedgingPercentile;
+
+/**
+ The number of observed times to first byte required before requests with a given host and path template are hedged. This is 20 by default.
+ */
+@property (nonatomic, assign) unsigned long long minimumSampleCount;
+
+/**
+ The number of hedge tokens deposited by each request. This is `0.05` by default, which allows hedges to add at most 5% to traffic once the initial budget has been spent.
+ */
+@property (nonatomic, assign) double hedgeBudgetRatio;
+
+/**
+ The maximum number of hedge tokens that can be saved up, and the number the budget starts with. This is `5` by default.
+ */
+@property (nonatomic, assign) double hedgeBudgetCapacity;
+
+///-------------------------------
+/// @name Getting Hedging Statistics
+///-------------------------------
+
+/**
+ The number of hedge tokens currently available.
+ */
+@property (readonly, nonatomic, assign) double hedgeBudget;
+
+/**
+ The number of hedges that have been sent.
+ */
+@property (readonly, nonatomic, assign) NSUInteger hedgeCount;
+
+/**
+ The number of hedged requests for which the original request finished first.
+ */
+@property (readonly, nonatomic, assign) NSUInteger primaryWinCount;
+
+/**
+ The number of hedged requests for which the hedge finished first.
+ */
+@property (readonly, nonatomic, assign) NSUInteger hedgeWinCount;
+
+/**
+ The number of slow requests that would have been hedged, but were not because the hedge budget was empty.
+ */
+@property (readonly, nonatomic, assign) NSUInteger exhaustedHedgeBudgetCount;
+
+///-------------------------------
+/// @name Deciding Whether to Hedge
+///-------------------------------
+
+/**
+ Records that a request is being sent, which deposits `hedgeBudgetRatio` tokens into the hedge budget.
+ */
+- (void)recordRequest;
+
+/**
+ Returns how long a request's connection may wait for the first byte of a response before the request is hedged.
+ 
+ @param request The request.
+ 
+ @return The delay, or a negative value if the request should not be hedged.
+ */
+- (NSTimeInterval)hedgingDelayForRequest:(NSURLRequest *)request;
+
+/**
+ Withdraws a token from the hedge budget to send a hedge.
+ 
+ @return `YES` if the hedge should be sent, or `NO` if the hedge budget is empty.
+ */
+- (BOOL)consumeHedgeToken;
+
+/**
+ Records which of the two copies of a hedged request finished first.
+ 
+ @param hedgeWon `YES` if the hedge finished first, or `NO` if the original request did.
+ */
+- (void)recordWinnerOfHedgedRequest:(BOOL)hedgeWon;
+
+@end
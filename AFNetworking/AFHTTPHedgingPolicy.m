@@ -0,0 +1,116 @@
+// AFHTTPHedgingPolicy.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPHedgingPolicy.h"
+#import "AFHTTPRequestOperation.h"
+#import "AFHTTPLatencyHistogram.h"
+
+static double const kAFHTTPHedgingPolicyDefaultHedgingPercentile = 95.0;
+static unsigned long long const kAFHTTPHedgingPolicyDefaultMinimumSampleCount = 20;
+static double const kAFHTTPHedgingPolicyDefaultHedgeBudgetRatio = 0.05;
+static double const kAFHTTPHedgingPolicyDefaultHedgeBudgetCapacity = 5.0;
+
+@interface AFHTTPHedgingPolicy ()
+@property (readwrite, nonatomic, assign) double hedgeBudget;
+@property (readwrite, nonatomic, assign) NSUInteger hedgeCount;
+@property (readwrite, nonatomic, assign) NSUInteger primaryWinCount;
+@property (readwrite, nonatomic, assign) NSUInteger hedgeWinCount;
+@property (readwrite, nonatomic, assign) NSUInteger exhaustedHedgeBudgetCount;
+@end
+
+@implementation AFHTTPHedgingPolicy
+@synthesize hedgeableHTTPMethods = _hedgeableHTTPMethods;
+@synthesize hedgingPercentile = _hedgingPercentile;
+@synthesize minimumSampleCount = _minimumSampleCount;
+@synthesize hedgeBudgetRatio = _hedgeBudgetRatio;
+@synthesize hedgeBudgetCapacity = _hedgeBudgetCapacity;
+@synthesize hedgeBudget = _hedgeBudget;
+@synthesize hedgeCount = _hedgeCount;
+@synthesize primaryWinCount = _primaryWinCount;
+@synthesize hedgeWinCount = _hedgeWinCount;
+@synthesize exhaustedHedgeBudgetCount = _exhaustedHedgeBudgetCount;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.hedgeableHTTPMethods = [NSSet setWithObjects:@"GET", @"HEAD", nil];
+    self.hedgingPercentile = kAFHTTPHedgingPolicyDefaultHedgingPercentile;
+    self.minimumSampleCount = kAFHTTPHedgingPolicyDefaultMinimumSampleCount;
+    self.hedgeBudgetRatio = kAFHTTPHedgingPolicyDefaultHedgeBudgetRatio;
+    self.hedgeBudgetCapacity = kAFHTTPHedgingPolicyDefaultHedgeBudgetCapacity;
+    self.hedgeBudget = self.hedgeBudgetCapacity;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_hedgeableHTTPMethods release];
+    [super dealloc];
+}
+
+- (void)recordRequest {
+    @synchronized(self) {
+        self.hedgeBudget = MIN(self.hedgeBudget + self.hedgeBudgetRatio, self.hedgeBudgetCapacity);
+    }
+}
+
+- (NSTimeInterval)hedgingDelayForRequest:(NSURLRequest *)request {
+    if (![self.hedgeableHTTPMethods containsObject:[[request HTTPMethod] uppercaseString] ?: @"GET"]) {
+        return -1.0;
+    }
+    
+    AFHTTPLatencyHistogram *histogram = [AFHTTPRequestOperation latencyHistogramForRequest:request timingKey:AFHTTPRequestOperationTimeToFirstByteTimingKey];
+    if (!histogram || histogram.totalCount < MAX(self.minimumSampleCount, 1ULL)) {
+        return -1.0;
+    }
+    
+    return [histogram valueAtPercentile:self.hedgingPercentile];
+}
+
+- (BOOL)consumeHedgeToken {
+    @synchronized(self) {
+        if (self.hedgeBudget < 1.0) {
+            self.exhaustedHedgeBudgetCount++;
+            return NO;
+        }
+        
+        self.hedgeBudget -= 1.0;
+        self.hedgeCount++;
+        
+        return YES;
+    }
+}
+
+- (void)recordWinnerOfHedgedRequest:(BOOL)hedgeWon {
+    @synchronized(self) {
+        if (hedgeWon) {
+            self.hedgeWinCount++;
+        } else {
+            self.primaryWinCount++;
+        }
+    }
+}
+
+@end
@@ -0,0 +1,77 @@
+// AFHTTPLatencyHistogram.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ `AFHTTPLatencyHistogram` records a distribution of durations in constant memory, in the manner of an HDR histogram.
+ 
+ @discussion Durations are recorded with microsecond resolution in logarithmically-sized buckets, each of which is divided into 16 linear sub-buckets, so that any recorded value is reported to within about 3% of its true value, for durations from 1 microsecond up to about 12 days.
+ 
+ Histograms are not thread-safe. The histograms returned by `+[AFHTTPRequestOperation latencyHistograms]` are copies, which may be read on any thread.
+ */
+@interface AFHTTPLatencyHistogram : NSObject <NSCopying> {
+@private
+    uint32_t *_counts;
+    unsigned long long _totalCount;
+    unsigned long long _minimumValue;
+    unsigned long long _maximumValue;
+    double _sum;
+}
+
+/**
+ The number of durations recorded.
+ */
+@property (readonly, nonatomic, assign) unsigned long long totalCount;
+
+/**
+ The shortest duration recorded, in seconds.
+ */
+- (NSTimeInterval)minimum;
+
+/**
+ The longest duration recorded, in seconds.
+ */
+- (NSTimeInterval)maximum;
+
+/**
+ The mean of the durations recorded, in seconds.
+ */
+- (NSTimeInterval)mean;
+
+/**
+ Returns the duration below which the specified percentage of recorded durations fall.
+ 
+ @param percentile The percentile, between `0` and `100`.
+ 
+ @return The duration at the percentile, in seconds, or `0` if no durations have been recorded.
+ */
+- (NSTimeInterval)valueAtPercentile:(double)percentile;
+
+/**
+ Records a duration.
+ 
+ @param duration The duration, in seconds. Negative durations are recorded as `0`.
+ */
+- (void)recordDuration:(NSTimeInterval)duration;
+
+@end
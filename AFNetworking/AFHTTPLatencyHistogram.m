@@ -0,0 +1,133 @@
+// AFHTTPLatencyHistogram.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPLatencyHistogram.h"
+
+static NSUInteger const kAFHTTPLatencyHistogramSubBucketBits = 4;
+static NSUInteger const kAFHTTPLatencyHistogramSubBucketCount = 1 << kAFHTTPLatencyHistogramSubBucketBits;
+static NSUInteger const kAFHTTPLatencyHistogramMaximumExponent = 40;
+static NSUInteger const kAFHTTPLatencyHistogramBucketCount = kAFHTTPLatencyHistogramSubBucketCount + (kAFHTTPLatencyHistogramMaximumExponent - kAFHTTPLatencyHistogramSubBucketBits) * kAFHTTPLatencyHistogramSubBucketCount;
+
+// Values below the sub-bucket count are counted exactly; larger values are counted in the sub-bucket given by the 4 bits below their most significant bit
+static inline NSUInteger AFHTTPLatencyHistogramIndexForValue(unsigned long long value) {
+    if (value < kAFHTTPLatencyHistogramSubBucketCount) {
+        return (NSUInteger)value;
+    }
+    
+    NSUInteger exponent = 63 - __builtin_clzll(value);
+    if (exponent >= kAFHTTPLatencyHistogramMaximumExponent) {
+        return kAFHTTPLatencyHistogramBucketCount - 1;
+    }
+    
+    NSUInteger subBucket = (NSUInteger)(value >> (exponent - kAFHTTPLatencyHistogramSubBucketBits)) & (kAFHTTPLatencyHistogramSubBucketCount - 1);
+    
+    return kAFHTTPLatencyHistogramSubBucketCount + (exponent - kAFHTTPLatencyHistogramSubBucketBits) * kAFHTTPLatencyHistogramSubBucketCount + subBucket;
+}
+
+static inline unsigned long long AFHTTPLatencyHistogramValueForIndex(NSUInteger idx) {
+    if (idx < kAFHTTPLatencyHistogramSubBucketCount) {
+        return idx;
+    }
+    
+    NSUInteger exponent = (idx - kAFHTTPLatencyHistogramSubBucketCount) / kAFHTTPLatencyHistogramSubBucketCount + kAFHTTPLatencyHistogramSubBucketBits;
+    NSUInteger subBucket = (idx - kAFHTTPLatencyHistogramSubBucketCount) % kAFHTTPLatencyHistogramSubBucketCount;
+    unsigned long long lowerBound = (unsigned long long)(kAFHTTPLatencyHistogramSubBucketCount + subBucket) << (exponent - kAFHTTPLatencyHistogramSubBucketBits);
+    unsigned long long bucketWidth = 1ULL << (exponent - kAFHTTPLatencyHistogramSubBucketBits);
+    
+    return lowerBound + bucketWidth / 2;
+}
+
+@implementation AFHTTPLatencyHistogram
+@synthesize totalCount = _totalCount;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _counts = calloc(kAFHTTPLatencyHistogramBucketCount, sizeof(uint32_t));
+    
+    return self;
+}
+
+- (void)dealloc {
+    free(_counts);
+    [super dealloc];
+}
+
+- (NSTimeInterval)minimum {
+    return _totalCount > 0 ? _minimumValue / (double)USEC_PER_SEC : 0.0;
+}
+
+- (NSTimeInterval)maximum {
+    return _maximumValue / (double)USEC_PER_SEC;
+}
+
+- (NSTimeInterval)mean {
+    return _totalCount > 0 ? (_sum / _totalCount) / (double)USEC_PER_SEC : 0.0;
+}
+
+- (NSTimeInterval)valueAtPercentile:(double)percentile {
+    if (_totalCount == 0) {
+        return 0.0;
+    }
+    
+    unsigned long long countAtPercentile = (unsigned long long)ceil((MIN(MAX(percentile, 0.0), 100.0) / 100.0) * _totalCount);
+    countAtPercentile = MAX(countAtPercentile, 1ULL);
+    
+    unsigned long long cumulativeCount = 0;
+    for (NSUInteger idx = 0; idx < kAFHTTPLatencyHistogramBucketCount; idx++) {
+        cumulativeCount += _counts[idx];
+        if (cumulativeCount >= countAtPercentile) {
+            unsigned long long value = MIN(MAX(AFHTTPLatencyHistogramValueForIndex(idx), _minimumValue), _maximumValue);
+            return value / (double)USEC_PER_SEC;
+        }
+    }
+    
+    return [self maximum];
+}
+
+- (void)recordDuration:(NSTimeInterval)duration {
+    unsigned long long value = (unsigned long long)(MAX(duration, 0.0) * USEC_PER_SEC);
+    
+    _counts[AFHTTPLatencyHistogramIndexForValue(value)]++;
+    _minimumValue = _totalCount > 0 ? MIN(_minimumValue, value) : value;
+    _maximumValue = MAX(_maximumValue, value);
+    _sum += value;
+    _totalCount++;
+}
+
+#pragma mark - NSCopying
+
+- (id)copyWithZone:(NSZone *)zone {
+    AFHTTPLatencyHistogram *histogram = [[[self class] allocWithZone:zone] init];
+    memcpy(histogram->_counts, _counts, kAFHTTPLatencyHistogramBucketCount * sizeof(uint32_t));
+    histogram->_totalCount = _totalCount;
+    histogram->_minimumValue = _minimumValue;
+    histogram->_maximumValue = _maximumValue;
+    histogram->_sum = _sum;
+    
+    return histogram;
+}
+
+@end
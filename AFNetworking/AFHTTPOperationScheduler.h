@@ -0,0 +1,163 @@
+// AFHTTPOperationScheduler.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+@class AFHTTPRequestOperation;
+
+/**
+ Priority classes for operations enqueued with an `AFHTTPOperationScheduler`, from highest to lowest.
+ 
+ - `AFHTTPRequestInteractivePriority`: Work the user is waiting on, such as loading the screen they are looking at.
+ - `AFHTTPRequestNormalPriority`: Work that is needed soon, such as images for visible cells.
+ - `AFHTTPRequestPrefetchPriority`: Work that may be needed soon, such as images for cells that are about to scroll into view.
+ - `AFHTTPRequestBackgroundPriority`: Work that is not needed by the user interface, such as synchronization.
+ */
+typedef enum {
+    AFHTTPRequestInteractivePriority    = 0,
+    AFHTTPRequestNormalPriority         = 1,
+    AFHTTPRequestPrefetchPriority       = 2,
+    AFHTTPRequestBackgroundPriority     = 3,
+} AFHTTPRequestPriority;
+
+/**
+ `AFHTTPOperationScheduler` runs operations from `AFHTTPClient` and `UIImageView+AFNetworking` on a single operation queue, ordered by priority class, so that a burst of image loads cannot delay a request the user is waiting on.
+ 
+ @discussion Priority classes map onto the `queuePriority` of operations. To prevent starvation, the queue priority of an operation that has been waiting is raised by one level for each `agingInterval` it has waited, until it reaches that of interactive operations. An operation that has not yet started can be reprioritized, such as when the cell that requested it scrolls into view.
+ 
+ Each host has its own budget of operations in flight, so that a slow host cannot hold every slot of the operation queue while requests to other hosts wait. Operations for a host that is at its budget are held by the scheduler, and added to the operation queue, highest priority first, as operations for that host finish. The operation queue's `maxConcurrentOperationCount` is the process-wide cap across all hosts.
+ 
+ Unless a host has a budget of its own, its budget adapts to what the host and the network can sustain, using additive increase and multiplicative decrease (AIMD). Each completed operation contributes a round-trip time, from the connection starting to the response arriving. Round-trip times are smoothed with an exponentially weighted moving average. While the average stays within twice the lowest round-trip time seen for the host, and the host is using at least half of its budget, the budget grows by about one operation per budget's worth of completions. When the average exceeds that, or an operation times out, loses its connection, or is answered with `429 Too Many Requests` or `503 Service Unavailable`, the budget shrinks by 10%, at most once per average round-trip time.
+ */
+@interface AFHTTPOperationScheduler : NSObject {
+@private
+    NSOperationQueue *_operationQueue;
+    NSTimeInterval _agingInterval;
+    NSUInteger _maximumConcurrentOperationCountPerHost;
+    NSMutableDictionary *_maximumConcurrentOperationCountsByHost;
+    NSMutableDictionary *_concurrencyLimitsByHost;
+    BOOL _adaptsConcurrencyPerHost;
+    NSMutableDictionary *_operationCountsByHost;
+    NSMutableArray *_scheduledOperations;
+    dispatch_queue_t _queue;
+    dispatch_source_t _agingTimer;
+    BOOL _agingTimerSuspended;
+}
+
+///--------------------------------------
+/// @name Configuring the Scheduler
+///--------------------------------------
+
+/**
+ The operation queue on which scheduled operations run. Its maximum number of concurrent operations, which caps the number of operations in flight across all hosts, is 16 by default.
+ */
+@property (readonly, nonatomic, retain) NSOperationQueue *operationQueue;
+
+/**
+ The time an operation waits before its queue priority is raised by one level. This is 1 second by default.
+ */
+@property (nonatomic, assign) NSTimeInterval agingInterval;
+
+/**
+ The maximum number of operations in flight for any one host that has no budget of its own. This is 4 by default. When `adaptsConcurrencyPerHost` is `YES`, this is the budget each host starts with.
+ */
+@property (nonatomic, assign) NSUInteger maximumConcurrentOperationCountPerHost;
+
+/**
+ Whether the budgets of hosts without a budget of their own adapt to measured round-trip times and errors, between 1 and the operation queue's `maxConcurrentOperationCount`. This is `YES` by default.
+ */
+@property (nonatomic, assign) BOOL adaptsConcurrencyPerHost;
+
+/**
+ Returns the scheduler shared by `AFHTTPClient` and `UIImageView+AFNetworking`.
+ */
++ (AFHTTPOperationScheduler *)sharedScheduler;
+
+/**
+ Sets the maximum number of operations in flight for the specified host.
+ 
+ @param count The maximum number of operations in flight, or `NSNotFound` to use `maximumConcurrentOperationCountPerHost`.
+ @param host The host, such as `api.example.com`. Hosts are compared case-insensitively.
+ */
+- (void)setMaximumConcurrentOperationCount:(NSUInteger)count 
+                                   forHost:(NSString *)host;
+
+/**
+ Returns the maximum number of operations in flight for the specified host. For a host whose budget adapts, this is its current budget.
+ */
+- (NSUInteger)maximumConcurrentOperationCountForHost:(NSString *)host;
+
+/**
+ Returns the estimated bandwidth available to a single connection to the specified host, in bytes per second.
+ 
+ @discussion The estimate is a moving average of the transfer rates of response bodies of at least 16 KB, measured from the response arriving until loading finishes. It is `0` until such a response has been received from the host.
+ */
+- (double)estimatedBandwidthForHost:(NSString *)host;
+
+///--------------------------------------
+/// @name Scheduling Operations
+///--------------------------------------
+
+/**
+ Schedules an operation with the specified priority class. The operation is added to the operation queue once its host has a free slot.
+ 
+ @param operation The operation to enqueue.
+ @param priority The priority class of the operation.
+ */
+- (void)enqueueOperation:(AFHTTPRequestOperation *)operation 
+                priority:(AFHTTPRequestPriority)priority;
+
+/**
+ Schedules an operation with the specified priority class, to be added to the operation queue no sooner than the specified delay has passed. Until then, the operation is included in `operations`, and can be cancelled.
+ 
+ @param operation The operation to enqueue.
+ @param priority The priority class of the operation.
+ @param delay The time to wait before the operation may be added to the operation queue. Aging starts once it has passed.
+ */
+- (void)enqueueOperation:(AFHTTPRequestOperation *)operation 
+                priority:(AFHTTPRequestPriority)priority 
+              afterDelay:(NSTimeInterval)delay;
+
+/**
+ Changes the priority class of an operation that has not yet started. Its aging starts over from the new priority class.
+ 
+ @param priority The new priority class.
+ @param operation An operation enqueued with the scheduler.
+ */
+- (void)setPriority:(AFHTTPRequestPriority)priority 
+       forOperation:(AFHTTPRequestOperation *)operation;
+
+/**
+ Returns the priority class of an operation enqueued with the scheduler.
+ 
+ @param operation An operation enqueued with the scheduler.
+ 
+ @return The priority class with which the operation was enqueued or last reprioritized, or `AFHTTPRequestNormalPriority` if it is not known to the scheduler.
+ */
+- (AFHTTPRequestPriority)priorityForOperation:(AFHTTPRequestOperation *)operation;
+
+/**
+ Returns the operations that have been enqueued with the scheduler and have not yet finished, including those waiting for their host to have a free slot.
+ */
+- (NSArray *)operations;
+
+@end
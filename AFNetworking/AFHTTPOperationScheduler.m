@@ -0,0 +1,614 @@
+// AFHTTPOperationScheduler.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPOperationScheduler.h"
+#import "AFHTTPRequestOperation.h"
+
+static NSInteger const kAFHTTPOperationSchedulerDefaultMaxConcurrentOperationCount = 16;
+static NSUInteger const kAFHTTPOperationSchedulerDefaultMaxConcurrentOperationCountPerHost = 4;
+static NSTimeInterval const kAFHTTPOperationSchedulerDefaultAgingInterval = 1.0;
+static NSUInteger const kAFHTTPOperationSchedulerUnboundedMaxConcurrentOperationCount = 64;
+
+static double const kAFConcurrencyLimitBackoffRatio = 0.9;
+static double const kAFConcurrencyLimitRoundTripTimeTolerance = 2.0;
+static double const kAFConcurrencyLimitMinimumRoundTripTimeDrift = 0.01;
+static double const kAFConcurrencyLimitRoundTripTimeSmoothingFactor = 0.125;
+static double const kAFConcurrencyLimitBandwidthSmoothingFactor = 0.25;
+static NSInteger const kAFConcurrencyLimitMinimumBandwidthSampleLength = 16 * 1024;
+
+static void * AFHTTPOperationSchedulerObservationContext = &AFHTTPOperationSchedulerObservationContext;
+
+static NSOperationQueuePriority const kAFQueuePriorityLevels[] = {
+    NSOperationQueuePriorityVeryLow,
+    NSOperationQueuePriorityLow,
+    NSOperationQueuePriorityNormal,
+    NSOperationQueuePriorityHigh,
+    NSOperationQueuePriorityVeryHigh,
+};
+
+static NSUInteger const kAFQueuePriorityLevelCount = sizeof(kAFQueuePriorityLevels) / sizeof(kAFQueuePriorityLevels[0]);
+
+static inline NSUInteger AFQueuePriorityLevelForPriority(AFHTTPRequestPriority priority) {
+    switch (priority) {
+        case AFHTTPRequestInteractivePriority:
+            return 4;
+        case AFHTTPRequestPrefetchPriority:
+            return 1;
+        case AFHTTPRequestBackgroundPriority:
+            return 0;
+        case AFHTTPRequestNormalPriority:
+        default:
+            return 2;
+    }
+}
+
+static inline NSString * AFHostKeyForOperation(AFHTTPRequestOperation *operation) {
+    NSString *host = [[[operation.request URL] host] lowercaseString];
+    return host ? host : @"";
+}
+
+static inline BOOL AFOperationIndicatesCongestion(AFHTTPRequestOperation *operation) {
+    NSError *error = operation.error;
+    if ([[error domain] isEqualToString:NSURLErrorDomain]) {
+        switch ([error code]) {
+            case NSURLErrorTimedOut:
+            case NSURLErrorCannotConnectToHost:
+            case NSURLErrorNetworkConnectionLost:
+                return YES;
+            default:
+                break;
+        }
+    }
+    
+    NSInteger statusCode = [operation.response statusCode];
+    return statusCode == 429 || statusCode == 503;
+}
+
+@interface AFHostConcurrencyLimit : NSObject {
+@private
+    double _limit;
+    NSTimeInterval _minimumRoundTripTime;
+    NSTimeInterval _smoothedRoundTripTime;
+    CFAbsoluteTime _lastBackoffTime;
+    double _estimatedBandwidth;
+}
+
+@property (readonly, nonatomic, assign) double limit;
+@property (readonly, nonatomic, assign) double estimatedBandwidth;
+
+- (id)initWithLimit:(double)limit;
+
+- (void)recordRoundTripTime:(NSTimeInterval)roundTripTime 
+             operationCount:(NSUInteger)operationCount 
+               maximumLimit:(double)maximumLimit;
+- (void)recordCongestion;
+- (void)recordTransferOfLength:(NSInteger)length 
+                      duration:(NSTimeInterval)duration;
+@end
+
+@implementation AFHostConcurrencyLimit
+@synthesize limit = _limit;
+@synthesize estimatedBandwidth = _estimatedBandwidth;
+
+- (id)initWithLimit:(double)limit {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _limit = MAX(limit, 1.0);
+    
+    return self;
+}
+
+- (void)recordRoundTripTime:(NSTimeInterval)roundTripTime 
+             operationCount:(NSUInteger)operationCount 
+               maximumLimit:(double)maximumLimit
+{
+    // The baseline drifts up slowly, so that it follows the host to a slower route rather than treating every later sample as congested
+    if (_minimumRoundTripTime == 0.0 || roundTripTime < _minimumRoundTripTime) {
+        _minimumRoundTripTime = roundTripTime;
+    } else {
+        _minimumRoundTripTime += (roundTripTime - _minimumRoundTripTime) * kAFConcurrencyLimitMinimumRoundTripTimeDrift;
+    }
+    
+    // Compare the smoothed round trip time against the baseline, so that a single slow response does not read as congestion
+    if (_smoothedRoundTripTime == 0.0) {
+        _smoothedRoundTripTime = roundTripTime;
+    } else {
+        _smoothedRoundTripTime += (roundTripTime - _smoothedRoundTripTime) * kAFConcurrencyLimitRoundTripTimeSmoothingFactor;
+    }
+    
+    if (_smoothedRoundTripTime > _minimumRoundTripTime * kAFConcurrencyLimitRoundTripTimeTolerance) {
+        [self recordCongestion];
+    } else if (operationCount * 2 >= _limit) {
+        // Only grow a budget that is actually being used
+        _limit = MIN(_limit + 1.0 / _limit, MAX(maximumLimit, 1.0));
+    }
+}
+
+- (void)recordCongestion {
+    // Back off at most once per round trip, since every operation in flight during that window reports the same congestion
+    CFAbsoluteTime currentTime = CFAbsoluteTimeGetCurrent();
+    if (_lastBackoffTime > 0 && currentTime - _lastBackoffTime < _smoothedRoundTripTime) {
+        return;
+    }
+    
+    _lastBackoffTime = currentTime;
+    _limit = MAX(_limit * kAFConcurrencyLimitBackoffRatio, 1.0);
+}
+
+- (void)recordTransferOfLength:(NSInteger)length 
+                      duration:(NSTimeInterval)duration
+{
+    if (length < kAFConcurrencyLimitMinimumBandwidthSampleLength || duration <= 0.0) {
+        return;
+    }
+    
+    double bandwidth = length / duration;
+    if (_estimatedBandwidth == 0.0) {
+        _estimatedBandwidth = bandwidth;
+    } else {
+        _estimatedBandwidth += (bandwidth - _estimatedBandwidth) * kAFConcurrencyLimitBandwidthSmoothingFactor;
+    }
+}
+
+@end
+
+#pragma mark -
+
+@interface AFScheduledOperation : NSObject {
+@private
+    AFHTTPRequestOperation *_operation;
+    NSString *_host;
+    AFHTTPRequestPriority _priority;
+    CFAbsoluteTime _scheduledTime;
+    BOOL _enqueued;
+}
+
+@property (readwrite, nonatomic, retain) AFHTTPRequestOperation *operation;
+@property (readwrite, nonatomic, copy) NSString *host;
+@property (readwrite, nonatomic, assign) AFHTTPRequestPriority priority;
+@property (readwrite, nonatomic, assign) CFAbsoluteTime scheduledTime;
+@property (readwrite, nonatomic, assign, getter = isEnqueued) BOOL enqueued;
+
+- (NSUInteger)queuePriorityLevelAtTime:(CFAbsoluteTime)time 
+                         agingInterval:(NSTimeInterval)agingInterval;
+@end
+
+@implementation AFScheduledOperation
+@synthesize operation = _operation;
+@synthesize host = _host;
+@synthesize priority = _priority;
+@synthesize scheduledTime = _scheduledTime;
+@synthesize enqueued = _enqueued;
+
+- (void)dealloc {
+    [_operation release];
+    [_host release];
+    [super dealloc];
+}
+
+- (NSUInteger)queuePriorityLevelAtTime:(CFAbsoluteTime)time 
+                         agingInterval:(NSTimeInterval)agingInterval
+{
+    NSUInteger level = AFQueuePriorityLevelForPriority(self.priority) + (NSUInteger)(MAX(time - self.scheduledTime, 0.0) / agingInterval);
+    return MIN(level, kAFQueuePriorityLevelCount - 1);
+}
+
+@end
+
+#pragma mark -
+
+@interface AFHTTPOperationScheduler ()
+@property (readwrite, nonatomic, retain) NSOperationQueue *operationQueue;
+@property (readwrite, nonatomic, retain) NSMutableDictionary *maximumConcurrentOperationCountsByHost;
+@property (readwrite, nonatomic, retain) NSMutableDictionary *concurrencyLimitsByHost;
+@property (readwrite, nonatomic, retain) NSMutableDictionary *operationCountsByHost;
+@property (readwrite, nonatomic, retain) NSMutableArray *scheduledOperations;
+
+- (AFScheduledOperation *)scheduledOperationForOperation:(AFHTTPRequestOperation *)operation;
+- (NSUInteger)maximumConcurrentOperationCountForHostKey:(NSString *)hostKey;
+- (void)recordCompletionOfOperation:(AFHTTPRequestOperation *)operation 
+                            hostKey:(NSString *)hostKey 
+                     operationCount:(NSUInteger)operationCount;
+- (void)ageScheduledOperations;
+- (void)enqueueOperationsForHostsWithFreeSlots;
+- (void)operationDidFinish:(AFHTTPRequestOperation *)operation;
+- (void)resumeAgingTimer;
+@end
+
+@implementation AFHTTPOperationScheduler
+@synthesize operationQueue = _operationQueue;
+@synthesize agingInterval = _agingInterval;
+@synthesize maximumConcurrentOperationCountPerHost = _maximumConcurrentOperationCountPerHost;
+@synthesize adaptsConcurrencyPerHost = _adaptsConcurrencyPerHost;
+@synthesize maximumConcurrentOperationCountsByHost = _maximumConcurrentOperationCountsByHost;
+@synthesize concurrencyLimitsByHost = _concurrencyLimitsByHost;
+@synthesize operationCountsByHost = _operationCountsByHost;
+@synthesize scheduledOperations = _scheduledOperations;
+
++ (AFHTTPOperationScheduler *)sharedScheduler {
+    static AFHTTPOperationScheduler *_sharedScheduler = nil;
+    static dispatch_once_t oncePredicate;
+    
+    dispatch_once(&oncePredicate, ^{
+        _sharedScheduler = [[self alloc] init];
+    });
+    
+    return _sharedScheduler;
+}
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.operationQueue = [[[NSOperationQueue alloc] init] autorelease];
+    [self.operationQueue setMaxConcurrentOperationCount:kAFHTTPOperationSchedulerDefaultMaxConcurrentOperationCount];
+    
+    self.maximumConcurrentOperationCountsByHost = [NSMutableDictionary dictionary];
+    self.concurrencyLimitsByHost = [NSMutableDictionary dictionary];
+    self.operationCountsByHost = [NSMutableDictionary dictionary];
+    self.scheduledOperations = [NSMutableArray array];
+    
+    _queue = dispatch_queue_create("com.alamofire.networking.operation-scheduler", 0);
+    
+    _agingTimer = dispatch_source_create(DISPATCH_SOURCE_TYPE_TIMER, 0, 0, _queue);
+    dispatch_source_set_event_handler(_agingTimer, ^{
+        [self ageScheduledOperations];
+    });
+    _agingTimerSuspended = YES;
+    
+    self.agingInterval = kAFHTTPOperationSchedulerDefaultAgingInterval;
+    _maximumConcurrentOperationCountPerHost = kAFHTTPOperationSchedulerDefaultMaxConcurrentOperationCountPerHost;
+    _adaptsConcurrencyPerHost = YES;
+    
+    return self;
+}
+
+- (void)dealloc {
+    dispatch_source_cancel(_agingTimer);
+    if (_agingTimerSuspended) {
+        dispatch_resume(_agingTimer);
+    }
+    dispatch_release(_agingTimer);
+    dispatch_release(_queue);
+    
+    [_operationQueue release];
+    [_maximumConcurrentOperationCountsByHost release];
+    [_concurrencyLimitsByHost release];
+    [_operationCountsByHost release];
+    [_scheduledOperations release];
+    [super dealloc];
+}
+
+- (void)setAgingInterval:(NSTimeInterval)agingInterval {
+    _agingInterval = MAX(agingInterval, 0.01);
+    
+    dispatch_source_set_timer(_agingTimer, dispatch_time(DISPATCH_TIME_NOW, (int64_t)(_agingInterval * NSEC_PER_SEC)), (uint64_t)(_agingInterval * NSEC_PER_SEC), (uint64_t)(_agingInterval * NSEC_PER_SEC / 10));
+}
+
+- (void)setMaximumConcurrentOperationCountPerHost:(NSUInteger)maximumConcurrentOperationCountPerHost {
+    dispatch_async(_queue, ^{
+        _maximumConcurrentOperationCountPerHost = MAX(maximumConcurrentOperationCountPerHost, 1);
+        [self enqueueOperationsForHostsWithFreeSlots];
+    });
+}
+
+- (void)setMaximumConcurrentOperationCount:(NSUInteger)count 
+                                   forHost:(NSString *)host
+{
+    NSString *hostKey = [host lowercaseString];
+    dispatch_async(_queue, ^{
+        if (count == NSNotFound) {
+            [self.maximumConcurrentOperationCountsByHost removeObjectForKey:hostKey];
+        } else {
+            [self.maximumConcurrentOperationCountsByHost setObject:[NSNumber numberWithUnsignedInteger:MAX(count, 1)] forKey:hostKey];
+        }
+        
+        [self enqueueOperationsForHostsWithFreeSlots];
+    });
+}
+
+- (NSUInteger)maximumConcurrentOperationCountForHost:(NSString *)host {
+    __block NSUInteger count = 0;
+    dispatch_sync(_queue, ^{
+        count = [self maximumConcurrentOperationCountForHostKey:[host lowercaseString]];
+    });
+    
+    return count;
+}
+
+- (double)estimatedBandwidthForHost:(NSString *)host {
+    __block double estimatedBandwidth = 0.0;
+    dispatch_sync(_queue, ^{
+        estimatedBandwidth = [[self.concurrencyLimitsByHost objectForKey:[host lowercaseString]] estimatedBandwidth];
+    });
+    
+    return estimatedBandwidth;
+}
+
+- (void)enqueueOperation:(AFHTTPRequestOperation *)operation 
+                priority:(AFHTTPRequestPriority)priority
+{
+    [self enqueueOperation:operation priority:priority afterDelay:0.0];
+}
+
+- (void)enqueueOperation:(AFHTTPRequestOperation *)operation 
+                priority:(AFHTTPRequestPriority)priority 
+              afterDelay:(NSTimeInterval)delay
+{
+    [operation setQueuePriority:kAFQueuePriorityLevels[AFQueuePriorityLevelForPriority(priority)]];
+    
+    AFScheduledOperation *scheduledOperation = [[[AFScheduledOperation alloc] init] autorelease];
+    scheduledOperation.operation = operation;
+    scheduledOperation.host = AFHostKeyForOperation(operation);
+    scheduledOperation.priority = priority;
+    scheduledOperation.scheduledTime = CFAbsoluteTimeGetCurrent() + MAX(delay, 0.0);
+    
+    // Operations cancelled while they wait for a free slot finish without ever being added to the operation queue
+    [operation addObserver:self forKeyPath:@"isFinished" options:0 context:AFHTTPOperationSchedulerObservationContext];
+    
+    dispatch_async(_queue, ^{
+        [self.scheduledOperations addObject:scheduledOperation];
+        [self enqueueOperationsForHostsWithFreeSlots];
+        [self resumeAgingTimer];
+    });
+    
+    if (delay > 0.0) {
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(delay * NSEC_PER_SEC)), _queue, ^{
+            [self enqueueOperationsForHostsWithFreeSlots];
+        });
+    }
+}
+
+- (void)setPriority:(AFHTTPRequestPriority)priority 
+       forOperation:(AFHTTPRequestOperation *)operation
+{
+    dispatch_async(_queue, ^{
+        AFScheduledOperation *scheduledOperation = [self scheduledOperationForOperation:operation];
+        if (!scheduledOperation || [operation isExecuting] || [operation isFinished]) {
+            return;
+        }
+        
+        scheduledOperation.priority = priority;
+        scheduledOperation.scheduledTime = MAX(scheduledOperation.scheduledTime, CFAbsoluteTimeGetCurrent());
+        [operation setQueuePriority:kAFQueuePriorityLevels[AFQueuePriorityLevelForPriority(priority)]];
+        
+        [self enqueueOperationsForHostsWithFreeSlots];
+    });
+}
+
+- (AFHTTPRequestPriority)priorityForOperation:(AFHTTPRequestOperation *)operation {
+    __block AFHTTPRequestPriority priority = AFHTTPRequestNormalPriority;
+    dispatch_sync(_queue, ^{
+        AFScheduledOperation *scheduledOperation = [self scheduledOperationForOperation:operation];
+        if (scheduledOperation) {
+            priority = scheduledOperation.priority;
+        }
+    });
+    
+    return priority;
+}
+
+- (NSArray *)operations {
+    __block NSArray *operations = nil;
+    dispatch_sync(_queue, ^{
+        operations = [[self.scheduledOperations valueForKey:@"operation"] retain];
+    });
+    
+    return [operations autorelease];
+}
+
+#pragma mark -
+
+- (AFScheduledOperation *)scheduledOperationForOperation:(AFHTTPRequestOperation *)operation {
+    for (AFScheduledOperation *scheduledOperation in self.scheduledOperations) {
+        if (scheduledOperation.operation == operation) {
+            return scheduledOperation;
+        }
+    }
+    
+    return nil;
+}
+
+- (NSUInteger)maximumConcurrentOperationCountForHostKey:(NSString *)hostKey {
+    NSNumber *hostBudget = [self.maximumConcurrentOperationCountsByHost objectForKey:hostKey];
+    if (hostBudget) {
+        return [hostBudget unsignedIntegerValue];
+    }
+    
+    AFHostConcurrencyLimit *concurrencyLimit = [self.concurrencyLimitsByHost objectForKey:hostKey];
+    if (self.adaptsConcurrencyPerHost && concurrencyLimit) {
+        return (NSUInteger)floor(concurrencyLimit.limit);
+    }
+    
+    return _maximumConcurrentOperationCountPerHost;
+}
+
+- (void)recordCompletionOfOperation:(AFHTTPRequestOperation *)operation 
+                            hostKey:(NSString *)hostKey 
+                     operationCount:(NSUInteger)operationCount
+{
+    if (!self.adaptsConcurrencyPerHost || [self.maximumConcurrentOperationCountsByHost objectForKey:hostKey] || [operation isCancelled]) {
+        return;
+    }
+    
+    // Operations answered from the response cache never started a connection, and say nothing about the host
+    CFAbsoluteTime connectionStartedTime = [operation timeForTimingPoint:AFHTTPRequestOperationConnectionStartedTimingPoint];
+    if (connectionStartedTime == 0) {
+        return;
+    }
+    
+    AFHostConcurrencyLimit *concurrencyLimit = [self.concurrencyLimitsByHost objectForKey:hostKey];
+    if (!concurrencyLimit) {
+        concurrencyLimit = [[[AFHostConcurrencyLimit alloc] initWithLimit:_maximumConcurrentOperationCountPerHost] autorelease];
+        [self.concurrencyLimitsByHost setObject:concurrencyLimit forKey:hostKey];
+    }
+    
+    if (AFOperationIndicatesCongestion(operation)) {
+        [concurrencyLimit recordCongestion];
+        return;
+    }
+    
+    CFAbsoluteTime responseReceivedTime = [operation timeForTimingPoint:AFHTTPRequestOperationResponseReceivedTimingPoint];
+    if (responseReceivedTime == 0) {
+        return;
+    }
+    
+    NSInteger maxConcurrentOperationCount = [self.operationQueue maxConcurrentOperationCount];
+    double maximumLimit = maxConcurrentOperationCount > 0 ? maxConcurrentOperationCount : kAFHTTPOperationSchedulerUnboundedMaxConcurrentOperationCount;
+    [concurrencyLimit recordRoundTripTime:(responseReceivedTime - connectionStartedTime) operationCount:operationCount maximumLimit:maximumLimit];
+    
+    CFAbsoluteTime loadingFinishedTime = [operation timeForTimingPoint:AFHTTPRequestOperationLoadingFinishedTimingPoint];
+    if (loadingFinishedTime > 0 && !operation.error) {
+        [concurrencyLimit recordTransferOfLength:operation.totalBytesRead duration:(loadingFinishedTime - responseReceivedTime)];
+    }
+}
+
+- (void)ageScheduledOperations {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    
+    BOOL hasWaitingOperations = NO;
+    for (AFScheduledOperation *scheduledOperation in self.scheduledOperations) {
+        AFHTTPRequestOperation *operation = scheduledOperation.operation;
+        if ([operation isExecuting] || [operation isFinished]) {
+            continue;
+        }
+        
+        NSOperationQueuePriority queuePriority = kAFQueuePriorityLevels[[scheduledOperation queuePriorityLevelAtTime:now agingInterval:self.agingInterval]];
+        if ([operation queuePriority] != queuePriority) {
+            [operation setQueuePriority:queuePriority];
+        }
+        
+        hasWaitingOperations = YES;
+    }
+    
+    if (!hasWaitingOperations && !_agingTimerSuspended) {
+        dispatch_suspend(_agingTimer);
+        _agingTimerSuspended = YES;
+    }
+}
+
+// Operations waiting for their host are added to the operation queue in the order the queue would start them: by aged queue priority, then first come, first served
+- (void)enqueueOperationsForHostsWithFreeSlots {
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    NSTimeInterval agingInterval = self.agingInterval;
+    
+    NSMutableArray *mutableWaitingOperations = [NSMutableArray array];
+    for (AFScheduledOperation *scheduledOperation in self.scheduledOperations) {
+        if (![scheduledOperation isEnqueued] && scheduledOperation.scheduledTime <= now) {
+            [mutableWaitingOperations addObject:scheduledOperation];
+        }
+    }
+    
+    if ([mutableWaitingOperations count] == 0) {
+        return;
+    }
+    
+    [mutableWaitingOperations sortUsingComparator:^NSComparisonResult(id obj1, id obj2) {
+        NSUInteger level1 = [obj1 queuePriorityLevelAtTime:now agingInterval:agingInterval];
+        NSUInteger level2 = [obj2 queuePriorityLevelAtTime:now agingInterval:agingInterval];
+        if (level1 != level2) {
+            return level1 > level2 ? NSOrderedAscending : NSOrderedDescending;
+        }
+        
+        CFAbsoluteTime time1 = [(AFScheduledOperation *)obj1 scheduledTime];
+        CFAbsoluteTime time2 = [(AFScheduledOperation *)obj2 scheduledTime];
+        if (time1 == time2) {
+            return NSOrderedSame;
+        }
+        
+        return time1 < time2 ? NSOrderedAscending : NSOrderedDescending;
+    }];
+    
+    for (AFScheduledOperation *scheduledOperation in mutableWaitingOperations) {
+        NSString *host = scheduledOperation.host;
+        NSUInteger maximumCount = [self maximumConcurrentOperationCountForHostKey:host];
+        NSUInteger count = [[self.operationCountsByHost objectForKey:host] unsignedIntegerValue];
+        if (count >= maximumCount) {
+            continue;
+        }
+        
+        [self.operationCountsByHost setObject:[NSNumber numberWithUnsignedInteger:count + 1] forKey:host];
+        scheduledOperation.enqueued = YES;
+        [self.operationQueue addOperation:scheduledOperation.operation];
+    }
+}
+
+- (void)operationDidFinish:(AFHTTPRequestOperation *)operation {
+    AFScheduledOperation *scheduledOperation = [self scheduledOperationForOperation:operation];
+    if (!scheduledOperation) {
+        return;
+    }
+    
+    if ([scheduledOperation isEnqueued]) {
+        NSString *host = scheduledOperation.host;
+        NSUInteger count = [[self.operationCountsByHost objectForKey:host] unsignedIntegerValue];
+        [self recordCompletionOfOperation:operation hostKey:host operationCount:count];
+        
+        if (count > 1) {
+            [self.operationCountsByHost setObject:[NSNumber numberWithUnsignedInteger:count - 1] forKey:host];
+        } else {
+            [self.operationCountsByHost removeObjectForKey:host];
+        }
+    }
+    
+    [self.scheduledOperations removeObjectIdenticalTo:scheduledOperation];
+    
+    [self enqueueOperationsForHostsWithFreeSlots];
+}
+
+- (void)resumeAgingTimer {
+    if (_agingTimerSuspended) {
+        _agingTimerSuspended = NO;
+        dispatch_resume(_agingTimer);
+    }
+}
+
+#pragma mark - NSKeyValueObserving
+
+- (void)observeValueForKeyPath:(NSString *)keyPath 
+                      ofObject:(id)object 
+                        change:(NSDictionary *)change 
+                       context:(void *)context
+{
+    if (context != AFHTTPOperationSchedulerObservationContext) {
+        [super observeValueForKeyPath:keyPath ofObject:object change:change context:context];
+        return;
+    }
+    
+    AFHTTPRequestOperation *operation = (AFHTTPRequestOperation *)object;
+    if (![operation isFinished]) {
+        return;
+    }
+    
+    [operation removeObserver:self forKeyPath:@"isFinished"];
+    
+    dispatch_async(_queue, ^{
+        [self operationDidFinish:operation];
+    });
+}
+
+@end
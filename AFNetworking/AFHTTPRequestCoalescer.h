@@ -0,0 +1,92 @@
+// AFHTTPRequestCoalescer.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+@class AFHTTPRequestOperation;
+
+/**
+ `AFHTTPRequestCoalescer` is a table of in-flight requests, which allows identical requests made while one is already loading to share a single operation, response body, and decoded result, rather than each creating an operation of its own.
+ 
+ Requests are identical if they have the same HTTP method, URL, and header fields. Each caller attaches a handler, which is an object of its choosing (typically a block) that is returned to the caller that created the operation when it finishes, so that it can be invoked with the shared result. Cancellation is reference-counted: removing a handler detaches its caller, and the operation is only cancelled once every handler attached to it has been removed.
+ 
+ @discussion Only requests that are safe to share should be coalesced; `AFHTTPClient` only coalesces `GET` requests, and `UIImageView+AFNetworking` coalesces image loads.
+ */
+@interface AFHTTPRequestCoalescer : NSObject {
+@private
+    NSMutableDictionary *_coalescedRequests;
+    NSUInteger _coalescedHandlerCount;
+}
+
+/**
+ The number of handlers that have been attached to an operation that was already in flight, rather than creating an operation of their own.
+ */
+@property (readonly, nonatomic, assign) NSUInteger coalescedHandlerCount;
+
+/**
+ Attaches a handler to the in-flight operation for the specified request, or if there is none, creates one by calling the specified block.
+ 
+ @param handler The handler to attach. This argument must not be `nil`.
+ @param request The request to be loaded.
+ @param block A block object that is called if there is no in-flight operation for the request. This block takes a single argument, an opaque object identifying the coalesced request, which should be passed to `handlersForFinishedCoalescedRequest:` when the operation finishes, and returns the operation, which the block is responsible for enqueueing.
+ 
+ @return The operation that will load the request, to which the handler was attached.
+ */
+- (AFHTTPRequestOperation *)addHandler:(id)handler 
+                            forRequest:(NSURLRequest *)request 
+                        operationBlock:(AFHTTPRequestOperation * (^)(id coalescedRequest))block;
+
+/**
+ Removes a coalesced request from the table of in-flight requests, and returns the handlers that remain attached to it, in the order they were added.
+ 
+ @param coalescedRequest The object passed to the operation block when the coalesced request was created.
+ 
+ @return The handlers to be invoked with the result of the operation.
+ */
+- (NSArray *)handlersForFinishedCoalescedRequest:(id)coalescedRequest;
+
+/**
+ Replaces the operation loading a coalesced request, such as when a failed request is retried, so that removing handlers cancels the new operation.
+ 
+ @param operation The operation that will load the request. The caller is responsible for enqueueing it.
+ @param coalescedRequest The object passed to the operation block when the coalesced request was created.
+ 
+ @return `YES` if the coalesced request is still in flight, or `NO` if every handler attached to it has been removed, in which case the operation should not be enqueued.
+ */
+- (BOOL)setOperation:(AFHTTPRequestOperation *)operation 
+ forCoalescedRequest:(id)coalescedRequest;
+
+/**
+ Detaches a handler from the operation it was attached to. If it was the last handler attached, the operation is cancelled.
+ 
+ @param handler The handler to remove.
+ */
+- (void)removeHandler:(id)handler;
+
+/**
+ Removes the coalesced request loaded by the specified operation from the table of in-flight requests, without invoking or retaining its handlers. This should be called when an operation is cancelled directly.
+ 
+ @param operation The operation whose coalesced request should be removed.
+ */
+- (void)removeCoalescedRequestForOperation:(AFHTTPRequestOperation *)operation;
+
+@end
@@ -0,0 +1,190 @@
+// AFHTTPRequestCoalescer.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPRequestCoalescer.h"
+#import "AFHTTPRequestOperation.h"
+
+static NSString * AFCoalescingKeyForRequest(NSURLRequest *request) {
+    NSMutableString *mutableKey = [NSMutableString stringWithFormat:@"%@ %@", [request HTTPMethod] ?: @"GET", [[request URL] absoluteString]];
+    
+    NSDictionary *headers = [request allHTTPHeaderFields];
+    for (NSString *field in [[headers allKeys] sortedArrayUsingSelector:@selector(caseInsensitiveCompare:)]) {
+        [mutableKey appendFormat:@"\n%@: %@", [field lowercaseString], [headers valueForKey:field]];
+    }
+    
+    return mutableKey;
+}
+
+@interface AFCoalescedHTTPRequest : NSObject {
+@private
+    NSString *_key;
+    AFHTTPRequestOperation *_operation;
+    NSMutableArray *_handlers;
+}
+
+@property (readwrite, nonatomic, copy) NSString *key;
+@property (readwrite, nonatomic, retain) AFHTTPRequestOperation *operation;
+@property (readwrite, nonatomic, retain) NSMutableArray *handlers;
+@end
+
+@implementation AFCoalescedHTTPRequest
+@synthesize key = _key;
+@synthesize operation = _operation;
+@synthesize handlers = _handlers;
+
+- (void)dealloc {
+    [_key release];
+    [_operation release];
+    [_handlers release];
+    [super dealloc];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFHTTPRequestCoalescer ()
+@property (readwrite, nonatomic, retain) NSMutableDictionary *coalescedRequests;
+
+- (void)removeCoalescedRequest:(AFCoalescedHTTPRequest *)coalescedRequest;
+@end
+
+@implementation AFHTTPRequestCoalescer
+@synthesize coalescedRequests = _coalescedRequests;
+@synthesize coalescedHandlerCount = _coalescedHandlerCount;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.coalescedRequests = [NSMutableDictionary dictionary];
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_coalescedRequests release];
+    [super dealloc];
+}
+
+- (AFHTTPRequestOperation *)addHandler:(id)handler 
+                            forRequest:(NSURLRequest *)request 
+                        operationBlock:(AFHTTPRequestOperation * (^)(id coalescedRequest))block
+{
+    NSString *key = AFCoalescingKeyForRequest(request);
+    
+    @synchronized(self) {
+        AFCoalescedHTTPRequest *coalescedRequest = [self.coalescedRequests objectForKey:key];
+        if (coalescedRequest && ![coalescedRequest.operation isCancelled]) {
+            [coalescedRequest.handlers addObject:handler];
+            _coalescedHandlerCount++;
+            
+            return coalescedRequest.operation;
+        } else if (coalescedRequest) {
+            [self removeCoalescedRequest:coalescedRequest];
+        }
+        
+        coalescedRequest = [[[AFCoalescedHTTPRequest alloc] init] autorelease];
+        coalescedRequest.key = key;
+        coalescedRequest.handlers = [NSMutableArray arrayWithObject:handler];
+        [self.coalescedRequests setObject:coalescedRequest forKey:key];
+        
+        coalescedRequest.operation = block(coalescedRequest);
+        
+        return coalescedRequest.operation;
+    }
+}
+
+- (NSArray *)handlersForFinishedCoalescedRequest:(id)coalescedRequest {
+    @synchronized(self) {
+        NSArray *handlers = [[[coalescedRequest handlers] copy] autorelease];
+        [self removeCoalescedRequest:coalescedRequest];
+        
+        return handlers;
+    }
+}
+
+- (BOOL)setOperation:(AFHTTPRequestOperation *)operation 
+ forCoalescedRequest:(id)coalescedRequest
+{
+    @synchronized(self) {
+        AFCoalescedHTTPRequest *request = (AFCoalescedHTTPRequest *)coalescedRequest;
+        if ([self.coalescedRequests objectForKey:request.key] != request) {
+            return NO;
+        }
+        
+        request.operation = operation;
+        
+        return YES;
+    }
+}
+
+- (void)removeHandler:(id)handler {
+    if (!handler) {
+        return;
+    }
+    
+    AFHTTPRequestOperation *operationToCancel = nil;
+    
+    @synchronized(self) {
+        for (AFCoalescedHTTPRequest *coalescedRequest in [self.coalescedRequests allValues]) {
+            NSUInteger index = [coalescedRequest.handlers indexOfObjectIdenticalTo:handler];
+            if (index == NSNotFound) {
+                continue;
+            }
+            
+            [coalescedRequest.handlers removeObjectAtIndex:index];
+            if ([coalescedRequest.handlers count] == 0) {
+                operationToCancel = [[coalescedRequest.operation retain] autorelease];
+                [self removeCoalescedRequest:coalescedRequest];
+            }
+            
+            break;
+        }
+    }
+    
+    [operationToCancel cancel];
+}
+
+- (void)removeCoalescedRequestForOperation:(AFHTTPRequestOperation *)operation {
+    @synchronized(self) {
+        for (AFCoalescedHTTPRequest *coalescedRequest in [self.coalescedRequests allValues]) {
+            if (coalescedRequest.operation == operation) {
+                [self removeCoalescedRequest:coalescedRequest];
+            }
+        }
+    }
+}
+
+- (void)removeCoalescedRequest:(AFCoalescedHTTPRequest *)coalescedRequest {
+    if ([self.coalescedRequests objectForKey:coalescedRequest.key] == coalescedRequest) {
+        [self.coalescedRequests removeObjectForKey:coalescedRequest.key];
+    }
+    
+    // The operation's callbacks retain the coalesced request, so releasing the operation here breaks the cycle
+    [coalescedRequest.handlers removeAllObjects];
+    coalescedRequest.operation = nil;
+}
+
+@end
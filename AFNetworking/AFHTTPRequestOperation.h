@@ -21,6 +21,12 @@
 // THE SOFTWARE.
 
 #import <Foundation/Foundation.h>
+#import "AFHTTPTransport.h"
+#import "AFHTTPContentDecoder.h"
+
+@class AFHTTPResponseCache;
+@class AFCachedHTTPResponse;
+@class AFHTTPLatencyHistogram;
 
 /**
  Indicates an error occured in AFNetworking.
@@ -40,7 +46,75 @@ extern NSString * const AFHTTPOperationDidStartNotification;
 extern NSString * const AFHTTPOperationDidFinishNotification;
 
 /**
-  `AFHTTPRequestOperation` is an `NSOperation` that implements the `NSURLConnection` delegate methods, and provides a simple block-based interface to asynchronously get the result and context of that operation finishes.
+ Points in the life of an operation at which its timing is recorded.
+ 
+ - `AFHTTPRequestOperationCreatedTimingPoint`: The operation was created, which is typically just before it is added to an operation queue.
+ - `AFHTTPRequestOperationStartedTimingPoint`: The operation queue started the operation.
+ - `AFHTTPRequestOperationConnectionStartedTimingPoint`: The network request thread started the connection.
+ - `AFHTTPRequestOperationResponseReceivedTimingPoint`: The response headers were received.
+ - `AFHTTPRequestOperationLoadingFinishedTimingPoint`: The response body finished loading, or the operation was answered from the response cache.
+ - `AFHTTPRequestOperationProcessingStartedTimingPoint`: Processing of the response, such as JSON or image decoding, was scheduled.
+ - `AFHTTPRequestOperationProcessingFinishedTimingPoint`: Processing of the response finished.
+ - `AFHTTPRequestOperationDeliveredTimingPoint`: The result was delivered to the caller's callback.
+ */
+typedef enum {
+    AFHTTPRequestOperationCreatedTimingPoint            = 0,
+    AFHTTPRequestOperationStartedTimingPoint            = 1,
+    AFHTTPRequestOperationConnectionStartedTimingPoint  = 2,
+    AFHTTPRequestOperationResponseReceivedTimingPoint   = 3,
+    AFHTTPRequestOperationLoadingFinishedTimingPoint    = 4,
+    AFHTTPRequestOperationProcessingStartedTimingPoint  = 5,
+    AFHTTPRequestOperationProcessingFinishedTimingPoint = 6,
+    AFHTTPRequestOperationDeliveredTimingPoint          = 7,
+} AFHTTPRequestOperationTimingPoint;
+
+/**
+ Keys in the timing breakdown of an operation, and in the latency histograms, for the duration of each stage of an operation.
+ 
+ - `AFHTTPRequestOperationQueueWaitTimingKey`: From creation until the operation queue started the operation.
+ - `AFHTTPRequestOperationStartHandoffTimingKey`: From start until the network request thread started the connection.
+ - `AFHTTPRequestOperationTimeToFirstByteTimingKey`: From the connection starting until the response headers were received.
+ - `AFHTTPRequestOperationTransferTimingKey`: From the response headers until the body finished loading.
+ - `AFHTTPRequestOperationProcessingTimingKey`: From processing being scheduled until it finished, including time waiting for a processing queue.
+ - `AFHTTPRequestOperationDeliveryTimingKey`: From processing finishing until the result was delivered, such as on the main queue.
+ - `AFHTTPRequestOperationTotalTimingKey`: From creation until the result was delivered.
+ */
+extern NSString * const AFHTTPRequestOperationQueueWaitTimingKey;
+extern NSString * const AFHTTPRequestOperationStartHandoffTimingKey;
+extern NSString * const AFHTTPRequestOperationTimeToFirstByteTimingKey;
+extern NSString * const AFHTTPRequestOperationTransferTimingKey;
+extern NSString * const AFHTTPRequestOperationProcessingTimingKey;
+extern NSString * const AFHTTPRequestOperationDeliveryTimingKey;
+extern NSString * const AFHTTPRequestOperationTotalTimingKey;
+
+/**
+ Keys in the content decoding statistics of each content coding.
+ 
+ - `AFContentDecodingResponseCountKey`: The number of response bodies decoded.
+ - `AFContentDecodingEncodedByteCountKey`: The number of bytes received in the content coding.
+ - `AFContentDecodingDecodedByteCountKey`: The number of bytes the bodies decoded to.
+ - `AFContentDecodingCompressionRatioKey`: The decoded byte count divided by the encoded byte count.
+ - `AFContentDecodingTimeKey`: The CPU time spent decoding, in seconds.
+ */
+extern NSString * const AFContentDecodingResponseCountKey;
+extern NSString * const AFContentDecodingEncodedByteCountKey;
+extern NSString * const AFContentDecodingDecodedByteCountKey;
+extern NSString * const AFContentDecodingCompressionRatioKey;
+extern NSString * const AFContentDecodingTimeKey;
+
+/**
+ Strategies for assigning an operation to one of the network request threads when it starts.
+ 
+ - `AFNetworkRequestThreadLeastLoadedSchedulingPolicy`: The operation is scheduled on the thread with the fewest executing operations.
+ - `AFNetworkRequestThreadHostHashSchedulingPolicy`: The operation is scheduled on a thread chosen by the hash of its request URL host, so that all connections to a given host share a run loop.
+ */
+typedef enum {
+    AFNetworkRequestThreadLeastLoadedSchedulingPolicy   = 0,
+    AFNetworkRequestThreadHostHashSchedulingPolicy      = 1,
+} AFNetworkRequestThreadSchedulingPolicy;
+
+/**
+  `AFHTTPRequestOperation` is an `NSOperation` that loads a request with a connection from its transport, which is `NSURLConnection` by default, and provides a simple block-based interface to asynchronously get the result and context of that operation finishes.
  
  # Subclassing Notes
  
@@ -50,50 +124,106 @@ extern NSString * const AFHTTPOperationDidFinishNotification;
  
  ## Methods to Subclass
  
- Unless you need to override specific `NSURLConnection` delegate methods, you shouldn't need to subclass any methods. Instead, you should provide alternative constructor class methods, that are essentially wrappers around the callback from `AFHTTPRequestOperation`.
+ Unless you need to override specific transport connection delegate methods, you shouldn't need to subclass any methods. Instead, you should provide alternative constructor class methods, that are essentially wrappers around the callback from `AFHTTPRequestOperation`.
  
- ### `NSURLConnection` Delegate Methods
+ ### Transport Connection Delegate Methods
  
- Notably, `AFHTTPRequestOperation` does not implement any of the authentication challenge-related `NSURLConnection` delegate methods.
+ Notably, `AFHTTPRequestOperation` does not handle authentication challenges.
  
- `AFHTTPRequestOperation` does implement the following `NSURLConnection` delegate methods:
+ `AFHTTPRequestOperation` implements the following `AFHTTPTransportConnectionDelegate` methods, which mirror the `NSURLConnection` delegate methods of the same names:
  
- - `connection:didReceiveResponse:`
- - `connection:didReceiveData:`
- - `connectionDidFinishLoading:`
- - `connection:didFailWithError:`
- - `connection:didSendBodyData:totalBytesWritten:totalBytesExpectedToWrite:`
- - `connection:willCacheResponse:`
+ - `transportConnection:didReceiveResponse:`
+ - `transportConnection:didReceiveData:`
+ - `transportConnectionDidFinishLoading:`
+ - `transportConnection:didFailWithError:`
+ - `transportConnection:didSendBodyData:totalBytesWritten:totalBytesExpectedToWrite:`
  
- If you overwrite any of the above methods, be sure to make the call to `super` first, or else it may cause unexpected results.
+ If you overwrite any of the above methods, be sure to make the call to `super` first, or else it may cause unexpected results. Subclasses that process the response body as it arrives should override `didReceiveResponseBodyData:` instead of `transportConnection:didReceiveData:`, so that they are given the body after its content coding has been decoded.
  
  @see NSOperation
- @see NSURLConnection
+ @see AFHTTPTransport
  */
-@interface AFHTTPRequestOperation : NSOperation {
+@interface AFHTTPRequestOperation : NSOperation <AFHTTPTransportConnectionDelegate> {
 @private    
+    volatile int32_t _state;
+    
     NSSet *_runLoopModes;
     
-    NSURLConnection *_connection;
+    id <AFHTTPTransport> _transport;
+    id <AFHTTPTransportConnection> _connection;
     NSURLRequest *_request;
     NSHTTPURLResponse *_response;
     NSError *_error;
     
     NSData *_responseBody;
     NSInteger _totalBytesRead;
-    NSMutableData *_dataAccumulator;
+    NSMutableArray *_dataAccumulator;
     NSOutputStream *_outputStream;
+    NSMutableArray *_outputStreamPendingWrites;
+    NSUInteger _outputStreamPendingWriteOffset;
+    NSUInteger _outputStreamBufferCapacity;
+    NSUInteger _outputStreamBufferedLength;
+    NSUInteger _maximumOutputStreamBufferedLength;
+    NSTimeInterval _outputStreamStallTime;
+    CFAbsoluteTime _outputStreamStallStartTime;
+    BOOL _connectionPaused;
+    BOOL _connectionFinishedLoading;
+    
+    NSUInteger _networkRequestThreadIndex;
+    
+    AFHTTPResponseCache *_responseCache;
+    AFCachedHTTPResponse *_cachedResponse;
+    
+    long long _maximumResponseLength;
+    id _responseValidation;
+    
+    NSString *_contentCoding;
+    id <AFHTTPContentDecoder> _contentDecoder;
+    dispatch_queue_t _contentDecodingQueue;
+    CFRunLoopRef _contentDecodingRunLoop;
+    BOOL _responseBodyIsEncoded;
+    long long _decodedContentLength;
+    NSTimeInterval _contentDecodingTime;
+    
+    CFAbsoluteTime _timingPoints[AFHTTPRequestOperationDeliveredTimingPoint + 1];
 }
 
 @property (nonatomic, retain) NSSet *runLoopModes;
 
 @property (readonly, nonatomic, retain) NSURLRequest *request;
+
+/**
+ The transport that creates the connection with which the operation loads its request. This is the shared `AFURLConnectionTransport` by default. It must be set before the operation starts.
+ */
+@property (nonatomic, retain) id <AFHTTPTransport> transport;
 @property (readonly, nonatomic, retain) NSHTTPURLResponse *response;
 @property (readonly, nonatomic, retain) NSError *error;
 
+/**
+ The data received during the request. 
+ 
+ @discussion Chunks received from the connection are retained as-is rather than being appended to a single growing buffer. If the response arrived in more than one chunk, this is an `AFSegmentedData` object, which only creates a contiguous copy of its contents when its `bytes` are requested.
+ */
 @property (readonly, nonatomic, retain) NSData *responseBody;
 @property (readonly) NSString *responseString;
 
+/**
+ The number of bytes of the response body received from the connection so far.
+ */
+@property (readonly, nonatomic, assign) NSInteger totalBytesRead;
+
+/**
+ The response cache consulted when the operation starts, and updated when it finishes. `nil` by default.
+ 
+ @discussion If a fresh response for the request is cached, the operation finishes with it without going to the network. If a stale response with an `ETag` or `Last-Modified` validator is cached, the request is sent with `If-None-Match` and `If-Modified-Since` headers, and a `304 Not Modified` response is answered with the cached response. Streaming operations with an `outputStream` do not use the cache.
+ */
+@property (nonatomic, retain) AFHTTPResponseCache *responseCache;
+
+/**
+ The cached response with which the operation was answered, either because it was fresh or because it was revalidated by the server, or `nil` if the response was loaded from the network.
+ */
+@property (readonly, nonatomic, retain) AFCachedHTTPResponse *cachedResponse;
+
 ///---------------------------------------
 /// @name Creating HTTP Request Operations
 ///---------------------------------------
@@ -114,7 +244,7 @@ extern NSString * const AFHTTPOperationDidFinishNotification;
  
  @param urlRequest The request object to be loaded asynchronously during execution of the operation.
  @param inputStream The input stream object for reading data to be sent during the request. If set, the input stream is set as the `HTTPBodyStream` on the `NSMutableURLRequest`. If the request method is `GET`, it is changed to `POST`. This argument may be `nil`.
- @param outputStream The output stream object for writing data received during the request. If set, data accumulated in `NSURLConnectionDelegate` methods will be sent to the output stream, and the NSData parameter in the completion block will be `nil`. This argument may be `nil`.
+ @param outputStream The output stream object for writing data received during the request. If set, data accumulated in `NSURLConnectionDelegate` methods will be sent to the output stream as it has space available, and the NSData parameter in the completion block will be `nil`. This argument may be `nil`.
  @param completion A block object to be executed when the HTTP request operation is finished. This block has no return value and takes four arguments: the request sent from the client, the response received from the server, the data received by the server during the execution of the request, and an error, which will have been set if an error occured while loading the request. This argument may be `nil`.
  
  @see operationWithRequest:completion
@@ -126,6 +256,208 @@ extern NSString * const AFHTTPOperationDidFinishNotification;
                                              outputStream:(NSOutputStream *)outputStream
                                                completion:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error))completion;
 
+///-------------------------------------------
+/// @name Configuring Network Request Threads
+///-------------------------------------------
+
+/**
+ Returns the number of threads in the network request thread pool. By default, this is `1`.
+ */
++ (NSUInteger)numberOfNetworkRequestThreads;
+
+/**
+ Sets the number of threads in the network request thread pool. Each thread runs its own run loop, on which the `NSURLConnection` delegate callbacks for the operations assigned to it are delivered.
+ 
+ @param numberOfThreads The number of network request threads. Values less than `1` are treated as `1`.
+ 
+ @discussion The thread pool is created when the first operation starts, so this must be called before any operations are started; subsequent calls have no effect.
+ */
++ (void)setNumberOfNetworkRequestThreads:(NSUInteger)numberOfThreads;
+
+/**
+ Returns the policy used to assign operations to network request threads. By default, this is `AFNetworkRequestThreadLeastLoadedSchedulingPolicy`.
+ */
++ (AFNetworkRequestThreadSchedulingPolicy)networkRequestThreadSchedulingPolicy;
+
+/**
+ Sets the policy used to assign operations to network request threads.
+ 
+ @param policy The scheduling policy.
+ */
++ (void)setNetworkRequestThreadSchedulingPolicy:(AFNetworkRequestThreadSchedulingPolicy)policy;
+
+/**
+ Returns the number of executing operations currently assigned to each network request thread.
+ 
+ @return An array of `NSNumber` objects, one for each thread in the pool, in thread order.
+ */
++ (NSArray *)networkRequestThreadQueueDepths;
+
+/**
+ Creates the network request thread pool and waits for each thread's run loop to be ready, so that the first operation to start does not pay for it.
+ 
+ @discussion This is otherwise done lazily when the first operation starts. Calling it more than once has no further effect.
+ */
++ (void)prewarmNetworkRequestThreads;
+
+///---------------------------------
+/// @name Validating Responses Early
+///---------------------------------
+
+/**
+ The maximum number of bytes of response data the operation will receive. If the response's expected content length, or the number of bytes read so far, exceeds this, the connection is cancelled, and the operation finishes with an `NSURLErrorDataLengthExceedsMaximum` error. `0`, the default, means there is no maximum.
+ */
+@property (nonatomic, assign) long long maximumResponseLength;
+
+/**
+ Sets a callback to be called as soon as the response headers are received, before any of the body is downloaded.
+ 
+ @param block A block object to be called when the response is received. This block returns an error if the response is unacceptable, or `nil` otherwise, and takes two arguments: the request sent from the client, and the response received from the server. If an error is returned, the connection is cancelled without downloading the body, and the operation finishes with that error.
+ 
+ @discussion Fresh responses served from `responseCache` are validated with this block too, before being delivered. `AFJSONRequestOperation` uses this to reject responses with unacceptable status codes or content types, such as HTML error pages, before downloading them, and does not validate them again on completion.
+ */
+- (void)setResponseValidationBlock:(NSError * (^)(NSURLRequest *request, NSHTTPURLResponse *response))block;
+
+///--------------------------------
+/// @name Decoding Response Content
+///--------------------------------
+
+/**
+ The content coding of the response body that the operation decoded, such as `zstd`, or `nil` if the body was not decoded by the operation.
+ 
+ @discussion A response body is decoded when its `Content-Encoding` is a single content coding with a registered decoder, and the connection has not already decoded it. `NSURLConnection` decodes `gzip` and `deflate` itself. Decoding is done on a serial queue of the operation, rather than on the network request thread, and only decoded data is accumulated in `responseBody` or written to the `outputStream`.
+ */
+@property (readonly, nonatomic, copy) NSString *contentCoding;
+
+/**
+ The number of bytes the response body has decoded to so far. Divided by `totalBytesRead`, this is the compression ratio of the response. If the operation has a `maximumResponseLength`, it also applies to the decoded length.
+ */
+@property (readonly, nonatomic, assign) long long decodedContentLength;
+
+/**
+ The CPU time spent decoding the response body so far.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval contentDecodingTime;
+
+/**
+ Registers a decoder class for a content coding, for use by all operations.
+ 
+ @param decoderClass A class conforming to `AFHTTPContentDecoder`, an instance of which is created to decode each response body sent with the content coding, or `Nil` to unregister the content coding.
+ @param contentCoding The content coding, such as `zstd`, as it appears in the `Content-Encoding` header. Content codings are case-insensitive.
+ 
+ @discussion `gzip` and `deflate` are registered with `AFZlibContentDecoder` by default, and `zstd` and `br` with `AFZstdContentDecoder` and `AFBrotliContentDecoder` when those are built. A newly registered content coding is preferred over those registered before it.
+ */
++ (void)registerContentDecoderClass:(Class)decoderClass 
+                   forContentCoding:(NSString *)contentCoding;
+
+/**
+ Returns the content codings with registered decoders, from the most to the least preferred.
+ 
+ @discussion `AFHTTPClient` advertises these in its default `Accept-Encoding` header.
+ */
++ (NSArray *)registeredContentCodings;
+
+/**
+ Returns cumulative counters for the decoding of response bodies by all operations.
+ 
+ @return A dictionary keyed by content coding, whose values are dictionaries containing values for `AFContentDecodingResponseCountKey`, `AFContentDecodingEncodedByteCountKey`, `AFContentDecodingDecodedByteCountKey`, `AFContentDecodingCompressionRatioKey`, and `AFContentDecodingTimeKey`.
+ */
++ (NSDictionary *)contentDecodingStatistics;
+
+/**
+ Called on the network request thread with each chunk of the response body, once it has been decoded if the operation decodes its content coding, and before it is accumulated or written to the `outputStream`.
+ 
+ @param data The chunk of the response body.
+ 
+ @discussion Subclasses that process the response body as it is received override this method, rather than `transportConnection:didReceiveData:`, whose data may still be encoded, and call `super`.
+ */
+- (void)didReceiveResponseBodyData:(NSData *)data;
+
+/**
+ Whether each chunk of the response body is kept, to make up the `responseBody` once the request finishes. `YES` by default.
+ 
+ @discussion Subclasses that consume the body in `didReceiveResponseBodyData:` as it is received override this method to return `NO`, so that the body is not also held in memory in full. The `responseBody` of such an operation is `nil`, and its response is not stored in the `responseCache`. Operations with an `outputStream` write the body to it either way.
+ */
+- (BOOL)accumulatesResponseBody;
+
+///----------------------------------
+/// @name Managing Streaming Output
+///----------------------------------
+
+/**
+ The maximum number of bytes received from the connection that are held while waiting for the output stream to accept them. By default, this is 1 MB.
+ 
+ @discussion When the output stream cannot keep up with the connection, received data is queued and written as the stream signals that it has space available. Once the queue exceeds this capacity, the connection stops delivering data until the queue has drained to half of it, so that downloads proceed at the speed of the stream with bounded memory.
+ */
+@property (nonatomic, assign) NSUInteger outputStreamBufferCapacity;
+
+/**
+ The number of bytes received from the connection that have not yet been written to the output stream.
+ */
+@property (readonly, nonatomic, assign) NSUInteger outputStreamBufferedLength;
+
+/**
+ The largest number of bytes that have been waiting to be written to the output stream at once.
+ */
+@property (readonly, nonatomic, assign) NSUInteger maximumOutputStreamBufferedLength;
+
+/**
+ The total time for which the connection has been paused waiting for the output stream to drain.
+ */
+@property (readonly, nonatomic, assign) NSTimeInterval outputStreamStallTime;
+
+///--------------------------------
+/// @name Measuring Request Timing
+///--------------------------------
+
+/**
+ Returns the time at which the operation reached the specified timing point.
+ 
+ @param timingPoint The timing point.
+ 
+ @return The absolute time of the timing point, or `0` if the operation has not reached it.
+ */
+- (CFAbsoluteTime)timeForTimingPoint:(AFHTTPRequestOperationTimingPoint)timingPoint;
+
+/**
+ Records the current time for the specified timing point.
+ 
+ @param timingPoint The timing point.
+ 
+ @discussion Operations mark their own timing points up to `AFHTTPRequestOperationLoadingFinishedTimingPoint`. Constructors that process the response asynchronously, such as those of `AFJSONRequestOperation` and `AFImageRequestOperation`, mark `AFHTTPRequestOperationProcessingStartedTimingPoint` from their completion callback, and the remaining points once processing has finished and the result has been delivered; otherwise, the operation marks them itself once its completion callback returns. When `AFHTTPRequestOperationDeliveredTimingPoint` is marked, the operation's timing breakdown is recorded in the latency histograms.
+ */
+- (void)markTimingPoint:(AFHTTPRequestOperationTimingPoint)timingPoint;
+
+/**
+ Returns the duration of each stage of the operation that has completed.
+ 
+ @return A dictionary of `NSNumber` durations in seconds, keyed by the timing keys, such as `AFHTTPRequestOperationTimeToFirstByteTimingKey`. Stages that the operation has not completed, or skipped, such as connecting when answered from the response cache, are omitted.
+ */
+- (NSDictionary *)timingBreakdown;
+
+/**
+ Returns a snapshot of the latency histograms of all operations that have delivered their results.
+ 
+ @return A dictionary keyed by host, whose values are dictionaries keyed by path template, in which numeric and identifier-like path components are replaced by `:id`, such as `/spots/:id`, whose values are dictionaries of `AFHTTPLatencyHistogram` objects keyed by the timing keys.
+ */
++ (NSDictionary *)latencyHistograms;
+
+/**
+ Returns a snapshot of the latency histogram of the specified stage, for operations that delivered their results for requests with the same host and path template as the specified request.
+ 
+ @param request The request whose host and path template to look up.
+ @param timingKey The timing key of the stage, such as `AFHTTPRequestOperationTimeToFirstByteTimingKey`.
+ 
+ @return The histogram, or `nil` if no such operation has delivered its result.
+ */
++ (AFHTTPLatencyHistogram *)latencyHistogramForRequest:(NSURLRequest *)request 
+                                             timingKey:(NSString *)timingKey;
+
+/**
+ Discards all recorded latency histograms.
+ */
++ (void)resetLatencyHistograms;
+
 ///---------------------------------
 /// @name Setting Progress Callbacks
 ///---------------------------------
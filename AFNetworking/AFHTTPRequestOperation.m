@@ -21,9 +21,12 @@
 // THE SOFTWARE.
 
 #import "AFHTTPRequestOperation.h"
+#import "AFSegmentedData.h"
+#import "AFHTTPResponseCache.h"
+#import "AFHTTPLatencyHistogram.h"
 
-static NSUInteger const kAFHTTPMinimumInitialDataCapacity = 1024;
-static NSUInteger const kAFHTTPMaximumInitialDataCapacity = 1024 * 1024 * 8;
+#include <libkern/OSAtomic.h>
+#include <mach/mach.h>
 
 typedef enum {
     AFHTTPOperationReadyState       = 1,
@@ -37,8 +40,23 @@ NSString * const AFNetworkingErrorDomain = @"com.alamofire.networking.error";
 NSString * const AFHTTPOperationDidStartNotification = @"com.alamofire.networking.http-operation.start";
 NSString * const AFHTTPOperationDidFinishNotification = @"com.alamofire.networking.http-operation.finish";
 
+NSString * const AFHTTPRequestOperationQueueWaitTimingKey = @"queueWait";
+NSString * const AFHTTPRequestOperationStartHandoffTimingKey = @"startHandoff";
+NSString * const AFHTTPRequestOperationTimeToFirstByteTimingKey = @"timeToFirstByte";
+NSString * const AFHTTPRequestOperationTransferTimingKey = @"transfer";
+NSString * const AFHTTPRequestOperationProcessingTimingKey = @"processing";
+NSString * const AFHTTPRequestOperationDeliveryTimingKey = @"delivery";
+NSString * const AFHTTPRequestOperationTotalTimingKey = @"total";
+
+NSString * const AFContentDecodingResponseCountKey = @"AFContentDecodingResponseCount";
+NSString * const AFContentDecodingEncodedByteCountKey = @"AFContentDecodingEncodedByteCount";
+NSString * const AFContentDecodingDecodedByteCountKey = @"AFContentDecodingDecodedByteCount";
+NSString * const AFContentDecodingCompressionRatioKey = @"AFContentDecodingCompressionRatio";
+NSString * const AFContentDecodingTimeKey = @"AFContentDecodingTime";
+
 typedef void (^AFHTTPRequestOperationProgressBlock)(NSInteger bytes, NSInteger totalBytes, NSInteger totalBytesExpected);
 typedef void (^AFHTTPRequestOperationCompletionBlock)(NSURLRequest *request, NSHTTPURLResponse *response, NSData *data, NSError *error);
+typedef NSError * (^AFHTTPRequestOperationResponseValidationBlock)(NSURLRequest *request, NSHTTPURLResponse *response);
 
 static inline NSString * AFKeyPathFromOperationState(AFHTTPOperationState state) {
     switch (state) {
@@ -47,6 +65,7 @@ static inline NSString * AFKeyPathFromOperationState(AFHTTPOperationState state)
         case AFHTTPOperationExecutingState:
             return @"isExecuting";
         case AFHTTPOperationFinishedState:
+        case AFHTTPOperationCancelledState:
             return @"isFinished";
         default:
             return @"state";
@@ -58,46 +77,158 @@ static inline BOOL AFHTTPOperationStateTransitionIsValid(AFHTTPOperationState fr
         case AFHTTPOperationReadyState:
             switch (to) {
                 case AFHTTPOperationExecutingState:
+                case AFHTTPOperationCancelledState:
                     return YES;
                 default:
                     return NO;
             }
         case AFHTTPOperationExecutingState:
             switch (to) {
-                case AFHTTPOperationReadyState:
-                    return NO;
-                default:
+                case AFHTTPOperationFinishedState:
+                case AFHTTPOperationCancelledState:
                     return YES;
+                default:
+                    return NO;
             }
-        case AFHTTPOperationFinishedState:
-            return NO;
         default:
-            return YES;
+            return NO;
+    }
+}
+
+static NSString * AFPathTemplateFromURL(NSURL *url) {
+    NSCharacterSet *nonDecimalDigitCharacterSet = [[NSCharacterSet decimalDigitCharacterSet] invertedSet];
+    NSCharacterSet *nonIdentifierCharacterSet = [[NSCharacterSet characterSetWithCharactersInString:@"0123456789abcdefABCDEF-"] invertedSet];
+    
+    NSMutableArray *mutableComponents = [NSMutableArray array];
+    for (NSString *component in [[url path] componentsSeparatedByString:@"/"]) {
+        BOOL isNumeric = [component length] > 0 && [component rangeOfCharacterFromSet:nonDecimalDigitCharacterSet].location == NSNotFound;
+        BOOL isIdentifier = [component length] >= 16 && [component rangeOfCharacterFromSet:nonIdentifierCharacterSet].location == NSNotFound;
+        [mutableComponents addObject:(isNumeric || isIdentifier) ? @":id" : component];
     }
+    
+    NSString *pathTemplate = [mutableComponents componentsJoinedByString:@"/"];
+    
+    return [pathTemplate length] > 0 ? pathTemplate : @"/";
 }
 
-@interface AFHTTPRequestOperation ()
-@property (readwrite, nonatomic, assign) AFHTTPOperationState state;
-@property (readwrite, nonatomic, assign, getter = isCancelled) BOOL cancelled;
-@property (readwrite, nonatomic, retain) NSURLConnection *connection;
+static dispatch_queue_t af_http_request_operation_latency_histogram_queue() {
+    static dispatch_queue_t _latencyHistogramQueue = NULL;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _latencyHistogramQueue = dispatch_queue_create("com.alamofire.networking.http-operation.latency-histograms", 0);
+    });
+    
+    return _latencyHistogramQueue;
+}
+
+static NSMutableDictionary *_latencyHistograms = nil;
+
+static NSMutableArray *_contentCodings = nil;
+static NSMutableDictionary *_contentDecoderClasses = nil;
+static NSMutableDictionary *_contentDecodingStatistics = nil;
+
+static dispatch_queue_t af_http_request_operation_content_decoders_queue() {
+    static dispatch_queue_t _contentDecodersQueue = NULL;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _contentDecodersQueue = dispatch_queue_create("com.alamofire.networking.http-operation.content-decoders", 0);
+        
+        _contentCodings = [[NSMutableArray alloc] init];
+        _contentDecoderClasses = [[NSMutableDictionary alloc] init];
+        _contentDecodingStatistics = [[NSMutableDictionary alloc] init];
+        
+        // Listed from the most to the least preferred, since zstd and brotli compress JSON better than gzip
+#if AFNETWORKING_ZSTD_AVAILABLE
+        [_contentCodings addObject:@"zstd"];
+        [_contentDecoderClasses setObject:[AFZstdContentDecoder class] forKey:@"zstd"];
+#endif
+#if AFNETWORKING_BROTLI_AVAILABLE
+        [_contentCodings addObject:@"br"];
+        [_contentDecoderClasses setObject:[AFBrotliContentDecoder class] forKey:@"br"];
+#endif
+        [_contentCodings addObject:@"gzip"];
+        [_contentDecoderClasses setObject:[AFZlibContentDecoder class] forKey:@"gzip"];
+        [_contentCodings addObject:@"deflate"];
+        [_contentDecoderClasses setObject:[AFZlibContentDecoder class] forKey:@"deflate"];
+    });
+    
+    return _contentDecodersQueue;
+}
+
+static Class AFContentDecoderClassForContentCoding(NSString *contentCoding) {
+    __block Class decoderClass = Nil;
+    dispatch_sync(af_http_request_operation_content_decoders_queue(), ^{
+        decoderClass = [_contentDecoderClasses objectForKey:contentCoding];
+    });
+    
+    return decoderClass;
+}
+
+static NSTimeInterval AFCurrentThreadCPUTime() {
+    thread_basic_info_data_t info;
+    mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+    mach_port_t thread = mach_thread_self();
+    kern_return_t result = thread_info(thread, THREAD_BASIC_INFO, (thread_info_t)&info, &count);
+    mach_port_deallocate(mach_task_self(), thread);
+    
+    if (result != KERN_SUCCESS) {
+        return 0.0;
+    }
+    
+    return (info.user_time.seconds + info.system_time.seconds) + (info.user_time.microseconds + info.system_time.microseconds) / (NSTimeInterval)USEC_PER_SEC;
+}
+
+static NSUInteger const kAFHTTPDefaultOutputStreamBufferCapacity = 1024 * 1024;
+
+@interface AFHTTPRequestOperation () <NSStreamDelegate>
+@property (readwrite, nonatomic, retain) id <AFHTTPTransportConnection> connection;
 @property (readwrite, nonatomic, retain) NSURLRequest *request;
 @property (readwrite, nonatomic, retain) NSHTTPURLResponse *response;
 @property (readwrite, nonatomic, retain) NSError *error;
 @property (readwrite, nonatomic, retain) NSData *responseBody;
 @property (readwrite, nonatomic, assign) NSInteger totalBytesRead;
-@property (readwrite, nonatomic, retain) NSMutableData *dataAccumulator;
+@property (readwrite, nonatomic, retain) NSMutableArray *dataAccumulator;
 @property (readwrite, nonatomic, retain) NSOutputStream *outputStream;
+@property (readwrite, nonatomic, retain) NSMutableArray *outputStreamPendingWrites;
+@property (readwrite, nonatomic, assign) NSUInteger outputStreamBufferedLength;
+@property (readwrite, nonatomic, assign) NSUInteger maximumOutputStreamBufferedLength;
+@property (readwrite, nonatomic, assign) NSTimeInterval outputStreamStallTime;
 @property (readwrite, nonatomic, copy) AFHTTPRequestOperationProgressBlock uploadProgress;
 @property (readwrite, nonatomic, copy) AFHTTPRequestOperationProgressBlock downloadProgress;
 @property (readwrite, nonatomic, copy) AFHTTPRequestOperationCompletionBlock completion;
+@property (readwrite, nonatomic, copy) AFHTTPRequestOperationResponseValidationBlock responseValidation;
+@property (readwrite, nonatomic, assign) NSUInteger networkRequestThreadIndex;
+@property (readwrite, nonatomic, retain) AFCachedHTTPResponse *cachedResponse;
+@property (readwrite, nonatomic, copy) NSString *contentCoding;
+@property (readwrite, nonatomic, retain) id <AFHTTPContentDecoder> contentDecoder;
+@property (readwrite, nonatomic, assign) dispatch_queue_t contentDecodingQueue;
+@property (readwrite, nonatomic, assign) long long decodedContentLength;
+@property (readwrite, nonatomic, assign) NSTimeInterval contentDecodingTime;
+
++ (NSArray *)networkRequestThreads;
++ (NSUInteger)networkRequestThreadIndexForRequest:(NSURLRequest *)request;
+
+- (AFHTTPOperationState)state;
+- (BOOL)transitionToState:(AFHTTPOperationState)state;
 
 - (void)operationDidStart;
 - (void)finish;
+- (void)writePendingDataToOutputStream;
+- (void)pauseConnection;
+- (void)resumeConnection;
+- (void)closeOutputStreamAndFinish;
+- (void)failWithError:(NSError *)error;
+- (NSError *)responseLengthExceededError;
+- (void)prepareContentDecoderForConnection:(id <AFHTTPTransportConnection>)connection;
+- (void)decodeResponseBodyData:(NSData *)data 
+                   isLastChunk:(BOOL)isLastChunk;
+- (void)didFinishLoadingResponseBody;
+- (void)recordContentDecodingStatistics;
+- (void)recordTimingBreakdownInLatencyHistograms;
 @end
 
 @implementation AFHTTPRequestOperation
-@synthesize state = _state;
-@synthesize cancelled = _cancelled;
+@synthesize transport = _transport;
 @synthesize connection = _connection;
 @synthesize runLoopModes = _runLoopModes;
 @synthesize request = _request;
@@ -107,13 +238,100 @@ static inline BOOL AFHTTPOperationStateTransitionIsValid(AFHTTPOperationState fr
 @synthesize totalBytesRead = _totalBytesRead;
 @synthesize dataAccumulator = _dataAccumulator;
 @synthesize outputStream = _outputStream;
+@synthesize outputStreamPendingWrites = _outputStreamPendingWrites;
+@synthesize outputStreamBufferCapacity = _outputStreamBufferCapacity;
+@synthesize outputStreamBufferedLength = _outputStreamBufferedLength;
+@synthesize maximumOutputStreamBufferedLength = _maximumOutputStreamBufferedLength;
+@synthesize outputStreamStallTime = _outputStreamStallTime;
 @synthesize uploadProgress = _uploadProgress;
 @synthesize downloadProgress = _downloadProgress;
 @synthesize completion = _completion;
+@synthesize responseValidation = _responseValidation;
+@synthesize maximumResponseLength = _maximumResponseLength;
+@synthesize networkRequestThreadIndex = _networkRequestThreadIndex;
+@synthesize responseCache = _responseCache;
+@synthesize cachedResponse = _cachedResponse;
+@synthesize contentCoding = _contentCoding;
+@synthesize contentDecoder = _contentDecoder;
+@synthesize contentDecodingQueue = _contentDecodingQueue;
+@synthesize decodedContentLength = _decodedContentLength;
+@synthesize contentDecodingTime = _contentDecodingTime;
 
-static NSThread *_networkRequestThread = nil;
+static NSUInteger _numberOfNetworkRequestThreads = 1;
+static AFNetworkRequestThreadSchedulingPolicy _networkRequestThreadSchedulingPolicy = AFNetworkRequestThreadLeastLoadedSchedulingPolicy;
+static NSArray *_networkRequestThreads = nil;
+static volatile int32_t *_networkRequestThreadQueueDepths = NULL;
 
-+ (void)networkRequestThreadEntryPoint:(id)__unused object {
+typedef struct _AFNetworkRequestStartNode {
+    struct _AFNetworkRequestStartNode *next;
+    AFHTTPRequestOperation *operation;
+} AFNetworkRequestStartNode;
+
+// Operations started on a network request thread are pushed onto a lock-free stack by any number of threads, and the whole stack is taken at once by a run loop source on the network request thread, which is only signalled when the stack was empty, so that a burst of starts costs a single wakeup.
+typedef struct {
+    AFNetworkRequestStartNode * volatile head;
+    CFRunLoopSourceRef source;
+    CFRunLoopRef runLoop;
+} AFNetworkRequestStartQueue;
+
+static AFNetworkRequestStartQueue *_networkRequestStartQueues = NULL;
+static dispatch_semaphore_t _networkRequestThreadSetupSemaphore = NULL;
+
+static void AFNetworkRequestStartQueueEnqueue(AFNetworkRequestStartQueue *startQueue, AFHTTPRequestOperation *operation) {
+    AFNetworkRequestStartNode *node = malloc(sizeof(AFNetworkRequestStartNode));
+    node->operation = [operation retain];
+    
+    AFNetworkRequestStartNode *head;
+    do {
+        head = startQueue->head;
+        node->next = head;
+    } while (!OSAtomicCompareAndSwapPtrBarrier(head, node, (void * volatile *)&startQueue->head));
+    
+    if (!head) {
+        CFRunLoopSourceSignal(startQueue->source);
+        CFRunLoopWakeUp(startQueue->runLoop);
+    }
+}
+
+static void AFNetworkRequestStartQueuePerform(void *info) {
+    AFNetworkRequestStartQueue *startQueue = (AFNetworkRequestStartQueue *)info;
+    
+    AFNetworkRequestStartNode *head;
+    do {
+        head = startQueue->head;
+    } while (!OSAtomicCompareAndSwapPtrBarrier(head, NULL, (void * volatile *)&startQueue->head));
+    
+    // Nodes are pushed in reverse order, so the list is reversed to start operations in the order they were enqueued
+    AFNetworkRequestStartNode *node = NULL;
+    while (head) {
+        AFNetworkRequestStartNode *next = head->next;
+        head->next = node;
+        node = head;
+        head = next;
+    }
+    
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    while (node) {
+        AFNetworkRequestStartNode *next = node->next;
+        [node->operation operationDidStart];
+        [node->operation release];
+        free(node);
+        node = next;
+    }
+    [pool drain];
+}
+
++ (void)networkRequestThreadEntryPoint:(NSNumber *)threadIndex {
+    NSAutoreleasePool *setupPool = [[NSAutoreleasePool alloc] init];
+    AFNetworkRequestStartQueue *startQueue = &_networkRequestStartQueues[[threadIndex unsignedIntegerValue]];
+    CFRunLoopSourceContext context = {0, startQueue, NULL, NULL, NULL, NULL, NULL, NULL, NULL, AFNetworkRequestStartQueuePerform};
+    startQueue->source = CFRunLoopSourceCreate(kCFAllocatorDefault, 0, &context);
+    startQueue->runLoop = CFRunLoopGetCurrent();
+    CFRunLoopAddSource(startQueue->runLoop, startQueue->source, kCFRunLoopCommonModes);
+    [setupPool drain];
+    
+    dispatch_semaphore_signal(_networkRequestThreadSetupSemaphore);
+    
     do {
         NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
         [[NSRunLoop currentRunLoop] run];
@@ -121,15 +339,84 @@ static NSThread *_networkRequestThread = nil;
     } while (YES);
 }
 
-+ (NSThread *)networkRequestThread {
++ (NSArray *)networkRequestThreads {
     static dispatch_once_t oncePredicate;
     
     dispatch_once(&oncePredicate, ^{
-        _networkRequestThread = [[NSThread alloc] initWithTarget:self selector:@selector(networkRequestThreadEntryPoint:) object:nil];
-        [_networkRequestThread start];
+        _networkRequestThreadQueueDepths = calloc(_numberOfNetworkRequestThreads, sizeof(int32_t));
+        _networkRequestStartQueues = calloc(_numberOfNetworkRequestThreads, sizeof(AFNetworkRequestStartQueue));
+        _networkRequestThreadSetupSemaphore = dispatch_semaphore_create(0);
+        
+        NSMutableArray *mutableThreads = [NSMutableArray arrayWithCapacity:_numberOfNetworkRequestThreads];
+        for (NSUInteger idx = 0; idx < _numberOfNetworkRequestThreads; idx++) {
+            NSThread *thread = [[[NSThread alloc] initWithTarget:self selector:@selector(networkRequestThreadEntryPoint:) object:[NSNumber numberWithUnsignedInteger:idx]] autorelease];
+            [thread setName:[NSString stringWithFormat:@"com.alamofire.networking.http-operation.thread-%lu", (unsigned long)idx]];
+            [thread start];
+            [mutableThreads addObject:thread];
+        }
+        
+        // Each thread's run loop source must exist before operations can be handed to it
+        for (NSUInteger idx = 0; idx < _numberOfNetworkRequestThreads; idx++) {
+            dispatch_semaphore_wait(_networkRequestThreadSetupSemaphore, DISPATCH_TIME_FOREVER);
+        }
+        
+        _networkRequestThreads = [mutableThreads copy];
     });
         
-    return _networkRequestThread;
+    return _networkRequestThreads;
+}
+
++ (NSUInteger)networkRequestThreadIndexForRequest:(NSURLRequest *)request {
+    NSUInteger numberOfThreads = [[self networkRequestThreads] count];
+    if (numberOfThreads == 1) {
+        return 0;
+    }
+    
+    switch (_networkRequestThreadSchedulingPolicy) {
+        case AFNetworkRequestThreadHostHashSchedulingPolicy:
+            return [[[[request URL] host] lowercaseString] hash] % numberOfThreads;
+        case AFNetworkRequestThreadLeastLoadedSchedulingPolicy:
+        default: {
+            NSUInteger leastLoadedIndex = 0;
+            for (NSUInteger idx = 1; idx < numberOfThreads; idx++) {
+                if (_networkRequestThreadQueueDepths[idx] < _networkRequestThreadQueueDepths[leastLoadedIndex]) {
+                    leastLoadedIndex = idx;
+                }
+            }
+            
+            return leastLoadedIndex;
+        }
+    }
+}
+
++ (NSUInteger)numberOfNetworkRequestThreads {
+    return _numberOfNetworkRequestThreads;
+}
+
++ (void)setNumberOfNetworkRequestThreads:(NSUInteger)numberOfThreads {
+    _numberOfNetworkRequestThreads = MAX(numberOfThreads, (NSUInteger)1);
+}
+
++ (AFNetworkRequestThreadSchedulingPolicy)networkRequestThreadSchedulingPolicy {
+    return _networkRequestThreadSchedulingPolicy;
+}
+
++ (void)setNetworkRequestThreadSchedulingPolicy:(AFNetworkRequestThreadSchedulingPolicy)policy {
+    _networkRequestThreadSchedulingPolicy = policy;
+}
+
++ (NSArray *)networkRequestThreadQueueDepths {
+    NSUInteger numberOfThreads = [[self networkRequestThreads] count];
+    NSMutableArray *mutableQueueDepths = [NSMutableArray arrayWithCapacity:numberOfThreads];
+    for (NSUInteger idx = 0; idx < numberOfThreads; idx++) {
+        [mutableQueueDepths addObject:[NSNumber numberWithInt:_networkRequestThreadQueueDepths[idx]]];
+    }
+    
+    return mutableQueueDepths;
+}
+
++ (void)prewarmNetworkRequestThreads {
+    [self networkRequestThreads];
 }
 
 + (AFHTTPRequestOperation *)operationWithRequest:(NSURLRequest *)urlRequest 
@@ -174,7 +461,15 @@ static NSThread *_networkRequestThread = nil;
     	
     self.runLoopModes = [NSSet setWithObject:NSRunLoopCommonModes];
     
-    self.state = AFHTTPOperationReadyState;
+    self.transport = [AFURLConnectionTransport sharedTransport];
+    
+    self.networkRequestThreadIndex = NSNotFound;
+    
+    self.outputStreamBufferCapacity = kAFHTTPDefaultOutputStreamBufferCapacity;
+    
+    [self markTimingPoint:AFHTTPRequestOperationCreatedTimingPoint];
+    
+    _state = AFHTTPOperationReadyState;
 	
     return self;
 }
@@ -187,12 +482,24 @@ static NSThread *_networkRequestThread = nil;
     [_responseBody release];
     [_dataAccumulator release];
     [_outputStream release]; _outputStream = nil;
+    [_outputStreamPendingWrites release];
     
     [_connection release]; _connection = nil;
+    [_transport release];
+    
+    [_responseCache release];
+    [_cachedResponse release];
+    
+    [_contentCoding release];
+    [_contentDecoder release];
+    if (_contentDecodingQueue) {
+        dispatch_release(_contentDecodingQueue);
+    }
 	
     [_uploadProgress release];
     [_downloadProgress release];
     [_completion release];
+    [_responseValidation release];
     [super dealloc];
 }
 
@@ -204,21 +511,33 @@ static NSThread *_networkRequestThread = nil;
     self.downloadProgress = block;
 }
 
-- (void)setState:(AFHTTPOperationState)state {
-    if (self.state == state) {
-        return;
-    }
-    
-    if (!AFHTTPOperationStateTransitionIsValid(self.state, state)) {
-        return;
-    }
+- (void)setResponseValidationBlock:(NSError * (^)(NSURLRequest *request, NSHTTPURLResponse *response))block {
+    self.responseValidation = block;
+}
+
+- (AFHTTPOperationState)state {
+    return (AFHTTPOperationState)_state;
+}
+
+// State changes are made with a compare-and-swap, so that when transitions race, such as `cancel` on one thread and `finish` on the network thread, exactly one of them takes effect, and only it notifies observers once the swap has succeeded.
+- (BOOL)transitionToState:(AFHTTPOperationState)state {
+    AFHTTPOperationState fromState;
+    do {
+        fromState = [self state];
+        if (!AFHTTPOperationStateTransitionIsValid(fromState, state)) {
+            return NO;
+        }
+    } while (!OSAtomicCompareAndSwap32Barrier(fromState, state, &_state));
     
-    NSString *oldStateKey = AFKeyPathFromOperationState(self.state);
+    NSString *oldStateKey = AFKeyPathFromOperationState(fromState);
     NSString *newStateKey = AFKeyPathFromOperationState(state);
     
     [self willChangeValueForKey:newStateKey];
     [self willChangeValueForKey:oldStateKey];
-    _state = state;
+    if (state == AFHTTPOperationCancelledState) {
+        [self willChangeValueForKey:@"isCancelled"];
+        [self didChangeValueForKey:@"isCancelled"];
+    }
     [self didChangeValueForKey:oldStateKey];
     [self didChangeValueForKey:newStateKey];
     
@@ -227,21 +546,22 @@ static NSThread *_networkRequestThread = nil;
             [[NSNotificationCenter defaultCenter] postNotificationName:AFHTTPOperationDidStartNotification object:self];
             break;
         case AFHTTPOperationFinishedState:
-            [[NSNotificationCenter defaultCenter] postNotificationName:AFHTTPOperationDidFinishNotification object:self];
+        case AFHTTPOperationCancelledState:
+            if (self.networkRequestThreadIndex != NSNotFound) {
+                OSAtomicDecrement32Barrier(&_networkRequestThreadQueueDepths[self.networkRequestThreadIndex]);
+                self.networkRequestThreadIndex = NSNotFound;
+            }
+            
+            // Operations cancelled before they started never posted a start notification
+            if (fromState == AFHTTPOperationExecutingState) {
+                [[NSNotificationCenter defaultCenter] postNotificationName:AFHTTPOperationDidFinishNotification object:self];
+            }
             break;
         default:
             break;
     }
-}
-
-- (void)setCancelled:(BOOL)cancelled {
-    [self willChangeValueForKey:@"isCancelled"];
-    _cancelled = cancelled;
-    [self didChangeValueForKey:@"isCancelled"];
     
-    if ([self isCancelled]) {
-        self.state = AFHTTPOperationFinishedState;
-    }
+    return YES;
 }
 
 - (NSString *)responseString {
@@ -254,6 +574,258 @@ static NSThread *_networkRequestThread = nil;
     return [[[NSString alloc] initWithData:self.responseBody encoding:textEncoding] autorelease];
 }
 
+#pragma mark - Timing
+
++ (NSDictionary *)latencyHistograms {
+    NSMutableDictionary *mutableHistograms = [NSMutableDictionary dictionary];
+    dispatch_sync(af_http_request_operation_latency_histogram_queue(), ^{
+        for (NSString *host in _latencyHistograms) {
+            NSMutableDictionary *mutablePathHistograms = [NSMutableDictionary dictionary];
+            NSDictionary *pathHistograms = [_latencyHistograms objectForKey:host];
+            for (NSString *pathTemplate in pathHistograms) {
+                NSDictionary *timingHistograms = [pathHistograms objectForKey:pathTemplate];
+                NSMutableDictionary *mutableTimingHistograms = [NSMutableDictionary dictionaryWithCapacity:[timingHistograms count]];
+                for (NSString *timingKey in timingHistograms) {
+                    [mutableTimingHistograms setObject:[[[timingHistograms objectForKey:timingKey] copy] autorelease] forKey:timingKey];
+                }
+                [mutablePathHistograms setObject:mutableTimingHistograms forKey:pathTemplate];
+            }
+            [mutableHistograms setObject:mutablePathHistograms forKey:host];
+        }
+    });
+    
+    return mutableHistograms;
+}
+
++ (AFHTTPLatencyHistogram *)latencyHistogramForRequest:(NSURLRequest *)request 
+                                             timingKey:(NSString *)timingKey
+{
+    NSString *host = [[[request URL] host] lowercaseString] ?: @"";
+    NSString *pathTemplate = AFPathTemplateFromURL([request URL]);
+    
+    __block AFHTTPLatencyHistogram *histogram = nil;
+    dispatch_sync(af_http_request_operation_latency_histogram_queue(), ^{
+        histogram = [[[[_latencyHistograms objectForKey:host] objectForKey:pathTemplate] objectForKey:timingKey] copy];
+    });
+    
+    return [histogram autorelease];
+}
+
++ (void)resetLatencyHistograms {
+    dispatch_async(af_http_request_operation_latency_histogram_queue(), ^{
+        [_latencyHistograms removeAllObjects];
+    });
+}
+
+#pragma mark - Content Decoding
+
++ (void)registerContentDecoderClass:(Class)decoderClass 
+                   forContentCoding:(NSString *)contentCoding
+{
+    NSString *lowercaseContentCoding = [contentCoding lowercaseString];
+    dispatch_sync(af_http_request_operation_content_decoders_queue(), ^{
+        [_contentCodings removeObject:lowercaseContentCoding];
+        [_contentDecoderClasses removeObjectForKey:lowercaseContentCoding];
+        
+        if (decoderClass) {
+            [_contentCodings insertObject:lowercaseContentCoding atIndex:0];
+            [_contentDecoderClasses setObject:decoderClass forKey:lowercaseContentCoding];
+        }
+    });
+}
+
++ (NSArray *)registeredContentCodings {
+    __block NSArray *contentCodings = nil;
+    dispatch_sync(af_http_request_operation_content_decoders_queue(), ^{
+        contentCodings = [_contentCodings copy];
+    });
+    
+    return [contentCodings autorelease];
+}
+
++ (NSDictionary *)contentDecodingStatistics {
+    NSMutableDictionary *mutableStatistics = [NSMutableDictionary dictionary];
+    dispatch_sync(af_http_request_operation_content_decoders_queue(), ^{
+        [_contentDecodingStatistics enumerateKeysAndObjectsUsingBlock:^(id contentCoding, id statistics, __unused BOOL *stop) {
+            NSMutableDictionary *mutableCodingStatistics = [NSMutableDictionary dictionaryWithDictionary:statistics];
+            double encodedByteCount = [[statistics objectForKey:AFContentDecodingEncodedByteCountKey] doubleValue];
+            double decodedByteCount = [[statistics objectForKey:AFContentDecodingDecodedByteCountKey] doubleValue];
+            [mutableCodingStatistics setObject:[NSNumber numberWithDouble:(encodedByteCount > 0 ? decodedByteCount / encodedByteCount : 0.0)] forKey:AFContentDecodingCompressionRatioKey];
+            [mutableStatistics setObject:mutableCodingStatistics forKey:contentCoding];
+        }];
+    });
+    
+    return mutableStatistics;
+}
+
+- (void)recordContentDecodingStatistics {
+    NSString *contentCoding = self.contentCoding;
+    long long encodedByteCount = self.totalBytesRead;
+    long long decodedByteCount = self.decodedContentLength;
+    NSTimeInterval decodingTime = self.contentDecodingTime;
+    
+    dispatch_async(af_http_request_operation_content_decoders_queue(), ^{
+        NSDictionary *statistics = [_contentDecodingStatistics objectForKey:contentCoding];
+        
+        NSMutableDictionary *mutableStatistics = [NSMutableDictionary dictionaryWithCapacity:4];
+        [mutableStatistics setObject:[NSNumber numberWithUnsignedLongLong:([[statistics objectForKey:AFContentDecodingResponseCountKey] unsignedLongLongValue] + 1)] forKey:AFContentDecodingResponseCountKey];
+        [mutableStatistics setObject:[NSNumber numberWithLongLong:([[statistics objectForKey:AFContentDecodingEncodedByteCountKey] longLongValue] + encodedByteCount)] forKey:AFContentDecodingEncodedByteCountKey];
+        [mutableStatistics setObject:[NSNumber numberWithLongLong:([[statistics objectForKey:AFContentDecodingDecodedByteCountKey] longLongValue] + decodedByteCount)] forKey:AFContentDecodingDecodedByteCountKey];
+        [mutableStatistics setObject:[NSNumber numberWithDouble:([[statistics objectForKey:AFContentDecodingTimeKey] doubleValue] + decodingTime)] forKey:AFContentDecodingTimeKey];
+        
+        [_contentDecodingStatistics setObject:mutableStatistics forKey:contentCoding];
+    });
+}
+
+- (void)prepareContentDecoderForConnection:(id <AFHTTPTransportConnection>)connection {
+    _responseBodyIsEncoded = NO;
+    
+    NSString *contentCoding = [[AFHTTPHeaderValueForKey([self.response allHeaderFields], @"Content-Encoding") stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+    if ([contentCoding length] == 0 || [contentCoding isEqualToString:@"identity"]) {
+        return;
+    }
+    
+    // Connections that decode a content coding themselves leave it in the response headers
+    if ([connection respondsToSelector:@selector(decodesContentCoding:)] && [connection decodesContentCoding:contentCoding]) {
+        return;
+    }
+    
+    // Bodies with more than one content coding, or one without a registered decoder, are delivered as they were received
+    Class decoderClass = AFContentDecoderClassForContentCoding(contentCoding);
+    id <AFHTTPContentDecoder> contentDecoder = [[[decoderClass alloc] init] autorelease];
+    if (!contentDecoder) {
+        _responseBodyIsEncoded = YES;
+        return;
+    }
+    
+    self.contentCoding = contentCoding;
+    self.contentDecoder = contentDecoder;
+    if (!self.contentDecodingQueue) {
+        self.contentDecodingQueue = dispatch_queue_create("com.alamofire.networking.http-operation.content-decoding", 0);
+    }
+    
+    _contentDecodingRunLoop = CFRunLoopGetCurrent();
+}
+
+// Chunks are decoded in order on the operation's own queue, so that decoding does not hold up the other connections of the network request thread, and the decoded data is handed back to the network request thread in the same order
+- (void)decodeResponseBodyData:(NSData *)data 
+                   isLastChunk:(BOOL)isLastChunk
+{
+    id <AFHTTPContentDecoder> contentDecoder = self.contentDecoder;
+    CFRunLoopRef runLoop = _contentDecodingRunLoop;
+    NSArray *runLoopModes = [self.runLoopModes allObjects];
+    
+    dispatch_async(self.contentDecodingQueue, ^(void) {
+        if ([self isFinished]) {
+            return;
+        }
+        
+        NSTimeInterval startTime = AFCurrentThreadCPUTime();
+        NSError *decodingError = nil;
+        NSData *decodedData = isLastChunk ? [contentDecoder finishDecoding:&decodingError] : [contentDecoder decodeData:data error:&decodingError];
+        NSTimeInterval decodingTime = AFCurrentThreadCPUTime() - startTime;
+        
+        CFRunLoopPerformBlock(runLoop, (CFArrayRef)runLoopModes, ^{
+            if ([self isFinished]) {
+                return;
+            }
+            
+            self.contentDecodingTime += decodingTime;
+            
+            if (!decodedData) {
+                NSMutableDictionary *userInfo = [NSMutableDictionary dictionaryWithDictionary:[decodingError userInfo]];
+                [userInfo setValue:[self.request URL] forKey:NSURLErrorFailingURLErrorKey];
+                [self failWithError:[[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorCannotDecodeContentData userInfo:userInfo] autorelease]];
+                return;
+            }
+            
+            if ([decodedData length] > 0) {
+                [self didReceiveResponseBodyData:decodedData];
+            }
+            
+            if (isLastChunk && ![self isFinished]) {
+                [self recordContentDecodingStatistics];
+                [self didFinishLoadingResponseBody];
+            }
+        });
+        CFRunLoopWakeUp(runLoop);
+    });
+}
+
+- (CFAbsoluteTime)timeForTimingPoint:(AFHTTPRequestOperationTimingPoint)timingPoint {
+    return _timingPoints[timingPoint];
+}
+
+- (void)markTimingPoint:(AFHTTPRequestOperationTimingPoint)timingPoint {
+    if (_timingPoints[timingPoint] != 0) {
+        return;
+    }
+    
+    _timingPoints[timingPoint] = CFAbsoluteTimeGetCurrent();
+    
+    if (timingPoint == AFHTTPRequestOperationDeliveredTimingPoint) {
+        [self recordTimingBreakdownInLatencyHistograms];
+    }
+}
+
+- (NSDictionary *)timingBreakdown {
+    static AFHTTPRequestOperationTimingPoint const stages[][2] = {
+        {AFHTTPRequestOperationCreatedTimingPoint, AFHTTPRequestOperationStartedTimingPoint},
+        {AFHTTPRequestOperationStartedTimingPoint, AFHTTPRequestOperationConnectionStartedTimingPoint},
+        {AFHTTPRequestOperationConnectionStartedTimingPoint, AFHTTPRequestOperationResponseReceivedTimingPoint},
+        {AFHTTPRequestOperationResponseReceivedTimingPoint, AFHTTPRequestOperationLoadingFinishedTimingPoint},
+        {AFHTTPRequestOperationProcessingStartedTimingPoint, AFHTTPRequestOperationProcessingFinishedTimingPoint},
+        {AFHTTPRequestOperationProcessingFinishedTimingPoint, AFHTTPRequestOperationDeliveredTimingPoint},
+        {AFHTTPRequestOperationCreatedTimingPoint, AFHTTPRequestOperationDeliveredTimingPoint},
+    };
+    NSArray *timingKeys = [NSArray arrayWithObjects:AFHTTPRequestOperationQueueWaitTimingKey, AFHTTPRequestOperationStartHandoffTimingKey, AFHTTPRequestOperationTimeToFirstByteTimingKey, AFHTTPRequestOperationTransferTimingKey, AFHTTPRequestOperationProcessingTimingKey, AFHTTPRequestOperationDeliveryTimingKey, AFHTTPRequestOperationTotalTimingKey, nil];
+    
+    NSMutableDictionary *mutableTimingBreakdown = [NSMutableDictionary dictionaryWithCapacity:[timingKeys count]];
+    for (NSUInteger idx = 0; idx < [timingKeys count]; idx++) {
+        CFAbsoluteTime startTime = _timingPoints[stages[idx][0]];
+        CFAbsoluteTime endTime = _timingPoints[stages[idx][1]];
+        if (startTime != 0 && endTime != 0) {
+            [mutableTimingBreakdown setObject:[NSNumber numberWithDouble:MAX(endTime - startTime, 0.0)] forKey:[timingKeys objectAtIndex:idx]];
+        }
+    }
+    
+    return mutableTimingBreakdown;
+}
+
+- (void)recordTimingBreakdownInLatencyHistograms {
+    NSDictionary *timingBreakdown = [self timingBreakdown];
+    NSString *host = [[[self.request URL] host] lowercaseString] ?: @"";
+    NSString *pathTemplate = AFPathTemplateFromURL([self.request URL]);
+    
+    dispatch_async(af_http_request_operation_latency_histogram_queue(), ^{
+        if (!_latencyHistograms) {
+            _latencyHistograms = [[NSMutableDictionary alloc] init];
+        }
+        
+        NSMutableDictionary *pathHistograms = [_latencyHistograms objectForKey:host];
+        if (!pathHistograms) {
+            pathHistograms = [NSMutableDictionary dictionary];
+            [_latencyHistograms setObject:pathHistograms forKey:host];
+        }
+        
+        NSMutableDictionary *timingHistograms = [pathHistograms objectForKey:pathTemplate];
+        if (!timingHistograms) {
+            timingHistograms = [NSMutableDictionary dictionary];
+            [pathHistograms setObject:timingHistograms forKey:pathTemplate];
+        }
+        
+        [timingBreakdown enumerateKeysAndObjectsUsingBlock:^(id timingKey, id duration, __unused BOOL *stop) {
+            AFHTTPLatencyHistogram *histogram = [timingHistograms objectForKey:timingKey];
+            if (!histogram) {
+                histogram = [[[AFHTTPLatencyHistogram alloc] init] autorelease];
+                [timingHistograms setObject:histogram forKey:timingKey];
+            }
+            
+            [histogram recordDuration:[duration doubleValue]];
+        }];
+    });
+}
+
 #pragma mark - NSOperation
 
 - (BOOL)isReady {
@@ -265,7 +837,12 @@ static NSThread *_networkRequestThread = nil;
 }
 
 - (BOOL)isFinished {
-    return self.state == AFHTTPOperationFinishedState;
+    AFHTTPOperationState state = self.state;
+    return state == AFHTTPOperationFinishedState || state == AFHTTPOperationCancelledState;
+}
+
+- (BOOL)isCancelled {
+    return self.state == AFHTTPOperationCancelledState;
 }
 
 - (BOOL)isConcurrent {
@@ -276,14 +853,52 @@ static NSThread *_networkRequestThread = nil;
     if (![self isReady]) {
         return;
     }
+    
+    [self markTimingPoint:AFHTTPRequestOperationStartedTimingPoint];
+    
+    if (self.responseCache && !self.outputStream) {
+        self.cachedResponse = [self.responseCache cachedResponseForRequest:self.request];
+        if ([self.cachedResponse isFreshForRequest:self.request]) {
+            self.response = [self.cachedResponse HTTPURLResponse];
+            
+            // Fresh responses never reach `transportConnection:didReceiveResponse:`, so they are validated here instead
+            self.error = self.responseValidation ? self.responseValidation(self.request, self.response) : nil;
+            if (!self.error) {
+                self.responseBody = self.cachedResponse.data;
+            }
+            
+            if ([self transitionToState:AFHTTPOperationExecutingState]) {
+                [self finish];
+            }
+            
+            return;
+        }
+    }
         
-    self.state = AFHTTPOperationExecutingState;
+    NSUInteger threadIndex = [[self class] networkRequestThreadIndexForRequest:self.request];
+    OSAtomicIncrement32Barrier(&_networkRequestThreadQueueDepths[threadIndex]);
+    self.networkRequestThreadIndex = threadIndex;
+    
+    if (![self transitionToState:AFHTTPOperationExecutingState]) {
+        OSAtomicDecrement32Barrier(&_networkRequestThreadQueueDepths[threadIndex]);
+        self.networkRequestThreadIndex = NSNotFound;
+        return;
+    }
 
-    [self performSelector:@selector(operationDidStart) onThread:[[self class] networkRequestThread] withObject:nil waitUntilDone:YES modes:[self.runLoopModes allObjects]];
+    AFNetworkRequestStartQueueEnqueue(&_networkRequestStartQueues[threadIndex], self);
 }
 
 - (void)operationDidStart {
-    self.connection = [[[NSURLConnection alloc] initWithRequest:self.request delegate:self startImmediately:NO] autorelease];
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    [self markTimingPoint:AFHTTPRequestOperationConnectionStartedTimingPoint];
+    
+    NSURLRequest *request = self.cachedResponse ? [self.cachedResponse conditionalRequestForRequest:self.request] : self.request;
+    self.connection = [self.transport connectionWithRequest:request delegate:self];
+    
+    [self.outputStream setDelegate:self];
     
     NSRunLoop *runLoop = [NSRunLoop currentRunLoop];
     for (NSString *runLoopMode in self.runLoopModes) {
@@ -292,61 +907,100 @@ static NSThread *_networkRequestThread = nil;
     }
     
     [self.connection start];
+    
+    if ([self isCancelled]) {
+        [self.connection cancel];
+    }
 }
 
 - (void)cancel {
-    if ([self isFinished]) {
+    if (![self transitionToState:AFHTTPOperationCancelledState]) {
         return;
     }
     
     [super cancel];
     
-    self.cancelled = YES;
-    
     [self.connection cancel];
 }
 
 - (void)finish {
-    self.state = AFHTTPOperationFinishedState;
+    // Marked before the transition, so that observers of `isFinished` can read it
+    [self markTimingPoint:AFHTTPRequestOperationLoadingFinishedTimingPoint];
     
-    if ([self isCancelled]) {
+    if (![self transitionToState:AFHTTPOperationFinishedState]) {
         return;
     }
     
     if (self.completion) {
         self.completion(self.request, self.response, self.responseBody, self.error);
     }
+    
+    // Completion callbacks that process the response asynchronously mark the remaining timing points themselves
+    if ([self timeForTimingPoint:AFHTTPRequestOperationProcessingStartedTimingPoint] == 0) {
+        [self markTimingPoint:AFHTTPRequestOperationProcessingStartedTimingPoint];
+        [self markTimingPoint:AFHTTPRequestOperationProcessingFinishedTimingPoint];
+        [self markTimingPoint:AFHTTPRequestOperationDeliveredTimingPoint];
+    }
 }
 
-#pragma mark - NSURLConnection
+#pragma mark - AFHTTPTransportConnectionDelegate
 
-- (void)connection:(NSURLConnection *)__unused connection 
-didReceiveResponse:(NSURLResponse *)response 
+- (void)transportConnection:(id <AFHTTPTransportConnection>)connection 
+         didReceiveResponse:(NSHTTPURLResponse *)response 
 {
-    self.response = (NSHTTPURLResponse *)response;
+    [self markTimingPoint:AFHTTPRequestOperationResponseReceivedTimingPoint];
+    
+    self.response = response;
+    
+    if (self.cachedResponse) {
+        if ([self.response statusCode] == 304) {
+            self.cachedResponse = [self.responseCache cachedResponseByRevalidatingCachedResponse:self.cachedResponse withNotModifiedResponse:self.response forRequest:self.request];
+            self.response = [self.cachedResponse HTTPURLResponse];
+        } else {
+            self.cachedResponse = nil;
+        }
+    }
+    
+    NSError *validationError = self.responseValidation ? self.responseValidation(self.request, self.response) : nil;
+    if (!validationError && self.maximumResponseLength > 0 && !self.cachedResponse && [self.response expectedContentLength] > self.maximumResponseLength) {
+        validationError = [self responseLengthExceededError];
+    }
+    
+    if (validationError) {
+        [self failWithError:validationError];
+        return;
+    }
+    
+    if (!self.cachedResponse) {
+        [self prepareContentDecoderForConnection:connection];
+    }
     
     if (self.outputStream) {
+        self.outputStreamPendingWrites = [NSMutableArray array];
         [self.outputStream open];
     } else {
-        
-        NSUInteger maxCapacity = MAX((NSUInteger)llabs(response.expectedContentLength), kAFHTTPMinimumInitialDataCapacity);
-        NSUInteger capacity = MIN(maxCapacity, kAFHTTPMaximumInitialDataCapacity);
-        self.dataAccumulator = [NSMutableData dataWithCapacity:capacity];
+        self.dataAccumulator = [NSMutableArray array];
     }
 }
 
-- (void)connection:(NSURLConnection *)__unused connection 
-    didReceiveData:(NSData *)data 
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+             didReceiveData:(NSData *)data 
 {
     self.totalBytesRead += [data length];
     
-    if (self.outputStream) {
-        if ([self.outputStream hasSpaceAvailable]) {
-            const uint8_t *dataBuffer = [data bytes];
-            [self.outputStream write:&dataBuffer[0] maxLength:[data length]];
-        }
+    if (self.maximumResponseLength > 0 && self.totalBytesRead > self.maximumResponseLength) {
+        [self failWithError:[self responseLengthExceededError]];
+        return;
+    }
+    
+    if (self.contentDecoder) {
+        [self decodeResponseBodyData:data isLastChunk:NO];
     } else {
-        [self.dataAccumulator appendData:data];
+        [self didReceiveResponseBodyData:data];
+    }
+    
+    if ([self isFinished]) {
+        return;
     }
     
     if (self.downloadProgress) {
@@ -354,24 +1008,84 @@ didReceiveResponse:(NSURLResponse *)response
     }
 }
 
-- (void)connectionDidFinishLoading:(NSURLConnection *)__unused connection {        
+- (BOOL)accumulatesResponseBody {
+    return YES;
+}
+
+- (void)didReceiveResponseBodyData:(NSData *)data {
+    self.decodedContentLength += [data length];
+    
+    if (self.maximumResponseLength > 0 && self.decodedContentLength > self.maximumResponseLength) {
+        [self failWithError:[self responseLengthExceededError]];
+        return;
+    }
+    
     if (self.outputStream) {
-        [self.outputStream close];
+        NSData *segment = [data copy];
+        [self.outputStreamPendingWrites addObject:segment];
+        [segment release];
+        
+        self.outputStreamBufferedLength += [data length];
+        self.maximumOutputStreamBufferedLength = MAX(self.maximumOutputStreamBufferedLength, self.outputStreamBufferedLength);
+        
+        [self writePendingDataToOutputStream];
+        
+        if (self.outputStreamBufferedLength > self.outputStreamBufferCapacity) {
+            [self pauseConnection];
+        }
+    } else if ([self accumulatesResponseBody]) {
+        // Copying an immutable `NSData` only retains it, so this avoids copying the received bytes
+        NSData *segment = [data copy];
+        [self.dataAccumulator addObject:segment];
+        [segment release];
+    }
+}
+
+- (void)transportConnectionDidFinishLoading:(id <AFHTTPTransportConnection>)__unused connection {
+    // The operation finishes once the decoder has delivered the rest of the decoded body
+    if (self.contentDecoder && self.totalBytesRead > 0) {
+        [self decodeResponseBodyData:nil isLastChunk:YES];
+        return;
+    }
+    
+    [self didFinishLoadingResponseBody];
+}
+
+- (void)didFinishLoadingResponseBody {
+    if (self.outputStream) {
+        // The operation finishes once the data still waiting for the output stream has been written
+        _connectionFinishedLoading = YES;
+        [self writePendingDataToOutputStream];
+        
+        return;
+    } else if (self.cachedResponse) {
+        self.responseBody = self.cachedResponse.data;
+        [_dataAccumulator release]; _dataAccumulator = nil;
+    } else if (![self accumulatesResponseBody]) {
+        // A body that was consumed as it arrived was not kept, and cannot be cached either
+        [_dataAccumulator release]; _dataAccumulator = nil;
     } else {
-        self.responseBody = [NSData dataWithData:self.dataAccumulator];
+        self.responseBody = [AFSegmentedData dataWithSegments:self.dataAccumulator];
         [_dataAccumulator release]; _dataAccumulator = nil;
+        
+        // The cache stores decoded bodies, and so does not keep one that is still in a content coding
+        if (!_responseBodyIsEncoded) {
+            [self.responseCache storeResponse:self.response data:self.responseBody forRequest:self.request];
+        }
     }
 
     [self finish];
 }
 
-- (void)connection:(NSURLConnection *)__unused connection 
-  didFailWithError:(NSError *)error 
-{      
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+           didFailWithError:(NSError *)error 
+{
     self.error = error;
     
     if (self.outputStream) {
+        [self.outputStream setDelegate:nil];
         [self.outputStream close];
+        [_outputStreamPendingWrites release]; _outputStreamPendingWrites = nil;
     } else {
         [_dataAccumulator release]; _dataAccumulator = nil;
     }
@@ -379,24 +1093,134 @@ didReceiveResponse:(NSURLResponse *)response
     [self finish];
 }
 
-- (void)connection:(NSURLConnection *)__unused connection 
-   didSendBodyData:(NSInteger)bytesWritten 
- totalBytesWritten:(NSInteger)totalBytesWritten 
-totalBytesExpectedToWrite:(NSInteger)totalBytesExpectedToWrite
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+            didSendBodyData:(NSInteger)bytesWritten 
+          totalBytesWritten:(NSInteger)totalBytesWritten 
+  totalBytesExpectedToWrite:(NSInteger)totalBytesExpectedToWrite
 {
     if (self.uploadProgress) {
         self.uploadProgress(bytesWritten, totalBytesWritten, totalBytesExpectedToWrite);
     }
 }
 
-- (NSCachedURLResponse *)connection:(NSURLConnection *)__unused connection 
-                  willCacheResponse:(NSCachedURLResponse *)cachedResponse 
+#pragma mark -
+
+- (void)failWithError:(NSError *)error {
+    [self.connection cancel];
+    
+    self.error = error;
+    
+    [_dataAccumulator release]; _dataAccumulator = nil;
+    [_outputStreamPendingWrites release]; _outputStreamPendingWrites = nil;
+    self.outputStreamBufferedLength = 0;
+    
+    if (self.outputStream) {
+        [self.outputStream setDelegate:nil];
+        [self.outputStream close];
+    }
+    
+    [self finish];
+}
+
+- (NSError *)responseLengthExceededError {
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+    [userInfo setValue:[NSString stringWithFormat:NSLocalizedString(@"Response exceeded the maximum length of %lld bytes", nil), self.maximumResponseLength] forKey:NSLocalizedDescriptionKey];
+    [userInfo setValue:[self.request URL] forKey:NSURLErrorFailingURLErrorKey];
+    
+    return [[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorDataLengthExceedsMaximum userInfo:userInfo] autorelease];
+}
+
+#pragma mark - NSStreamDelegate
+
+- (void)stream:(NSStream *)stream 
+   handleEvent:(NSStreamEvent)eventCode
 {
-    if ([self isCancelled]) {
-        return nil;
+    if (stream != self.outputStream) {
+        return;
+    }
+    
+    switch (eventCode) {
+        case NSStreamEventHasSpaceAvailable:
+            [self writePendingDataToOutputStream];
+            break;
+        case NSStreamEventErrorOccurred:
+            self.error = [stream streamError];
+            [self resumeConnection];
+            [self.connection cancel];
+            
+            [_outputStreamPendingWrites release]; _outputStreamPendingWrites = nil;
+            self.outputStreamBufferedLength = 0;
+            [self closeOutputStreamAndFinish];
+            break;
+        default:
+            break;
+    }
+}
+
+#pragma mark -
+
+- (void)writePendingDataToOutputStream {
+    while ([self.outputStreamPendingWrites count] > 0 && [self.outputStream hasSpaceAvailable]) {
+        NSData *data = [self.outputStreamPendingWrites objectAtIndex:0];
+        const uint8_t *dataBuffer = [data bytes];
+        NSInteger numberOfBytesWritten = [self.outputStream write:&dataBuffer[_outputStreamPendingWriteOffset] maxLength:([data length] - _outputStreamPendingWriteOffset)];
+        if (numberOfBytesWritten <= 0) {
+            break;
+        }
+        
+        self.outputStreamBufferedLength -= numberOfBytesWritten;
+        _outputStreamPendingWriteOffset += numberOfBytesWritten;
+        if (_outputStreamPendingWriteOffset == [data length]) {
+            [self.outputStreamPendingWrites removeObjectAtIndex:0];
+            _outputStreamPendingWriteOffset = 0;
+        }
+    }
+    
+    if (_connectionPaused && self.outputStreamBufferedLength <= self.outputStreamBufferCapacity / 2) {
+        [self resumeConnection];
+    }
+    
+    if (_connectionFinishedLoading && self.outputStreamBufferedLength == 0) {
+        [self closeOutputStreamAndFinish];
+    }
+}
+
+// Connections cannot be paused directly, but while it is unscheduled from the run loop it delivers no data, and the socket's receive buffer filling up applies flow control to the server
+- (void)pauseConnection {
+    if (_connectionPaused) {
+        return;
+    }
+    
+    _connectionPaused = YES;
+    _outputStreamStallStartTime = CFAbsoluteTimeGetCurrent();
+    
+    NSRunLoop *runLoop = [NSRunLoop currentRunLoop];
+    for (NSString *runLoopMode in self.runLoopModes) {
+        [self.connection unscheduleFromRunLoop:runLoop forMode:runLoopMode];
+    }
+}
+
+- (void)resumeConnection {
+    if (!_connectionPaused) {
+        return;
     }
     
-    return cachedResponse;
+    _connectionPaused = NO;
+    self.outputStreamStallTime += CFAbsoluteTimeGetCurrent() - _outputStreamStallStartTime;
+    
+    NSRunLoop *runLoop = [NSRunLoop currentRunLoop];
+    for (NSString *runLoopMode in self.runLoopModes) {
+        [self.connection scheduleInRunLoop:runLoop forMode:runLoopMode];
+    }
+}
+
+- (void)closeOutputStreamAndFinish {
+    _connectionFinishedLoading = NO;
+    
+    [self.outputStream setDelegate:nil];
+    [self.outputStream close];
+    
+    [self finish];
 }
 
 @end
@@ -0,0 +1,249 @@
+// AFHTTPResponseCache.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ Returns the value of a header field, whose name is matched case-insensitively, since transports other than `NSURLConnection` keep names as they were sent by the server.
+ */
+extern NSString * AFHTTPHeaderValueForKey(NSDictionary *headers, NSString *key);
+
+/**
+ Returns the date represented by an HTTP-date header value, such as that of `Expires`, `Last-Modified`, or `Retry-After`, in the RFC 1123 format, or `nil` if the string is not a valid HTTP-date.
+ */
+extern NSDate * AFDateFromHTTPDateString(NSString *string);
+
+/**
+ Returns an HTTP URL response with the specified status code and header fields, with its MIME type, text encoding name, and expected content length taken from the header fields. `NSHTTPURLResponse` cannot be initialized with a status code and header fields before iOS 5.
+ */
+extern NSHTTPURLResponse * AFHTTPURLResponseWithURL(NSURL *URL, NSInteger statusCode, NSDictionary *headerFields);
+
+/**
+ `AFCachedHTTPResponse` represents a response stored in an `AFHTTPResponseCache`, along with the information needed to determine whether it is fresh, and to revalidate it with the server when it is not.
+ */
+@interface AFCachedHTTPResponse : NSObject <NSCoding> {
+@private
+    NSURL *_URL;
+    NSInteger _statusCode;
+    NSDictionary *_allHeaderFields;
+    NSDictionary *_varyingRequestHeaderFields;
+    NSData *_data;
+    NSDate *_storedDate;
+}
+
+/**
+ The URL of the cached response.
+ */
+@property (readonly, nonatomic, retain) NSURL *URL;
+
+/**
+ The HTTP status code of the cached response.
+ */
+@property (readonly, nonatomic, assign) NSInteger statusCode;
+
+/**
+ The HTTP headers of the cached response.
+ */
+@property (readonly, nonatomic, retain) NSDictionary *allHeaderFields;
+
+/**
+ The values of the request headers named by the `Vary` header of the response, at the time the response was stored. A cached response is only used for requests with matching values for these headers.
+ */
+@property (readonly, nonatomic, retain) NSDictionary *varyingRequestHeaderFields;
+
+/**
+ The body of the cached response.
+ */
+@property (readonly, nonatomic, retain) NSData *data;
+
+/**
+ The date at which the response was stored or last revalidated.
+ */
+@property (readonly, nonatomic, retain) NSDate *storedDate;
+
+/**
+ Whether the cached response can be used without revalidating it with the server, as determined by its `Cache-Control`, `Expires`, `Date`, and `Last-Modified` headers.
+ */
+- (BOOL)isFresh;
+
+/**
+ Whether the cached response can be used for the specified request without revalidating it with the server. This is the case if it is fresh, and the request does not have a `Cache-Control: no-cache` or `Pragma: no-cache` header, or a `Cache-Control: max-age` lower than the age of the response.
+ 
+ @param request The request to be answered.
+ */
+- (BOOL)isFreshForRequest:(NSURLRequest *)request;
+
+/**
+ Whether the cached response has an `ETag` or `Last-Modified` validator that can be used to make a conditional request.
+ */
+- (BOOL)canBeRevalidated;
+
+/**
+ Returns a copy of the specified request, with `If-None-Match` and `If-Modified-Since` headers set from the validators of the cached response.
+ 
+ @param request The request to be revalidated.
+ */
+- (NSURLRequest *)conditionalRequestForRequest:(NSURLRequest *)request;
+
+/**
+ Returns an `NSHTTPURLResponse` object with the status code and headers of the cached response.
+ */
+- (NSHTTPURLResponse *)HTTPURLResponse;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFHTTPResponseCache` is a two-level cache of HTTP responses, consisting of a size-bounded, least-recently-used memory cache in front of a size-bounded store on disk. It is used by `AFHTTPRequestOperation` to answer `GET` requests with fresh responses without going to the network, and to revalidate stale responses with conditional requests.
+ 
+ @discussion Responses are keyed by HTTP method and URL, along with the values of any request headers named by the response's `Vary` header, so that each variant of a response is stored separately. The header fields that responses for a URL vary on are stored alongside them. Only `200` responses to `GET` requests that are not marked `no-store`, and that either have a freshness lifetime or a validator, are stored.
+ */
+@interface AFHTTPResponseCache : NSObject {
+@private
+    NSUInteger _memoryCapacity;
+    NSUInteger _diskCapacity;
+    NSString *_diskPath;
+    NSMutableDictionary *_memoryCachedResponses;
+    NSMutableArray *_leastRecentlyUsedKeys;
+    NSMutableDictionary *_varyingHeaderFieldsByKey;
+    NSCountedSet *_pendingDiskRemovalKeys;
+    NSUInteger _pendingDiskRemovalOfAllResponsesCount;
+    NSUInteger _removalCount;
+    NSUInteger _currentMemoryUsage;
+    NSUInteger _currentDiskUsage;
+    dispatch_queue_t _queue;
+    
+    NSUInteger _hitCount;
+    NSUInteger _missCount;
+    NSUInteger _revalidationCount;
+    NSUInteger _notModifiedCount;
+}
+
+/**
+ The maximum number of bytes of response data held in memory.
+ */
+@property (readonly, nonatomic, assign) NSUInteger memoryCapacity;
+
+/**
+ The maximum number of bytes of cached responses stored on disk.
+ */
+@property (readonly, nonatomic, assign) NSUInteger diskCapacity;
+
+/**
+ The directory in which cached responses are stored.
+ */
+@property (readonly, nonatomic, retain) NSString *diskPath;
+
+/**
+ The number of bytes of response data currently held in memory.
+ */
+@property (readonly, nonatomic, assign) NSUInteger currentMemoryUsage;
+
+/**
+ The number of bytes of cached responses currently stored on disk.
+ */
+@property (readonly, nonatomic, assign) NSUInteger currentDiskUsage;
+
+/**
+ The number of requests that were answered with a fresh cached response.
+ */
+@property (readonly, nonatomic, assign) NSUInteger hitCount;
+
+/**
+ The number of requests for which there was no usable cached response.
+ */
+@property (readonly, nonatomic, assign) NSUInteger missCount;
+
+/**
+ The number of requests for which there was a stale cached response, which was revalidated with a conditional request.
+ */
+@property (readonly, nonatomic, assign) NSUInteger revalidationCount;
+
+/**
+ The number of conditional requests for which the server responded with `304 Not Modified`, and which were answered with the cached response.
+ */
+@property (readonly, nonatomic, assign) NSUInteger notModifiedCount;
+
+/**
+ Initializes a response cache with the specified capacities and disk path.
+ 
+ @param memoryCapacity The maximum number of bytes of response data to hold in memory.
+ @param diskCapacity The maximum number of bytes of cached responses to store on disk. If `0`, responses are only cached in memory.
+ @param path The directory in which to store cached responses. If `nil`, a directory in the application's caches directory is used.
+ 
+ @return The newly-initialized response cache
+ */
+- (id)initWithMemoryCapacity:(NSUInteger)memoryCapacity 
+                diskCapacity:(NSUInteger)diskCapacity 
+                    diskPath:(NSString *)path;
+
+/**
+ Returns a cached response that can be used for the specified request, either because it is fresh, or because it can be revalidated with a conditional request. 
+ 
+ @param request The request to look up.
+ 
+ @discussion This may read from disk, and so should not be called from the main thread. It does not wait for responses that are being stored to be written to disk. Requests with a cache policy of `NSURLRequestReloadIgnoringLocalCacheData` bypass the cache. Requests that do not accept a fresh response without revalidation, as described in `-[AFCachedHTTPResponse isFreshForRequest:]`, are only answered with a response that can be revalidated.
+ 
+ @return The cached response, or `nil` if there is no usable cached response for the request.
+ */
+- (AFCachedHTTPResponse *)cachedResponseForRequest:(NSURLRequest *)request;
+
+/**
+ Stores a response and its data for the specified request, if the response is cacheable.
+ 
+ @param response The response to store.
+ @param data The body of the response, after any content coding has been decoded.
+ @param request The request for which the response was received.
+ 
+ @discussion The `Content-Encoding` header is not stored, and `Content-Length` is set to the length of `data`, so that the stored headers describe the stored body. `data` is retained rather than copied; an `AFSegmentedData` body is made contiguous on the cache's own queue.
+ */
+- (void)storeResponse:(NSHTTPURLResponse *)response 
+                 data:(NSData *)data 
+           forRequest:(NSURLRequest *)request;
+
+/**
+ Refreshes a cached response with the headers of a `304 Not Modified` response received for a conditional request, and stores the result.
+ 
+ @param cachedResponse The cached response that was revalidated.
+ @param response The `304 Not Modified` response.
+ @param request The original, unconditional request.
+ 
+ @return The refreshed cached response.
+ */
+- (AFCachedHTTPResponse *)cachedResponseByRevalidatingCachedResponse:(AFCachedHTTPResponse *)cachedResponse 
+                                                withNotModifiedResponse:(NSHTTPURLResponse *)response 
+                                                             forRequest:(NSURLRequest *)request;
+
+/**
+ Removes the cached response for the specified request, if any.
+ 
+ @param request The request whose cached response should be removed.
+ */
+- (void)removeCachedResponseForRequest:(NSURLRequest *)request;
+
+/**
+ Removes all cached responses from memory and disk.
+ */
+- (void)removeAllCachedResponses;
+
+@end
@@ -0,0 +1,845 @@
+// AFHTTPResponseCache.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPResponseCache.h"
+#import "AFSegmentedData.h"
+
+#import <CommonCrypto/CommonDigest.h>
+
+static NSUInteger const kAFHTTPResponseCacheEntryOverhead = 512;
+static NSTimeInterval const kAFHTTPResponseCacheMaximumHeuristicFreshnessLifetime = 60.0 * 60.0 * 24.0;
+static NSUInteger const kAFHTTPResponseCacheMaximumVaryIndexCount = 1024;
+
+NSString * AFHTTPHeaderValueForKey(NSDictionary *headers, NSString *key) {
+    NSString *value = [headers valueForKey:key];
+    if (value) {
+        return value;
+    }
+    
+    for (NSString *headerKey in headers) {
+        if ([headerKey caseInsensitiveCompare:key] == NSOrderedSame) {
+            return [headers valueForKey:headerKey];
+        }
+    }
+    
+    return nil;
+}
+
+static NSDictionary * AFCacheControlDirectivesFromHeaders(NSDictionary *headers) {
+    NSString *cacheControl = AFHTTPHeaderValueForKey(headers, @"Cache-Control");
+    if (!cacheControl) {
+        return nil;
+    }
+    
+    NSMutableDictionary *mutableDirectives = [NSMutableDictionary dictionary];
+    for (NSString *component in [[cacheControl lowercaseString] componentsSeparatedByString:@","]) {
+        NSArray *pair = [component componentsSeparatedByString:@"="];
+        NSString *directive = [[pair objectAtIndex:0] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+        if ([directive length] == 0) {
+            continue;
+        }
+        
+        NSString *value = [pair count] > 1 ? [[pair objectAtIndex:1] stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@" \t\""]] : @"";
+        [mutableDirectives setValue:value forKey:directive];
+    }
+    
+    return mutableDirectives;
+}
+
+NSDate * AFDateFromHTTPDateString(NSString *string) {
+    if (!string) {
+        return nil;
+    }
+    
+    static NSDateFormatter *_dateFormatter = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _dateFormatter = [[NSDateFormatter alloc] init];
+        [_dateFormatter setLocale:[[[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"] autorelease]];
+        [_dateFormatter setTimeZone:[NSTimeZone timeZoneWithAbbreviation:@"GMT"]];
+        [_dateFormatter setDateFormat:@"EEE, dd MMM yyyy HH:mm:ss zzz"];
+    });
+    
+    @synchronized(_dateFormatter) {
+        return [_dateFormatter dateFromString:string];
+    }
+}
+
+static NSString * AFHTTPResponseCacheKeyForRequest(NSURLRequest *request) {
+    return [NSString stringWithFormat:@"%@ %@", [request HTTPMethod] ?: @"GET", [[request URL] absoluteString]];
+}
+
+// Each variant of a response that varies on request headers is stored under a key that includes the values of those headers
+static NSString * AFHTTPResponseCacheVariantKeyForRequest(NSURLRequest *request, NSArray *varyingHeaderFields) {
+    NSMutableString *mutableKey = [NSMutableString stringWithString:AFHTTPResponseCacheKeyForRequest(request)];
+    for (NSString *headerField in varyingHeaderFields) {
+        [mutableKey appendFormat:@"\n%@: %@", headerField, [request valueForHTTPHeaderField:headerField] ?: @""];
+    }
+    
+    return mutableKey;
+}
+
+// The header fields a URL's responses vary on are stored under a key of their own, so that they are known before a variant is looked up
+static NSString * AFHTTPResponseCacheVaryKeyForKey(NSString *key) {
+    return [@"Vary " stringByAppendingString:key];
+}
+
+static NSArray * AFVaryingHeaderFieldsFromHeaders(NSDictionary *headers) {
+    NSMutableSet *mutableHeaderFields = [NSMutableSet set];
+    for (NSString *component in [AFHTTPHeaderValueForKey(headers, @"Vary") componentsSeparatedByString:@","]) {
+        NSString *headerField = [[component stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] lowercaseString];
+        if ([headerField length] > 0) {
+            [mutableHeaderFields addObject:headerField];
+        }
+    }
+    
+    return [[mutableHeaderFields allObjects] sortedArrayUsingSelector:@selector(compare:)];
+}
+
+// A request with `Cache-Control: no-cache`, `Pragma: no-cache`, or a `max-age` its cached response is older than, must revalidate the response before using it
+static BOOL AFRequestAcceptsCachedResponseWithAge(NSURLRequest *request, NSTimeInterval age) {
+    NSDictionary *headers = [request allHTTPHeaderFields];
+    NSDictionary *cacheControlDirectives = AFCacheControlDirectivesFromHeaders(headers);
+    if (cacheControlDirectives) {
+        if ([cacheControlDirectives valueForKey:@"no-cache"]) {
+            return NO;
+        }
+        
+        NSString *maxAge = [cacheControlDirectives valueForKey:@"max-age"];
+        return !maxAge || age <= [maxAge doubleValue];
+    }
+    
+    return [[AFHTTPHeaderValueForKey(headers, @"Pragma") lowercaseString] rangeOfString:@"no-cache"].location == NSNotFound;
+}
+
+static NSString * AFHTTPResponseCacheFilenameForKey(NSString *key) {
+    const char *string = [key UTF8String];
+    unsigned char digest[CC_MD5_DIGEST_LENGTH];
+    CC_MD5(string, (CC_LONG)strlen(string), digest);
+    
+    NSMutableString *mutableFilename = [NSMutableString stringWithCapacity:CC_MD5_DIGEST_LENGTH * 2];
+    for (NSUInteger idx = 0; idx < CC_MD5_DIGEST_LENGTH; idx++) {
+        [mutableFilename appendFormat:@"%02x", digest[idx]];
+    }
+    
+    return mutableFilename;
+}
+
+#pragma mark -
+
+@interface AFCachedHTTPURLResponse : NSHTTPURLResponse {
+@private
+    NSInteger _cachedStatusCode;
+    NSDictionary *_cachedHeaderFields;
+}
+
+- (id)initWithURL:(NSURL *)URL 
+       statusCode:(NSInteger)statusCode 
+     headerFields:(NSDictionary *)headerFields;
+@end
+
+@implementation AFCachedHTTPURLResponse
+
+- (id)initWithURL:(NSURL *)URL 
+       statusCode:(NSInteger)statusCode 
+     headerFields:(NSDictionary *)headerFields
+{
+    NSString *contentType = AFHTTPHeaderValueForKey(headerFields, @"Content-Type");
+    NSArray *contentTypeComponents = [contentType componentsSeparatedByString:@";"];
+    NSString *MIMEType = [contentTypeComponents count] > 0 ? [[contentTypeComponents objectAtIndex:0] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] : nil;
+    NSString *textEncodingName = nil;
+    for (NSString *parameter in contentTypeComponents) {
+        NSRange charsetRange = [parameter rangeOfString:@"charset=" options:NSCaseInsensitiveSearch];
+        if (charsetRange.location != NSNotFound) {
+            textEncodingName = [[parameter substringFromIndex:NSMaxRange(charsetRange)] stringByTrimmingCharactersInSet:[NSCharacterSet characterSetWithCharactersInString:@" \t\""]];
+        }
+    }
+    
+    NSString *contentLength = AFHTTPHeaderValueForKey(headerFields, @"Content-Length");
+    
+    self = [super initWithURL:URL MIMEType:MIMEType expectedContentLength:(contentLength ? [contentLength integerValue] : -1) textEncodingName:textEncodingName];
+    if (!self) {
+        return nil;
+    }
+    
+    _cachedStatusCode = statusCode;
+    _cachedHeaderFields = [headerFields copy];
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_cachedHeaderFields release];
+    [super dealloc];
+}
+
+- (NSInteger)statusCode {
+    return _cachedStatusCode;
+}
+
+- (NSDictionary *)allHeaderFields {
+    return _cachedHeaderFields;
+}
+
+@end
+
+NSHTTPURLResponse * AFHTTPURLResponseWithURL(NSURL *URL, NSInteger statusCode, NSDictionary *headerFields) {
+    return [[[AFCachedHTTPURLResponse alloc] initWithURL:URL statusCode:statusCode headerFields:headerFields] autorelease];
+}
+
+#pragma mark -
+
+@interface AFCachedHTTPResponse ()
+@property (readwrite, nonatomic, retain) NSURL *URL;
+@property (readwrite, nonatomic, assign) NSInteger statusCode;
+@property (readwrite, nonatomic, retain) NSDictionary *allHeaderFields;
+@property (readwrite, nonatomic, retain) NSDictionary *varyingRequestHeaderFields;
+@property (readwrite, nonatomic, retain) NSData *data;
+@property (readwrite, nonatomic, retain) NSDate *storedDate;
+
+- (NSTimeInterval)freshnessLifetime;
+- (NSTimeInterval)currentAge;
+- (BOOL)matchesRequest:(NSURLRequest *)request;
+@end
+
+@implementation AFCachedHTTPResponse
+@synthesize URL = _URL;
+@synthesize statusCode = _statusCode;
+@synthesize allHeaderFields = _allHeaderFields;
+@synthesize varyingRequestHeaderFields = _varyingRequestHeaderFields;
+@synthesize data = _data;
+@synthesize storedDate = _storedDate;
+
+- (void)dealloc {
+    [_URL release];
+    [_allHeaderFields release];
+    [_varyingRequestHeaderFields release];
+    [_data release];
+    [_storedDate release];
+    [super dealloc];
+}
+
+- (NSTimeInterval)freshnessLifetime {
+    NSDictionary *cacheControlDirectives = AFCacheControlDirectivesFromHeaders(self.allHeaderFields);
+    if ([cacheControlDirectives valueForKey:@"no-cache"]) {
+        return 0.0;
+    }
+    
+    NSString *maxAge = [cacheControlDirectives valueForKey:@"max-age"];
+    if (maxAge) {
+        return [maxAge doubleValue];
+    }
+    
+    NSDate *date = AFDateFromHTTPDateString(AFHTTPHeaderValueForKey(self.allHeaderFields, @"Date")) ?: self.storedDate;
+    
+    NSString *expires = AFHTTPHeaderValueForKey(self.allHeaderFields, @"Expires");
+    if (expires) {
+        NSDate *expirationDate = AFDateFromHTTPDateString(expires);
+        return expirationDate ? MAX([expirationDate timeIntervalSinceDate:date], 0.0) : 0.0;
+    }
+    
+    // Heuristic freshness, as suggested by RFC 2616 section 13.2.4
+    NSDate *lastModifiedDate = AFDateFromHTTPDateString(AFHTTPHeaderValueForKey(self.allHeaderFields, @"Last-Modified"));
+    if (lastModifiedDate) {
+        return MIN(MAX([date timeIntervalSinceDate:lastModifiedDate] * 0.1, 0.0), kAFHTTPResponseCacheMaximumHeuristicFreshnessLifetime);
+    }
+    
+    return 0.0;
+}
+
+- (NSTimeInterval)currentAge {
+    NSTimeInterval age = MAX([[NSDate date] timeIntervalSinceDate:self.storedDate], 0.0);
+    NSString *ageHeader = AFHTTPHeaderValueForKey(self.allHeaderFields, @"Age");
+    if (ageHeader) {
+        age += MAX([ageHeader doubleValue], 0.0);
+    }
+    
+    return age;
+}
+
+- (BOOL)isFresh {
+    return [self currentAge] < [self freshnessLifetime];
+}
+
+- (BOOL)isFreshForRequest:(NSURLRequest *)request {
+    NSTimeInterval age = [self currentAge];
+    return age < [self freshnessLifetime] && AFRequestAcceptsCachedResponseWithAge(request, age);
+}
+
+- (BOOL)canBeRevalidated {
+    return AFHTTPHeaderValueForKey(self.allHeaderFields, @"ETag") || AFHTTPHeaderValueForKey(self.allHeaderFields, @"Last-Modified");
+}
+
+- (BOOL)matchesRequest:(NSURLRequest *)request {
+    for (NSString *headerField in self.varyingRequestHeaderFields) {
+        NSString *value = [request valueForHTTPHeaderField:headerField] ?: @"";
+        if (![value isEqualToString:[self.varyingRequestHeaderFields valueForKey:headerField]]) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+- (NSURLRequest *)conditionalRequestForRequest:(NSURLRequest *)request {
+    NSMutableURLRequest *mutableRequest = [[request mutableCopy] autorelease];
+    
+    NSString *entityTag = AFHTTPHeaderValueForKey(self.allHeaderFields, @"ETag");
+    if (entityTag) {
+        [mutableRequest setValue:entityTag forHTTPHeaderField:@"If-None-Match"];
+    }
+    
+    NSString *lastModified = AFHTTPHeaderValueForKey(self.allHeaderFields, @"Last-Modified");
+    if (lastModified) {
+        [mutableRequest setValue:lastModified forHTTPHeaderField:@"If-Modified-Since"];
+    }
+    
+    return mutableRequest;
+}
+
+- (NSHTTPURLResponse *)HTTPURLResponse {
+    return AFHTTPURLResponseWithURL(self.URL, self.statusCode, self.allHeaderFields);
+}
+
+#pragma mark - NSCoding
+
+- (id)initWithCoder:(NSCoder *)decoder {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.URL = [decoder decodeObjectForKey:@"URL"];
+    self.statusCode = [decoder decodeIntegerForKey:@"statusCode"];
+    self.allHeaderFields = [decoder decodeObjectForKey:@"allHeaderFields"];
+    self.varyingRequestHeaderFields = [decoder decodeObjectForKey:@"varyingRequestHeaderFields"];
+    self.data = [decoder decodeObjectForKey:@"data"];
+    self.storedDate = [decoder decodeObjectForKey:@"storedDate"];
+    
+    return self;
+}
+
+- (void)encodeWithCoder:(NSCoder *)coder {
+    [coder encodeObject:self.URL forKey:@"URL"];
+    [coder encodeInteger:self.statusCode forKey:@"statusCode"];
+    [coder encodeObject:self.allHeaderFields forKey:@"allHeaderFields"];
+    [coder encodeObject:self.varyingRequestHeaderFields forKey:@"varyingRequestHeaderFields"];
+    [coder encodeObject:self.data forKey:@"data"];
+    [coder encodeObject:self.storedDate forKey:@"storedDate"];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFHTTPResponseCache ()
+@property (readwrite, nonatomic, assign) NSUInteger memoryCapacity;
+@property (readwrite, nonatomic, assign) NSUInteger diskCapacity;
+@property (readwrite, nonatomic, retain) NSString *diskPath;
+@property (readwrite, nonatomic, retain) NSMutableDictionary *memoryCachedResponses;
+@property (readwrite, nonatomic, retain) NSMutableArray *leastRecentlyUsedKeys;
+@property (readwrite, nonatomic, retain) NSMutableDictionary *varyingHeaderFieldsByKey;
+@property (readwrite, nonatomic, retain) NSCountedSet *pendingDiskRemovalKeys;
+@property (readwrite, nonatomic, assign) NSUInteger currentMemoryUsage;
+@property (readwrite, nonatomic, assign) NSUInteger currentDiskUsage;
+
+- (NSString *)diskPathForKey:(NSString *)key;
+- (NSString *)variantKeyForRequest:(NSURLRequest *)request;
+- (BOOL)hasPendingDiskRemovalForKey:(NSString *)key;
+- (void)setMemoryCachedResponse:(AFCachedHTTPResponse *)cachedResponse forKey:(NSString *)key;
+- (void)removeMemoryCachedResponseForKey:(NSString *)key;
+- (void)setDiskCachedResponse:(AFCachedHTTPResponse *)cachedResponse forKey:(NSString *)key;
+- (void)removeDiskCachedResponseForKey:(NSString *)key;
+- (void)removeDiskCachedDataForKey:(NSString *)key;
+- (NSArray *)diskCachedVaryingHeaderFieldsForKey:(NSString *)key;
+- (void)setMemoryVaryingHeaderFields:(NSArray *)varyingHeaderFields forKey:(NSString *)key;
+- (void)setVaryingHeaderFields:(NSArray *)varyingHeaderFields forKey:(NSString *)key;
+- (void)trimDiskToCapacity;
+@end
+
+@implementation AFHTTPResponseCache
+@synthesize memoryCapacity = _memoryCapacity;
+@synthesize diskCapacity = _diskCapacity;
+@synthesize diskPath = _diskPath;
+@synthesize memoryCachedResponses = _memoryCachedResponses;
+@synthesize leastRecentlyUsedKeys = _leastRecentlyUsedKeys;
+@synthesize varyingHeaderFieldsByKey = _varyingHeaderFieldsByKey;
+@synthesize pendingDiskRemovalKeys = _pendingDiskRemovalKeys;
+@synthesize currentMemoryUsage = _currentMemoryUsage;
+@synthesize currentDiskUsage = _currentDiskUsage;
+@synthesize hitCount = _hitCount;
+@synthesize missCount = _missCount;
+@synthesize revalidationCount = _revalidationCount;
+@synthesize notModifiedCount = _notModifiedCount;
+
+- (id)init {
+    return [self initWithMemoryCapacity:(1024 * 1024 * 4) diskCapacity:(1024 * 1024 * 20) diskPath:nil];
+}
+
+- (id)initWithMemoryCapacity:(NSUInteger)memoryCapacity 
+                diskCapacity:(NSUInteger)diskCapacity 
+                    diskPath:(NSString *)path
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.memoryCapacity = memoryCapacity;
+    self.diskCapacity = diskCapacity;
+    
+    if (!path) {
+        NSString *cachesDirectory = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+        path = [cachesDirectory stringByAppendingPathComponent:@"com.alamofire.networking.response-cache"];
+    }
+    self.diskPath = path;
+    
+    self.memoryCachedResponses = [NSMutableDictionary dictionary];
+    self.leastRecentlyUsedKeys = [NSMutableArray array];
+    self.varyingHeaderFieldsByKey = [NSMutableDictionary dictionary];
+    self.pendingDiskRemovalKeys = [NSCountedSet set];
+    
+    _queue = dispatch_queue_create("com.alamofire.networking.response-cache", 0);
+    
+    if (self.diskCapacity > 0) {
+        dispatch_async(_queue, ^{
+            NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+            [fileManager createDirectoryAtPath:self.diskPath withIntermediateDirectories:YES attributes:nil error:nil];
+            
+            NSUInteger diskUsage = 0;
+            for (NSString *filename in [fileManager contentsOfDirectoryAtPath:self.diskPath error:nil]) {
+                NSDictionary *attributes = [fileManager attributesOfItemAtPath:[self.diskPath stringByAppendingPathComponent:filename] error:nil];
+                diskUsage += (NSUInteger)[attributes fileSize];
+            }
+            self.currentDiskUsage = diskUsage;
+            
+            [self trimDiskToCapacity];
+        });
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    dispatch_release(_queue);
+    
+    [_diskPath release];
+    [_memoryCachedResponses release];
+    [_leastRecentlyUsedKeys release];
+    [_varyingHeaderFieldsByKey release];
+    [_pendingDiskRemovalKeys release];
+    [super dealloc];
+}
+
+// Lookups read from disk on the calling thread, rather than waiting behind the writes on `_queue`; files are written atomically, so a read sees either the old file or the new one
+- (AFCachedHTTPResponse *)cachedResponseForRequest:(NSURLRequest *)request {
+    if ([request cachePolicy] == NSURLRequestReloadIgnoringLocalCacheData || ![[request HTTPMethod] isEqualToString:@"GET"]) {
+        return nil;
+    }
+    
+    NSString *key = [self variantKeyForRequest:request];
+    AFCachedHTTPResponse *cachedResponse = nil;
+    NSUInteger removalCount = 0;
+    BOOL readsDisk = NO;
+    
+    @synchronized(self) {
+        cachedResponse = [[self.memoryCachedResponses objectForKey:key] retain];
+        if (cachedResponse) {
+            [self.leastRecentlyUsedKeys removeObject:key];
+            [self.leastRecentlyUsedKeys addObject:key];
+        } else {
+            readsDisk = self.diskCapacity > 0 && ![self hasPendingDiskRemovalForKey:key];
+            removalCount = _removalCount;
+        }
+    }
+    
+    if (readsDisk) {
+        NSString *path = [self diskPathForKey:key];
+        @try {
+            cachedResponse = [[NSKeyedUnarchiver unarchiveObjectWithFile:path] retain];
+        } @catch (NSException *exception) {
+            dispatch_async(_queue, ^{
+                [self removeDiskCachedResponseForKey:key];
+            });
+        }
+        
+        if (cachedResponse) {
+            dispatch_async(_queue, ^{
+                NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+                [fileManager setAttributes:[NSDictionary dictionaryWithObject:[NSDate date] forKey:NSFileModificationDate] ofItemAtPath:path error:nil];
+            });
+            
+            @synchronized(self) {
+                // A response removed, or stored anew, while it was being read from disk is not brought back into memory
+                if (_removalCount == removalCount && ![self.memoryCachedResponses objectForKey:key]) {
+                    [self setMemoryCachedResponse:cachedResponse forKey:key];
+                }
+            }
+        }
+    }
+    
+    if (cachedResponse && ![cachedResponse matchesRequest:request]) {
+        [cachedResponse release];
+        cachedResponse = nil;
+    }
+    
+    @synchronized(self) {
+        if (cachedResponse && [cachedResponse isFreshForRequest:request]) {
+            _hitCount++;
+        } else if (cachedResponse && [cachedResponse canBeRevalidated]) {
+            _revalidationCount++;
+        } else {
+            [cachedResponse release];
+            cachedResponse = nil;
+            _missCount++;
+        }
+    }
+    
+    return [cachedResponse autorelease];
+}
+
+- (void)storeResponse:(NSHTTPURLResponse *)response 
+                 data:(NSData *)data 
+           forRequest:(NSURLRequest *)request
+{
+    if (!response || !data || [response statusCode] != 200 || ![[request HTTPMethod] isEqualToString:@"GET"]) {
+        return;
+    }
+    
+    NSDictionary *headers = [response allHeaderFields];
+    if ([AFCacheControlDirectivesFromHeaders(headers) valueForKey:@"no-store"] || [AFCacheControlDirectivesFromHeaders([request allHTTPHeaderFields]) valueForKey:@"no-store"]) {
+        return;
+    }
+    
+    NSArray *varyingHeaderFields = AFVaryingHeaderFieldsFromHeaders(headers);
+    if ([varyingHeaderFields containsObject:@"*"]) {
+        return;
+    }
+    
+    NSMutableDictionary *mutableVaryingRequestHeaderFields = [NSMutableDictionary dictionary];
+    for (NSString *headerField in varyingHeaderFields) {
+        [mutableVaryingRequestHeaderFields setValue:([request valueForHTTPHeaderField:headerField] ?: @"") forKey:headerField];
+    }
+    
+    // The stored body has already been decoded, so its headers describe it rather than the body as it was received
+    NSMutableDictionary *mutableHeaders = [NSMutableDictionary dictionaryWithDictionary:headers];
+    for (NSString *headerField in [headers allKeys]) {
+        if ([headerField caseInsensitiveCompare:@"Content-Encoding"] == NSOrderedSame || [headerField caseInsensitiveCompare:@"Content-Length"] == NSOrderedSame) {
+            [mutableHeaders removeObjectForKey:headerField];
+        }
+    }
+    [mutableHeaders setValue:[NSString stringWithFormat:@"%lu", (unsigned long)[data length]] forKey:@"Content-Length"];
+    
+    AFCachedHTTPResponse *cachedResponse = [[[AFCachedHTTPResponse alloc] init] autorelease];
+    cachedResponse.URL = [response URL] ?: [request URL];
+    cachedResponse.statusCode = [response statusCode];
+    cachedResponse.allHeaderFields = mutableHeaders;
+    cachedResponse.varyingRequestHeaderFields = mutableVaryingRequestHeaderFields;
+    cachedResponse.data = [[data copy] autorelease];
+    cachedResponse.storedDate = [NSDate date];
+    
+    if ([cachedResponse freshnessLifetime] <= 0.0 && ![cachedResponse canBeRevalidated]) {
+        return;
+    }
+    
+    NSString *key = AFHTTPResponseCacheKeyForRequest(request);
+    NSString *variantKey = AFHTTPResponseCacheVariantKeyForRequest(request, varyingHeaderFields);
+    dispatch_async(_queue, ^{
+        // A segmented body is made contiguous here rather than on the network request thread, so that memory and disk each hold a single copy of it
+        if ([cachedResponse.data isKindOfClass:[AFSegmentedData class]]) {
+            cachedResponse.data = [NSData dataWithData:cachedResponse.data];
+        }
+        
+        [self setVaryingHeaderFields:varyingHeaderFields forKey:key];
+        
+        // A response whose removal was requested after it was stored is removed from disk by a block that follows this one, and is kept out of memory until then
+        @synchronized(self) {
+            if (![self hasPendingDiskRemovalForKey:variantKey]) {
+                [self setMemoryCachedResponse:cachedResponse forKey:variantKey];
+            }
+        }
+        [self setDiskCachedResponse:cachedResponse forKey:variantKey];
+    });
+}
+
+- (AFCachedHTTPResponse *)cachedResponseByRevalidatingCachedResponse:(AFCachedHTTPResponse *)cachedResponse 
+                                                withNotModifiedResponse:(NSHTTPURLResponse *)response 
+                                                             forRequest:(NSURLRequest *)request
+{
+    NSMutableDictionary *mutableHeaders = [NSMutableDictionary dictionaryWithDictionary:cachedResponse.allHeaderFields];
+    [[response allHeaderFields] enumerateKeysAndObjectsUsingBlock:^(id field, id value, __unused BOOL *stop) {
+        if ([field caseInsensitiveCompare:@"Content-Length"] == NSOrderedSame || [field caseInsensitiveCompare:@"Content-Encoding"] == NSOrderedSame) {
+            return;
+        }
+        
+        for (NSString *existingField in [mutableHeaders allKeys]) {
+            if ([existingField caseInsensitiveCompare:field] == NSOrderedSame) {
+                [mutableHeaders removeObjectForKey:existingField];
+            }
+        }
+        [mutableHeaders setValue:value forKey:field];
+    }];
+    
+    AFCachedHTTPResponse *revalidatedResponse = [[[AFCachedHTTPResponse alloc] init] autorelease];
+    revalidatedResponse.URL = cachedResponse.URL;
+    revalidatedResponse.statusCode = cachedResponse.statusCode;
+    revalidatedResponse.allHeaderFields = mutableHeaders;
+    revalidatedResponse.varyingRequestHeaderFields = cachedResponse.varyingRequestHeaderFields;
+    revalidatedResponse.data = cachedResponse.data;
+    revalidatedResponse.storedDate = [NSDate date];
+    
+    NSArray *varyingHeaderFields = [[cachedResponse.varyingRequestHeaderFields allKeys] sortedArrayUsingSelector:@selector(compare:)];
+    NSString *key = AFHTTPResponseCacheVariantKeyForRequest(request, varyingHeaderFields);
+    @synchronized(self) {
+        _notModifiedCount++;
+    }
+    
+    dispatch_async(_queue, ^{
+        @synchronized(self) {
+            if (![self hasPendingDiskRemovalForKey:key]) {
+                [self setMemoryCachedResponse:revalidatedResponse forKey:key];
+            }
+        }
+        [self setDiskCachedResponse:revalidatedResponse forKey:key];
+    });
+    
+    return revalidatedResponse;
+}
+
+- (void)removeCachedResponseForRequest:(NSURLRequest *)request {
+    NSString *key = [self variantKeyForRequest:request];
+    @synchronized(self) {
+        _removalCount++;
+        [self.pendingDiskRemovalKeys addObject:key];
+        [self removeMemoryCachedResponseForKey:key];
+    }
+    
+    dispatch_async(_queue, ^{
+        [self removeDiskCachedResponseForKey:key];
+        
+        @synchronized(self) {
+            [self.pendingDiskRemovalKeys removeObject:key];
+        }
+    });
+}
+
+- (void)removeAllCachedResponses {
+    @synchronized(self) {
+        _removalCount++;
+        _pendingDiskRemovalOfAllResponsesCount++;
+        [self.memoryCachedResponses removeAllObjects];
+        [self.leastRecentlyUsedKeys removeAllObjects];
+        [self.varyingHeaderFieldsByKey removeAllObjects];
+        self.currentMemoryUsage = 0;
+    }
+    
+    dispatch_async(_queue, ^{
+        NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+        for (NSString *filename in [fileManager contentsOfDirectoryAtPath:self.diskPath error:nil]) {
+            [fileManager removeItemAtPath:[self.diskPath stringByAppendingPathComponent:filename] error:nil];
+        }
+        self.currentDiskUsage = 0;
+        
+        @synchronized(self) {
+            _pendingDiskRemovalOfAllResponsesCount--;
+        }
+    });
+}
+
+#pragma mark -
+
+- (NSString *)diskPathForKey:(NSString *)key {
+    return [self.diskPath stringByAppendingPathComponent:AFHTTPResponseCacheFilenameForKey(key)];
+}
+
+- (NSString *)variantKeyForRequest:(NSURLRequest *)request {
+    NSString *key = AFHTTPResponseCacheKeyForRequest(request);
+    NSArray *varyingHeaderFields = nil;
+    NSUInteger removalCount = 0;
+    BOOL hasPendingDiskRemoval = NO;
+    
+    @synchronized(self) {
+        varyingHeaderFields = [[[self.varyingHeaderFieldsByKey objectForKey:key] retain] autorelease];
+        removalCount = _removalCount;
+        hasPendingDiskRemoval = [self hasPendingDiskRemovalForKey:AFHTTPResponseCacheVaryKeyForKey(key)];
+    }
+    
+    // Responses are not read from disk until a pending removal of all of them is done, so which variant is looked up does not matter until then
+    if (!varyingHeaderFields && hasPendingDiskRemoval) {
+        return AFHTTPResponseCacheVariantKeyForRequest(request, [NSArray array]);
+    }
+    
+    if (!varyingHeaderFields) {
+        varyingHeaderFields = [self diskCachedVaryingHeaderFieldsForKey:key];
+        
+        // Remembering that a URL does not vary saves a disk read on each lookup
+        @synchronized(self) {
+            if (_removalCount == removalCount && ![self.varyingHeaderFieldsByKey objectForKey:key]) {
+                [self setMemoryVaryingHeaderFields:varyingHeaderFields forKey:key];
+            }
+        }
+    }
+    
+    return AFHTTPResponseCacheVariantKeyForRequest(request, varyingHeaderFields);
+}
+
+- (BOOL)hasPendingDiskRemovalForKey:(NSString *)key {
+    return _pendingDiskRemovalOfAllResponsesCount > 0 || [self.pendingDiskRemovalKeys containsObject:key];
+}
+
+- (NSArray *)diskCachedVaryingHeaderFieldsForKey:(NSString *)key {
+    NSArray *varyingHeaderFields = nil;
+    if (self.diskCapacity > 0) {
+        @try {
+            varyingHeaderFields = [NSKeyedUnarchiver unarchiveObjectWithFile:[self diskPathForKey:AFHTTPResponseCacheVaryKeyForKey(key)]];
+        } @catch (NSException *exception) {
+            varyingHeaderFields = nil;
+        }
+    }
+    
+    if (![varyingHeaderFields isKindOfClass:[NSArray class]]) {
+        varyingHeaderFields = [NSArray array];
+    }
+    
+    return varyingHeaderFields;
+}
+
+- (void)setMemoryVaryingHeaderFields:(NSArray *)varyingHeaderFields forKey:(NSString *)key {
+    // The index is only a cache of what is on disk, so it can be cleared when it grows large
+    if ([self.varyingHeaderFieldsByKey count] >= kAFHTTPResponseCacheMaximumVaryIndexCount) {
+        [self.varyingHeaderFieldsByKey removeAllObjects];
+    }
+    [self.varyingHeaderFieldsByKey setObject:varyingHeaderFields forKey:key];
+}
+
+- (void)setVaryingHeaderFields:(NSArray *)varyingHeaderFields forKey:(NSString *)key {
+    NSArray *currentVaryingHeaderFields = nil;
+    @synchronized(self) {
+        currentVaryingHeaderFields = [[[self.varyingHeaderFieldsByKey objectForKey:key] retain] autorelease];
+        [self setMemoryVaryingHeaderFields:varyingHeaderFields forKey:key];
+    }
+    
+    if ([varyingHeaderFields isEqualToArray:(currentVaryingHeaderFields ?: [self diskCachedVaryingHeaderFieldsForKey:key])]) {
+        return;
+    }
+    
+    NSString *varyKey = AFHTTPResponseCacheVaryKeyForKey(key);
+    [self removeDiskCachedDataForKey:varyKey];
+    if ([varyingHeaderFields count] > 0 && self.diskCapacity > 0) {
+        NSData *archivedData = [NSKeyedArchiver archivedDataWithRootObject:varyingHeaderFields];
+        if ([archivedData writeToFile:[self diskPathForKey:varyKey] atomically:YES]) {
+            self.currentDiskUsage += [archivedData length];
+        }
+    }
+}
+
+// The memory cache is changed with `@synchronized(self)` held
+- (void)setMemoryCachedResponse:(AFCachedHTTPResponse *)cachedResponse forKey:(NSString *)key {
+    NSUInteger cost = [cachedResponse.data length] + kAFHTTPResponseCacheEntryOverhead;
+    if (cost > self.memoryCapacity) {
+        [self removeMemoryCachedResponseForKey:key];
+        return;
+    }
+    
+    [self removeMemoryCachedResponseForKey:key];
+    [self.memoryCachedResponses setObject:cachedResponse forKey:key];
+    [self.leastRecentlyUsedKeys addObject:key];
+    self.currentMemoryUsage += cost;
+    
+    while (self.currentMemoryUsage > self.memoryCapacity && [self.leastRecentlyUsedKeys count] > 0) {
+        [self removeMemoryCachedResponseForKey:[self.leastRecentlyUsedKeys objectAtIndex:0]];
+    }
+}
+
+- (void)removeMemoryCachedResponseForKey:(NSString *)key {
+    AFCachedHTTPResponse *cachedResponse = [self.memoryCachedResponses objectForKey:key];
+    if (!cachedResponse) {
+        return;
+    }
+    
+    self.currentMemoryUsage -= MIN([cachedResponse.data length] + kAFHTTPResponseCacheEntryOverhead, self.currentMemoryUsage);
+    [self.leastRecentlyUsedKeys removeObject:key];
+    [self.memoryCachedResponses removeObjectForKey:key];
+}
+
+- (void)setDiskCachedResponse:(AFCachedHTTPResponse *)cachedResponse forKey:(NSString *)key {
+    if (self.diskCapacity == 0) {
+        return;
+    }
+    
+    NSData *archivedData = [NSKeyedArchiver archivedDataWithRootObject:cachedResponse];
+    if ([archivedData length] > self.diskCapacity) {
+        [self removeDiskCachedResponseForKey:key];
+        return;
+    }
+    
+    [self removeDiskCachedResponseForKey:key];
+    if ([archivedData writeToFile:[self diskPathForKey:key] atomically:YES]) {
+        self.currentDiskUsage += [archivedData length];
+    }
+    
+    [self trimDiskToCapacity];
+}
+
+- (void)removeDiskCachedResponseForKey:(NSString *)key {
+    [self removeDiskCachedDataForKey:key];
+}
+
+- (void)removeDiskCachedDataForKey:(NSString *)key {
+    NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+    NSString *path = [self diskPathForKey:key];
+    NSDictionary *attributes = [fileManager attributesOfItemAtPath:path error:nil];
+    if (attributes && [fileManager removeItemAtPath:path error:nil]) {
+        self.currentDiskUsage -= MIN((NSUInteger)[attributes fileSize], self.currentDiskUsage);
+    }
+}
+
+- (void)trimDiskToCapacity {
+    if (self.currentDiskUsage <= self.diskCapacity) {
+        return;
+    }
+    
+    NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+    NSMutableArray *mutableFiles = [NSMutableArray array];
+    for (NSString *filename in [fileManager contentsOfDirectoryAtPath:self.diskPath error:nil]) {
+        NSString *path = [self.diskPath stringByAppendingPathComponent:filename];
+        NSDictionary *attributes = [fileManager attributesOfItemAtPath:path error:nil];
+        if (attributes) {
+            [mutableFiles addObject:[NSDictionary dictionaryWithObjectsAndKeys:path, @"path", [attributes fileModificationDate], @"date", [NSNumber numberWithUnsignedLongLong:[attributes fileSize]], @"size", nil]];
+        }
+    }
+    
+    // Least recently read or written files have the oldest modification dates
+    [mutableFiles sortUsingDescriptors:[NSArray arrayWithObject:[NSSortDescriptor sortDescriptorWithKey:@"date" ascending:YES]]];
+    
+    for (NSDictionary *file in mutableFiles) {
+        if (self.currentDiskUsage <= self.diskCapacity) {
+            break;
+        }
+        
+        if ([fileManager removeItemAtPath:[file valueForKey:@"path"] error:nil]) {
+            self.currentDiskUsage -= MIN([[file valueForKey:@"size"] unsignedIntegerValue], self.currentDiskUsage);
+        }
+    }
+}
+
+@end
@@ -0,0 +1,132 @@
+// AFHTTPRetryPolicy.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ `AFHTTPRetryPolicy` decides whether a failed request should be sent again, and how long to wait before doing so.
+ 
+ By default, only requests with idempotent methods are retried, and only after errors that are likely to be transient: timeouts, lost or refused connections, failed host lookups, and `408`, `429`, `502`, `503`, and `504` responses. The delay before each retry is drawn uniformly between zero and an exponentially growing ceiling ("full jitter"), so that clients that failed together do not retry together. A `Retry-After` header on the response takes precedence over the computed delay.
+ 
+ Retries are also limited by a token bucket shared by every request made with the policy. Each original request deposits `retryBudgetRatio` tokens, up to `retryBudgetCapacity`, and each retry withdraws one. Once the bucket is empty, failures are reported rather than retried, so that retries never add more than that fraction of traffic to a server that is already failing.
+ 
+ @discussion `AFHTTPRetryPolicy` is thread-safe.
+ */
+@interface AFHTTPRetryPolicy : NSObject {
+@private
+    NSUInteger _maximumRetryCount;
+    NSTimeInterval _baseDelay;
+    NSTimeInterval _maximumDelay;
+    NSSet *_retriableHTTPMethods;
+    NSIndexSet *_retriableStatusCodes;
+    double _retryBudgetRatio;
+    double _retryBudgetCapacity;
+    double _retryBudget;
+    NSUInteger _retryCount;
+    NSUInteger _exhaustedRetryBudgetCount;
+}
+
+///-------------------------------
+/// @name Configuring Retries
+///-------------------------------
+
+/**
+ The maximum number of times a request is retried after its first attempt. This is 2 by default.
+ */
+@property (nonatomic, assign) NSUInteger maximumRetryCount;
+
+/**
+ The ceiling of the delay before the first retry, which doubles with each subsequent retry. This is 0.5 seconds by default.
+ */
+@property (nonatomic, assign) NSTimeInterval baseDelay;
+
+/**
+ The largest delay before a retry. Requests whose response asks for a longer wait with `Retry-After` are not retried. This is 30 seconds by default.
+ */
+@property (nonatomic, assign) NSTimeInterval maximumDelay;
+
+/**
+ The HTTP methods of requests that may be retried. This is `GET`, `HEAD`, `PUT`, `DELETE`, `OPTIONS`, and `TRACE` by default.
+ */
+@property (nonatomic, copy) NSSet *retriableHTTPMethods;
+
+/**
+ The status codes of responses after which a request may be retried. This is `408`, `429`, `502`, `503`, and `504` by default.
+ */
+@property (nonatomic, copy) NSIndexSet *retriableStatusCodes;
+
+/**
+ The number of retry tokens deposited by each original request. This is `0.1` by default, which allows retries to add at most 10% to traffic once the initial budget has been spent.
+ */
+@property (nonatomic, assign) double retryBudgetRatio;
+
+/**
+ The maximum number of retry tokens that can be saved up, and the number the budget starts with. This is `10` by default.
+ */
+@property (nonatomic, assign) double retryBudgetCapacity;
+
+///-------------------------------
+/// @name Getting Retry Statistics
+///-------------------------------
+
+/**
+ The number of retry tokens currently available.
+ */
+@property (readonly, nonatomic, assign) double retryBudget;
+
+/**
+ The number of retries that have been allowed.
+ */
+@property (readonly, nonatomic, assign) NSUInteger retryCount;
+
+/**
+ The number of failures that would have been retried, but were not because the retry budget was empty.
+ */
+@property (readonly, nonatomic, assign) NSUInteger exhaustedRetryBudgetCount;
+
+///-------------------------------
+/// @name Deciding Whether to Retry
+///-------------------------------
+
+/**
+ Records that an original request, as opposed to a retry, is being sent, which deposits `retryBudgetRatio` tokens into the retry budget.
+ */
+- (void)recordRequest;
+
+/**
+ Returns whether a failed request should be retried, and if so, withdraws a token from the retry budget and computes the delay before the retry.
+ 
+ @param request The request that failed.
+ @param response The response to the request, if one was received.
+ @param error The error with which the request failed.
+ @param retryCount The number of times the request has already been retried.
+ @param delay On return, if the request should be retried, the time to wait before retrying it.
+ 
+ @return `YES` if the request should be retried, otherwise `NO`.
+ */
+- (BOOL)shouldRetryRequest:(NSURLRequest *)request 
+                  response:(NSHTTPURLResponse *)response 
+                     error:(NSError *)error 
+                retryCount:(NSUInteger)retryCount 
+                     delay:(NSTimeInterval *)delay;
+
+@end
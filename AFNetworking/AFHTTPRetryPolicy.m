@@ -0,0 +1,164 @@
+// AFHTTPRetryPolicy.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPRetryPolicy.h"
+#import "AFHTTPResponseCache.h"
+
+static NSUInteger const kAFHTTPRetryPolicyDefaultMaximumRetryCount = 2;
+static NSTimeInterval const kAFHTTPRetryPolicyDefaultBaseDelay = 0.5;
+static NSTimeInterval const kAFHTTPRetryPolicyDefaultMaximumDelay = 30.0;
+static double const kAFHTTPRetryPolicyDefaultRetryBudgetRatio = 0.1;
+static double const kAFHTTPRetryPolicyDefaultRetryBudgetCapacity = 10.0;
+
+static BOOL AFErrorIsTransient(NSError *error) {
+    if (![[error domain] isEqualToString:NSURLErrorDomain]) {
+        return NO;
+    }
+    
+    switch ([error code]) {
+        case NSURLErrorTimedOut:
+        case NSURLErrorCannotFindHost:
+        case NSURLErrorCannotConnectToHost:
+        case NSURLErrorNetworkConnectionLost:
+        case NSURLErrorDNSLookupFailed:
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+// `Retry-After` is either a number of seconds or an HTTP-date; see http://www.w3.org/Protocols/rfc2616/rfc2616-sec14.html#sec14.37
+static NSTimeInterval AFRetryAfterIntervalFromResponse(NSHTTPURLResponse *response) {
+    NSString *retryAfter = [AFHTTPHeaderValueForKey([response allHeaderFields], @"Retry-After") stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    if ([retryAfter length] == 0) {
+        return -1.0;
+    }
+    
+    NSScanner *scanner = [NSScanner scannerWithString:retryAfter];
+    NSInteger seconds = 0;
+    if ([scanner scanInteger:&seconds] && [scanner isAtEnd]) {
+        return MAX(seconds, 0);
+    }
+    
+    NSDate *date = AFDateFromHTTPDateString(retryAfter);
+    if (date) {
+        return MAX([date timeIntervalSinceNow], 0.0);
+    }
+    
+    return -1.0;
+}
+
+@interface AFHTTPRetryPolicy ()
+@property (readwrite, nonatomic, assign) double retryBudget;
+@property (readwrite, nonatomic, assign) NSUInteger retryCount;
+@property (readwrite, nonatomic, assign) NSUInteger exhaustedRetryBudgetCount;
+@end
+
+@implementation AFHTTPRetryPolicy
+@synthesize maximumRetryCount = _maximumRetryCount;
+@synthesize baseDelay = _baseDelay;
+@synthesize maximumDelay = _maximumDelay;
+@synthesize retriableHTTPMethods = _retriableHTTPMethods;
+@synthesize retriableStatusCodes = _retriableStatusCodes;
+@synthesize retryBudgetRatio = _retryBudgetRatio;
+@synthesize retryBudgetCapacity = _retryBudgetCapacity;
+@synthesize retryBudget = _retryBudget;
+@synthesize retryCount = _retryCount;
+@synthesize exhaustedRetryBudgetCount = _exhaustedRetryBudgetCount;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.maximumRetryCount = kAFHTTPRetryPolicyDefaultMaximumRetryCount;
+    self.baseDelay = kAFHTTPRetryPolicyDefaultBaseDelay;
+    self.maximumDelay = kAFHTTPRetryPolicyDefaultMaximumDelay;
+    self.retriableHTTPMethods = [NSSet setWithObjects:@"GET", @"HEAD", @"PUT", @"DELETE", @"OPTIONS", @"TRACE", nil];
+    
+    NSMutableIndexSet *mutableStatusCodes = [NSMutableIndexSet indexSet];
+    [mutableStatusCodes addIndex:408];
+    [mutableStatusCodes addIndex:429];
+    [mutableStatusCodes addIndexesInRange:NSMakeRange(502, 3)];
+    self.retriableStatusCodes = mutableStatusCodes;
+    
+    self.retryBudgetRatio = kAFHTTPRetryPolicyDefaultRetryBudgetRatio;
+    self.retryBudgetCapacity = kAFHTTPRetryPolicyDefaultRetryBudgetCapacity;
+    self.retryBudget = self.retryBudgetCapacity;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_retriableHTTPMethods release];
+    [_retriableStatusCodes release];
+    [super dealloc];
+}
+
+- (void)recordRequest {
+    @synchronized(self) {
+        self.retryBudget = MIN(self.retryBudget + self.retryBudgetRatio, self.retryBudgetCapacity);
+    }
+}
+
+- (BOOL)shouldRetryRequest:(NSURLRequest *)request 
+                  response:(NSHTTPURLResponse *)response 
+                     error:(NSError *)error 
+                retryCount:(NSUInteger)retryCount 
+                     delay:(NSTimeInterval *)delay
+{
+    if (retryCount >= self.maximumRetryCount || ![self.retriableHTTPMethods containsObject:[[request HTTPMethod] uppercaseString] ?: @"GET"]) {
+        return NO;
+    }
+    
+    BOOL hasRetriableStatusCode = response && [self.retriableStatusCodes containsIndex:(NSUInteger)[response statusCode]];
+    if (!hasRetriableStatusCode && !AFErrorIsTransient(error)) {
+        return NO;
+    }
+    
+    NSTimeInterval retryDelay = AFRetryAfterIntervalFromResponse(response);
+    if (retryDelay > self.maximumDelay) {
+        return NO;
+    } else if (retryDelay < 0.0) {
+        NSTimeInterval ceiling = MIN(self.baseDelay * pow(2.0, retryCount), self.maximumDelay);
+        retryDelay = ceiling * ((double)arc4random() / UINT32_MAX);
+    }
+    
+    @synchronized(self) {
+        if (self.retryBudget < 1.0) {
+            self.exhaustedRetryBudgetCount++;
+            return NO;
+        }
+        
+        self.retryBudget -= 1.0;
+        self.retryCount++;
+    }
+    
+    if (delay) {
+        *delay = retryDelay;
+    }
+    
+    return YES;
+}
+
+@end
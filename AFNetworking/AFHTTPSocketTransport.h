@@ -0,0 +1,87 @@
+// AFHTTPSocketTransport.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+#import "AFHTTPTransport.h"
+
+/**
+ `AFHTTPSocketTransport` loads requests over HTTP/1.1 on its own non-blocking sockets, driven by the run loops of the network request threads, rather than through `NSURLConnection`. It keeps idle connections to each host alive, and reuses them for later requests.
+ 
+ Responses are parsed incrementally as they are read: headers are parsed as soon as they are complete, and bodies framed by `Content-Length`, by chunked transfer coding, or by the connection closing are delivered as they arrive. A request whose reused connection turns out to have been closed by the server before any response was read is sent again on a new connection, if its method is idempotent.
+ 
+ @discussion The transport does not decode content codings, and delivers response bodies as they were received, for the operation to decode; requests without an `Accept-Encoding` header are sent with `Accept-Encoding: identity`. Redirects are delivered as responses rather than followed. Cookies are sent and stored if the request handles cookies. Requests with an `HTTPBodyStream`, and URLs other than `http` and `https`, are loaded with the shared `AFURLConnectionTransport` instead.
+ */
+@interface AFHTTPSocketTransport : NSObject <AFHTTPTransport> {
+@private
+    NSMutableDictionary *_idleSocketsByKey;
+    NSUInteger _maximumIdleConnectionsPerHost;
+    NSTimeInterval _idleConnectionTimeout;
+    NSUInteger _readBufferLength;
+    NSUInteger _openedConnectionCount;
+    NSUInteger _reusedConnectionCount;
+}
+
+/**
+ The maximum number of idle connections kept alive for each host. This is 6 by default.
+ */
+@property (nonatomic, assign) NSUInteger maximumIdleConnectionsPerHost;
+
+/**
+ The time after which an idle connection is closed rather than reused. This is 30 seconds by default.
+ */
+@property (nonatomic, assign) NSTimeInterval idleConnectionTimeout;
+
+/**
+ The maximum number of bytes read from a socket at once. This is 32 KB by default.
+ */
+@property (nonatomic, assign) NSUInteger readBufferLength;
+
+/**
+ The number of connections the transport has opened.
+ */
+@property (readonly, nonatomic, assign) NSUInteger openedConnectionCount;
+
+/**
+ The number of requests that were sent on a kept-alive connection rather than a new one.
+ */
+@property (readonly, nonatomic, assign) NSUInteger reusedConnectionCount;
+
+/**
+ Returns the shared socket transport.
+ */
++ (AFHTTPSocketTransport *)sharedTransport;
+
+/**
+ Opens a connection to the host of the specified URL, and keeps it alive for a later request once it has been established, unless there is already an idle connection to the host.
+ 
+ @param url The URL whose host is to be connected to.
+ 
+ @discussion The connection is established on the main run loop, and for `https` URLs includes the TLS handshake. It is subject to `idleConnectionTimeout` like any other idle connection, and is counted in `openedConnectionCount`.
+ */
+- (void)prewarmConnectionToURL:(NSURL *)url;
+
+/**
+ Closes all idle connections.
+ */
+- (void)closeIdleConnections;
+
+@end
@@ -0,0 +1,1082 @@
+// AFHTTPSocketTransport.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPSocketTransport.h"
+#import "AFHTTPResponseCache.h"
+
+#include <libkern/OSAtomic.h>
+
+static NSUInteger const kAFHTTPSocketTransportDefaultMaximumIdleConnectionsPerHost = 6;
+static NSTimeInterval const kAFHTTPSocketTransportDefaultIdleConnectionTimeout = 30.0;
+static NSUInteger const kAFHTTPSocketTransportDefaultReadBufferLength = 32 * 1024;
+static NSUInteger const kAFHTTPSocketTransportMaximumHeaderLength = 64 * 1024;
+
+typedef enum {
+    AFHTTPResponseParserStatusLineState,
+    AFHTTPResponseParserHeadersState,
+    AFHTTPResponseParserBodyState,
+    AFHTTPResponseParserBodyUntilCloseState,
+    AFHTTPResponseParserChunkSizeState,
+    AFHTTPResponseParserChunkDataState,
+    AFHTTPResponseParserChunkDataEndState,
+    AFHTTPResponseParserChunkTrailerState,
+    AFHTTPResponseParserDoneState,
+} AFHTTPResponseParserState;
+
+static NSUInteger AFIndexOfCRLF(NSData *data) {
+    const uint8_t *bytes = [data bytes];
+    NSUInteger length = [data length];
+    for (NSUInteger idx = 0; idx + 1 < length; idx++) {
+        if (bytes[idx] == '\r' && bytes[idx + 1] == '\n') {
+            return idx;
+        }
+    }
+    
+    return NSNotFound;
+}
+
+// Parses a chunk size line, which is one or more hex digits, optionally followed by whitespace and chunk extensions after a semicolon
+static BOOL AFParseChunkSizeLine(const char *line, NSUInteger length, unsigned long long *chunkLength) {
+    unsigned long long value = 0;
+    NSUInteger idx = 0;
+    for (; idx < length; idx++) {
+        char c = line[idx];
+        unsigned int digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            break;
+        }
+        
+        if (value > (ULLONG_MAX >> 4)) {
+            return NO;
+        }
+        
+        value = (value << 4) | digit;
+    }
+    
+    if (idx == 0) {
+        return NO;
+    }
+    
+    while (idx < length && (line[idx] == ' ' || line[idx] == '\t')) {
+        idx++;
+    }
+    
+    if (idx < length && line[idx] != ';') {
+        return NO;
+    }
+    
+    *chunkLength = value;
+    
+    return YES;
+}
+
+static inline BOOL AFHTTPMethodIsIdempotent(NSString *method) {
+    static NSSet *_idempotentMethods = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _idempotentMethods = [[NSSet alloc] initWithObjects:@"GET", @"HEAD", @"PUT", @"DELETE", @"OPTIONS", @"TRACE", nil];
+    });
+    
+    return [_idempotentMethods containsObject:[method uppercaseString] ?: @"GET"];
+}
+
+static NSString * AFSocketKeyForURL(NSURL *url) {
+    NSString *scheme = [[url scheme] lowercaseString];
+    NSInteger port = [url port] ? [[url port] integerValue] : ([scheme isEqualToString:@"https"] ? 443 : 80);
+    
+    return [NSString stringWithFormat:@"%@://%@:%ld", scheme, [[url host] lowercaseString], (long)port];
+}
+
+// IPv6 literals are bracketed, as they are in URLs, so that their colons are not read as the port separator
+static NSString * AFHTTPHostHeaderValueForURL(NSURL *url) {
+    NSString *host = [url host];
+    if ([host rangeOfString:@":"].location != NSNotFound && ![host hasPrefix:@"["]) {
+        host = [NSString stringWithFormat:@"[%@]", host];
+    }
+    
+    return [url port] ? [NSString stringWithFormat:@"%@:%@", host, [url port]] : host;
+}
+
+static NSData * AFHTTPMessageDataForRequest(NSURLRequest *request, NSUInteger *bodyLength) {
+    NSURL *url = [request URL];
+    NSString *method = [request HTTPMethod] ?: @"GET";
+    
+    // Unlike `-[NSURL path]`, `CFURLCopyPath` keeps percent escapes intact
+    NSString *requestTarget = [(NSString *)CFURLCopyPath((CFURLRef)url) autorelease];
+    if ([requestTarget length] == 0) {
+        requestTarget = @"/";
+    }
+    if ([url query]) {
+        requestTarget = [requestTarget stringByAppendingFormat:@"?%@", [url query]];
+    }
+    
+    NSMutableString *mutableHead = [NSMutableString stringWithFormat:@"%@ %@ HTTP/1.1\r\n", method, requestTarget];
+    [mutableHead appendFormat:@"Host: %@\r\n", AFHTTPHostHeaderValueForURL(url)];
+    
+    NSMutableDictionary *mutableHeaderFields = [NSMutableDictionary dictionaryWithDictionary:[request allHTTPHeaderFields]];
+    if ([request HTTPShouldHandleCookies]) {
+        NSArray *cookies = [[NSHTTPCookieStorage sharedHTTPCookieStorage] cookiesForURL:url];
+        [mutableHeaderFields addEntriesFromDictionary:[NSHTTPCookie requestHeaderFieldsWithCookies:cookies]];
+    }
+    
+    for (NSString *field in mutableHeaderFields) {
+        NSString *lowercaseField = [field lowercaseString];
+        if ([lowercaseField isEqualToString:@"host"] || [lowercaseField isEqualToString:@"content-length"] || [lowercaseField isEqualToString:@"connection"]) {
+            continue;
+        }
+        
+        [mutableHead appendFormat:@"%@: %@\r\n", field, [mutableHeaderFields objectForKey:field]];
+    }
+    
+    // Encoded bodies are delivered as they were received, for the operation to decode
+    if (![request valueForHTTPHeaderField:@"Accept-Encoding"]) {
+        [mutableHead appendString:@"Accept-Encoding: identity\r\n"];
+    }
+    
+    NSData *body = [request HTTPBody];
+    if (body || [method isEqualToString:@"POST"] || [method isEqualToString:@"PUT"]) {
+        [mutableHead appendFormat:@"Content-Length: %lu\r\n", (unsigned long)[body length]];
+    }
+    
+    [mutableHead appendString:@"\r\n"];
+    
+    NSMutableData *mutableData = [NSMutableData dataWithData:[mutableHead dataUsingEncoding:NSUTF8StringEncoding]];
+    if (body) {
+        [mutableData appendData:body];
+    }
+    
+    if (bodyLength) {
+        *bodyLength = [body length];
+    }
+    
+    return mutableData;
+}
+
+#pragma mark -
+
+@interface AFHTTPSocket : NSObject {
+@private
+    NSString *_key;
+    NSInputStream *_inputStream;
+    NSOutputStream *_outputStream;
+    CFAbsoluteTime _idleTime;
+    BOOL _opened;
+    BOOL _reused;
+}
+
+@property (readonly, nonatomic, copy) NSString *key;
+@property (readonly, nonatomic, retain) NSInputStream *inputStream;
+@property (readonly, nonatomic, retain) NSOutputStream *outputStream;
+@property (readwrite, nonatomic, assign) CFAbsoluteTime idleTime;
+@property (readwrite, nonatomic, assign, getter = isReused) BOOL reused;
+
+- (id)initWithURL:(NSURL *)url 
+              key:(NSString *)key;
+- (void)open;
+- (BOOL)isReusable;
+- (void)close;
+@end
+
+@implementation AFHTTPSocket
+@synthesize key = _key;
+@synthesize inputStream = _inputStream;
+@synthesize outputStream = _outputStream;
+@synthesize idleTime = _idleTime;
+@synthesize reused = _reused;
+
+- (id)initWithURL:(NSURL *)url 
+              key:(NSString *)key
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _key = [key copy];
+    
+    BOOL secure = [[[url scheme] lowercaseString] isEqualToString:@"https"];
+    UInt32 port = [url port] ? [[url port] unsignedIntValue] : (secure ? 443 : 80);
+    
+    CFReadStreamRef readStream = NULL;
+    CFWriteStreamRef writeStream = NULL;
+    CFStreamCreatePairWithSocketToHost(kCFAllocatorDefault, (CFStringRef)[url host], port, &readStream, &writeStream);
+    _inputStream = (NSInputStream *)readStream;
+    _outputStream = (NSOutputStream *)writeStream;
+    
+    if (secure) {
+        [_inputStream setProperty:NSStreamSocketSecurityLevelNegotiatedSSL forKey:NSStreamSocketSecurityLevelKey];
+        [_outputStream setProperty:NSStreamSocketSecurityLevelNegotiatedSSL forKey:NSStreamSocketSecurityLevelKey];
+    }
+    
+    return self;
+}
+
+- (void)dealloc {
+    [self close];
+    [_key release];
+    [_inputStream release];
+    [_outputStream release];
+    [super dealloc];
+}
+
+- (void)open {
+    if (_opened) {
+        return;
+    }
+    
+    _opened = YES;
+    [self.inputStream open];
+    [self.outputStream open];
+}
+
+// A server that closed an idle connection leaves it readable, with the end of the stream or unsolicited bytes waiting
+- (BOOL)isReusable {
+    return [self.inputStream streamStatus] == NSStreamStatusOpen && [self.outputStream streamStatus] == NSStreamStatusOpen && ![self.inputStream hasBytesAvailable];
+}
+
+- (void)close {
+    [self.inputStream setDelegate:nil];
+    [self.outputStream setDelegate:nil];
+    [self.inputStream close];
+    [self.outputStream close];
+}
+
+@end
+
+#pragma mark -
+
+@interface AFHTTPSocketTransport ()
+@property (readwrite, nonatomic, retain) NSMutableDictionary *idleSocketsByKey;
+@property (readwrite, nonatomic, assign) NSUInteger openedConnectionCount;
+@property (readwrite, nonatomic, assign) NSUInteger reusedConnectionCount;
+
+- (AFHTTPSocket *)checkOutSocketForURL:(NSURL *)url 
+                         allowingReuse:(BOOL)allowingReuse;
+- (void)checkInSocket:(AFHTTPSocket *)socket;
+@end
+
+#pragma mark -
+
+@interface AFHTTPSocketTransportConnection : NSObject <AFHTTPTransportConnection, NSStreamDelegate> {
+@private
+    AFHTTPSocketTransport *_transport;
+    NSURLRequest *_request;
+    id <AFHTTPTransportConnectionDelegate> _delegate;
+    AFHTTPSocket *_socket;
+    
+    NSRunLoop *_runLoop;
+    NSThread *_runLoopThread;
+    NSMutableSet *_runLoopModes;
+    NSTimer *_timeoutTimer;
+    CFAbsoluteTime _lastActivityTime;
+    
+    NSData *_requestData;
+    NSUInteger _requestDataOffset;
+    NSUInteger _requestBodyLength;
+    
+    uint8_t *_readBuffer;
+    NSMutableData *_buffer;
+    AFHTTPResponseParserState _parserState;
+    NSInteger _statusCode;
+    NSString *_HTTPVersion;
+    NSMutableDictionary *_headerFields;
+    unsigned long long _remainingLength;
+    BOOL _keepAlive;
+    BOOL _receivedResponseBytes;
+    BOOL _resentOnNewSocket;
+    volatile int32_t _cancelled;
+}
+
+@property (readwrite, nonatomic, retain) AFHTTPSocketTransport *transport;
+@property (readwrite, nonatomic, retain) NSURLRequest *request;
+@property (readwrite, nonatomic, retain) id <AFHTTPTransportConnectionDelegate> delegate;
+@property (readwrite, nonatomic, retain) AFHTTPSocket *socket;
+@property (readwrite, nonatomic, retain) NSThread *runLoopThread;
+@property (readwrite, nonatomic, retain) NSMutableSet *runLoopModes;
+@property (readwrite, nonatomic, retain) NSTimer *timeoutTimer;
+@property (readwrite, nonatomic, retain) NSData *requestData;
+@property (readwrite, nonatomic, retain) NSMutableData *buffer;
+@property (readwrite, nonatomic, copy) NSString *HTTPVersion;
+@property (readwrite, nonatomic, retain) NSMutableDictionary *headerFields;
+
+- (id)initWithRequest:(NSURLRequest *)request 
+            transport:(AFHTTPSocketTransport *)transport 
+             delegate:(id <AFHTTPTransportConnectionDelegate>)delegate;
+
+- (BOOL)isCancelled;
+- (void)cancelOnRunLoopThread;
+- (void)attachSocket:(AFHTTPSocket *)socket;
+- (void)detachSocket;
+- (void)writeRequestData;
+- (void)readAvailableBytes;
+- (void)parseBuffer;
+- (BOOL)parseStatusLine:(NSString *)line;
+- (void)parseHeaderLine:(NSString *)line;
+- (void)didParseHeaders;
+- (void)deliverBodyBytesOfLength:(NSUInteger)length;
+- (void)didFinishResponse;
+- (void)didFailWithError:(NSError *)error;
+- (void)didLoseConnectionWithError:(NSError *)error;
+- (void)timeoutTimerDidFire:(NSTimer *)timer;
+@end
+
+@implementation AFHTTPSocketTransportConnection
+@synthesize transport = _transport;
+@synthesize request = _request;
+@synthesize delegate = _delegate;
+@synthesize socket = _socket;
+@synthesize runLoopThread = _runLoopThread;
+@synthesize runLoopModes = _runLoopModes;
+@synthesize timeoutTimer = _timeoutTimer;
+@synthesize requestData = _requestData;
+@synthesize buffer = _buffer;
+@synthesize HTTPVersion = _HTTPVersion;
+@synthesize headerFields = _headerFields;
+
+- (id)initWithRequest:(NSURLRequest *)request 
+            transport:(AFHTTPSocketTransport *)transport 
+             delegate:(id <AFHTTPTransportConnectionDelegate>)delegate
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.request = request;
+    self.transport = transport;
+    self.delegate = delegate;
+    self.runLoopModes = [NSMutableSet set];
+    self.requestData = AFHTTPMessageDataForRequest(request, &_requestBodyLength);
+    self.buffer = [NSMutableData data];
+    
+    _readBuffer = malloc(transport.readBufferLength);
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_socket close];
+    [_socket release];
+    [_timeoutTimer invalidate];
+    [_timeoutTimer release];
+    
+    [_transport release];
+    [_request release];
+    [_delegate release];
+    [_runLoopThread release];
+    [_runLoopModes release];
+    [_requestData release];
+    [_buffer release];
+    [_HTTPVersion release];
+    [_headerFields release];
+    
+    free(_readBuffer);
+    
+    [super dealloc];
+}
+
+- (BOOL)isCancelled {
+    return _cancelled != 0;
+}
+
+#pragma mark - AFHTTPTransportConnection
+
+// Connections are scheduled from the thread of their run loop, which is the only thread that may touch their streams and timer
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop 
+                  forMode:(NSString *)mode
+{
+    _runLoop = runLoop;
+    self.runLoopThread = [NSThread currentThread];
+    [self.runLoopModes addObject:mode];
+    
+    [self.socket.inputStream scheduleInRunLoop:runLoop forMode:mode];
+    [self.socket.outputStream scheduleInRunLoop:runLoop forMode:mode];
+    
+    // Data that arrived while the connection was unscheduled does not signal the stream again
+    if ([self.socket.inputStream hasBytesAvailable]) {
+        [self performSelector:@selector(readAvailableBytes) withObject:nil afterDelay:0.0 inModes:[NSArray arrayWithObject:mode]];
+    }
+}
+
+- (void)unscheduleFromRunLoop:(NSRunLoop *)runLoop 
+                      forMode:(NSString *)mode
+{
+    [self.runLoopModes removeObject:mode];
+    
+    [self.socket.inputStream removeFromRunLoop:runLoop forMode:mode];
+    [self.socket.outputStream removeFromRunLoop:runLoop forMode:mode];
+}
+
+- (void)start {
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    _lastActivityTime = CFAbsoluteTimeGetCurrent();
+    
+    NSTimeInterval timeoutInterval = [self.request timeoutInterval] > 0 ? [self.request timeoutInterval] : 60.0;
+    self.timeoutTimer = [NSTimer timerWithTimeInterval:MAX(timeoutInterval / 4.0, 0.25) target:self selector:@selector(timeoutTimerDidFire:) userInfo:nil repeats:YES];
+    for (NSString *runLoopMode in self.runLoopModes) {
+        [_runLoop addTimer:self.timeoutTimer forMode:runLoopMode];
+    }
+    
+    [self attachSocket:[self.transport checkOutSocketForURL:[self.request URL] allowingReuse:YES]];
+}
+
+// Cancellation may come from any thread, so it is only marked here, and the streams and timer are torn down on the thread of their run loop
+- (void)cancel {
+    if (!OSAtomicCompareAndSwap32Barrier(0, 1, &_cancelled)) {
+        return;
+    }
+    
+    NSThread *runLoopThread = self.runLoopThread;
+    if (!runLoopThread || runLoopThread == [NSThread currentThread]) {
+        [self cancelOnRunLoopThread];
+    } else {
+        [self performSelector:@selector(cancelOnRunLoopThread) onThread:runLoopThread withObject:nil waitUntilDone:NO];
+    }
+}
+
+- (void)cancelOnRunLoopThread {
+    [self.timeoutTimer invalidate];
+    self.timeoutTimer = nil;
+    
+    [self.socket close];
+    [self detachSocket];
+    
+    _parserState = AFHTTPResponseParserDoneState;
+    self.delegate = nil;
+}
+
+#pragma mark -
+
+- (void)attachSocket:(AFHTTPSocket *)socket {
+    self.socket = socket;
+    
+    [socket.inputStream setDelegate:self];
+    [socket.outputStream setDelegate:self];
+    for (NSString *runLoopMode in self.runLoopModes) {
+        [socket.inputStream scheduleInRunLoop:_runLoop forMode:runLoopMode];
+        [socket.outputStream scheduleInRunLoop:_runLoop forMode:runLoopMode];
+    }
+    
+    [socket open];
+    
+    // A kept-alive socket that is already writable does not signal that it has space available again
+    if ([socket isReused]) {
+        [self writeRequestData];
+    }
+}
+
+- (void)detachSocket {
+    AFHTTPSocket *socket = self.socket;
+    [socket.inputStream setDelegate:nil];
+    [socket.outputStream setDelegate:nil];
+    for (NSString *runLoopMode in self.runLoopModes) {
+        [socket.inputStream removeFromRunLoop:_runLoop forMode:runLoopMode];
+        [socket.outputStream removeFromRunLoop:_runLoop forMode:runLoopMode];
+    }
+    
+    self.socket = nil;
+}
+
+- (void)writeRequestData {
+    NSOutputStream *outputStream = self.socket.outputStream;
+    NSUInteger requestHeadLength = [self.requestData length] - _requestBodyLength;
+    
+    while (_requestDataOffset < [self.requestData length] && [outputStream hasSpaceAvailable]) {
+        const uint8_t *bytes = [self.requestData bytes];
+        NSInteger numberOfBytesWritten = [outputStream write:&bytes[_requestDataOffset] maxLength:([self.requestData length] - _requestDataOffset)];
+        if (numberOfBytesWritten <= 0) {
+            break;
+        }
+        
+        NSUInteger previousOffset = _requestDataOffset;
+        _requestDataOffset += numberOfBytesWritten;
+        _lastActivityTime = CFAbsoluteTimeGetCurrent();
+        
+        if (_requestDataOffset > requestHeadLength) {
+            NSInteger bodyBytesWritten = _requestDataOffset - MAX(previousOffset, requestHeadLength);
+            [self.delegate transportConnection:self didSendBodyData:bodyBytesWritten totalBytesWritten:(_requestDataOffset - requestHeadLength) totalBytesExpectedToWrite:_requestBodyLength];
+        }
+    }
+}
+
+- (void)readAvailableBytes {
+    NSInputStream *inputStream = self.socket.inputStream;
+    if ([self isCancelled] || !inputStream || [self.runLoopModes count] == 0 || ![inputStream hasBytesAvailable]) {
+        return;
+    }
+    
+    NSInteger numberOfBytesRead = [inputStream read:_readBuffer maxLength:self.transport.readBufferLength];
+    if (numberOfBytesRead < 0) {
+        [self didLoseConnectionWithError:[inputStream streamError]];
+        return;
+    } else if (numberOfBytesRead == 0) {
+        return;
+    }
+    
+    _receivedResponseBytes = YES;
+    _lastActivityTime = CFAbsoluteTimeGetCurrent();
+    
+    [self.buffer appendBytes:_readBuffer length:numberOfBytesRead];
+    [self parseBuffer];
+}
+
+- (void)parseBuffer {
+    while ([self.buffer length] > 0 && self.delegate && ![self isCancelled]) {
+        switch (_parserState) {
+            case AFHTTPResponseParserStatusLineState:
+            case AFHTTPResponseParserHeadersState:
+            case AFHTTPResponseParserChunkSizeState:
+            case AFHTTPResponseParserChunkTrailerState: {
+                NSUInteger lineLength = AFIndexOfCRLF(self.buffer);
+                if (lineLength == NSNotFound) {
+                    if ([self.buffer length] > kAFHTTPSocketTransportMaximumHeaderLength) {
+                        [self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:nil]];
+                    }
+                    
+                    return;
+                }
+                
+                NSString *line = [[[NSString alloc] initWithBytes:[self.buffer bytes] length:lineLength encoding:NSISOLatin1StringEncoding] autorelease];
+                [self.buffer replaceBytesInRange:NSMakeRange(0, lineLength + 2) withBytes:NULL length:0];
+                
+                if (_parserState == AFHTTPResponseParserStatusLineState) {
+                    if (![self parseStatusLine:line]) {
+                        [self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:nil]];
+                        return;
+                    }
+                    
+                    _parserState = AFHTTPResponseParserHeadersState;
+                } else if (_parserState == AFHTTPResponseParserHeadersState) {
+                    if ([line length] > 0) {
+                        [self parseHeaderLine:line];
+                    } else {
+                        [self didParseHeaders];
+                    }
+                } else if (_parserState == AFHTTPResponseParserChunkSizeState) {
+                    // Chunk extensions, after a semicolon, are ignored; a line without a size would otherwise read as the last chunk, and end the body early
+                    unsigned long long chunkLength = 0;
+                    if (!AFParseChunkSizeLine([line cStringUsingEncoding:NSISOLatin1StringEncoding], [line length], &chunkLength)) {
+                        [self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:nil]];
+                        return;
+                    }
+                    
+                    if (chunkLength == 0) {
+                        _parserState = AFHTTPResponseParserChunkTrailerState;
+                    } else {
+                        _remainingLength = chunkLength;
+                        _parserState = AFHTTPResponseParserChunkDataState;
+                    }
+                } else if ([line length] == 0) {
+                    [self didFinishResponse];
+                    return;
+                }
+                
+                break;
+            }
+            case AFHTTPResponseParserBodyState:
+            case AFHTTPResponseParserChunkDataState: {
+                NSUInteger length = (NSUInteger)MIN(_remainingLength, (unsigned long long)[self.buffer length]);
+                _remainingLength -= length;
+                [self deliverBodyBytesOfLength:length];
+                
+                if (_remainingLength == 0) {
+                    if (_parserState == AFHTTPResponseParserBodyState) {
+                        [self didFinishResponse];
+                        return;
+                    }
+                    
+                    _parserState = AFHTTPResponseParserChunkDataEndState;
+                }
+                
+                break;
+            }
+            case AFHTTPResponseParserChunkDataEndState:
+                if ([self.buffer length] < 2) {
+                    return;
+                }
+                
+                if (memcmp([self.buffer bytes], "\r\n", 2) != 0) {
+                    [self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorBadServerResponse userInfo:nil]];
+                    return;
+                }
+                
+                [self.buffer replaceBytesInRange:NSMakeRange(0, 2) withBytes:NULL length:0];
+                _parserState = AFHTTPResponseParserChunkSizeState;
+                break;
+            case AFHTTPResponseParserBodyUntilCloseState:
+                [self deliverBodyBytesOfLength:[self.buffer length]];
+                break;
+            case AFHTTPResponseParserDoneState:
+            default:
+                return;
+        }
+    }
+}
+
+- (BOOL)parseStatusLine:(NSString *)line {
+    NSArray *components = [line componentsSeparatedByString:@" "];
+    if ([components count] < 2 || ![[components objectAtIndex:0] hasPrefix:@"HTTP/"]) {
+        return NO;
+    }
+    
+    self.HTTPVersion = [components objectAtIndex:0];
+    _statusCode = [[components objectAtIndex:1] integerValue];
+    self.headerFields = [NSMutableDictionary dictionary];
+    
+    return _statusCode >= 100;
+}
+
+- (void)parseHeaderLine:(NSString *)line {
+    NSRange separatorRange = [line rangeOfString:@":"];
+    if (separatorRange.location == NSNotFound) {
+        return;
+    }
+    
+    NSString *field = [line substringToIndex:separatorRange.location];
+    NSString *value = [[line substringFromIndex:NSMaxRange(separatorRange)] stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+    
+    // Repeated fields are combined into a comma-separated list; see http://www.w3.org/Protocols/rfc2616/rfc2616-sec4.html#sec4.2
+    for (NSString *existingField in self.headerFields) {
+        if ([existingField caseInsensitiveCompare:field] == NSOrderedSame) {
+            [self.headerFields setObject:[NSString stringWithFormat:@"%@, %@", [self.headerFields objectForKey:existingField], value] forKey:existingField];
+            return;
+        }
+    }
+    
+    [self.headerFields setObject:value forKey:field];
+}
+
+- (void)didParseHeaders {
+    // Interim responses, such as `100 Continue`, are followed by the final response
+    if (_statusCode < 200) {
+        _parserState = AFHTTPResponseParserStatusLineState;
+        return;
+    }
+    
+    NSMutableDictionary *mutableLowercaseHeaderFields = [NSMutableDictionary dictionaryWithCapacity:[self.headerFields count]];
+    for (NSString *field in self.headerFields) {
+        [mutableLowercaseHeaderFields setObject:[self.headerFields objectForKey:field] forKey:[field lowercaseString]];
+    }
+    
+    NSString *connection = [[mutableLowercaseHeaderFields objectForKey:@"connection"] lowercaseString];
+    if ([self.HTTPVersion isEqualToString:@"HTTP/1.0"]) {
+        _keepAlive = connection && [connection rangeOfString:@"keep-alive"].location != NSNotFound;
+    } else {
+        _keepAlive = !connection || [connection rangeOfString:@"close"].location == NSNotFound;
+    }
+    
+    NSString *transferEncoding = [[mutableLowercaseHeaderFields objectForKey:@"transfer-encoding"] lowercaseString];
+    NSString *contentLength = [mutableLowercaseHeaderFields objectForKey:@"content-length"];
+    BOOL hasBody = !([[self.request HTTPMethod] isEqualToString:@"HEAD"] || _statusCode == 204 || _statusCode == 304);
+    if (!hasBody) {
+        _parserState = AFHTTPResponseParserDoneState;
+    } else if (transferEncoding && [transferEncoding rangeOfString:@"chunked"].location != NSNotFound) {
+        _parserState = AFHTTPResponseParserChunkSizeState;
+    } else if (contentLength) {
+        _remainingLength = strtoull([contentLength UTF8String], NULL, 10);
+        _parserState = _remainingLength > 0 ? AFHTTPResponseParserBodyState : AFHTTPResponseParserDoneState;
+    } else {
+        _keepAlive = NO;
+        _parserState = AFHTTPResponseParserBodyUntilCloseState;
+    }
+    
+    NSURL *url = [self.request URL];
+    if ([self.request HTTPShouldHandleCookies]) {
+        NSArray *cookies = [NSHTTPCookie cookiesWithResponseHeaderFields:self.headerFields forURL:url];
+        [[NSHTTPCookieStorage sharedHTTPCookieStorage] setCookies:cookies forURL:url mainDocumentURL:[self.request mainDocumentURL]];
+    }
+    
+    [self.delegate transportConnection:self didReceiveResponse:AFHTTPURLResponseWithURL(url, _statusCode, self.headerFields)];
+    
+    if (_parserState == AFHTTPResponseParserDoneState && self.delegate) {
+        [self didFinishResponse];
+    }
+}
+
+- (void)deliverBodyBytesOfLength:(NSUInteger)length {
+    if (length == 0) {
+        return;
+    }
+    
+    NSData *data = [NSData dataWithBytes:[self.buffer bytes] length:length];
+    [self.buffer replaceBytesInRange:NSMakeRange(0, length) withBytes:NULL length:0];
+    
+    [self.delegate transportConnection:self didReceiveData:data];
+}
+
+- (void)didFinishResponse {
+    _parserState = AFHTTPResponseParserDoneState;
+    
+    [self.timeoutTimer invalidate];
+    self.timeoutTimer = nil;
+    
+    // Only a connection whose response was read exactly to its end can carry another request
+    AFHTTPSocket *socket = [[self.socket retain] autorelease];
+    [self detachSocket];
+    if (_keepAlive && [self.buffer length] == 0) {
+        [self.transport checkInSocket:socket];
+    } else {
+        [socket close];
+    }
+    
+    id <AFHTTPTransportConnectionDelegate> delegate = [[self.delegate retain] autorelease];
+    self.delegate = nil;
+    
+    [delegate transportConnectionDidFinishLoading:self];
+}
+
+- (void)didFailWithError:(NSError *)error {
+    _parserState = AFHTTPResponseParserDoneState;
+    
+    [self.timeoutTimer invalidate];
+    self.timeoutTimer = nil;
+    
+    [self.socket close];
+    [self detachSocket];
+    
+    id <AFHTTPTransportConnectionDelegate> delegate = [[self.delegate retain] autorelease];
+    self.delegate = nil;
+    
+    [delegate transportConnection:self didFailWithError:error];
+}
+
+- (void)didLoseConnectionWithError:(NSError *)streamError {
+    if (_parserState == AFHTTPResponseParserBodyUntilCloseState && !streamError) {
+        [self didFinishResponse];
+        return;
+    }
+    
+    // A kept-alive connection may have been closed by the server just as it was reused
+    if ([self.socket isReused] && !_receivedResponseBytes && !_resentOnNewSocket && AFHTTPMethodIsIdempotent([self.request HTTPMethod])) {
+        _resentOnNewSocket = YES;
+        _requestDataOffset = 0;
+        
+        [self.socket close];
+        [self detachSocket];
+        [self attachSocket:[self.transport checkOutSocketForURL:[self.request URL] allowingReuse:NO]];
+        
+        return;
+    }
+    
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+    [userInfo setValue:[self.request URL] forKey:NSURLErrorFailingURLErrorKey];
+    [userInfo setValue:streamError forKey:NSUnderlyingErrorKey];
+    NSInteger code = (_receivedResponseBytes || _requestDataOffset > 0) ? NSURLErrorNetworkConnectionLost : NSURLErrorCannotConnectToHost;
+    
+    [self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:code userInfo:userInfo]];
+}
+
+- (void)timeoutTimerDidFire:(NSTimer *)__unused timer {
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    // A connection paused by its delegate is not timed out, since it is not waiting on the server
+    if ([self.runLoopModes count] == 0) {
+        _lastActivityTime = CFAbsoluteTimeGetCurrent();
+        return;
+    }
+    
+    NSTimeInterval timeoutInterval = [self.request timeoutInterval] > 0 ? [self.request timeoutInterval] : 60.0;
+    if (CFAbsoluteTimeGetCurrent() - _lastActivityTime < timeoutInterval) {
+        return;
+    }
+    
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+    [userInfo setValue:[self.request URL] forKey:NSURLErrorFailingURLErrorKey];
+    
+    [self didFailWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorTimedOut userInfo:userInfo]];
+}
+
+#pragma mark - NSStreamDelegate
+
+- (void)stream:(NSStream *)stream 
+   handleEvent:(NSStreamEvent)eventCode
+{
+    // Events that were already queued when the connection was cancelled are dropped until it is torn down
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    switch (eventCode) {
+        case NSStreamEventHasSpaceAvailable:
+            if (stream == self.socket.outputStream) {
+                [self writeRequestData];
+            }
+            break;
+        case NSStreamEventHasBytesAvailable:
+            if (stream == self.socket.inputStream) {
+                [self readAvailableBytes];
+            }
+            break;
+        case NSStreamEventEndEncountered:
+            [self didLoseConnectionWithError:nil];
+            break;
+        case NSStreamEventErrorOccurred:
+            [self didLoseConnectionWithError:[stream streamError]];
+            break;
+        default:
+            break;
+    }
+}
+
+@end
+
+#pragma mark -
+
+@interface AFHTTPSocketPrewarmer : NSObject <NSStreamDelegate> {
+@private
+    AFHTTPSocketTransport *_transport;
+    AFHTTPSocket *_socket;
+    BOOL _finished;
+}
+
+@property (readwrite, nonatomic, retain) AFHTTPSocketTransport *transport;
+@property (readwrite, nonatomic, retain) AFHTTPSocket *socket;
+
+- (id)initWithSocket:(AFHTTPSocket *)socket 
+           transport:(AFHTTPSocketTransport *)transport;
+- (void)start;
+- (void)finishWithSocketOpened:(BOOL)opened;
+@end
+
+@implementation AFHTTPSocketPrewarmer
+@synthesize transport = _transport;
+@synthesize socket = _socket;
+
+- (id)initWithSocket:(AFHTTPSocket *)socket 
+           transport:(AFHTTPSocketTransport *)transport
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.socket = socket;
+    self.transport = transport;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_transport release];
+    [_socket release];
+    [super dealloc];
+}
+
+// Streams do not retain their delegate, so the prewarmer keeps itself alive until the socket has opened or failed
+- (void)start {
+    [self retain];
+    
+    for (NSStream *stream in [NSArray arrayWithObjects:self.socket.inputStream, self.socket.outputStream, nil]) {
+        [stream setDelegate:self];
+        [stream scheduleInRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+    
+    [self.socket open];
+}
+
+- (void)finishWithSocketOpened:(BOOL)opened {
+    if (_finished) {
+        return;
+    }
+    
+    _finished = YES;
+    
+    for (NSStream *stream in [NSArray arrayWithObjects:self.socket.inputStream, self.socket.outputStream, nil]) {
+        [stream setDelegate:nil];
+        [stream removeFromRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
+    }
+    
+    if (opened) {
+        [self.transport checkInSocket:self.socket];
+    } else {
+        [self.socket close];
+    }
+    
+    [self autorelease];
+}
+
+#pragma mark - NSStreamDelegate
+
+// The output stream has space available once the connection, and the TLS handshake of a secure one, have completed
+- (void)stream:(NSStream *)stream 
+   handleEvent:(NSStreamEvent)eventCode
+{
+    switch (eventCode) {
+        case NSStreamEventHasSpaceAvailable:
+            if (stream == self.socket.outputStream) {
+                [self finishWithSocketOpened:YES];
+            }
+            break;
+        case NSStreamEventHasBytesAvailable:
+        case NSStreamEventEndEncountered:
+        case NSStreamEventErrorOccurred:
+            [self finishWithSocketOpened:NO];
+            break;
+        default:
+            break;
+    }
+}
+
+@end
+
+#pragma mark -
+
+@implementation AFHTTPSocketTransport
+@synthesize idleSocketsByKey = _idleSocketsByKey;
+@synthesize maximumIdleConnectionsPerHost = _maximumIdleConnectionsPerHost;
+@synthesize idleConnectionTimeout = _idleConnectionTimeout;
+@synthesize readBufferLength = _readBufferLength;
+@synthesize openedConnectionCount = _openedConnectionCount;
+@synthesize reusedConnectionCount = _reusedConnectionCount;
+
++ (AFHTTPSocketTransport *)sharedTransport {
+    static AFHTTPSocketTransport *_sharedTransport = nil;
+    static dispatch_once_t oncePredicate;
+    
+    dispatch_once(&oncePredicate, ^{
+        _sharedTransport = [[self alloc] init];
+    });
+    
+    return _sharedTransport;
+}
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.idleSocketsByKey = [NSMutableDictionary dictionary];
+    self.maximumIdleConnectionsPerHost = kAFHTTPSocketTransportDefaultMaximumIdleConnectionsPerHost;
+    self.idleConnectionTimeout = kAFHTTPSocketTransportDefaultIdleConnectionTimeout;
+    self.readBufferLength = kAFHTTPSocketTransportDefaultReadBufferLength;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [self closeIdleConnections];
+    [_idleSocketsByKey release];
+    [super dealloc];
+}
+
+- (id <AFHTTPTransportConnection>)connectionWithRequest:(NSURLRequest *)request 
+                                               delegate:(id <AFHTTPTransportConnectionDelegate>)delegate
+{
+    NSString *scheme = [[[request URL] scheme] lowercaseString];
+    if ([request HTTPBodyStream] || !([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"])) {
+        return [[AFURLConnectionTransport sharedTransport] connectionWithRequest:request delegate:delegate];
+    }
+    
+    return [[[AFHTTPSocketTransportConnection alloc] initWithRequest:request transport:self delegate:delegate] autorelease];
+}
+
+- (void)closeIdleConnections {
+    @synchronized(self) {
+        for (NSArray *idleSockets in [self.idleSocketsByKey allValues]) {
+            [idleSockets makeObjectsPerformSelector:@selector(close)];
+        }
+        
+        [self.idleSocketsByKey removeAllObjects];
+    }
+}
+
+- (void)prewarmConnectionToURL:(NSURL *)url {
+    NSString *scheme = [[url scheme] lowercaseString];
+    if (![url host] || !([scheme isEqualToString:@"http"] || [scheme isEqualToString:@"https"])) {
+        return;
+    }
+    
+    @synchronized(self) {
+        if ([[self.idleSocketsByKey objectForKey:AFSocketKeyForURL(url)] count] > 0) {
+            return;
+        }
+    }
+    
+    AFHTTPSocket *socket = [self checkOutSocketForURL:url allowingReuse:NO];
+    dispatch_async(dispatch_get_main_queue(), ^(void) {
+        [[[[AFHTTPSocketPrewarmer alloc] initWithSocket:socket transport:self] autorelease] start];
+    });
+}
+
+#pragma mark -
+
+- (AFHTTPSocket *)checkOutSocketForURL:(NSURL *)url 
+                         allowingReuse:(BOOL)allowingReuse
+{
+    NSString *key = AFSocketKeyForURL(url);
+    CFAbsoluteTime now = CFAbsoluteTimeGetCurrent();
+    
+    @synchronized(self) {
+        // The most recently used socket is the least likely to have been closed by the server
+        NSMutableArray *idleSockets = [self.idleSocketsByKey objectForKey:key];
+        while (allowingReuse && [idleSockets count] > 0) {
+            AFHTTPSocket *socket = [[[idleSockets lastObject] retain] autorelease];
+            [idleSockets removeLastObject];
+            
+            if (now - socket.idleTime < self.idleConnectionTimeout && [socket isReusable]) {
+                socket.reused = YES;
+                self.reusedConnectionCount++;
+                
+                return socket;
+            }
+            
+            [socket close];
+        }
+        
+        self.openedConnectionCount++;
+    }
+    
+    return [[[AFHTTPSocket alloc] initWithURL:url key:key] autorelease];
+}
+
+- (void)checkInSocket:(AFHTTPSocket *)socket {
+    socket.idleTime = CFAbsoluteTimeGetCurrent();
+    
+    @synchronized(self) {
+        NSMutableArray *idleSockets = [self.idleSocketsByKey objectForKey:socket.key];
+        if (!idleSockets) {
+            idleSockets = [NSMutableArray array];
+            [self.idleSocketsByKey setObject:idleSockets forKey:socket.key];
+        }
+        
+        [idleSockets addObject:socket];
+        
+        while ([idleSockets count] > self.maximumIdleConnectionsPerHost) {
+            [[idleSockets objectAtIndex:0] close];
+            [idleSockets removeObjectAtIndex:0];
+        }
+    }
+}
+
+@end
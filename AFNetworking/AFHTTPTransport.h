@@ -0,0 +1,158 @@
+// AFHTTPTransport.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+@protocol AFHTTPTransportConnection;
+
+/**
+ The `AFHTTPTransportConnectionDelegate` protocol defines the callbacks by which a transport connection reports the progress of loading a request. They mirror the corresponding `NSURLConnection` delegate methods, and are called on the run loops in which the connection is scheduled.
+ */
+@protocol AFHTTPTransportConnectionDelegate <NSObject>
+
+/**
+ Called when the response headers have been received. This is called once, before any response data.
+ */
+- (void)transportConnection:(id <AFHTTPTransportConnection>)connection 
+         didReceiveResponse:(NSHTTPURLResponse *)response;
+
+/**
+ Called as the response body is received, with the data received since the previous call.
+ */
+- (void)transportConnection:(id <AFHTTPTransportConnection>)connection 
+             didReceiveData:(NSData *)data;
+
+/**
+ Called as the request body is sent.
+ */
+- (void)transportConnection:(id <AFHTTPTransportConnection>)connection 
+            didSendBodyData:(NSInteger)bytesWritten 
+          totalBytesWritten:(NSInteger)totalBytesWritten 
+  totalBytesExpectedToWrite:(NSInteger)totalBytesExpectedToWrite;
+
+/**
+ Called when the response has been received in full. No further callbacks are made.
+ */
+- (void)transportConnectionDidFinishLoading:(id <AFHTTPTransportConnection>)connection;
+
+/**
+ Called when the request could not be loaded. No further callbacks are made.
+ */
+- (void)transportConnection:(id <AFHTTPTransportConnection>)connection 
+           didFailWithError:(NSError *)error;
+
+@end
+
+#pragma mark -
+
+/**
+ The `AFHTTPTransportConnection` protocol is adopted by objects that load a single request on behalf of an `AFHTTPRequestOperation`. A connection retains its delegate until it finishes loading, fails, or is cancelled.
+ */
+@protocol AFHTTPTransportConnection <NSObject>
+
+/**
+ Schedules the connection's callbacks to be delivered in the specified run loop and mode. A connection that is unscheduled from every run loop delivers no callbacks, and reads no further data.
+ */
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop 
+                  forMode:(NSString *)mode;
+
+/**
+ Unschedules the connection from the specified run loop and mode.
+ */
+- (void)unscheduleFromRunLoop:(NSRunLoop *)runLoop 
+                      forMode:(NSString *)mode;
+
+/**
+ Starts loading the request.
+ */
+- (void)start;
+
+/**
+ Stops loading the request. No further callbacks are made, and the delegate is released.
+ */
+- (void)cancel;
+
+@optional
+
+/**
+ Returns whether the connection decodes the specified content coding of the response body itself, before delivering it to its delegate. Connections that do not implement this method deliver the body as it was received.
+ 
+ @param contentCoding A lowercase content coding from the `Content-Encoding` header of the response, such as `gzip`.
+ */
+- (BOOL)decodesContentCoding:(NSString *)contentCoding;
+
+@end
+
+#pragma mark -
+
+/**
+ The `AFHTTPTransport` protocol is adopted by objects that create the connections with which `AFHTTPRequestOperation` loads requests, so that the networking stack beneath operations can be replaced.
+ 
+ @see AFURLConnectionTransport
+ @see AFHTTPSocketTransport
+ */
+@protocol AFHTTPTransport <NSObject>
+
+/**
+ Creates a connection for the specified request, which does not start loading until it is sent `start`.
+ 
+ @param request The request to load.
+ @param delegate The delegate of the connection.
+ 
+ @return A new connection.
+ */
+- (id <AFHTTPTransportConnection>)connectionWithRequest:(NSURLRequest *)request 
+                                               delegate:(id <AFHTTPTransportConnectionDelegate>)delegate;
+
+@optional
+
+/**
+ Prepares the transport to load requests to the host of the specified URL, by doing ahead of time as much of the work of connecting to it as the transport can, such as resolving the host name or opening a connection that is kept alive for the first request. This returns immediately, and the work is done in the background.
+ 
+ @param url The URL whose host is to be connected to.
+ */
+- (void)prewarmConnectionToURL:(NSURL *)url;
+
+@end
+
+#pragma mark -
+
+/**
+ `AFURLConnectionTransport` loads requests with `NSURLConnection`, and is the default transport of `AFHTTPRequestOperation`.
+ 
+ @discussion `NSURLConnection` decodes `gzip` and `deflate` response bodies itself, and other content codings are left to the operation to decode. It does not expose its pool of connections, so `prewarmConnectionToURL:` can only resolve the host name, which leaves the address in the system resolver's cache for the first request.
+ */
+@interface AFURLConnectionTransport : NSObject <AFHTTPTransport>
+
+/**
+ Returns the shared `NSURLConnection` transport.
+ */
++ (AFURLConnectionTransport *)sharedTransport;
+
+/**
+ Resolves the host name of the specified URL in the background.
+ 
+ @param url The URL whose host name is to be resolved.
+ */
+- (void)prewarmConnectionToURL:(NSURL *)url;
+
+@end
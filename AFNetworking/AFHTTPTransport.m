@@ -0,0 +1,237 @@
+// AFHTTPTransport.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFHTTPTransport.h"
+#import "AFHTTPBodyCompressionPolicy.h"
+#import <CFNetwork/CFNetwork.h>
+
+#include <libkern/OSAtomic.h>
+
+@interface AFURLConnectionTransportConnection : NSObject <AFHTTPTransportConnection> {
+@private
+    NSURLConnection *_connection;
+    id <AFHTTPTransportConnectionDelegate> _delegate;
+    NSThread *_runLoopThread;
+    volatile int32_t _cancelled;
+}
+
+@property (readwrite, nonatomic, retain) NSURLConnection *connection;
+@property (readwrite, nonatomic, retain) id <AFHTTPTransportConnectionDelegate> delegate;
+@property (readwrite, nonatomic, retain) NSThread *runLoopThread;
+
+- (id)initWithRequest:(NSURLRequest *)request 
+             delegate:(id <AFHTTPTransportConnectionDelegate>)delegate;
+
+- (BOOL)isCancelled;
+- (void)cancelOnRunLoopThread;
+@end
+
+@implementation AFURLConnectionTransportConnection
+@synthesize connection = _connection;
+@synthesize delegate = _delegate;
+@synthesize runLoopThread = _runLoopThread;
+
+- (id)initWithRequest:(NSURLRequest *)request 
+             delegate:(id <AFHTTPTransportConnectionDelegate>)delegate
+{
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    // `NSURLConnection` retains its delegate until it finishes, which in turn retains the transport connection's delegate
+    self.connection = [[[NSURLConnection alloc] initWithRequest:request delegate:self startImmediately:NO] autorelease];
+    self.delegate = delegate;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_connection release];
+    [_delegate release];
+    [_runLoopThread release];
+    [super dealloc];
+}
+
+- (BOOL)isCancelled {
+    return _cancelled != 0;
+}
+
+// Connections are scheduled from the thread of their run loop, which is the thread their callbacks are delivered on
+- (void)scheduleInRunLoop:(NSRunLoop *)runLoop 
+                  forMode:(NSString *)mode
+{
+    self.runLoopThread = [NSThread currentThread];
+    [self.connection scheduleInRunLoop:runLoop forMode:mode];
+}
+
+- (void)unscheduleFromRunLoop:(NSRunLoop *)runLoop 
+                      forMode:(NSString *)mode
+{
+    [self.connection unscheduleFromRunLoop:runLoop forMode:mode];
+}
+
+- (void)start {
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    [self.connection start];
+}
+
+// Cancellation may come from any thread, so it is only marked here, and the connection and delegate are released on the thread of their run loop
+- (void)cancel {
+    if (!OSAtomicCompareAndSwap32Barrier(0, 1, &_cancelled)) {
+        return;
+    }
+    
+    NSThread *runLoopThread = self.runLoopThread;
+    if (!runLoopThread || runLoopThread == [NSThread currentThread]) {
+        [self cancelOnRunLoopThread];
+    } else {
+        [self performSelector:@selector(cancelOnRunLoopThread) onThread:runLoopThread withObject:nil waitUntilDone:NO];
+    }
+}
+
+- (void)cancelOnRunLoopThread {
+    [self.connection cancel];
+    self.delegate = nil;
+}
+
+- (BOOL)decodesContentCoding:(NSString *)contentCoding {
+    return [contentCoding isEqualToString:@"gzip"] || [contentCoding isEqualToString:@"x-gzip"] || [contentCoding isEqualToString:@"deflate"];
+}
+
+#pragma mark - NSURLConnection
+
+- (void)connection:(NSURLConnection *)__unused connection 
+didReceiveResponse:(NSURLResponse *)response 
+{
+    // Callbacks that were already queued when the connection was cancelled are dropped until it is torn down
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    [self.delegate transportConnection:self didReceiveResponse:(NSHTTPURLResponse *)response];
+}
+
+- (void)connection:(NSURLConnection *)__unused connection 
+    didReceiveData:(NSData *)data 
+{
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    [self.delegate transportConnection:self didReceiveData:data];
+}
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)__unused connection {
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    id <AFHTTPTransportConnectionDelegate> delegate = [[self.delegate retain] autorelease];
+    self.delegate = nil;
+    
+    [delegate transportConnectionDidFinishLoading:self];
+}
+
+- (void)connection:(NSURLConnection *)__unused connection 
+  didFailWithError:(NSError *)error 
+{
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    id <AFHTTPTransportConnectionDelegate> delegate = [[self.delegate retain] autorelease];
+    self.delegate = nil;
+    
+    [delegate transportConnection:self didFailWithError:error];
+}
+
+- (void)connection:(NSURLConnection *)__unused connection 
+   didSendBodyData:(NSInteger)bytesWritten 
+ totalBytesWritten:(NSInteger)totalBytesWritten 
+totalBytesExpectedToWrite:(NSInteger)totalBytesExpectedToWrite
+{
+    if ([self isCancelled]) {
+        return;
+    }
+    
+    [self.delegate transportConnection:self didSendBodyData:bytesWritten totalBytesWritten:totalBytesWritten totalBytesExpectedToWrite:totalBytesExpectedToWrite];
+}
+
+- (NSInputStream *)connection:(NSURLConnection *)__unused connection 
+            needNewBodyStream:(NSURLRequest *)request
+{
+    // Redirected and authenticated requests send their body again, which is only possible for a body stream that can be made again
+    return AFHTTPBodyStreamForResendingRequest(request);
+}
+
+- (NSCachedURLResponse *)connection:(NSURLConnection *)__unused connection 
+                  willCacheResponse:(NSCachedURLResponse *)cachedResponse 
+{
+    // Connections that were cancelled have released their delegate
+    if ([self isCancelled] || !self.delegate) {
+        return nil;
+    }
+    
+    return cachedResponse;
+}
+
+@end
+
+#pragma mark -
+
+@implementation AFURLConnectionTransport
+
++ (AFURLConnectionTransport *)sharedTransport {
+    static AFURLConnectionTransport *_sharedTransport = nil;
+    static dispatch_once_t oncePredicate;
+    
+    dispatch_once(&oncePredicate, ^{
+        _sharedTransport = [[self alloc] init];
+    });
+    
+    return _sharedTransport;
+}
+
+- (id <AFHTTPTransportConnection>)connectionWithRequest:(NSURLRequest *)request 
+                                               delegate:(id <AFHTTPTransportConnectionDelegate>)delegate
+{
+    return [[[AFURLConnectionTransportConnection alloc] initWithRequest:request delegate:delegate] autorelease];
+}
+
+- (void)prewarmConnectionToURL:(NSURL *)url {
+    NSString *hostName = [url host];
+    if (!hostName) {
+        return;
+    }
+    
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(void) {
+        CFHostRef host = CFHostCreateWithName(kCFAllocatorDefault, (CFStringRef)hostName);
+        CFHostStartInfoResolution(host, kCFHostAddresses, NULL);
+        CFRelease(host);
+    });
+}
+
+@end
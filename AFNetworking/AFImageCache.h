@@ -27,8 +27,47 @@
  `AFImageCache` is a subclass of `NSCache` that stores and retrieves images from cache.
  
  @discussion `AFImageCache` is used to cache images for successful `AFImageRequestOperations` with the proper cache policy.
+ 
+ Behind the in-memory cache of decoded images is a size-bounded store on disk of encoded image data, which survives memory warnings and relaunches. Data is stored on disk by URL and cache name, like images in memory: the original data of an image without a cache name, and either the original data or the processed image of an image with one. When an image is not in memory, it can be loaded asynchronously from a memory-mapped read of its data on disk, and decoded off the main thread. The least recently used images on disk are evicted when the store exceeds its capacity, and an index of the store is kept alongside it, so that it does not need to be rebuilt at launch.
  */
-@interface AFImageCache : NSCache
+@interface AFImageCache : NSCache {
+@private
+    NSString *_diskCachePath;
+    NSUInteger _diskCapacity;
+    NSUInteger _currentDiskUsage;
+    NSMutableDictionary *_diskCacheIndex;
+    BOOL _diskCacheIndexSaveScheduled;
+    dispatch_queue_t _diskCacheQueue;
+    
+    volatile int32_t _memoryHitCount;
+    volatile int32_t _diskHitCount;
+    volatile int32_t _missCount;
+}
+
+/**
+ The maximum number of bytes of image data stored on disk. This is 50 MB by default. If `0`, images are only cached in memory.
+ */
+@property (nonatomic, assign) NSUInteger diskCapacity;
+
+/**
+ The number of bytes of image data currently stored on disk.
+ */
+@property (readonly, nonatomic, assign) NSUInteger currentDiskUsage;
+
+/**
+ The number of lookups with `cachedImageForURL:cacheName:` that were answered with an image in memory.
+ */
+@property (readonly, nonatomic, assign) NSUInteger memoryHitCount;
+
+/**
+ The number of lookups with `loadCachedImageFromDiskForURL:cacheName:completion:` that were answered with an image decoded from data on disk.
+ */
+@property (readonly, nonatomic, assign) NSUInteger diskHitCount;
+
+/**
+ The number of lookups with `loadCachedImageFromDiskForURL:cacheName:completion:` that found no image on disk.
+ */
+@property (readonly, nonatomic, assign) NSUInteger missCount;
 
 /**
  Returns the shared image cache object for the system.
@@ -43,11 +82,24 @@
  @param url The URL associated with the image in the cache.
  @param cacheName The cache name associated with the image in the cache. This allows for multiple versions of an image to be associated for a single URL, such as image thumbnails, for instance.
  
+ @discussion Only images in memory are returned, so that this can be called on the main thread. Images that are not in memory can be loaded from disk with `loadCachedImageFromDiskForURL:cacheName:completion:`.
+ 
  @return The image associated with the URL and cache name, or `nil` if not image exists.
  */
 - (UIImage *)cachedImageForURL:(NSURL *)url
                      cacheName:(NSString *)cacheName;
 
+/**
+ Asynchronously loads the image data stored on disk for a given URL and cache name, and decodes it off the main thread. A decoded image is added to the in-memory cache with the same cache name.
+ 
+ @param url The URL associated with the image data.
+ @param cacheName The cache name associated with the image data, or `nil` for the original data of the image.
+ @param completion A block object to be executed on the main queue once the lookup is done. This block has no return value and takes a single argument: the decoded image, or `nil` if no image data is stored for the URL and cache name.
+ */
+- (void)loadCachedImageFromDiskForURL:(NSURL *)url
+                            cacheName:(NSString *)cacheName
+                           completion:(void (^)(UIImage *image))completion;
+
 /**
  Stores an image into cache, associated with a given URL and cache name.
  
@@ -59,4 +111,33 @@
             forURL:(NSURL *)url
          cacheName:(NSString *)cacheName;
 
+/**
+ Returns the encoded image data stored on disk for a given URL and cache name.
+ 
+ @param url The URL associated with the image data.
+ @param cacheName The cache name associated with the image data, or `nil` for the original data of the image.
+ 
+ @discussion This waits for the disk cache queue, which may be writing or trimming, and should not be called on the main thread.
+ 
+ @return The memory-mapped image data, or `nil` if none is stored.
+ */
+- (NSData *)cachedImageDataForURL:(NSURL *)url
+                        cacheName:(NSString *)cacheName;
+
+/**
+ Stores encoded image data on disk, associated with a given URL and cache name. The data is written asynchronously.
+ 
+ @param data The image data to be stored.
+ @param url The URL to be associated with the image data.
+ @param cacheName The cache name to be associated with the image data. Data for an image that was processed after being decoded should only be stored with a cache name, since data without one is taken to be the original data of the image.
+ */
+- (void)cacheImageData:(NSData *)data
+                forURL:(NSURL *)url
+             cacheName:(NSString *)cacheName;
+
+/**
+ Removes all image data stored on disk.
+ */
+- (void)removeAllCachedImageData;
+
 @end
@@ -22,11 +22,74 @@
 
 #import "AFImageCache.h"
 
+#import <CommonCrypto/CommonDigest.h>
+#include <libkern/OSAtomic.h>
+
+static NSString * const kAFImageCacheIndexFilename = @"index.plist";
+static NSString * const kAFImageCacheIndexSizeKey = @"size";
+static NSString * const kAFImageCacheIndexAccessDateKey = @"accessDate";
+static NSTimeInterval const kAFImageCacheIndexSaveDelay = 5.0;
+
 static inline NSString * AFImageCacheKeyFromURLAndCacheName(NSURL *url, NSString *cacheName) {
     return [[url absoluteString] stringByAppendingFormat:@"#%@", cacheName];
 }
 
+// The original data of an image is stored under the digest of its URL alone, and data stored with a cache name under the digest of its cache key
+static NSString * AFImageCacheFilenameFromURLAndCacheName(NSURL *url, NSString *cacheName) {
+    const char *string = [(cacheName ? AFImageCacheKeyFromURLAndCacheName(url, cacheName) : [url absoluteString]) UTF8String];
+    unsigned char digest[CC_MD5_DIGEST_LENGTH];
+    CC_MD5(string, (CC_LONG)strlen(string), digest);
+    
+    NSMutableString *mutableFilename = [NSMutableString stringWithCapacity:CC_MD5_DIGEST_LENGTH * 2];
+    for (NSUInteger idx = 0; idx < CC_MD5_DIGEST_LENGTH; idx++) {
+        [mutableFilename appendFormat:@"%02x", digest[idx]];
+    }
+    
+    return mutableFilename;
+}
+
+// Drawing the image into a bitmap decodes it on the calling thread, rather than on the main thread when it is first displayed
+static UIImage * AFDecodedImageFromData(NSData *data, CGFloat scale) {
+    CGImageRef imageRef = [[UIImage imageWithData:data] CGImage];
+    if (!imageRef) {
+        return nil;
+    }
+    
+    size_t width = CGImageGetWidth(imageRef);
+    size_t height = CGImageGetHeight(imageRef);
+    CGColorSpaceRef colorSpaceRef = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, width, height, 8, 0, colorSpaceRef, kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host);
+    CGColorSpaceRelease(colorSpaceRef);
+    if (!context) {
+        return [UIImage imageWithCGImage:imageRef scale:scale orientation:UIImageOrientationUp];
+    }
+    
+    CGContextDrawImage(context, CGRectMake(0.0f, 0.0f, width, height), imageRef);
+    CGImageRef decodedImageRef = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    
+    UIImage *image = [UIImage imageWithCGImage:decodedImageRef scale:scale orientation:UIImageOrientationUp];
+    CGImageRelease(decodedImageRef);
+    
+    return image;
+}
+
+@interface AFImageCache ()
+@property (readwrite, nonatomic, retain) NSString *diskCachePath;
+@property (readwrite, nonatomic, assign) NSUInteger currentDiskUsage;
+@property (readwrite, nonatomic, retain) NSMutableDictionary *diskCacheIndex;
+
+- (NSData *)cachedImageDataForFilename:(NSString *)filename;
+- (void)loadDiskCacheIndex;
+- (void)setNeedsSaveDiskCacheIndex;
+- (void)trimDiskCacheToCapacity;
+@end
+
 @implementation AFImageCache
+@synthesize diskCachePath = _diskCachePath;
+@synthesize diskCapacity = _diskCapacity;
+@synthesize currentDiskUsage = _currentDiskUsage;
+@synthesize diskCacheIndex = _diskCacheIndex;
 
 + (AFImageCache *)sharedImageCache {
     static AFImageCache *_sharedImageCache = nil;
@@ -39,10 +102,103 @@ static inline NSString * AFImageCacheKeyFromURLAndCacheName(NSURL *url, NSString
     return _sharedImageCache;
 }
 
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    NSString *cachesDirectory = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+    self.diskCachePath = [cachesDirectory stringByAppendingPathComponent:@"com.alamofire.networking.image-cache"];
+    _diskCapacity = 1024 * 1024 * 50;
+    
+    self.diskCacheIndex = [NSMutableDictionary dictionary];
+    
+    _diskCacheQueue = dispatch_queue_create("com.alamofire.networking.image-cache.disk", 0);
+    dispatch_async(_diskCacheQueue, ^{
+        [self loadDiskCacheIndex];
+    });
+    
+    return self;
+}
+
+- (void)dealloc {
+    dispatch_release(_diskCacheQueue);
+    
+    [_diskCachePath release];
+    [_diskCacheIndex release];
+    [super dealloc];
+}
+
+- (void)setDiskCapacity:(NSUInteger)diskCapacity {
+    _diskCapacity = diskCapacity;
+    
+    dispatch_async(_diskCacheQueue, ^{
+        [self trimDiskCacheToCapacity];
+    });
+}
+
+- (NSUInteger)memoryHitCount {
+    return (NSUInteger)_memoryHitCount;
+}
+
+- (NSUInteger)diskHitCount {
+    return (NSUInteger)_diskHitCount;
+}
+
+- (NSUInteger)missCount {
+    return (NSUInteger)_missCount;
+}
+
 - (UIImage *)cachedImageForURL:(NSURL *)url
                      cacheName:(NSString *)cacheName
 {
-    return [self objectForKey:AFImageCacheKeyFromURLAndCacheName(url, cacheName)];
+    UIImage *image = [self objectForKey:AFImageCacheKeyFromURLAndCacheName(url, cacheName)];
+    if (image) {
+        OSAtomicIncrement32Barrier(&_memoryHitCount);
+    }
+    
+    return image;
+}
+
+- (void)loadCachedImageFromDiskForURL:(NSURL *)url
+                            cacheName:(NSString *)cacheName
+                           completion:(void (^)(UIImage *image))completion
+{
+    if (!url || self.diskCapacity == 0) {
+        OSAtomicIncrement32Barrier(&_missCount);
+        dispatch_async(dispatch_get_main_queue(), ^{
+            if (completion) {
+                completion(nil);
+            }
+        });
+        
+        return;
+    }
+    
+    NSString *filename = AFImageCacheFilenameFromURLAndCacheName(url, cacheName);
+    CGFloat scale = [[UIScreen mainScreen] scale];
+    
+    dispatch_async(_diskCacheQueue, ^{
+        NSData *data = [self cachedImageDataForFilename:filename];
+        
+        // Images are decoded on a global queue, so that the disk cache queue is free for writes and trimming
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            UIImage *image = data ? AFDecodedImageFromData(data, scale) : nil;
+            if (image) {
+                OSAtomicIncrement32Barrier(&_diskHitCount);
+                [self setObject:image forKey:AFImageCacheKeyFromURLAndCacheName(url, cacheName)];
+            } else {
+                OSAtomicIncrement32Barrier(&_missCount);
+            }
+            
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if (completion) {
+                    completion(image);
+                }
+            });
+        });
+    });
 }
 
 - (void)cacheImage:(UIImage *)image
@@ -56,4 +212,149 @@ static inline NSString * AFImageCacheKeyFromURLAndCacheName(NSURL *url, NSString
     [self setObject:image forKey:AFImageCacheKeyFromURLAndCacheName(url, cacheName)];
 }
 
+- (NSData *)cachedImageDataForURL:(NSURL *)url
+                        cacheName:(NSString *)cacheName
+{
+    if (!url || self.diskCapacity == 0) {
+        return nil;
+    }
+    
+    NSString *filename = AFImageCacheFilenameFromURLAndCacheName(url, cacheName);
+    __block NSData *data = nil;
+    
+    dispatch_sync(_diskCacheQueue, ^{
+        data = [[self cachedImageDataForFilename:filename] retain];
+    });
+    
+    return [data autorelease];
+}
+
+- (void)cacheImageData:(NSData *)data
+                forURL:(NSURL *)url
+             cacheName:(NSString *)cacheName
+{
+    if (!data || !url || [data length] == 0 || [data length] > self.diskCapacity) {
+        return;
+    }
+    
+    NSString *filename = AFImageCacheFilenameFromURLAndCacheName(url, cacheName);
+    NSData *immutableData = [[data copy] autorelease];
+    
+    dispatch_async(_diskCacheQueue, ^{
+        NSDictionary *existingEntry = [self.diskCacheIndex objectForKey:filename];
+        if (existingEntry) {
+            self.currentDiskUsage -= MIN([[existingEntry objectForKey:kAFImageCacheIndexSizeKey] unsignedIntegerValue], self.currentDiskUsage);
+            [self.diskCacheIndex removeObjectForKey:filename];
+        }
+        
+        if (![immutableData writeToFile:[self.diskCachePath stringByAppendingPathComponent:filename] atomically:YES]) {
+            return;
+        }
+        
+        NSDictionary *entry = [NSDictionary dictionaryWithObjectsAndKeys:[NSNumber numberWithUnsignedInteger:[immutableData length]], kAFImageCacheIndexSizeKey, [NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate]], kAFImageCacheIndexAccessDateKey, nil];
+        [self.diskCacheIndex setObject:entry forKey:filename];
+        self.currentDiskUsage += [immutableData length];
+        
+        [self trimDiskCacheToCapacity];
+        [self setNeedsSaveDiskCacheIndex];
+    });
+}
+
+- (void)removeAllCachedImageData {
+    dispatch_async(_diskCacheQueue, ^{
+        NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+        [fileManager removeItemAtPath:self.diskCachePath error:nil];
+        [fileManager createDirectoryAtPath:self.diskCachePath withIntermediateDirectories:YES attributes:nil error:nil];
+        
+        [self.diskCacheIndex removeAllObjects];
+        self.currentDiskUsage = 0;
+    });
+}
+
+#pragma mark -
+
+// Called on the disk cache queue
+- (NSData *)cachedImageDataForFilename:(NSString *)filename {
+    NSDictionary *entry = [self.diskCacheIndex objectForKey:filename];
+    if (!entry) {
+        return nil;
+    }
+    
+    // Mapping the file avoids copying its contents until the image is decoded
+    NSData *data = [NSData dataWithContentsOfFile:[self.diskCachePath stringByAppendingPathComponent:filename] options:NSDataReadingMapped error:nil];
+    if (data) {
+        NSMutableDictionary *mutableEntry = [NSMutableDictionary dictionaryWithDictionary:entry];
+        [mutableEntry setObject:[NSNumber numberWithDouble:[NSDate timeIntervalSinceReferenceDate]] forKey:kAFImageCacheIndexAccessDateKey];
+        [self.diskCacheIndex setObject:mutableEntry forKey:filename];
+    } else {
+        self.currentDiskUsage -= MIN([[entry objectForKey:kAFImageCacheIndexSizeKey] unsignedIntegerValue], self.currentDiskUsage);
+        [self.diskCacheIndex removeObjectForKey:filename];
+    }
+    
+    [self setNeedsSaveDiskCacheIndex];
+    
+    return data;
+}
+
+- (void)loadDiskCacheIndex {
+    NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+    [fileManager createDirectoryAtPath:self.diskCachePath withIntermediateDirectories:YES attributes:nil error:nil];
+    
+    NSDictionary *savedIndex = [NSDictionary dictionaryWithContentsOfFile:[self.diskCachePath stringByAppendingPathComponent:kAFImageCacheIndexFilename]];
+    
+    // Files that were written after the index was last saved are not in it, and are removed rather than measured
+    NSUInteger diskUsage = 0;
+    for (NSString *filename in [fileManager contentsOfDirectoryAtPath:self.diskCachePath error:nil]) {
+        if ([filename isEqualToString:kAFImageCacheIndexFilename]) {
+            continue;
+        }
+        
+        NSDictionary *entry = [savedIndex objectForKey:filename];
+        if (entry) {
+            [self.diskCacheIndex setObject:entry forKey:filename];
+            diskUsage += [[entry objectForKey:kAFImageCacheIndexSizeKey] unsignedIntegerValue];
+        } else {
+            [fileManager removeItemAtPath:[self.diskCachePath stringByAppendingPathComponent:filename] error:nil];
+        }
+    }
+    self.currentDiskUsage = diskUsage;
+    
+    [self trimDiskCacheToCapacity];
+}
+
+- (void)setNeedsSaveDiskCacheIndex {
+    if (_diskCacheIndexSaveScheduled) {
+        return;
+    }
+    
+    _diskCacheIndexSaveScheduled = YES;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kAFImageCacheIndexSaveDelay * NSEC_PER_SEC)), _diskCacheQueue, ^{
+        _diskCacheIndexSaveScheduled = NO;
+        [self.diskCacheIndex writeToFile:[self.diskCachePath stringByAppendingPathComponent:kAFImageCacheIndexFilename] atomically:YES];
+    });
+}
+
+- (void)trimDiskCacheToCapacity {
+    if (self.currentDiskUsage <= self.diskCapacity) {
+        return;
+    }
+    
+    NSArray *filenamesByAccessDate = [self.diskCacheIndex keysSortedByValueUsingComparator:^NSComparisonResult(id entry, id otherEntry) {
+        return [[entry objectForKey:kAFImageCacheIndexAccessDateKey] compare:[otherEntry objectForKey:kAFImageCacheIndexAccessDateKey]];
+    }];
+    
+    NSFileManager *fileManager = [[[NSFileManager alloc] init] autorelease];
+    for (NSString *filename in filenamesByAccessDate) {
+        if (self.currentDiskUsage <= self.diskCapacity) {
+            break;
+        }
+        
+        [fileManager removeItemAtPath:[self.diskCachePath stringByAppendingPathComponent:filename] error:nil];
+        self.currentDiskUsage -= MIN([[[self.diskCacheIndex objectForKey:filename] objectForKey:kAFImageCacheIndexSizeKey] unsignedIntegerValue], self.currentDiskUsage);
+        [self.diskCacheIndex removeObjectForKey:filename];
+    }
+    
+    [self setNeedsSaveDiskCacheIndex];
+}
+
 @end
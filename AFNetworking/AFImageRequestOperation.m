@@ -50,14 +50,22 @@ static dispatch_queue_t image_request_operation_processing_queue() {
                                           success:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, UIImage *image))success
                                           failure:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error))failure
 {
-    return (AFImageRequestOperation *)[self operationWithRequest:urlRequest completion:^(NSURLRequest *request, NSHTTPURLResponse *response, NSData *data, NSError *error) {
+    __block AFImageRequestOperation *operation = nil;
+    operation = (AFImageRequestOperation *)[self operationWithRequest:urlRequest completion:^(NSURLRequest *request, NSHTTPURLResponse *response, NSData *data, NSError *error) {
+        // Retained by the blocks below, so that timing points can be marked after the operation has been released by its queue
+        AFImageRequestOperation *timedOperation = operation;
+        [timedOperation markTimingPoint:AFHTTPRequestOperationProcessingStartedTimingPoint];
+        
         dispatch_async(image_request_operation_processing_queue(), ^(void) {
             if (error) {
-                if (failure) {
-                    dispatch_async(dispatch_get_main_queue(), ^(void) {
+                [timedOperation markTimingPoint:AFHTTPRequestOperationProcessingFinishedTimingPoint];
+                dispatch_async(dispatch_get_main_queue(), ^(void) {
+                    if (failure) {
                         failure(request, response, error);
-                    });
-                }
+                    }
+                    
+                    [timedOperation markTimingPoint:AFHTTPRequestOperationDeliveredTimingPoint];
+                });
             } else {
                 UIImage *image = nil;    
                 if ([[UIScreen mainScreen] scale] == 2.0) {
@@ -71,18 +79,30 @@ static dispatch_queue_t image_request_operation_processing_queue() {
                     image = imageProcessingBlock(image);
                 }
                 
+                [timedOperation markTimingPoint:AFHTTPRequestOperationProcessingFinishedTimingPoint];
                 dispatch_async(dispatch_get_main_queue(), ^(void) {
                     if (success) {
                         success(request, response, image);
                     }
+                    
+                    [timedOperation markTimingPoint:AFHTTPRequestOperationDeliveredTimingPoint];
                 });
                 
                 if ([request cachePolicy] != NSURLCacheStorageNotAllowed) {
                     [[AFImageCache sharedImageCache] cacheImage:image forURL:[request URL] cacheName:cacheNameOrNil];
+                    
+                    // A processed image is stored on disk as it was processed, and only under a cache name, so that it is never mistaken for the original
+                    if (image && !imageProcessingBlock) {
+                        [[AFImageCache sharedImageCache] cacheImageData:data forURL:[request URL] cacheName:cacheNameOrNil];
+                    } else if (image && cacheNameOrNil) {
+                        [[AFImageCache sharedImageCache] cacheImageData:UIImagePNGRepresentation(image) forURL:[request URL] cacheName:cacheNameOrNil];
+                    }
                 }
             }
         });
     }];
+    
+    return operation;
 }
 
 @end
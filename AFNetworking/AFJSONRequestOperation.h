@@ -23,13 +23,42 @@
 #import <Foundation/Foundation.h>
 #import "AFHTTPRequestOperation.h"
 
+/**
+ Keys for the dictionary returned by `+[AFJSONRequestOperation JSONProcessingStatistics]`.
+ 
+ - `AFJSONProcessingResponseCountKey`: The number of response bodies that have been parsed, as an `NSNumber`.
+ - `AFJSONProcessingQueueWaitTimeKey`: The total time, in seconds, that response bodies spent waiting for a processing queue, as an `NSNumber`.
+ - `AFJSONProcessingParseTimeKey`: The total time, in seconds, spent parsing response bodies, as an `NSNumber`.
+ - `AFJSONProcessingDecoderCacheHitCountKey`: The number of strings and numbers that were found in the token caches of the processing queues' `JSONDecoder` objects, as an `NSNumber`.
+ - `AFJSONProcessingDecoderCacheMissCountKey`: The number of strings and numbers that were not found in the token caches of the processing queues' `JSONDecoder` objects, as an `NSNumber`.
+ 
+ @discussion The decoder cache counts cover JSONKit only, and stay at `0` if `setPrefersJSONDecoder:` is set to `NO` where `NSJSONSerialization` is available. They are also only collected when the linked version of JSONKit implements `cacheHitCount` and `cacheMissCount`, and do not include the warm-up parsing done by `prewarmJSONProcessingQueues`. They are read on each processing queue in turn, after the parse in progress there, if any, has finished.
+ */
+extern NSString * const AFJSONProcessingResponseCountKey;
+extern NSString * const AFJSONProcessingQueueWaitTimeKey;
+extern NSString * const AFJSONProcessingParseTimeKey;
+extern NSString * const AFJSONProcessingDecoderCacheHitCountKey;
+extern NSString * const AFJSONProcessingDecoderCacheMissCountKey;
+
 /**
  `AFJSONRequestOperation` is an `NSOperation` that wraps the callback from `AFHTTPRequestOperation` to determine the success or failure of a request based on its status code and response content type, and parse the response body into a JSON object.
  
  @see NSOperation
  @see AFHTTPRequestOperation
  */
-@interface AFJSONRequestOperation : AFHTTPRequestOperation
+@interface AFJSONRequestOperation : AFHTTPRequestOperation {
+@private
+    BOOL _parsesJSONIncrementally;
+    id _streamingParser;
+    NSUInteger _processingQueueIndex;
+}
+
+/**
+ Whether the response body is parsed incrementally as it is received, rather than all at once after the request finishes. `NO` by default.
+ 
+ @discussion When enabled, each chunk of the response body, once any content coding has been decoded, is handed off to a resumable parser running on one of the shared JSON processing queues, so that the JSON object is ready shortly after the last byte of the response arrives. This is most useful for large responses, where parsing would otherwise add significantly to the overall latency of the request. The body is not also kept in memory, so `responseBody` is `nil`, and the response is not stored in the `responseCache`. This must be set before the operation is started.
+ */
+@property (nonatomic, assign) BOOL parsesJSONIncrementally;
 
 ///---------------------------------------
 /// @name Creating JSON Request Operations
@@ -85,6 +114,54 @@
                                          failure:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error))failure;
 
 
+///----------------------------------
+/// @name Configuring JSON Processing
+///----------------------------------
+
+/**
+ Returns the number of serial queues on which response bodies are parsed. By default, this is the number of active processor cores.
+ 
+ @discussion Before the processing queues are created, this is the number that will be created; calling it does not create them.
+ */
++ (NSUInteger)numberOfJSONProcessingQueues;
+
+/**
+ Sets the number of serial queues on which response bodies are parsed. Each finished response is parsed on the queue with the fewest pending responses, and each queue reuses its own `JSONDecoder` across responses.
+ 
+ @param numberOfQueues The number of JSON processing queues. If `0`, the number of active processor cores is used.
+ 
+ @discussion The processing queues are created when the first response is parsed, so this must be called before then; subsequent calls have no effect.
+ */
++ (void)setNumberOfJSONProcessingQueues:(NSUInteger)numberOfQueues;
+
+/**
+ Returns whether response bodies are parsed with the processing queues' `JSONDecoder` objects even where `NSJSONSerialization` is available. By default, this is `YES`, so that each queue's decoder keeps the keys and strings it has parsed for the responses that follow.
+ */
++ (BOOL)prefersJSONDecoder;
+
+/**
+ Sets whether response bodies are parsed with the processing queues' `JSONDecoder` objects even where `NSJSONSerialization` is available. Each queue's decoder keeps its cache of parsed keys and strings across responses, which can make JSONKit the faster choice for responses that repeat the same keys, and is needed for the decoder cache counts of `JSONProcessingStatistics`. Set this to `NO` to parse with `NSJSONSerialization` where it is available.
+ 
+ @param prefersJSONDecoder Whether to prefer `JSONDecoder`. This applies to responses parsed after it is set.
+ */
++ (void)setPrefersJSONDecoder:(BOOL)prefersJSONDecoder;
+
+/**
+ Returns cumulative counters for the parsing of response bodies across all JSON request operations.
+ 
+ @return A dictionary containing values for `AFJSONProcessingResponseCountKey`, `AFJSONProcessingQueueWaitTimeKey`, `AFJSONProcessingParseTimeKey`, `AFJSONProcessingDecoderCacheHitCountKey`, and `AFJSONProcessingDecoderCacheMissCountKey`. Dividing either time by the response count gives the average per response.
+ 
+ @discussion This waits for the parse in progress on each processing queue to finish, in order to read the queue's decoder cache counts.
+ */
++ (NSDictionary *)JSONProcessingStatistics;
+
+/**
+ Creates the JSON processing queues and their decoders, and parses a small document on each queue, so that the first response to be parsed does not pay for their setup.
+ 
+ @discussion The warm-up parsing is done asynchronously, and is not counted in any of the `JSONProcessingStatistics`. Once the processing queues have been created, `setNumberOfJSONProcessingQueues:` has no effect.
+ */
++ (void)prewarmJSONProcessingQueues;
+
 ///----------------------------------
 /// @name Getting Default HTTP Values
 ///----------------------------------
@@ -24,17 +24,658 @@
 #import "JSONKit.h"
 
 #include <Availability.h>
+#include <errno.h>
+#include <libkern/OSAtomic.h>
+#include <mach/mach_time.h>
 
-static dispatch_queue_t af_json_request_operation_processing_queue;
-static dispatch_queue_t json_request_operation_processing_queue() {
-    if (af_json_request_operation_processing_queue == NULL) {
-        af_json_request_operation_processing_queue = dispatch_queue_create("com.alamofire.json-request.processing", 0);
+NSString * const AFJSONProcessingResponseCountKey = @"AFJSONProcessingResponseCount";
+NSString * const AFJSONProcessingQueueWaitTimeKey = @"AFJSONProcessingQueueWaitTime";
+NSString * const AFJSONProcessingParseTimeKey = @"AFJSONProcessingParseTime";
+NSString * const AFJSONProcessingDecoderCacheHitCountKey = @"AFJSONProcessingDecoderCacheHitCount";
+NSString * const AFJSONProcessingDecoderCacheMissCountKey = @"AFJSONProcessingDecoderCacheMissCount";
+
+typedef void (^AFJSONProcessingCompletionBlock)(id JSON, NSError *error);
+
+static NSUInteger af_json_request_operation_configured_processing_queue_count = 0;
+static BOOL af_json_request_operation_processing_queues_initialized = NO;
+static BOOL af_json_request_operation_prefers_json_decoder = YES;
+static NSUInteger af_json_request_operation_processing_queue_count = 0;
+static dispatch_queue_t *af_json_request_operation_processing_queues = NULL;
+static JSONDecoder **af_json_request_operation_processing_decoders = NULL;
+static volatile int32_t *af_json_request_operation_processing_queue_depths = NULL;
+
+static volatile int64_t af_json_request_operation_processed_response_count = 0;
+static volatile int64_t af_json_request_operation_queue_wait_time = 0;
+static volatile int64_t af_json_request_operation_parse_time = 0;
+
+static NSUInteger json_request_operation_configured_processing_queue_count() {
+    NSUInteger count = af_json_request_operation_configured_processing_queue_count;
+    if (count == 0) {
+        count = MAX([[NSProcessInfo processInfo] activeProcessorCount], (NSUInteger)1);
+    }
+    
+    return count;
+}
+
+static void json_request_operation_processing_queues_initialize() {
+    static dispatch_once_t oncePredicate;
+    
+    dispatch_once(&oncePredicate, ^{
+        // The pool is sized once, and the count it was sized with is what bounds every loop over it, whatever is configured later
+        @synchronized([AFJSONRequestOperation class]) {
+            af_json_request_operation_processing_queue_count = json_request_operation_configured_processing_queue_count();
+            af_json_request_operation_processing_queues_initialized = YES;
+        }
+        
+        NSUInteger count = af_json_request_operation_processing_queue_count;
+        af_json_request_operation_processing_queues = calloc(count, sizeof(dispatch_queue_t));
+        af_json_request_operation_processing_decoders = calloc(count, sizeof(JSONDecoder *));
+        af_json_request_operation_processing_queue_depths = calloc(count, sizeof(int32_t));
+        
+        for (NSUInteger idx = 0; idx < count; idx++) {
+            af_json_request_operation_processing_queues[idx] = dispatch_queue_create([[NSString stringWithFormat:@"com.alamofire.json-request.processing-%lu", (unsigned long)idx] UTF8String], 0);
+            af_json_request_operation_processing_decoders[idx] = [[JSONDecoder alloc] init];
+        }
+    });
+}
+
+static NSUInteger json_request_operation_processing_queue_index() {
+    json_request_operation_processing_queues_initialize();
+    
+    NSUInteger leastLoadedIndex = 0;
+    for (NSUInteger idx = 1; idx < af_json_request_operation_processing_queue_count; idx++) {
+        if (af_json_request_operation_processing_queue_depths[idx] < af_json_request_operation_processing_queue_depths[leastLoadedIndex]) {
+            leastLoadedIndex = idx;
+        }
+    }
+    
+    return leastLoadedIndex;
+}
+
+static void json_request_operation_process_data(NSData *data, AFJSONProcessingCompletionBlock completion) {
+    NSUInteger idx = json_request_operation_processing_queue_index();
+    OSAtomicIncrement32Barrier(&af_json_request_operation_processing_queue_depths[idx]);
+    
+    uint64_t enqueueTime = mach_absolute_time();
+    dispatch_async(af_json_request_operation_processing_queues[idx], ^(void) {
+        uint64_t startTime = mach_absolute_time();
+        
+        id JSON = nil;
+        NSError *JSONError = nil;
+#if __IPHONE_OS_VERSION_MIN_REQUIRED > __IPHONE_4_3
+        if ([NSJSONSerialization class] && !af_json_request_operation_prefers_json_decoder) {
+            JSON = [NSJSONSerialization JSONObjectWithData:data options:0 error:&JSONError];
+        } else {
+            // Each processing queue has its own decoder, which is reused so that its cache of parsed keys and strings stays warm across responses
+            JSON = [af_json_request_operation_processing_decoders[idx] objectWithData:data error:&JSONError];
+        }
+#else
+        JSON = [af_json_request_operation_processing_decoders[idx] objectWithData:data error:&JSONError];
+#endif
+        
+        uint64_t endTime = mach_absolute_time();
+        OSAtomicDecrement32Barrier(&af_json_request_operation_processing_queue_depths[idx]);
+        OSAtomicIncrement64Barrier(&af_json_request_operation_processed_response_count);
+        OSAtomicAdd64Barrier((int64_t)(startTime - enqueueTime), &af_json_request_operation_queue_wait_time);
+        OSAtomicAdd64Barrier((int64_t)(endTime - startTime), &af_json_request_operation_parse_time);
+        
+        completion(JSON, JSONError);
+    });
+}
+
+static NSTimeInterval AFTimeIntervalFromMachAbsoluteTime(uint64_t absoluteTime) {
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    
+    return (NSTimeInterval)((absoluteTime * timebase.numer) / timebase.denom) / NSEC_PER_SEC;
+}
+
+#pragma mark -
+
+typedef enum {
+    AFJSONExpectRootState,
+    AFJSONExpectValueState,
+    AFJSONExpectValueOrArrayEndState,
+    AFJSONExpectKeyState,
+    AFJSONExpectKeyOrObjectEndState,
+    AFJSONExpectColonState,
+    AFJSONExpectCommaOrEndState,
+    AFJSONDoneState,
+} AFJSONStreamingParserState;
+
+typedef enum {
+    AFJSONNoToken,
+    AFJSONStringToken,
+    AFJSONStringEscapeToken,
+    AFJSONStringUnicodeEscapeToken,
+    AFJSONNumberToken,
+    AFJSONLiteralToken,
+} AFJSONStreamingParserTokenState;
+
+static inline BOOL AFJSONIsWhitespace(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static inline void AFJSONAppendUnicodeCodePoint(NSMutableData *buffer, uint32_t codePoint) {
+    uint8_t bytes[4];
+    NSUInteger length = 0;
+    if (codePoint < 0x80) {
+        bytes[length++] = (uint8_t)codePoint;
+    } else if (codePoint < 0x800) {
+        bytes[length++] = (uint8_t)(0xC0 | (codePoint >> 6));
+        bytes[length++] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        bytes[length++] = (uint8_t)(0xE0 | (codePoint >> 12));
+        bytes[length++] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        bytes[length++] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    } else {
+        bytes[length++] = (uint8_t)(0xF0 | (codePoint >> 18));
+        bytes[length++] = (uint8_t)(0x80 | ((codePoint >> 12) & 0x3F));
+        bytes[length++] = (uint8_t)(0x80 | ((codePoint >> 6) & 0x3F));
+        bytes[length++] = (uint8_t)(0x80 | (codePoint & 0x3F));
+    }
+    
+    [buffer appendBytes:bytes length:length];
+}
+
+/**
+ `AFJSONStreamingParser` is a resumable JSON parser, which builds an object graph from data that is appended to it in arbitrarily-sized chunks, such as those received by `transportConnection:didReceiveData:`.
+ */
+@interface AFJSONStreamingParser : NSObject {
+@private
+    AFJSONStreamingParserState _state;
+    AFJSONStreamingParserTokenState _tokenState;
+    BOOL _parsingKey;
+    NSMutableData *_tokenBuffer;
+    uint32_t _unicodeEscape;
+    NSUInteger _unicodeEscapeLength;
+    uint32_t _highSurrogate;
+    NSMutableArray *_containers;
+    NSMutableArray *_keys;
+    id _rootObject;
+    NSUInteger _offset;
+    BOOL _receivedData;
+    NSError *_error;
+}
+
+@property (readonly, nonatomic, retain) NSError *error;
+@property (readonly, nonatomic, assign, getter = hasReceivedData) BOOL receivedData;
+
+- (BOOL)appendData:(NSData *)data;
+- (id)finishParsing:(NSError **)error;
+
+@end
+
+@interface AFJSONStreamingParser ()
+@property (readwrite, nonatomic, retain) id rootObject;
+@property (readwrite, nonatomic, retain) NSError *error;
+
+- (void)failWithDescription:(NSString *)description atIndex:(NSUInteger)idx;
+- (void)addValue:(id)value;
+- (void)openContainer:(id)container;
+- (BOOL)closeContainerOfClass:(Class)containerClass;
+- (BOOL)finishStringToken;
+- (BOOL)finishNumberToken;
+- (BOOL)finishLiteralToken;
+- (void)flushHighSurrogate;
+@end
+
+@implementation AFJSONStreamingParser
+@synthesize rootObject = _rootObject;
+@synthesize error = _error;
+@synthesize receivedData = _receivedData;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    _state = AFJSONExpectRootState;
+    _tokenState = AFJSONNoToken;
+    _tokenBuffer = [[NSMutableData alloc] initWithCapacity:64];
+    _containers = [[NSMutableArray alloc] init];
+    _keys = [[NSMutableArray alloc] init];
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_tokenBuffer release];
+    [_containers release];
+    [_keys release];
+    [_rootObject release];
+    [_error release];
+    [super dealloc];
+}
+
+- (void)failWithDescription:(NSString *)description atIndex:(NSUInteger)idx {
+    NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+    [userInfo setValue:[NSString stringWithFormat:NSLocalizedString(@"%@ at offset %lu", nil), description, (unsigned long)(_offset + idx)] forKey:NSLocalizedDescriptionKey];
+    
+    self.error = [[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorCannotDecodeContentData userInfo:userInfo] autorelease];
+}
+
+- (void)addValue:(id)value {
+    id container = [_containers lastObject];
+    if ([container isKindOfClass:[NSMutableDictionary class]]) {
+        [container setObject:value forKey:[_keys lastObject]];
+        [_keys removeLastObject];
+    } else {
+        [container addObject:value];
+    }
+    
+    _state = AFJSONExpectCommaOrEndState;
+}
+
+- (void)openContainer:(id)container {
+    if ([_containers count] == 0) {
+        self.rootObject = container;
+    } else {
+        [self addValue:container];
+    }
+    
+    [_containers addObject:container];
+    _state = [container isKindOfClass:[NSMutableDictionary class]] ? AFJSONExpectKeyOrObjectEndState : AFJSONExpectValueOrArrayEndState;
+}
+
+- (BOOL)closeContainerOfClass:(Class)containerClass {
+    if (![[_containers lastObject] isKindOfClass:containerClass]) {
+        return NO;
+    }
+    
+    [_containers removeLastObject];
+    _state = [_containers count] == 0 ? AFJSONDoneState : AFJSONExpectCommaOrEndState;
+    
+    return YES;
+}
+
+- (void)flushHighSurrogate {
+    if (_highSurrogate) {
+        AFJSONAppendUnicodeCodePoint(_tokenBuffer, 0xFFFD);
+        _highSurrogate = 0;
+    }
+}
+
+- (BOOL)finishStringToken {
+    [self flushHighSurrogate];
+    
+    NSString *string = [[NSString alloc] initWithData:_tokenBuffer encoding:NSUTF8StringEncoding];
+    if (!string) {
+        return NO;
+    }
+    
+    if (_parsingKey) {
+        [_keys addObject:string];
+        _state = AFJSONExpectColonState;
+    } else {
+        [self addValue:string];
     }
     
-    return af_json_request_operation_processing_queue;
+    [string release];
+    
+    return YES;
+}
+
+- (BOOL)finishNumberToken {
+    [_tokenBuffer appendBytes:"\0" length:1];
+    const char *numberString = [_tokenBuffer bytes];
+    char *end = NULL;
+    NSNumber *number = nil;
+    
+    if (strpbrk(numberString, ".eE") == NULL) {
+        errno = 0;
+        long long integerValue = strtoll(numberString, &end, 10);
+        if (errno != ERANGE && *end == '\0') {
+            number = [NSNumber numberWithLongLong:integerValue];
+        }
+    }
+    
+    if (!number) {
+        double doubleValue = strtod(numberString, &end);
+        if (*end != '\0') {
+            return NO;
+        }
+        
+        number = [NSNumber numberWithDouble:doubleValue];
+    }
+    
+    [self addValue:number];
+    
+    return YES;
+}
+
+- (BOOL)finishLiteralToken {
+    NSUInteger length = [_tokenBuffer length];
+    const char *literal = [_tokenBuffer bytes];
+    
+    if (length == 4 && strncmp(literal, "true", 4) == 0) {
+        [self addValue:[NSNumber numberWithBool:YES]];
+    } else if (length == 5 && strncmp(literal, "false", 5) == 0) {
+        [self addValue:[NSNumber numberWithBool:NO]];
+    } else if (length == 4 && strncmp(literal, "null", 4) == 0) {
+        [self addValue:[NSNull null]];
+    } else {
+        return NO;
+    }
+    
+    return YES;
+}
+
+- (BOOL)appendData:(NSData *)data {
+    if (self.error) {
+        return NO;
+    }
+    
+    const uint8_t *bytes = [data bytes];
+    NSUInteger length = [data length];
+    NSUInteger idx = 0;
+    
+    if (length > 0) {
+        _receivedData = YES;
+    }
+    
+    while (idx < length) {
+        uint8_t c = bytes[idx];
+        
+        switch (_tokenState) {
+            case AFJSONStringToken: {
+                NSUInteger start = idx;
+                while (idx < length && bytes[idx] != '"' && bytes[idx] != '\\' && bytes[idx] >= 0x20) {
+                    idx++;
+                }
+                
+                if (idx > start) {
+                    [self flushHighSurrogate];
+                    [_tokenBuffer appendBytes:&bytes[start] length:idx - start];
+                }
+                
+                if (idx == length) {
+                    break;
+                }
+                
+                c = bytes[idx];
+                if (c == '"') {
+                    _tokenState = AFJSONNoToken;
+                    if (![self finishStringToken]) {
+                        [self failWithDescription:NSLocalizedString(@"Invalid UTF-8 in string", nil) atIndex:idx];
+                        return NO;
+                    }
+                } else if (c == '\\') {
+                    _tokenState = AFJSONStringEscapeToken;
+                } else {
+                    [self failWithDescription:NSLocalizedString(@"Unescaped control character in string", nil) atIndex:idx];
+                    return NO;
+                }
+                
+                idx++;
+                break;
+            }
+            case AFJSONStringEscapeToken: {
+                char unescaped = 0;
+                switch (c) {
+                    case '"':   unescaped = '"';    break;
+                    case '\\':  unescaped = '\\';   break;
+                    case '/':   unescaped = '/';    break;
+                    case 'b':   unescaped = '\b';   break;
+                    case 'f':   unescaped = '\f';   break;
+                    case 'n':   unescaped = '\n';   break;
+                    case 'r':   unescaped = '\r';   break;
+                    case 't':   unescaped = '\t';   break;
+                    case 'u':
+                        _unicodeEscape = 0;
+                        _unicodeEscapeLength = 0;
+                        _tokenState = AFJSONStringUnicodeEscapeToken;
+                        break;
+                    default:
+                        [self failWithDescription:NSLocalizedString(@"Invalid escape sequence in string", nil) atIndex:idx];
+                        return NO;
+                }
+                
+                if (unescaped) {
+                    [self flushHighSurrogate];
+                    [_tokenBuffer appendBytes:&unescaped length:1];
+                    _tokenState = AFJSONStringToken;
+                }
+                
+                idx++;
+                break;
+            }
+            case AFJSONStringUnicodeEscapeToken: {
+                uint32_t digit;
+                if (c >= '0' && c <= '9') {
+                    digit = c - '0';
+                } else if (c >= 'a' && c <= 'f') {
+                    digit = c - 'a' + 10;
+                } else if (c >= 'A' && c <= 'F') {
+                    digit = c - 'A' + 10;
+                } else {
+                    [self failWithDescription:NSLocalizedString(@"Invalid unicode escape sequence in string", nil) atIndex:idx];
+                    return NO;
+                }
+                
+                _unicodeEscape = (_unicodeEscape << 4) | digit;
+                if (++_unicodeEscapeLength == 4) {
+                    if (_unicodeEscape >= 0xD800 && _unicodeEscape <= 0xDBFF) {
+                        [self flushHighSurrogate];
+                        _highSurrogate = _unicodeEscape;
+                    } else if (_unicodeEscape >= 0xDC00 && _unicodeEscape <= 0xDFFF) {
+                        if (_highSurrogate) {
+                            AFJSONAppendUnicodeCodePoint(_tokenBuffer, 0x10000 + ((_highSurrogate - 0xD800) << 10) + (_unicodeEscape - 0xDC00));
+                            _highSurrogate = 0;
+                        } else {
+                            AFJSONAppendUnicodeCodePoint(_tokenBuffer, 0xFFFD);
+                        }
+                    } else {
+                        [self flushHighSurrogate];
+                        AFJSONAppendUnicodeCodePoint(_tokenBuffer, _unicodeEscape);
+                    }
+                    
+                    _tokenState = AFJSONStringToken;
+                }
+                
+                idx++;
+                break;
+            }
+            case AFJSONNumberToken:
+            case AFJSONLiteralToken: {
+                BOOL isNumber = _tokenState == AFJSONNumberToken;
+                NSUInteger start = idx;
+                if (isNumber) {
+                    while (idx < length && ((bytes[idx] >= '0' && bytes[idx] <= '9') || bytes[idx] == '-' || bytes[idx] == '+' || bytes[idx] == '.' || bytes[idx] == 'e' || bytes[idx] == 'E')) {
+                        idx++;
+                    }
+                } else {
+                    while (idx < length && bytes[idx] >= 'a' && bytes[idx] <= 'z') {
+                        idx++;
+                    }
+                }
+                
+                if (idx > start) {
+                    [_tokenBuffer appendBytes:&bytes[start] length:idx - start];
+                }
+                
+                if (idx == length) {
+                    break;
+                }
+                
+                _tokenState = AFJSONNoToken;
+                if (!(isNumber ? [self finishNumberToken] : [self finishLiteralToken])) {
+                    [self failWithDescription:(isNumber ? NSLocalizedString(@"Invalid number", nil) : NSLocalizedString(@"Invalid literal", nil)) atIndex:idx];
+                    return NO;
+                }
+                
+                break;
+            }
+            case AFJSONNoToken:
+            default: {
+                if (AFJSONIsWhitespace(c)) {
+                    idx++;
+                    break;
+                }
+                
+                BOOL expectsValue = (_state == AFJSONExpectValueState || _state == AFJSONExpectValueOrArrayEndState);
+                BOOL expectsKey = (_state == AFJSONExpectKeyState || _state == AFJSONExpectKeyOrObjectEndState);
+                BOOL isValid = YES;
+                
+                switch (c) {
+                    case '{':
+                        isValid = expectsValue || _state == AFJSONExpectRootState;
+                        if (isValid) {
+                            [self openContainer:[NSMutableDictionary dictionary]];
+                        }
+                        break;
+                    case '[':
+                        isValid = expectsValue || _state == AFJSONExpectRootState;
+                        if (isValid) {
+                            [self openContainer:[NSMutableArray array]];
+                        }
+                        break;
+                    case '}':
+                        isValid = (_state == AFJSONExpectKeyOrObjectEndState || _state == AFJSONExpectCommaOrEndState) && [self closeContainerOfClass:[NSMutableDictionary class]];
+                        break;
+                    case ']':
+                        isValid = (_state == AFJSONExpectValueOrArrayEndState || _state == AFJSONExpectCommaOrEndState) && [self closeContainerOfClass:[NSMutableArray class]];
+                        break;
+                    case ',':
+                        isValid = _state == AFJSONExpectCommaOrEndState;
+                        if (isValid) {
+                            _state = [[_containers lastObject] isKindOfClass:[NSMutableDictionary class]] ? AFJSONExpectKeyState : AFJSONExpectValueState;
+                        }
+                        break;
+                    case ':':
+                        isValid = _state == AFJSONExpectColonState;
+                        if (isValid) {
+                            _state = AFJSONExpectValueState;
+                        }
+                        break;
+                    case '"':
+                        isValid = expectsValue || expectsKey;
+                        if (isValid) {
+                            _parsingKey = expectsKey;
+                            [_tokenBuffer setLength:0];
+                            _tokenState = AFJSONStringToken;
+                        }
+                        break;
+                    default:
+                        isValid = expectsValue && ((c >= '0' && c <= '9') || c == '-' || c == 't' || c == 'f' || c == 'n');
+                        if (isValid) {
+                            [_tokenBuffer setLength:0];
+                            _tokenState = (c == 't' || c == 'f' || c == 'n') ? AFJSONLiteralToken : AFJSONNumberToken;
+                            continue;
+                        }
+                        break;
+                }
+                
+                if (!isValid) {
+                    [self failWithDescription:[NSString stringWithFormat:NSLocalizedString(@"Unexpected character '%c'", nil), c] atIndex:idx];
+                    return NO;
+                }
+                
+                idx++;
+                break;
+            }
+        }
+    }
+    
+    _offset += length;
+    
+    return YES;
+}
+
+- (id)finishParsing:(NSError **)error {
+    if (!self.error && _state != AFJSONDoneState) {
+        [self failWithDescription:NSLocalizedString(@"Unexpected end of data", nil) atIndex:0];
+    }
+    
+    if (self.error) {
+        if (error) {
+            *error = self.error;
+        }
+        
+        return nil;
+    }
+    
+    return self.rootObject;
+}
+
+@end
+
+#pragma mark -
+
+// A streamed response is parsed on a single processing queue, picked when its headers arrive, so that its chunks are appended in order. Each chunk counts towards the depth of the queue until it has been parsed.
+static void json_request_operation_append_streamed_data(NSUInteger idx, AFJSONStreamingParser *streamingParser, NSData *data) {
+    OSAtomicIncrement32Barrier(&af_json_request_operation_processing_queue_depths[idx]);
+    
+    dispatch_async(af_json_request_operation_processing_queues[idx], ^(void) {
+        uint64_t startTime = mach_absolute_time();
+        [streamingParser appendData:data];
+        
+        uint64_t endTime = mach_absolute_time();
+        OSAtomicDecrement32Barrier(&af_json_request_operation_processing_queue_depths[idx]);
+        OSAtomicAdd64Barrier((int64_t)(endTime - startTime), &af_json_request_operation_parse_time);
+    });
+}
+
+static void json_request_operation_finish_streamed_data(NSUInteger idx, AFJSONStreamingParser *streamingParser, AFJSONProcessingCompletionBlock completion) {
+    OSAtomicIncrement32Barrier(&af_json_request_operation_processing_queue_depths[idx]);
+    
+    uint64_t enqueueTime = mach_absolute_time();
+    dispatch_async(af_json_request_operation_processing_queues[idx], ^(void) {
+        uint64_t startTime = mach_absolute_time();
+        
+        // An empty body has no JSON object, as when it is parsed all at once
+        id JSON = nil;
+        NSError *JSONError = nil;
+        if ([streamingParser hasReceivedData]) {
+            JSON = [streamingParser finishParsing:&JSONError];
+        }
+        
+        uint64_t endTime = mach_absolute_time();
+        OSAtomicDecrement32Barrier(&af_json_request_operation_processing_queue_depths[idx]);
+        OSAtomicIncrement64Barrier(&af_json_request_operation_processed_response_count);
+        OSAtomicAdd64Barrier((int64_t)(startTime - enqueueTime), &af_json_request_operation_queue_wait_time);
+        OSAtomicAdd64Barrier((int64_t)(endTime - startTime), &af_json_request_operation_parse_time);
+        
+        completion(JSON, JSONError);
+    });
+}
+
+#pragma mark -
+
+@interface AFJSONRequestOperation ()
+@property (readwrite, nonatomic, retain) AFJSONStreamingParser *streamingParser;
+@property (readwrite, nonatomic, assign) NSUInteger processingQueueIndex;
+@end
+
+static NSError * AFJSONResponseValidationError(NSURLRequest *request, NSHTTPURLResponse *response, NSIndexSet *acceptableStatusCodes, NSSet *acceptableContentTypes) {
+    NSError *error = nil;
+    
+    if (acceptableStatusCodes && ![acceptableStatusCodes containsIndex:[response statusCode]]) {
+        NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+        [userInfo setValue:[NSString stringWithFormat:NSLocalizedString(@"Expected status code %@, got %ld", nil), acceptableStatusCodes, (long)[response statusCode]] forKey:NSLocalizedDescriptionKey];
+        [userInfo setValue:[request URL] forKey:NSURLErrorFailingURLErrorKey];
+        
+        error = [[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorBadServerResponse userInfo:userInfo] autorelease];
+    }
+    
+    if (acceptableContentTypes && ![acceptableContentTypes containsObject:[response MIMEType]]) {
+        NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
+        [userInfo setValue:[NSString stringWithFormat:NSLocalizedString(@"Expected content type %@, got %@", nil), acceptableContentTypes, [response MIMEType]] forKey:NSLocalizedDescriptionKey];
+        [userInfo setValue:[request URL] forKey:NSURLErrorFailingURLErrorKey];
+        
+        error = [[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorCannotDecodeContentData userInfo:userInfo] autorelease];
+    }
+    
+    return error;
 }
 
 @implementation AFJSONRequestOperation
+@synthesize parsesJSONIncrementally = _parsesJSONIncrementally;
+@synthesize streamingParser = _streamingParser;
+@synthesize processingQueueIndex = _processingQueueIndex;
 
 + (AFJSONRequestOperation *)operationWithRequest:(NSURLRequest *)urlRequest                
                                          success:(void (^)(id JSON))success
@@ -63,50 +704,31 @@ static dispatch_queue_t json_request_operation_processing_queue() {
                                          success:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, id JSON))success
                                          failure:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error))failure
 {
-    return (AFJSONRequestOperation *)[self operationWithRequest:urlRequest completion:^(NSURLRequest *request, NSHTTPURLResponse *response, NSData *data, NSError *error) {        
-        if (!error) {
-            if (acceptableStatusCodes && ![acceptableStatusCodes containsIndex:[response statusCode]]) {
-                NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
-                [userInfo setValue:[NSString stringWithFormat:NSLocalizedString(@"Expected status code %@, got %d", nil), acceptableStatusCodes, [response statusCode]] forKey:NSLocalizedDescriptionKey];
-                [userInfo setValue:[request URL] forKey:NSURLErrorFailingURLErrorKey];
-                
-                error = [[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorBadServerResponse userInfo:userInfo] autorelease];
-            }
-            
-            if (acceptableContentTypes && ![acceptableContentTypes containsObject:[response MIMEType]]) {
-                NSMutableDictionary *userInfo = [NSMutableDictionary dictionary];
-                [userInfo setValue:[NSString stringWithFormat:NSLocalizedString(@"Expected content type %@, got %@", nil), acceptableContentTypes, [response MIMEType]] forKey:NSLocalizedDescriptionKey];
-                [userInfo setValue:[request URL] forKey:NSURLErrorFailingURLErrorKey];
-                
-                error = [[[NSError alloc] initWithDomain:AFNetworkingErrorDomain code:NSURLErrorCannotDecodeContentData userInfo:userInfo] autorelease];
-            }
-        }
+    __block AFJSONRequestOperation *operation = nil;
+    operation = (AFJSONRequestOperation *)[self operationWithRequest:urlRequest completion:^(NSURLRequest *request, NSHTTPURLResponse *response, NSData *data, NSError *error) {        
+        // Retained by the blocks below, so that timing points can be marked after the operation has been released by its queue
+        AFJSONRequestOperation *timedOperation = operation;
+        [timedOperation markTimingPoint:AFHTTPRequestOperationProcessingStartedTimingPoint];
         
-        if (error) {
-            if (failure) {
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    failure(request, response, error);
-                });
-            }
-        } else if ([data length] == 0) {
-            if (success) {
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    success(request, response, nil);
-                });
-            }
-        } else {
-            dispatch_async(json_request_operation_processing_queue(), ^(void) {
-                id JSON = nil;
-                NSError *JSONError = nil;
-#if __IPHONE_OS_VERSION_MIN_REQUIRED > __IPHONE_4_3
-                if ([NSJSONSerialization class]) {
-                    JSON = [NSJSONSerialization JSONObjectWithData:data options:0 error:&JSONError];
+        // The body of a response that was parsed as it arrived is not kept, so only the parser knows whether there was one
+        if (error || (!operation.streamingParser && [data length] == 0)) {
+            [timedOperation markTimingPoint:AFHTTPRequestOperationProcessingFinishedTimingPoint];
+            dispatch_async(dispatch_get_main_queue(), ^{
+                if (error) {
+                    if (failure) {
+                        failure(request, response, error);
+                    }
                 } else {
-                    JSON = [[JSONDecoder decoder] objectWithData:data error:&JSONError];
+                    if (success) {
+                        success(request, response, nil);
+                    }
                 }
-#else
-                JSON = [[JSONDecoder decoder] objectWithData:data error:&JSONError];
-#endif
+                
+                [timedOperation markTimingPoint:AFHTTPRequestOperationDeliveredTimingPoint];
+            });
+        } else if (operation.streamingParser) {
+            json_request_operation_finish_streamed_data(operation.processingQueueIndex, operation.streamingParser, ^(id JSON, NSError *JSONError) {
+                [timedOperation markTimingPoint:AFHTTPRequestOperationProcessingFinishedTimingPoint];
                 
                 dispatch_async(dispatch_get_main_queue(), ^(void) {
                     if (JSONError) {
@@ -118,12 +740,149 @@ static dispatch_queue_t json_request_operation_processing_queue() {
                             success(request, response, JSON);
                         }
                     }
+                    
+                    [timedOperation markTimingPoint:AFHTTPRequestOperationDeliveredTimingPoint];
+                });
+            });
+        } else {
+            json_request_operation_process_data(data, ^(id JSON, NSError *JSONError) {
+                [timedOperation markTimingPoint:AFHTTPRequestOperationProcessingFinishedTimingPoint];
+                
+                dispatch_async(dispatch_get_main_queue(), ^(void) {
+                    if (JSONError) {
+                        if (failure) {
+                            failure(request, response, JSONError);
+                        }
+                    } else {
+                        if (success) {
+                            success(request, response, JSON);
+                        }
+                    }
+                    
+                    [timedOperation markTimingPoint:AFHTTPRequestOperationDeliveredTimingPoint];
                 });
             });
         }
     }];
+    
+    // Unacceptable responses are rejected as soon as their headers arrive, rather than after their body has been downloaded
+    [operation setResponseValidationBlock:^NSError *(NSURLRequest *request, NSHTTPURLResponse *response) {
+        return AFJSONResponseValidationError(request, response, acceptableStatusCodes, acceptableContentTypes);
+    }];
+    
+    return operation;
+}
+
++ (NSUInteger)numberOfJSONProcessingQueues {
+    @synchronized([AFJSONRequestOperation class]) {
+        if (af_json_request_operation_processing_queues_initialized) {
+            return af_json_request_operation_processing_queue_count;
+        }
+        
+        return json_request_operation_configured_processing_queue_count();
+    }
+}
+
++ (void)setNumberOfJSONProcessingQueues:(NSUInteger)numberOfQueues {
+    @synchronized([AFJSONRequestOperation class]) {
+        if (af_json_request_operation_processing_queues_initialized) {
+            return;
+        }
+        
+        af_json_request_operation_configured_processing_queue_count = numberOfQueues;
+    }
+}
+
++ (BOOL)prefersJSONDecoder {
+    return af_json_request_operation_prefers_json_decoder;
 }
 
++ (void)setPrefersJSONDecoder:(BOOL)prefersJSONDecoder {
+    af_json_request_operation_prefers_json_decoder = prefersJSONDecoder;
+}
+
++ (NSDictionary *)JSONProcessingStatistics {
+    json_request_operation_processing_queues_initialize();
+    
+    __block unsigned long long cacheHitCount = 0, cacheMissCount = 0;
+    for (NSUInteger idx = 0; idx < af_json_request_operation_processing_queue_count; idx++) {
+        // Each decoder is only used on its own queue, so its counts are read there too
+        dispatch_sync(af_json_request_operation_processing_queues[idx], ^(void) {
+            JSONDecoder *decoder = af_json_request_operation_processing_decoders[idx];
+            if ([decoder respondsToSelector:@selector(cacheHitCount)] && [decoder respondsToSelector:@selector(cacheMissCount)]) {
+                cacheHitCount += [[decoder valueForKey:@"cacheHitCount"] unsignedLongLongValue];
+                cacheMissCount += [[decoder valueForKey:@"cacheMissCount"] unsignedLongLongValue];
+            }
+        });
+    }
+    
+    NSMutableDictionary *mutableStatistics = [NSMutableDictionary dictionaryWithCapacity:5];
+    [mutableStatistics setValue:[NSNumber numberWithLongLong:af_json_request_operation_processed_response_count] forKey:AFJSONProcessingResponseCountKey];
+    [mutableStatistics setValue:[NSNumber numberWithDouble:AFTimeIntervalFromMachAbsoluteTime(af_json_request_operation_queue_wait_time)] forKey:AFJSONProcessingQueueWaitTimeKey];
+    [mutableStatistics setValue:[NSNumber numberWithDouble:AFTimeIntervalFromMachAbsoluteTime(af_json_request_operation_parse_time)] forKey:AFJSONProcessingParseTimeKey];
+    [mutableStatistics setValue:[NSNumber numberWithUnsignedLongLong:cacheHitCount] forKey:AFJSONProcessingDecoderCacheHitCountKey];
+    [mutableStatistics setValue:[NSNumber numberWithUnsignedLongLong:cacheMissCount] forKey:AFJSONProcessingDecoderCacheMissCountKey];
+    
+    return mutableStatistics;
+}
+
++ (void)prewarmJSONProcessingQueues {
+    json_request_operation_processing_queues_initialize();
+    
+    NSData *data = [@"{\"prewarm\":[true,0,\"\"]}" dataUsingEncoding:NSUTF8StringEncoding];
+    for (NSUInteger idx = 0; idx < af_json_request_operation_processing_queue_count; idx++) {
+        dispatch_async(af_json_request_operation_processing_queues[idx], ^(void) {
+#if __IPHONE_OS_VERSION_MIN_REQUIRED > __IPHONE_4_3
+            if ([NSJSONSerialization class] && !af_json_request_operation_prefers_json_decoder) {
+                [NSJSONSerialization JSONObjectWithData:data options:0 error:nil];
+            } else {
+                // A throwaway decoder warms up the parser without counting towards the queue's decoder cache statistics
+                [[JSONDecoder decoder] objectWithData:data error:nil];
+            }
+#else
+            [[JSONDecoder decoder] objectWithData:data error:nil];
+#endif
+        });
+    }
+}
+
+- (void)dealloc {
+    [_streamingParser release];
+    [super dealloc];
+}
+
+#pragma mark - AFHTTPTransportConnectionDelegate
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)connection 
+         didReceiveResponse:(NSHTTPURLResponse *)response 
+{
+    [super transportConnection:connection didReceiveResponse:response];
+    
+    if ([self isFinished]) {
+        return;
+    }
+    
+    // Responses revalidated from the cache have no body to parse incrementally
+    if (self.parsesJSONIncrementally && !self.cachedResponse) {
+        self.streamingParser = [[[AFJSONStreamingParser alloc] init] autorelease];
+        self.processingQueueIndex = json_request_operation_processing_queue_index();
+    }
+}
+
+- (BOOL)accumulatesResponseBody {
+    return !self.streamingParser;
+}
+
+- (void)didReceiveResponseBodyData:(NSData *)data {
+    [super didReceiveResponseBodyData:data];
+    
+    if (self.streamingParser && ![self isFinished]) {
+        json_request_operation_append_streamed_data(self.processingQueueIndex, self.streamingParser, [[data copy] autorelease]);
+    }
+}
+
+#pragma mark -
+
 + (NSIndexSet *)defaultAcceptableStatusCodes {
     return [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(200, 100)];
 }
@@ -0,0 +1,67 @@
+// AFSegmentedData.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import <Foundation/Foundation.h>
+
+/**
+ `AFSegmentedData` is an immutable `NSData` subclass backed by an ordered list of data segments, such as the chunks received over the course of an `NSURLConnection`. 
+ 
+ @discussion The segments are retained rather than copied into a single buffer as they arrive. A contiguous representation is created lazily, the first time `bytes` is called, and is cached from then on. Methods such as `getBytes:range:` and `enumerateSegmentsUsingBlock:` read directly from the segments, so consumers that can work on segmented input never incur a copy.
+ */
+@interface AFSegmentedData : NSData {
+@private
+    NSArray *_segments;
+    NSUInteger _length;
+    NSData *_contiguousData;
+}
+
+/**
+ The `NSData` segments that make up the receiver, in order.
+ */
+@property (readonly, nonatomic, retain) NSArray *segments;
+
+/**
+ Creates and returns a data object backed by the specified segments. If `segments` contains a single object, that object is returned directly.
+ 
+ @param segments An array of `NSData` objects.
+ 
+ @return A data object with the contents of the specified segments.
+ */
++ (NSData *)dataWithSegments:(NSArray *)segments;
+
+/**
+ Initializes a segmented data object with the specified segments.
+ 
+ @param segments An array of `NSData` objects. Each segment is retained; its bytes are not copied.
+ 
+ @return The newly-initialized segmented data object
+ */
+- (id)initWithSegments:(NSArray *)segments;
+
+/**
+ Executes a given block with each segment in the receiver, in order.
+ 
+ @param block The block to apply to each segment. This block has no return value and takes three arguments: the segment, the range of the segment within the receiver, and a reference to a Boolean value, which may be set to `YES` to stop further processing of the segments.
+ */
+- (void)enumerateSegmentsUsingBlock:(void (^)(NSData *segment, NSRange range, BOOL *stop))block;
+
+@end
@@ -0,0 +1,117 @@
+// AFSegmentedData.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#import "AFSegmentedData.h"
+
+@interface AFSegmentedData ()
+@property (readwrite, nonatomic, retain) NSArray *segments;
+@property (readwrite, nonatomic, assign) NSUInteger length;
+@property (readwrite, nonatomic, retain) NSData *contiguousData;
+@end
+
+@implementation AFSegmentedData
+@synthesize segments = _segments;
+@synthesize length = _length;
+@synthesize contiguousData = _contiguousData;
+
++ (NSData *)dataWithSegments:(NSArray *)segments {
+    if ([segments count] == 1) {
+        return [segments lastObject];
+    }
+    
+    return [[[self alloc] initWithSegments:segments] autorelease];
+}
+
+- (id)initWithSegments:(NSArray *)segments {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.segments = [NSArray arrayWithArray:segments];
+    
+    NSUInteger length = 0;
+    for (NSData *segment in self.segments) {
+        length += [segment length];
+    }
+    self.length = length;
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_segments release];
+    [_contiguousData release];
+    [super dealloc];
+}
+
+- (void)enumerateSegmentsUsingBlock:(void (^)(NSData *segment, NSRange range, BOOL *stop))block {
+    NSUInteger location = 0;
+    BOOL stop = NO;
+    for (NSData *segment in self.segments) {
+        block(segment, NSMakeRange(location, [segment length]), &stop);
+        if (stop) {
+            break;
+        }
+        
+        location += [segment length];
+    }
+}
+
+#pragma mark - NSData
+
+- (const void *)bytes {
+    @synchronized(self) {
+        if (!self.contiguousData) {
+            NSMutableData *mutableData = [NSMutableData dataWithLength:self.length];
+            [self getBytes:[mutableData mutableBytes] range:NSMakeRange(0, self.length)];
+            self.contiguousData = mutableData;
+        }
+    }
+    
+    return [self.contiguousData bytes];
+}
+
+- (void)getBytes:(void *)buffer range:(NSRange)range {
+    if (NSMaxRange(range) > self.length) {
+        [NSException raise:NSRangeException format:@"%@ is out of bounds for data of length %lu", NSStringFromRange(range), (unsigned long)self.length];
+    }
+    
+    __block uint8_t *destination = (uint8_t *)buffer;
+    [self enumerateSegmentsUsingBlock:^(NSData *segment, NSRange segmentRange, BOOL *stop) {
+        NSRange intersection = NSIntersectionRange(segmentRange, range);
+        if (intersection.length > 0) {
+            [segment getBytes:destination range:NSMakeRange(intersection.location - segmentRange.location, intersection.length)];
+            destination += intersection.length;
+        }
+        
+        if (NSMaxRange(segmentRange) >= NSMaxRange(range)) {
+            *stop = YES;
+        }
+    }];
+}
+
+- (void)getBytes:(void *)buffer length:(NSUInteger)length {
+    [self getBytes:buffer range:NSMakeRange(0, MIN(length, self.length))];
+}
+
+@end
@@ -22,6 +22,7 @@
 
 #import <UIKit/UIKit.h>
 #import "AFImageRequestOperation.h"
+#import "AFHTTPOperationScheduler.h"
 
 /**
  This category adds methods to the UIKit framework's `UIImageView` class. The methods in this category provide support for loading remote images asynchronously from a URL.
@@ -53,7 +54,7 @@
  
  @param urlRequest The url request used for the image request.
  @param placeholderImage The image to be set initially, until the image request finishes. If `nil`, the image view will not change its image until the image request finishes.
- @param success A block to be executed when the image request operation finishes successfully, with a status code in the 2xx range, and with an acceptable content type (e.g. `image/png`). This block has no return value and takes three arguments, the request sent from the client, the response received from the server, and the image created from the response data of request. If the image was returned from cache, the request and response parameters will be `nil`.
+ @param success A block to be executed when the image request operation finishes successfully, with a status code in the 2xx range, and with an acceptable content type (e.g. `image/png`). This block has no return value and takes three arguments, the request sent from the client, the response received from the server, and the image created from the response data of request. If the image was returned from the memory or disk cache, the response parameter will be `nil`.
  @param failure A block object to be executed when the image request operation finishes unsuccessfully, or that finishes successfully. This block has no return value and takes three arguments, the request sent from the client, the response received from the server, and the error object describing the network or parsing error that occurred.
  
  @discussion By default, url requests have a cache policy of `NSURLCacheStorageAllowed` and a timeout interval of 30 seconds, and are set to use HTTP pipelining, and not handle cookies. To configure url requests differently, use `setImageWithURLRequest:placeholderImage:success:failure:` 
@@ -71,4 +72,11 @@
 
 - (void)cancelImageRequestOperation;
 
+/**
+ Changes the priority class of the image view's image request operation, if it has not yet started. Image requests are enqueued with `AFHTTPRequestNormalPriority`, on the same scheduler as `AFHTTPClient` operations.
+ 
+ @param priority The new priority class, such as `AFHTTPRequestInteractivePriority` when the image view's cell scrolls into view, or `AFHTTPRequestPrefetchPriority` when it scrolls out of view.
+ */
+- (void)setImageRequestPriority:(AFHTTPRequestPriority)priority;
+
 @end
@@ -26,15 +26,26 @@
 #import "UIImageView+AFNetworking.h"
 
 #import "AFImageCache.h"
+#import "AFHTTPRequestCoalescer.h"
 
 static NSString * const kAFImageRequestOperationObjectKey = @"_af_imageRequestOperation";
+static NSString * const kAFImageRequestHandlerObjectKey = @"_af_imageRequestHandler";
+static NSString * const kAFImageDiskLookupURLObjectKey = @"_af_imageDiskLookupURL";
+
+typedef void (^AFImageRequestHandler)(NSURLRequest *request, NSHTTPURLResponse *response, UIImage *image, NSError *error);
 
 @interface UIImageView (_AFNetworking)
 @property (readwrite, nonatomic, retain, setter = af_setImageRequestOperation:) AFImageRequestOperation *af_imageRequestOperation;
+@property (readwrite, nonatomic, copy, setter = af_setImageRequestHandler:) AFImageRequestHandler af_imageRequestHandler;
+@property (readwrite, nonatomic, retain, setter = af_setImageDiskLookupURL:) NSURL *af_imageDiskLookupURL;
+
+- (void)af_loadImageWithURLRequest:(NSURLRequest *)urlRequest;
 @end
 
 @implementation UIImageView (_AFNetworking)
 @dynamic af_imageRequestOperation;
+@dynamic af_imageRequestHandler;
+@dynamic af_imageDiskLookupURL;
 @end
 
 #pragma mark -
@@ -49,15 +60,30 @@ static NSString * const kAFImageRequestOperationObjectKey = @"_af_imageRequestOp
     objc_setAssociatedObject(self, kAFImageRequestOperationObjectKey, imageRequestOperation, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
 }
 
-+ (NSOperationQueue *)af_sharedImageRequestOperationQueue {
-    static NSOperationQueue *_imageRequestOperationQueue = nil;
-    
-    if (!_imageRequestOperationQueue) {
-        _imageRequestOperationQueue = [[NSOperationQueue alloc] init];
-        [_imageRequestOperationQueue setMaxConcurrentOperationCount:8];
-    }
+- (AFImageRequestHandler)af_imageRequestHandler {
+    return (AFImageRequestHandler)objc_getAssociatedObject(self, kAFImageRequestHandlerObjectKey);
+}
+
+- (void)af_setImageRequestHandler:(AFImageRequestHandler)imageRequestHandler {
+    objc_setAssociatedObject(self, kAFImageRequestHandlerObjectKey, imageRequestHandler, OBJC_ASSOCIATION_COPY_NONATOMIC);
+}
+
+- (NSURL *)af_imageDiskLookupURL {
+    return (NSURL *)objc_getAssociatedObject(self, kAFImageDiskLookupURLObjectKey);
+}
+
+- (void)af_setImageDiskLookupURL:(NSURL *)imageDiskLookupURL {
+    objc_setAssociatedObject(self, kAFImageDiskLookupURLObjectKey, imageDiskLookupURL, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
++ (AFHTTPRequestCoalescer *)af_sharedImageRequestCoalescer {
+    static AFHTTPRequestCoalescer *_imageRequestCoalescer = nil;
+    static dispatch_once_t oncePredicate;
+    dispatch_once(&oncePredicate, ^{
+        _imageRequestCoalescer = [[AFHTTPRequestCoalescer alloc] init];
+    });
     
-    return _imageRequestOperationQueue;
+    return _imageRequestCoalescer;
 }
 
 #pragma mark -
@@ -81,7 +107,8 @@ static NSString * const kAFImageRequestOperationObjectKey = @"_af_imageRequestOp
                        success:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response,UIImage *image))success
                        failure:(void (^)(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error))failure
 {
-    if (![urlRequest URL] || (![self.af_imageRequestOperation isCancelled] && [[urlRequest URL] isEqual:self.af_imageRequestOperation.request.URL])) {
+    // An image that is still being looked up on disk has no request operation yet
+    if (![urlRequest URL] || [[urlRequest URL] isEqual:self.af_imageDiskLookupURL] || (self.af_imageRequestOperation && ![self.af_imageRequestOperation isCancelled] && [[urlRequest URL] isEqual:self.af_imageRequestOperation.request.URL])) {
         return;
     } else {
         [self cancelImageRequestOperation];
@@ -92,41 +119,82 @@ static NSString * const kAFImageRequestOperationObjectKey = @"_af_imageRequestOp
         self.image = cachedImage;
         
         if (success) {
-            success(nil, nil, cachedImage);
+            success(urlRequest, nil, cachedImage);
         }
     } else {
         self.image = placeholderImage;
         
-        self.af_imageRequestOperation = [AFImageRequestOperation operationWithRequest:urlRequest imageProcessingBlock:nil cacheName:nil success:^(NSURLRequest *request, NSHTTPURLResponse *response, UIImage *image) {
-            if (self.af_imageRequestOperation && ![self.af_imageRequestOperation isCancelled]) {
-                dispatch_async(dispatch_get_main_queue(), ^{
-                    if (success) {
-                        success(request, response, image);
-                    }
-                
-                    if ([[request URL] isEqual:[[self.af_imageRequestOperation request] URL]]) {
-                        self.image = image;
-                    } else {
-                        self.image = placeholderImage;
-                    }
-                });
-            }
-        } failure:^(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error) {
+        // Handlers are only called if they have not been removed by `cancelImageRequestOperation`
+        AFImageRequestHandler handler = ^(NSURLRequest *request, NSHTTPURLResponse *response, UIImage *image, NSError *error) {
             self.af_imageRequestOperation = nil;
+            self.af_imageRequestHandler = nil;
             
-            dispatch_async(dispatch_get_main_queue(), ^{
+            if (error) {
                 if (failure) {
                     failure(request, response, error);
-                } 
-            });
+                }
+            } else {
+                if (success) {
+                    success(request, response, image);
+                }
+                
+                self.image = image;
+            }
+        };
+        self.af_imageRequestHandler = handler;
+        AFImageRequestHandler currentHandler = self.af_imageRequestHandler;
+        
+        // The disk cache is looked up off the main thread, and the image is only requested if it is not found there
+        self.af_imageDiskLookupURL = [urlRequest URL];
+        [[AFImageCache sharedImageCache] loadCachedImageFromDiskForURL:[urlRequest URL] cacheName:nil completion:^(UIImage *image) {
+            if (self.af_imageRequestHandler != currentHandler) {
+                return;
+            }
+            
+            self.af_imageDiskLookupURL = nil;
+            
+            if (image) {
+                currentHandler(urlRequest, nil, image, nil);
+            } else {
+                [self af_loadImageWithURLRequest:urlRequest];
+            }
         }];
-       
-        [[[self class] af_sharedImageRequestOperationQueue] addOperation:self.af_imageRequestOperation];
     }
 }
 
+- (void)af_loadImageWithURLRequest:(NSURLRequest *)urlRequest {
+    AFHTTPRequestCoalescer *requestCoalescer = [[self class] af_sharedImageRequestCoalescer];
+    AFHTTPOperationScheduler *scheduler = [AFHTTPOperationScheduler sharedScheduler];
+    self.af_imageRequestOperation = (AFImageRequestOperation *)[requestCoalescer addHandler:self.af_imageRequestHandler forRequest:urlRequest operationBlock:^AFHTTPRequestOperation *(id coalescedRequest) {
+        AFImageRequestOperation *operation = [AFImageRequestOperation operationWithRequest:urlRequest imageProcessingBlock:nil cacheName:nil success:^(NSURLRequest *request, NSHTTPURLResponse *response, UIImage *image) {
+            for (AFImageRequestHandler coalescedHandler in [requestCoalescer handlersForFinishedCoalescedRequest:coalescedRequest]) {
+                coalescedHandler(request, response, image, nil);
+            }
+        } failure:^(NSURLRequest *request, NSHTTPURLResponse *response, NSError *error) {
+            for (AFImageRequestHandler coalescedHandler in [requestCoalescer handlersForFinishedCoalescedRequest:coalescedRequest]) {
+                coalescedHandler(request, response, nil, error);
+            }
+        }];
+        
+        [scheduler enqueueOperation:operation priority:AFHTTPRequestNormalPriority];
+        
+        return operation;
+    }];
+}
+
 - (void)cancelImageRequestOperation {
-    [self.af_imageRequestOperation cancel];
+    // Other image views may be waiting on the same operation, which is only cancelled once none remain
+    [[[self class] af_sharedImageRequestCoalescer] removeHandler:self.af_imageRequestHandler];
+    
+    self.af_imageRequestOperation = nil;
+    self.af_imageRequestHandler = nil;
+    self.af_imageDiskLookupURL = nil;
+}
+
+- (void)setImageRequestPriority:(AFHTTPRequestPriority)priority {
+    if (self.af_imageRequestOperation) {
+        [[AFHTTPOperationScheduler sharedScheduler] setPriority:priority forOperation:self.af_imageRequestOperation];
+    }
 }
 
 @end
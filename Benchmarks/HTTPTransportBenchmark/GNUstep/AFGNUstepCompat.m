@@ -0,0 +1,102 @@
+// AFGNUstepCompat.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#import <Foundation/Foundation.h>
+#import "CFNetwork/CFNetwork.h"
+
+#include <arpa/inet.h>
+
+// `AFHTTPRequestOperation.m` depends on Mach thread APIs, and is left out of the GNUstep build, so the error domain it defines is defined here
+NSString * const AFNetworkingErrorDomain = @"com.alamofire.networking.error";
+
+static NSHost * AFGNUstepHostForString(NSString *string) {
+    struct in6_addr address;
+    const char *characters = [string UTF8String];
+    if (inet_pton(AF_INET, characters, &address) == 1 || inet_pton(AF_INET6, characters, &address) == 1) {
+        return [NSHost hostWithAddress:string];
+    }
+    
+    return [NSHost hostWithName:string];
+}
+
+void AFGNUstepStreamCreatePairWithSocketToHost(CFAllocatorRef __unused allocator, CFStringRef host, UInt32 port, CFReadStreamRef *readStream, CFWriteStreamRef *writeStream) {
+    NSInputStream *inputStream = nil;
+    NSOutputStream *outputStream = nil;
+    [NSStream getStreamsToHost:AFGNUstepHostForString((NSString *)host) port:(NSInteger)port inputStream:&inputStream outputStream:&outputStream];
+    
+    if (readStream) {
+        *readStream = (CFReadStreamRef)[inputStream retain];
+    }
+    
+    if (writeStream) {
+        *writeStream = (CFWriteStreamRef)[outputStream retain];
+    }
+}
+
+// GNUstep has no bound pair of its own, so the pair is a pipe, and the pipe's buffer stands in for `transferBufferSize`
+void AFGNUstepStreamCreateBoundPair(CFAllocatorRef __unused allocator, CFReadStreamRef *readStream, CFWriteStreamRef *writeStream, CFIndex __unused transferBufferSize) {
+    NSInputStream *inputStream = nil;
+    NSOutputStream *outputStream = nil;
+    [NSStream pipeWithInputStream:&inputStream outputStream:&outputStream];
+    
+    if (readStream) {
+        *readStream = (CFReadStreamRef)[inputStream retain];
+    }
+    
+    if (writeStream) {
+        *writeStream = (CFWriteStreamRef)[outputStream retain];
+    }
+}
+
+// Like `CFURLCopyPath`, this keeps percent escapes intact, which `-[NSURL path]` does not
+CFStringRef AFGNUstepURLCopyPath(CFURLRef anURL) {
+    NSString *string = [(NSURL *)anURL absoluteString];
+    NSRange schemeRange = [string rangeOfString:@"://"];
+    NSUInteger location = schemeRange.location == NSNotFound ? 0 : NSMaxRange(schemeRange);
+    
+    NSCharacterSet *pathStartCharacterSet = [NSCharacterSet characterSetWithCharactersInString:@"/?#"];
+    NSRange pathStartRange = [string rangeOfCharacterFromSet:pathStartCharacterSet options:0 range:NSMakeRange(location, [string length] - location)];
+    if (pathStartRange.location == NSNotFound || [string characterAtIndex:pathStartRange.location] != '/') {
+        return (CFStringRef)[@"" copy];
+    }
+    
+    NSString *path = [string substringFromIndex:pathStartRange.location];
+    NSRange pathEndRange = [path rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@"?#"]];
+    if (pathEndRange.location != NSNotFound) {
+        path = [path substringToIndex:pathEndRange.location];
+    }
+    
+    return (CFStringRef)[path copy];
+}
+
+void AFGNUstepRelease(CFTypeRef cf) {
+    [(id)cf release];
+}
+
+CFHostRef AFGNUstepHostCreateWithName(CFAllocatorRef __unused allocator, CFStringRef hostname) {
+    return (CFHostRef)[(NSString *)hostname copy];
+}
+
+Boolean AFGNUstepHostStartInfoResolution(CFHostRef theHost, CFHostInfoType __unused info, void * __unused error) {
+    return [[AFGNUstepHostForString((NSString *)theHost) addresses] count] > 0;
+}
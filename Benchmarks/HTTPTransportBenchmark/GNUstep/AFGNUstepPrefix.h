@@ -0,0 +1,51 @@
+// AFGNUstepPrefix.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Included before every Objective-C file of the GNUstep build.
+//
+// On Darwin, Foundation brings in CoreFoundation and libdispatch, and NSStream and NSURL are toll-free bridged to CFReadStream, CFWriteStream and CFURL. GNUstep Base does neither, so this imports CoreBase and libdispatch, and routes the CoreFoundation calls the transports make on Foundation objects to Foundation.
+
+#ifdef __OBJC__
+
+#import <Foundation/Foundation.h>
+#import <CoreFoundation/CoreFoundation.h>
+
+#include <dispatch/dispatch.h>
+
+#ifndef __unused
+#define __unused __attribute__((unused))
+#endif
+
+extern void AFGNUstepStreamCreatePairWithSocketToHost(CFAllocatorRef allocator, CFStringRef host, UInt32 port, CFReadStreamRef *readStream, CFWriteStreamRef *writeStream);
+extern void AFGNUstepStreamCreateBoundPair(CFAllocatorRef allocator, CFReadStreamRef *readStream, CFWriteStreamRef *writeStream, CFIndex transferBufferSize);
+extern CFStringRef AFGNUstepURLCopyPath(CFURLRef anURL);
+extern void AFGNUstepRelease(CFTypeRef cf);
+
+#define CFStreamCreatePairWithSocketToHost AFGNUstepStreamCreatePairWithSocketToHost
+#define CFStreamCreateBoundPair AFGNUstepStreamCreateBoundPair
+#define CFURLCopyPath AFGNUstepURLCopyPath
+
+// Every object the transports release with CFRelease comes from the functions above, so it is a Foundation object
+#define CFRelease AFGNUstepRelease
+
+#endif
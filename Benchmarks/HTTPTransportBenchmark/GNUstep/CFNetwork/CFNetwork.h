@@ -0,0 +1,46 @@
+// CFNetwork.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// The CFHost functions that the URL connection transport uses to resolve host names ahead of time, backed by NSHost.
+
+#ifndef _AF_GNUSTEP_CFNETWORK_H
+#define _AF_GNUSTEP_CFNETWORK_H
+
+#import <Foundation/Foundation.h>
+#import <CoreFoundation/CoreFoundation.h>
+
+typedef const struct __AFGNUstepHost * CFHostRef;
+
+typedef enum {
+    kCFHostAddresses    = 0,
+    kCFHostNames        = 1,
+    kCFHostReachability = 2,
+} CFHostInfoType;
+
+extern CFHostRef AFGNUstepHostCreateWithName(CFAllocatorRef allocator, CFStringRef hostname);
+extern Boolean AFGNUstepHostStartInfoResolution(CFHostRef theHost, CFHostInfoType info, void *error);
+
+#define CFHostCreateWithName AFGNUstepHostCreateWithName
+#define CFHostStartInfoResolution AFGNUstepHostStartInfoResolution
+
+#endif
@@ -0,0 +1,45 @@
+// CommonDigest.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// The MD5 function of CommonCrypto that the response cache uses to name its files, backed by GNUstep Base's digest of NSData.
+
+#ifndef _AF_GNUSTEP_COMMONDIGEST_H
+#define _AF_GNUSTEP_COMMONDIGEST_H
+
+#import <Foundation/Foundation.h>
+#import <GNUstepBase/NSData+GNUstepBase.h>
+
+#include <stdint.h>
+
+typedef uint32_t CC_LONG;
+
+#define CC_MD5_DIGEST_LENGTH 16
+
+static inline unsigned char * CC_MD5(const void *data, CC_LONG len, unsigned char *md) {
+    NSData *digest = [[NSData dataWithBytesNoCopy:(void *)data length:len freeWhenDone:NO] md5Digest];
+    [digest getBytes:md length:CC_MD5_DIGEST_LENGTH];
+    
+    return md;
+}
+
+#endif
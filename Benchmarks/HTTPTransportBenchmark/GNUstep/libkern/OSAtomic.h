@@ -0,0 +1,48 @@
+// OSAtomic.h
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// The subset of Darwin's libkern atomics that the transports use, built on the GCC atomic builtins that Clang also provides.
+
+#ifndef _AF_GNUSTEP_OSATOMIC_H
+#define _AF_GNUSTEP_OSATOMIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+static inline bool OSAtomicCompareAndSwap32Barrier(int32_t oldValue, int32_t newValue, volatile int32_t *theValue) {
+    return __sync_bool_compare_and_swap(theValue, oldValue, newValue);
+}
+
+static inline bool OSAtomicCompareAndSwapPtrBarrier(void *oldValue, void *newValue, void * volatile *theValue) {
+    return __sync_bool_compare_and_swap(theValue, oldValue, newValue);
+}
+
+static inline int32_t OSAtomicIncrement32Barrier(volatile int32_t *theValue) {
+    return __sync_add_and_fetch(theValue, 1);
+}
+
+static inline int32_t OSAtomicDecrement32Barrier(volatile int32_t *theValue) {
+    return __sync_sub_and_fetch(theValue, 1);
+}
+
+#endif
@@ -0,0 +1,540 @@
+#!/usr/bin/env python3
+#
+# A local h2c server for testing AFHTTP2Transport: HTTP/2 with prior knowledge over cleartext TCP, as in RFC 7540
+# section 3.4. Each path exercises a part of the protocol that the transport must handle.
+#
+#   /download?size=N   N body bytes, sent only as far as the client's flow control windows allow
+#   /upload            Reads the request body under a 16 KiB stream window, which is only opened again with
+#                      WINDOW_UPDATE once the client has used all of it, and responds with the body's length and SHA-256
+#   /settings          The client's SETTINGS, as JSON, sent once the client has acknowledged the server's
+#   /refused?token=T   Refused with RST_STREAM REFUSED_STREAM the first time a token is seen, and served after that
+#   /goaway?token=T    Answered with a GOAWAY that leaves the stream unprocessed the first time a token is seen, and
+#                      served after that
+#   /reset             Reset with RST_STREAM INTERNAL_ERROR after the response headers
+#   /stall             Response headers, and then nothing, until the client resets the stream
+#   /stats             Counts of what the server has seen from clients, as JSON
+#
+# The server's SETTINGS limit clients to 4 concurrent streams with 16 KiB windows. Body byte i is i % 251, as with
+# server.py. A client that sends more than a window allows, opens too many streams, or sends a body that does not
+# match its content-length, gets a connection or stream error, and is counted in /stats.
+#
+# Usage: python3 h2c_server.py [--host HOST] [--port PORT] [--exec COMMAND [ARGUMENT ...]]
+#
+# With --exec, the server listens on an unused port, runs the command with `--host HOST --port PORT` appended, and
+# exits with its status once it has finished, which is how the test target runs.
+
+import argparse
+import hashlib
+import json
+import socket
+import socketserver
+import struct
+import subprocess
+import sys
+import threading
+from urllib.parse import parse_qs, urlsplit
+
+CONNECTION_PREFACE = b"PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+DATA, HEADERS, PRIORITY, RST_STREAM, SETTINGS, PUSH_PROMISE, PING, GOAWAY, WINDOW_UPDATE, CONTINUATION = range(10)
+END_STREAM, ACK, END_HEADERS, PADDED, PRIORITY_FLAG = 0x1, 0x1, 0x4, 0x8, 0x20
+NO_ERROR, PROTOCOL_ERROR, INTERNAL_ERROR, FLOW_CONTROL_ERROR, REFUSED_STREAM, CANCEL = 0x0, 0x1, 0x2, 0x3, 0x7, 0x8
+SETTINGS_NAMES = {0x1: "header_table_size", 0x2: "enable_push", 0x3: "max_concurrent_streams",
+                  0x4: "initial_window_size", 0x5: "max_frame_size", 0x6: "max_header_list_size"}
+
+DEFAULT_WINDOW_SIZE = 65535
+MAX_FRAME_SIZE = 16384
+SERVER_MAX_CONCURRENT_STREAMS = 4
+SERVER_INITIAL_WINDOW_SIZE = 16384
+DEFAULT_BODY_SIZE = 16 * 1024
+
+# See http://tools.ietf.org/html/rfc7541#appendix-A
+STATIC_TABLE = (
+    (":authority", ""), (":method", "GET"), (":method", "POST"), (":path", "/"), (":path", "/index.html"),
+    (":scheme", "http"), (":scheme", "https"), (":status", "200"), (":status", "204"), (":status", "206"),
+    (":status", "304"), (":status", "400"), (":status", "404"), (":status", "500"), ("accept-charset", ""),
+    ("accept-encoding", "gzip, deflate"), ("accept-language", ""), ("accept-ranges", ""), ("accept", ""),
+    ("access-control-allow-origin", ""), ("age", ""), ("allow", ""), ("authorization", ""), ("cache-control", ""),
+    ("content-disposition", ""), ("content-encoding", ""), ("content-language", ""), ("content-length", ""),
+    ("content-location", ""), ("content-range", ""), ("content-type", ""), ("cookie", ""), ("date", ""),
+    ("etag", ""), ("expect", ""), ("expires", ""), ("from", ""), ("host", ""), ("if-match", ""),
+    ("if-modified-since", ""), ("if-none-match", ""), ("if-range", ""), ("if-unmodified-since", ""),
+    ("last-modified", ""), ("link", ""), ("location", ""), ("max-forwards", ""), ("proxy-authenticate", ""),
+    ("proxy-authorization", ""), ("range", ""), ("referer", ""), ("refresh", ""), ("retry-after", ""),
+    ("server", ""), ("set-cookie", ""), ("strict-transport-security", ""), ("transfer-encoding", ""),
+    ("user-agent", ""), ("vary", ""), ("via", ""), ("www-authenticate", ""),
+)
+
+# See http://tools.ietf.org/html/rfc7541#appendix-B
+HUFFMAN_CODES = (
+    0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+    0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+    0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+    0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+    0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+    0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+    0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+    0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+    0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+    0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+    0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+    0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+    0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+    0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+    0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+    0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+    0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+    0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+    0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+    0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+    0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+    0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+    0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+    0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+    0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+    0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+    0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+    0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+    0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+    0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+    0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+    0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+    0x3fffffff,
+)
+HUFFMAN_CODE_LENGTHS = (
+    13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+    28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+    6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+    5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+    13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+    15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+    6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+    20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+    24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+    22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+    21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+    26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+    19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+    20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+    26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+    30,
+)
+HUFFMAN_SYMBOLS = {(code, length): symbol for symbol, (code, length) in enumerate(zip(HUFFMAN_CODES, HUFFMAN_CODE_LENGTHS))}
+
+
+class ProtocolError(Exception):
+    def __init__(self, code, message):
+        super().__init__(message)
+        self.code = code
+
+
+def body_of_size(size):
+    return bytes(i % 251 for i in range(size))
+
+
+def huffman_decode(data):
+    output, code, length = bytearray(), 0, 0
+    for byte in data:
+        for shift in range(7, -1, -1):
+            code, length = (code << 1) | ((byte >> shift) & 1), length + 1
+            symbol = HUFFMAN_SYMBOLS.get((code, length))
+            if symbol == 256:
+                raise ProtocolError(PROTOCOL_ERROR, "EOS in Huffman-coded string")
+            if symbol is not None:
+                output.append(symbol)
+                code, length = 0, 0
+    if length > 7 or code != (1 << length) - 1:
+        raise ProtocolError(PROTOCOL_ERROR, "invalid Huffman padding")
+    return bytes(output)
+
+
+def encode_integer(value, prefix_length, flags=0):
+    limit = (1 << prefix_length) - 1
+    if value < limit:
+        return bytes([flags | value])
+    output = bytearray([flags | limit])
+    value -= limit
+    while value >= 128:
+        output.append((value & 0x7f) | 0x80)
+        value >>= 7
+    output.append(value)
+    return bytes(output)
+
+
+class HPACKDecoder:
+    def __init__(self):
+        self.dynamic_table = []
+        self.maximum_size = 4096
+
+    def table_size(self):
+        return sum(len(name) + len(value) + 32 for name, value in self.dynamic_table)
+
+    def add(self, name, value):
+        self.dynamic_table.insert(0, (name, value))
+        while self.dynamic_table and self.table_size() > self.maximum_size:
+            self.dynamic_table.pop()
+
+    def entry(self, index):
+        if 0 < index <= len(STATIC_TABLE):
+            return STATIC_TABLE[index - 1]
+        if 0 < index - len(STATIC_TABLE) <= len(self.dynamic_table):
+            return self.dynamic_table[index - len(STATIC_TABLE) - 1]
+        raise ProtocolError(PROTOCOL_ERROR, "invalid table index %d" % index)
+
+    def decode(self, block):
+        offset, fields = 0, []
+
+        def read_integer(prefix_length):
+            nonlocal offset
+            value = block[offset] & ((1 << prefix_length) - 1)
+            offset += 1
+            if value < (1 << prefix_length) - 1:
+                return value
+            shift = 0
+            while True:
+                byte = block[offset]
+                offset += 1
+                value += (byte & 0x7f) << shift
+                shift += 7
+                if not byte & 0x80:
+                    return value
+
+        def read_string():
+            nonlocal offset
+            huffman = block[offset] & 0x80
+            length = read_integer(7)
+            data = block[offset:offset + length]
+            offset += length
+            return (huffman_decode(data) if huffman else data).decode("latin-1")
+
+        try:
+            while offset < len(block):
+                byte = block[offset]
+                if byte & 0x80:
+                    fields.append(self.entry(read_integer(7)))
+                elif byte & 0xe0 == 0x20:
+                    self.maximum_size = min(read_integer(5), 4096)
+                    while self.dynamic_table and self.table_size() > self.maximum_size:
+                        self.dynamic_table.pop()
+                else:
+                    incremental = byte & 0xc0 == 0x40
+                    index = read_integer(6 if incremental else 4)
+                    name = self.entry(index)[0] if index else read_string()
+                    value = read_string()
+                    fields.append((name, value))
+                    if incremental:
+                        self.add(name, value)
+        except IndexError:
+            raise ProtocolError(PROTOCOL_ERROR, "truncated header block")
+        return fields
+
+
+# Response fields are sent as literals without indexing, which needs no state on either side
+def encode_header_block(fields):
+    block = bytearray()
+    for name, value in fields:
+        block.append(0)
+        for string in (name.encode("latin-1"), value.encode("latin-1")):
+            block += encode_integer(len(string), 7) + string
+    return bytes(block)
+
+
+class H2CStatistics:
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.counts = {"connections": 0, "streams": 0, "client_resets": 0, "client_goaways": 0,
+                       "settings_acknowledgements": 0, "window_updates_sent": 0, "maximum_concurrent_streams": 0,
+                       "flow_control_errors": 0, "concurrency_errors": 0, "content_length_errors": 0,
+                       "protocol_errors": 0}
+        self.tokens = set()
+
+    def increment(self, name, value=1):
+        with self.lock:
+            self.counts[name] += value
+
+    def maximum(self, name, value):
+        with self.lock:
+            self.counts[name] = max(self.counts[name], value)
+
+    # Returns whether a token is seen for the first time
+    def add_token(self, token):
+        with self.lock:
+            if token in self.tokens:
+                return False
+            self.tokens.add(token)
+            return True
+
+    def snapshot(self):
+        with self.lock:
+            return dict(self.counts)
+
+
+class H2CStream:
+    def __init__(self, stream_id, send_window):
+        self.stream_id = stream_id
+        self.send_window = send_window
+        self.receive_window = SERVER_INITIAL_WINDOW_SIZE
+        self.headers = {}
+        self.body = bytearray()
+        self.response_body = b""
+        self.response_offset = 0
+        self.responding = False
+        self.waits_for_settings_acknowledgement = False
+
+
+class H2CHandler(socketserver.BaseRequestHandler):
+    def setup(self):
+        self.request.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.statistics = self.server.statistics
+        self.decoder = HPACKDecoder()
+        self.streams = {}
+        self.client_settings = {}
+        self.send_window = DEFAULT_WINDOW_SIZE
+        self.receive_window = DEFAULT_WINDOW_SIZE
+        self.initial_send_window = DEFAULT_WINDOW_SIZE
+        self.last_stream_id = 0
+        self.settings_acknowledged = False
+        self.going_away = False
+        self.header_block = None
+        self.buffer = b""
+
+    def handle(self):
+        self.statistics.increment("connections")
+        try:
+            if self.read_exactly(len(CONNECTION_PREFACE)) != CONNECTION_PREFACE:
+                return
+            self.write_frame(SETTINGS, 0, 0, struct.pack(">HIHI", 0x3, SERVER_MAX_CONCURRENT_STREAMS, 0x4, SERVER_INITIAL_WINDOW_SIZE))
+            while not (self.going_away and not self.streams):
+                header = self.read_exactly(9)
+                if header is None:
+                    return
+                length_high, length_low, frame_type, flags, stream_id = struct.unpack(">BHBBI", header)
+                payload = self.read_exactly((length_high << 16) | length_low)
+                if payload is None:
+                    return
+                self.process_frame(frame_type, flags, stream_id & 0x7fffffff, payload)
+                self.send_response_bodies()
+        except ProtocolError as error:
+            self.statistics.increment("protocol_errors")
+            self.write_frame(GOAWAY, 0, 0, struct.pack(">II", self.last_stream_id, error.code) + str(error).encode("utf-8"))
+        except (ConnectionError, OSError):
+            pass
+
+    def read_exactly(self, length):
+        while len(self.buffer) < length:
+            data = self.request.recv(65536)
+            if not data:
+                return None
+            self.buffer += data
+        data, self.buffer = self.buffer[:length], self.buffer[length:]
+        return data
+
+    def write_frame(self, frame_type, flags, stream_id, payload=b""):
+        self.request.sendall(struct.pack(">BHBBI", len(payload) >> 16, len(payload) & 0xffff, frame_type, flags, stream_id) + payload)
+
+    def process_frame(self, frame_type, flags, stream_id, payload):
+        if self.header_block is not None and frame_type != CONTINUATION:
+            raise ProtocolError(PROTOCOL_ERROR, "expected CONTINUATION")
+
+        if frame_type in (DATA, HEADERS) and flags & PADDED:
+            payload = payload[1:len(payload) - payload[0]]
+
+        if frame_type == SETTINGS:
+            if flags & ACK:
+                self.settings_acknowledged = True
+                self.statistics.increment("settings_acknowledgements")
+                for stream in list(self.streams.values()):
+                    if stream.waits_for_settings_acknowledgement:
+                        stream.waits_for_settings_acknowledgement = False
+                        self.respond(stream, 200, json.dumps(self.client_settings, sort_keys=True).encode("utf-8"), "application/json")
+                return
+            for offset in range(0, len(payload), 6):
+                identifier, value = struct.unpack(">HI", payload[offset:offset + 6])
+                self.client_settings[SETTINGS_NAMES.get(identifier, str(identifier))] = value
+                if identifier == 0x4:
+                    for stream in self.streams.values():
+                        stream.send_window += value - self.initial_send_window
+                    self.initial_send_window = value
+            self.write_frame(SETTINGS, ACK, 0)
+        elif frame_type == PING:
+            if not flags & ACK:
+                self.write_frame(PING, ACK, 0, payload)
+        elif frame_type == GOAWAY:
+            self.statistics.increment("client_goaways")
+            self.going_away = True
+        elif frame_type == WINDOW_UPDATE:
+            increment = struct.unpack(">I", payload)[0] & 0x7fffffff
+            if stream_id == 0:
+                self.send_window += increment
+            elif stream_id in self.streams:
+                self.streams[stream_id].send_window += increment
+        elif frame_type == RST_STREAM:
+            self.statistics.increment("client_resets")
+            self.streams.pop(stream_id, None)
+        elif frame_type == HEADERS:
+            if flags & PRIORITY_FLAG:
+                payload = payload[5:]
+            self.header_block = (stream_id, flags & END_STREAM, bytearray(payload))
+            if flags & END_HEADERS:
+                self.process_header_block()
+        elif frame_type == CONTINUATION:
+            if self.header_block is None or self.header_block[0] != stream_id:
+                raise ProtocolError(PROTOCOL_ERROR, "unexpected CONTINUATION")
+            self.header_block[2].extend(payload)
+            if flags & END_HEADERS:
+                self.process_header_block()
+        elif frame_type == DATA:
+            self.process_data(stream_id, flags, payload)
+
+    def process_header_block(self):
+        stream_id, ends_stream, block = self.header_block
+        self.header_block = None
+        fields = self.decoder.decode(bytes(block))
+
+        # Streams after the last one a GOAWAY named are ignored, though their headers still update the decoder
+        if self.going_away or stream_id <= self.last_stream_id:
+            return
+        self.last_stream_id = stream_id
+
+        self.statistics.increment("streams")
+        if len(self.streams) >= SERVER_MAX_CONCURRENT_STREAMS:
+            self.statistics.increment("concurrency_errors")
+            self.write_frame(RST_STREAM, 0, stream_id, struct.pack(">I", REFUSED_STREAM))
+            return
+
+        stream = H2CStream(stream_id, self.initial_send_window)
+        stream.headers = dict(fields)
+        self.streams[stream_id] = stream
+        self.statistics.maximum("maximum_concurrent_streams", len(self.streams))
+        if ends_stream:
+            self.process_request(stream)
+
+    def process_data(self, stream_id, flags, payload):
+        length = len(payload)
+        self.receive_window -= length
+        if self.receive_window < 0:
+            self.statistics.increment("flow_control_errors")
+            raise ProtocolError(FLOW_CONTROL_ERROR, "connection window exceeded")
+        if self.receive_window < DEFAULT_WINDOW_SIZE // 2:
+            self.write_frame(WINDOW_UPDATE, 0, 0, struct.pack(">I", DEFAULT_WINDOW_SIZE - self.receive_window))
+            self.receive_window = DEFAULT_WINDOW_SIZE
+
+        stream = self.streams.get(stream_id)
+        if stream is None:
+            return
+        stream.receive_window -= length
+        if stream.receive_window < 0:
+            self.statistics.increment("flow_control_errors")
+            self.reset(stream, FLOW_CONTROL_ERROR)
+            return
+        stream.body += payload
+
+        # The stream window is only opened again once the client has used all of it
+        if stream.receive_window == 0 and not flags & END_STREAM:
+            self.statistics.increment("window_updates_sent")
+            self.write_frame(WINDOW_UPDATE, 0, stream_id, struct.pack(">I", SERVER_INITIAL_WINDOW_SIZE))
+            stream.receive_window = SERVER_INITIAL_WINDOW_SIZE
+
+        if flags & END_STREAM:
+            self.process_request(stream)
+
+    def process_request(self, stream):
+        content_length = stream.headers.get("content-length")
+        if content_length is not None and int(content_length) != len(stream.body):
+            self.statistics.increment("content_length_errors")
+            self.respond(stream, 400, b"")
+            return
+
+        url = urlsplit(stream.headers.get(":path", "/"))
+        query = parse_qs(url.query)
+        token = query.get("token", [""])[0]
+
+        if url.path == "/download":
+            self.respond(stream, 200, body_of_size(int(query.get("size", [DEFAULT_BODY_SIZE])[0])))
+        elif url.path == "/upload":
+            body = json.dumps({"length": len(stream.body), "sha256": hashlib.sha256(stream.body).hexdigest()})
+            self.respond(stream, 200, body.encode("utf-8"), "application/json")
+        elif url.path == "/settings":
+            if self.settings_acknowledged:
+                self.respond(stream, 200, json.dumps(self.client_settings, sort_keys=True).encode("utf-8"), "application/json")
+            else:
+                stream.waits_for_settings_acknowledgement = True
+        elif url.path == "/refused" and self.statistics.add_token("refused-" + token):
+            self.reset(stream, REFUSED_STREAM)
+        elif url.path == "/goaway" and self.statistics.add_token("goaway-" + token):
+            # The stream is left unprocessed, for the client to send again on a new connection
+            self.last_stream_id = stream.stream_id - 2 if stream.stream_id > 2 else 0
+            self.going_away = True
+            del self.streams[stream.stream_id]
+            self.write_frame(GOAWAY, 0, 0, struct.pack(">II", self.last_stream_id, NO_ERROR))
+        elif url.path in ("/refused", "/goaway"):
+            self.respond(stream, 200, token.encode("utf-8"))
+        elif url.path == "/reset":
+            self.write_frame(HEADERS, END_HEADERS, stream.stream_id, encode_header_block([(":status", "200")]))
+            self.reset(stream, INTERNAL_ERROR)
+        elif url.path == "/stall":
+            self.write_frame(HEADERS, END_HEADERS, stream.stream_id, encode_header_block([(":status", "200")]))
+        elif url.path == "/stats":
+            self.respond(stream, 200, json.dumps(self.statistics.snapshot(), sort_keys=True).encode("utf-8"), "application/json")
+        else:
+            self.respond(stream, 404, b"")
+
+    def respond(self, stream, status, body, content_type="application/octet-stream"):
+        fields = [(":status", str(status)), ("content-length", str(len(body))), ("content-type", content_type)]
+        self.write_frame(HEADERS, END_HEADERS | (0 if body else END_STREAM), stream.stream_id, encode_header_block(fields))
+        if body:
+            stream.response_body = body
+            stream.responding = True
+        else:
+            del self.streams[stream.stream_id]
+
+    def reset(self, stream, error_code):
+        self.write_frame(RST_STREAM, 0, stream.stream_id, struct.pack(">I", error_code))
+        self.streams.pop(stream.stream_id, None)
+
+    # Response bodies are sent as far as the client's windows allow, and the rest waits for its WINDOW_UPDATE frames
+    def send_response_bodies(self):
+        for stream in list(self.streams.values()):
+            while stream.responding and self.send_window > 0 and stream.send_window > 0:
+                remaining = len(stream.response_body) - stream.response_offset
+                length = min(remaining, MAX_FRAME_SIZE, self.send_window, stream.send_window)
+                is_last_frame = length == remaining
+                self.write_frame(DATA, END_STREAM if is_last_frame else 0, stream.stream_id, stream.response_body[stream.response_offset:stream.response_offset + length])
+                stream.response_offset += length
+                stream.send_window -= length
+                self.send_window -= length
+                if is_last_frame:
+                    del self.streams[stream.stream_id]
+                    break
+
+
+class H2CServer(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+    def __init__(self, *arguments, **keywords):
+        super().__init__(*arguments, **keywords)
+        self.statistics = H2CStatistics()
+
+
+class H2CIPv6Server(H2CServer):
+    address_family = socket.AF_INET6
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--exec", nargs=argparse.REMAINDER, dest="command")
+    arguments = parser.parse_args()
+
+    server_class = H2CIPv6Server if ":" in arguments.host else H2CServer
+    with server_class((arguments.host, 0 if arguments.command else arguments.port), H2CHandler) as server:
+        if not arguments.command:
+            server.serve_forever()
+        threading.Thread(target=server.serve_forever, daemon=True).start()
+        port = server.server_address[1]
+        status = subprocess.call(arguments.command + ["--host", arguments.host, "--port", str(port)])
+        server.shutdown()
+        sys.exit(status)
@@ -0,0 +1,410 @@
+// h2c_test.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// A command-line test of `AFHTTP2Transport` against h2c_server.py, which checks the client's side of SETTINGS, flow control, GOAWAY and RST_STREAM, and counts every protocol error it sees.
+//
+// Build, then run the test from the root of the repository with:
+//
+//   cmake -S Benchmarks/HTTPTransportBenchmark -B build/HTTPTransportBenchmark
+//   cmake --build build/HTTPTransportBenchmark
+//   ctest --test-dir build/HTTPTransportBenchmark --output-on-failure
+//
+// or against a server that is already running, with:
+//
+//   python3 Benchmarks/HTTPTransportBenchmark/h2c_server.py --port 8090 &
+//   ./build/HTTPTransportBenchmark/http2-transport-test [--host HOST] [--port PORT]
+//
+// Each check is written to stdout as it passes or fails. The exit status is 1 if any check failed.
+
+#import <Foundation/Foundation.h>
+#import "AFHTTP2Transport.h"
+#import "AFHTTPBodyCompressionPolicy.h"
+
+#include <CommonCrypto/CommonDigest.h>
+
+static NSUInteger const kAFH2CTestDefaultPort = 8090;
+static NSString * const kAFH2CTestDefaultHost = @"127.0.0.1";
+static NSTimeInterval const kAFH2CTestTimeoutInterval = 10.0;
+
+static NSUInteger _failureCount = 0;
+
+static void AFH2CTestCheck(BOOL condition, NSString *name) {
+    if (!condition) {
+        _failureCount++;
+    }
+    
+    printf("%s %s\n", (condition ? "PASS" : "FAIL"), [name UTF8String]);
+    fflush(stdout);
+}
+
+static BOOL AFH2CTestBodyIsValid(NSData *data, NSUInteger size) {
+    if ([data length] != size) {
+        return NO;
+    }
+    
+    const uint8_t *bytes = [data bytes];
+    for (NSUInteger idx = 0; idx < size; idx++) {
+        if (bytes[idx] != idx % 251) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+static NSString * AFH2CTestSHA256(NSData *data) {
+    unsigned char digest[CC_SHA256_DIGEST_LENGTH];
+    CC_SHA256([data bytes], (CC_LONG)[data length], digest);
+    
+    NSMutableString *mutableString = [NSMutableString stringWithCapacity:(CC_SHA256_DIGEST_LENGTH * 2)];
+    for (NSUInteger idx = 0; idx < CC_SHA256_DIGEST_LENGTH; idx++) {
+        [mutableString appendFormat:@"%02x", digest[idx]];
+    }
+    
+    return mutableString;
+}
+
+#pragma mark -
+
+@interface AFH2CTestConnectionDelegate : NSObject <AFHTTPTransportConnectionDelegate> {
+@private
+    NSHTTPURLResponse *_response;
+    NSMutableData *_data;
+    NSError *_error;
+    NSInteger _totalBytesWritten;
+    BOOL _finished;
+}
+
+@property (readwrite, nonatomic, retain) NSHTTPURLResponse *response;
+@property (readwrite, nonatomic, retain) NSMutableData *data;
+@property (readwrite, nonatomic, retain) NSError *error;
+@property (readwrite, nonatomic, assign) NSInteger totalBytesWritten;
+@property (readwrite, nonatomic, assign, getter = isFinished) BOOL finished;
+
+- (id)JSONObject;
+@end
+
+@implementation AFH2CTestConnectionDelegate
+@synthesize response = _response;
+@synthesize data = _data;
+@synthesize error = _error;
+@synthesize totalBytesWritten = _totalBytesWritten;
+@synthesize finished = _finished;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.data = [NSMutableData data];
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_response release];
+    [_data release];
+    [_error release];
+    [super dealloc];
+}
+
+- (id)JSONObject {
+    return [NSJSONSerialization JSONObjectWithData:self.data options:0 error:nil];
+}
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+         didReceiveResponse:(NSHTTPURLResponse *)response
+{
+    self.response = response;
+}
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+             didReceiveData:(NSData *)data
+{
+    [self.data appendData:data];
+}
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+            didSendBodyData:(NSInteger)__unused bytesWritten 
+          totalBytesWritten:(NSInteger)totalBytesWritten 
+  totalBytesExpectedToWrite:(NSInteger)__unused totalBytesExpectedToWrite
+{
+    self.totalBytesWritten = totalBytesWritten;
+}
+
+- (void)transportConnectionDidFinishLoading:(id <AFHTTPTransportConnection>)__unused connection {
+    self.finished = YES;
+}
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+           didFailWithError:(NSError *)error
+{
+    self.error = error;
+    self.finished = YES;
+}
+
+@end
+
+#pragma mark -
+
+static NSString *_baseURLString = nil;
+
+static NSMutableURLRequest * AFH2CTestRequest(NSString *path) {
+    NSURL *url = [NSURL URLWithString:[_baseURLString stringByAppendingString:path]];
+    
+    return [NSMutableURLRequest requestWithURL:url cachePolicy:NSURLRequestReloadIgnoringLocalCacheData timeoutInterval:kAFH2CTestTimeoutInterval];
+}
+
+static NSString * AFH2CTestToken(void) {
+    CFUUIDRef UUID = CFUUIDCreate(kCFAllocatorDefault);
+    NSString *token = [(NSString *)CFUUIDCreateString(kCFAllocatorDefault, UUID) autorelease];
+    CFRelease(UUID);
+    
+    return token;
+}
+
+// Starts a request on the current run loop, and returns its connection, whose delegate is returned by reference
+static id <AFHTTPTransportConnection> AFH2CTestStartRequest(AFHTTP2Transport *transport, NSURLRequest *request, AFH2CTestConnectionDelegate **delegate) {
+    *delegate = [[[AFH2CTestConnectionDelegate alloc] init] autorelease];
+    id <AFHTTPTransportConnection> connection = [transport connectionWithRequest:request delegate:*delegate];
+    [connection scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    [connection start];
+    
+    return connection;
+}
+
+// Runs the current run loop until every delegate has finished, or the timeout interval has passed
+static void AFH2CTestWaitForDelegates(NSArray *delegates) {
+    NSDate *timeoutDate = [NSDate dateWithTimeIntervalSinceNow:kAFH2CTestTimeoutInterval * 2];
+    while ([timeoutDate timeIntervalSinceNow] > 0) {
+        BOOL isFinished = YES;
+        for (AFH2CTestConnectionDelegate *delegate in delegates) {
+            isFinished = isFinished && [delegate isFinished];
+        }
+        
+        if (isFinished) {
+            return;
+        }
+        
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    }
+}
+
+static AFH2CTestConnectionDelegate * AFH2CTestLoadRequest(AFHTTP2Transport *transport, NSURLRequest *request) {
+    AFH2CTestConnectionDelegate *delegate = nil;
+    id <AFHTTPTransportConnection> connection = AFH2CTestStartRequest(transport, request, &delegate);
+    AFH2CTestWaitForDelegates([NSArray arrayWithObject:delegate]);
+    [connection unscheduleFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    
+    return delegate;
+}
+
+static BOOL AFH2CTestDelegateSucceeded(AFH2CTestConnectionDelegate *delegate) {
+    return [delegate isFinished] && !delegate.error && [delegate.response statusCode] == 200;
+}
+
+#pragma mark -
+
+static void AFH2CTestSettings(AFHTTP2Transport *transport) {
+    AFH2CTestConnectionDelegate *delegate = AFH2CTestLoadRequest(transport, AFH2CTestRequest(@"/settings"));
+    NSDictionary *settings = [delegate JSONObject];
+    
+    // The server only responds once the client has acknowledged its SETTINGS
+    AFH2CTestCheck(AFH2CTestDelegateSucceeded(delegate), @"settings: the server's SETTINGS are acknowledged");
+    AFH2CTestCheck([[settings objectForKey:@"enable_push"] isEqual:[NSNumber numberWithInt:0]], @"settings: server push is disabled");
+    AFH2CTestCheck([[settings objectForKey:@"initial_window_size"] unsignedIntValue] == transport.initialStreamWindowSize, @"settings: the initial window size is the transport's");
+}
+
+static void AFH2CTestDownload(AFHTTP2Transport *transport) {
+    // A body larger than both windows of the client is only sent in full if the client acknowledges what it consumes
+    NSUInteger size = 4 * MAX(transport.initialStreamWindowSize, transport.connectionWindowSize);
+    AFH2CTestConnectionDelegate *delegate = AFH2CTestLoadRequest(transport, AFH2CTestRequest([NSString stringWithFormat:@"/download?size=%lu", (unsigned long)size]));
+    AFH2CTestCheck(AFH2CTestDelegateSucceeded(delegate) && AFH2CTestBodyIsValid(delegate.data, size), @"flow control: a body larger than the client's windows is received in full");
+}
+
+static void AFH2CTestUpload(AFHTTP2Transport *transport) {
+    NSMutableData *mutableBody = [NSMutableData dataWithLength:(1024 * 1024 + 7)];
+    uint8_t *bytes = [mutableBody mutableBytes];
+    for (NSUInteger idx = 0; idx < [mutableBody length]; idx++) {
+        bytes[idx] = (uint8_t)(idx * 31);
+    }
+    NSString *expectedDigest = AFH2CTestSHA256(mutableBody);
+    
+    NSArray *names = [NSArray arrayWithObjects:@"HTTPBody", @"HTTPBodyStream with Content-Length", @"HTTPBodyStream without Content-Length", nil];
+    for (NSString *name in names) {
+        NSMutableURLRequest *request = AFH2CTestRequest(@"/upload");
+        [request setHTTPMethod:@"POST"];
+        if ([name isEqualToString:@"HTTPBody"]) {
+            [request setHTTPBody:mutableBody];
+        } else {
+            [request setHTTPBodyStream:[NSInputStream inputStreamWithData:mutableBody]];
+            if ([name rangeOfString:@"with "].location != NSNotFound) {
+                [request setValue:[NSString stringWithFormat:@"%lu", (unsigned long)[mutableBody length]] forHTTPHeaderField:@"Content-Length"];
+            }
+        }
+        
+        // The server's stream window is 16 KB, and is only opened again once the client has used all of it
+        AFH2CTestConnectionDelegate *delegate = AFH2CTestLoadRequest(transport, request);
+        NSDictionary *result = [delegate JSONObject];
+        BOOL succeeded = AFH2CTestDelegateSucceeded(delegate) && [[result objectForKey:@"length"] unsignedIntegerValue] == [mutableBody length] && [[result objectForKey:@"sha256"] isEqualToString:expectedDigest];
+        AFH2CTestCheck(succeeded, [NSString stringWithFormat:@"flow control: a 1 MB %@ is sent under the server's 16 KB stream window", name]);
+        AFH2CTestCheck(delegate.totalBytesWritten == (NSInteger)[mutableBody length], [NSString stringWithFormat:@"flow control: upload progress of a %@ adds up to its length", name]);
+    }
+}
+
+static void AFH2CTestConcurrentStreams(AFHTTP2Transport *transport) {
+    NSMutableArray *mutableDelegates = [NSMutableArray array];
+    NSMutableArray *mutableConnections = [NSMutableArray array];
+    for (NSUInteger idx = 0; idx < 12; idx++) {
+        AFH2CTestConnectionDelegate *delegate = nil;
+        [mutableConnections addObject:AFH2CTestStartRequest(transport, AFH2CTestRequest(@"/download?size=65536"), &delegate)];
+        [mutableDelegates addObject:delegate];
+    }
+    
+    AFH2CTestWaitForDelegates(mutableDelegates);
+    
+    BOOL succeeded = YES;
+    for (AFH2CTestConnectionDelegate *delegate in mutableDelegates) {
+        succeeded = succeeded && AFH2CTestDelegateSucceeded(delegate) && AFH2CTestBodyIsValid(delegate.data, 65536);
+    }
+    AFH2CTestCheck(succeeded, @"settings: requests beyond SETTINGS_MAX_CONCURRENT_STREAMS wait for a stream to close");
+}
+
+static void AFH2CTestRefusedStream(AFHTTP2Transport *transport) {
+    NSString *token = AFH2CTestToken();
+    AFH2CTestConnectionDelegate *delegate = AFH2CTestLoadRequest(transport, AFH2CTestRequest([NSString stringWithFormat:@"/refused?token=%@", token]));
+    AFH2CTestCheck(AFH2CTestDelegateSucceeded(delegate) && [delegate.data isEqualToData:[token dataUsingEncoding:NSUTF8StringEncoding]], @"RST_STREAM: a refused stream is sent again");
+}
+
+static void AFH2CTestGoAway(AFHTTP2Transport *transport) {
+    NSUInteger openedConnectionCount = transport.openedConnectionCount;
+    NSString *token = AFH2CTestToken();
+    
+    // A compressed body can be made again from the start, so the stream left unprocessed by the GOAWAY is sent again on a new connection
+    NSMutableURLRequest *request = AFH2CTestRequest([NSString stringWithFormat:@"/goaway?token=%@", token]);
+    [request setHTTPMethod:@"POST"];
+    [request setHTTPBody:[token dataUsingEncoding:NSUTF8StringEncoding]];
+    AFHTTPBodyCompressionPolicy *compressionPolicy = [[[AFHTTPBodyCompressionPolicy alloc] init] autorelease];
+    compressionPolicy.minimumBodyLength = 0;
+    [compressionPolicy compressBodyOfRequest:request];
+    
+    AFH2CTestConnectionDelegate *delegate = AFH2CTestLoadRequest(transport, request);
+    AFH2CTestCheck(AFH2CTestDelegateSucceeded(delegate) && [delegate.data isEqualToData:[token dataUsingEncoding:NSUTF8StringEncoding]], @"GOAWAY: an unprocessed stream is sent again on a new connection, with a new body stream");
+    AFH2CTestCheck(transport.openedConnectionCount > openedConnectionCount, @"GOAWAY: the connection that is going away is not used for new streams");
+    
+    // A body stream that cannot be made again cannot be sent again either
+    token = AFH2CTestToken();
+    request = AFH2CTestRequest([NSString stringWithFormat:@"/goaway?token=%@", token]);
+    [request setHTTPMethod:@"POST"];
+    [request setHTTPBodyStream:[NSInputStream inputStreamWithData:[token dataUsingEncoding:NSUTF8StringEncoding]]];
+    
+    delegate = AFH2CTestLoadRequest(transport, request);
+    AFH2CTestCheck([delegate isFinished] && [delegate.error code] == NSURLErrorRequestBodyStreamExhausted, @"GOAWAY: an unprocessed stream whose body stream cannot be made again fails");
+}
+
+static void AFH2CTestResetStream(AFHTTP2Transport *transport) {
+    NSUInteger openedConnectionCount = transport.openedConnectionCount;
+    AFH2CTestConnectionDelegate *delegate = AFH2CTestLoadRequest(transport, AFH2CTestRequest(@"/reset"));
+    AFH2CTestCheck([delegate isFinished] && [[delegate.error domain] isEqualToString:NSURLErrorDomain], @"RST_STREAM: a stream reset by the server fails");
+    
+    delegate = AFH2CTestLoadRequest(transport, AFH2CTestRequest(@"/download?size=1024"));
+    AFH2CTestCheck(AFH2CTestDelegateSucceeded(delegate) && transport.openedConnectionCount == openedConnectionCount, @"RST_STREAM: a reset stream leaves its connection open for others");
+}
+
+static NSDictionary * AFH2CTestStatistics(AFHTTP2Transport *transport) {
+    return [AFH2CTestLoadRequest(transport, AFH2CTestRequest(@"/stats")) JSONObject];
+}
+
+static void AFH2CTestCancel(AFHTTP2Transport *transport) {
+    NSUInteger clientResetCount = [[AFH2CTestStatistics(transport) objectForKey:@"client_resets"] unsignedIntegerValue];
+    
+    AFH2CTestConnectionDelegate *delegate = nil;
+    id <AFHTTPTransportConnection> connection = AFH2CTestStartRequest(transport, AFH2CTestRequest(@"/stall"), &delegate);
+    NSDate *timeoutDate = [NSDate dateWithTimeIntervalSinceNow:kAFH2CTestTimeoutInterval];
+    while (!delegate.response && [timeoutDate timeIntervalSinceNow] > 0) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    }
+    [connection cancel];
+    
+    // The reset is sent from the network thread of the transport, and may reach the server after a later request
+    BOOL receivedReset = NO;
+    for (NSUInteger idx = 0; idx < 20 && !receivedReset; idx++) {
+        receivedReset = [[AFH2CTestStatistics(transport) objectForKey:@"client_resets"] unsignedIntegerValue] > clientResetCount;
+        if (!receivedReset) {
+            [[NSRunLoop currentRunLoop] runUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+        }
+    }
+    AFH2CTestCheck(delegate.response && receivedReset, @"RST_STREAM: a cancelled request resets its stream");
+}
+
+static void AFH2CTestServerStatistics(AFHTTP2Transport *transport) {
+    NSDictionary *statistics = AFH2CTestStatistics(transport);
+    AFH2CTestCheck([[statistics objectForKey:@"settings_acknowledgements"] unsignedIntegerValue] >= [[statistics objectForKey:@"connections"] unsignedIntegerValue] - 1, @"settings: every connection acknowledges the server's SETTINGS");
+    AFH2CTestCheck([[statistics objectForKey:@"maximum_concurrent_streams"] unsignedIntegerValue] <= 4 && [[statistics objectForKey:@"concurrency_errors"] unsignedIntegerValue] == 0, @"settings: the server's SETTINGS_MAX_CONCURRENT_STREAMS is never exceeded");
+    AFH2CTestCheck([[statistics objectForKey:@"window_updates_sent"] unsignedIntegerValue] > 0 && [[statistics objectForKey:@"flow_control_errors"] unsignedIntegerValue] == 0, @"flow control: the server's windows are never exceeded");
+    AFH2CTestCheck([[statistics objectForKey:@"content_length_errors"] unsignedIntegerValue] == 0 && [[statistics objectForKey:@"protocol_errors"] unsignedIntegerValue] == 0, @"the server saw no protocol errors");
+}
+
+int main(int argc, const char *argv[]) {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    NSString *host = kAFH2CTestDefaultHost;
+    NSUInteger port = kAFH2CTestDefaultPort;
+    for (int idx = 1; idx < argc; idx++) {
+        NSString *argument = [NSString stringWithUTF8String:argv[idx]];
+        if ([argument isEqualToString:@"--host"] && idx + 1 < argc) {
+            host = [NSString stringWithUTF8String:argv[++idx]];
+        } else if ([argument isEqualToString:@"--port"] && idx + 1 < argc) {
+            port = (NSUInteger)atoi(argv[++idx]);
+        } else {
+            fprintf(stderr, "usage: %s [--host HOST] [--port PORT]\n", argv[0]);
+            [pool drain];
+            return 1;
+        }
+    }
+    
+    NSString *authority = [host rangeOfString:@":"].location != NSNotFound ? [NSString stringWithFormat:@"[%@]", host] : host;
+    _baseURLString = [[NSString alloc] initWithFormat:@"http://%@:%lu", authority, (unsigned long)port];
+    
+    // The fallback transport is never used against an h2c server, so a request that reaches it fails the test rather than passing over HTTP/1.1
+    AFHTTP2Transport *transport = [[[AFHTTP2Transport alloc] init] autorelease];
+    transport.fallbackTransport = nil;
+    
+    AFH2CTestSettings(transport);
+    AFH2CTestDownload(transport);
+    AFH2CTestUpload(transport);
+    AFH2CTestConcurrentStreams(transport);
+    AFH2CTestRefusedStream(transport);
+    AFH2CTestGoAway(transport);
+    AFH2CTestResetStream(transport);
+    AFH2CTestCancel(transport);
+    AFH2CTestServerStatistics(transport);
+    
+    printf("%lu failures\n", (unsigned long)_failureCount);
+    
+    [_baseURLString release];
+    [pool drain];
+    
+    return _failureCount > 0 ? 1 : 0;
+}
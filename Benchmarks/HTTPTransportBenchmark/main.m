@@ -0,0 +1,244 @@
+// main.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// A command-line harness that loads responses from a local server with each HTTP transport, checks every body, and measures throughput.
+//
+// Start the server, then build and run from the root of the repository with:
+//
+//   python3 Benchmarks/HTTPTransportBenchmark/server.py --port 8089 &
+//   cmake -S Benchmarks/HTTPTransportBenchmark -B build/HTTPTransportBenchmark
+//   cmake --build build/HTTPTransportBenchmark
+//   ./build/HTTPTransportBenchmark/http-transport-benchmark [--host HOST] [--port PORT] [--requests N] [--size BYTES]
+//
+// Pass the same `--host` to both to load over IPv6, for example `--host ::1`.
+//
+// On Linux the harness builds against GNUstep Base, CoreBase and libdispatch, with GNUstep/ standing in for the Darwin headers the transports import. There `urlconnection` measures GNUstep's NSURLConnection.
+//
+// Each result is written to stdout as a single line of JSON. The exit status is 1 if any request did not end as its scenario expects.
+
+#import <Foundation/Foundation.h>
+#import "AFHTTPTransport.h"
+#import "AFHTTPSocketTransport.h"
+
+#include <sys/resource.h>
+
+static NSUInteger const kAFBenchmarkDefaultRequestCount = 500;
+static NSUInteger const kAFBenchmarkDefaultBodySize = 16 * 1024;
+static NSUInteger const kAFBenchmarkDefaultPort = 8089;
+static NSString * const kAFBenchmarkDefaultHost = @"127.0.0.1";
+
+static NSTimeInterval AFBenchmarkCPUTime() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+}
+
+static BOOL AFBenchmarkBodyIsValid(NSData *data, NSUInteger size) {
+    if ([data length] != size) {
+        return NO;
+    }
+    
+    const uint8_t *bytes = [data bytes];
+    for (NSUInteger idx = 0; idx < size; idx++) {
+        if (bytes[idx] != idx % 251) {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+#pragma mark -
+
+@interface AFBenchmarkConnectionDelegate : NSObject <AFHTTPTransportConnectionDelegate> {
+@private
+    NSHTTPURLResponse *_response;
+    NSMutableData *_data;
+    NSError *_error;
+    BOOL _finished;
+}
+
+@property (readwrite, nonatomic, retain) NSHTTPURLResponse *response;
+@property (readwrite, nonatomic, retain) NSMutableData *data;
+@property (readwrite, nonatomic, retain) NSError *error;
+@property (readwrite, nonatomic, assign, getter = isFinished) BOOL finished;
+@end
+
+@implementation AFBenchmarkConnectionDelegate
+@synthesize response = _response;
+@synthesize data = _data;
+@synthesize error = _error;
+@synthesize finished = _finished;
+
+- (id)init {
+    self = [super init];
+    if (!self) {
+        return nil;
+    }
+    
+    self.data = [NSMutableData data];
+    
+    return self;
+}
+
+- (void)dealloc {
+    [_response release];
+    [_data release];
+    [_error release];
+    [super dealloc];
+}
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+         didReceiveResponse:(NSHTTPURLResponse *)response
+{
+    self.response = response;
+}
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+             didReceiveData:(NSData *)data
+{
+    [self.data appendData:data];
+}
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+            didSendBodyData:(NSInteger)__unused bytesWritten 
+          totalBytesWritten:(NSInteger)__unused totalBytesWritten 
+  totalBytesExpectedToWrite:(NSInteger)__unused totalBytesExpectedToWrite
+{}
+
+- (void)transportConnectionDidFinishLoading:(id <AFHTTPTransportConnection>)__unused connection {
+    self.finished = YES;
+}
+
+- (void)transportConnection:(id <AFHTTPTransportConnection>)__unused connection 
+           didFailWithError:(NSError *)error
+{
+    self.error = error;
+    self.finished = YES;
+}
+
+@end
+
+#pragma mark -
+
+// Loads a request on the current run loop, and returns the delegate once the connection has finished or failed
+static AFBenchmarkConnectionDelegate * AFBenchmarkLoadRequest(id <AFHTTPTransport> transport, NSURLRequest *request) {
+    AFBenchmarkConnectionDelegate *delegate = [[[AFBenchmarkConnectionDelegate alloc] init] autorelease];
+    id <AFHTTPTransportConnection> connection = [transport connectionWithRequest:request delegate:delegate];
+    [connection scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    [connection start];
+    
+    while (![delegate isFinished]) {
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:1.0]];
+    }
+    
+    [connection unscheduleFromRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+    
+    return delegate;
+}
+
+static NSUInteger AFBenchmarkRunScenario(NSString *transportName, id <AFHTTPTransport> transport, NSString *scenario, NSString *host, NSUInteger port, NSUInteger requestCount, NSUInteger size) {
+    BOOL expectsBadServerResponse = [scenario isEqualToString:@"bad-chunk"];
+    NSString *authority = [host rangeOfString:@":"].location != NSNotFound ? [NSString stringWithFormat:@"[%@]", host] : host;
+    NSURL *url = [NSURL URLWithString:[NSString stringWithFormat:@"http://%@:%lu/%@?size=%lu", authority, (unsigned long)port, scenario, (unsigned long)size]];
+    NSURLRequest *request = [NSURLRequest requestWithURL:url cachePolicy:NSURLRequestReloadIgnoringLocalCacheData timeoutInterval:10.0];
+    
+    NSUInteger failureCount = 0;
+    NSDate *startDate = [NSDate date];
+    NSTimeInterval startCPUTime = AFBenchmarkCPUTime();
+    
+    for (NSUInteger idx = 0; idx < requestCount; idx++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        AFBenchmarkConnectionDelegate *delegate = AFBenchmarkLoadRequest(transport, request);
+        
+        BOOL succeeded = NO;
+        if (expectsBadServerResponse) {
+            succeeded = [[delegate.error domain] isEqualToString:NSURLErrorDomain] && [delegate.error code] == NSURLErrorBadServerResponse;
+        } else {
+            succeeded = !delegate.error && [delegate.response statusCode] == 200 && AFBenchmarkBodyIsValid(delegate.data, size);
+        }
+        
+        if (!succeeded) {
+            failureCount++;
+            fprintf(stderr, "%s %s #%lu: status %ld, %lu bytes, error %s\n", [transportName UTF8String], [scenario UTF8String], (unsigned long)idx, (long)[delegate.response statusCode], (unsigned long)[delegate.data length], [[delegate.error description] UTF8String]);
+        }
+        
+        [pool drain];
+    }
+    
+    NSTimeInterval elapsedTime = [[NSDate date] timeIntervalSinceDate:startDate];
+    NSTimeInterval CPUTime = AFBenchmarkCPUTime() - startCPUTime;
+    
+    printf("{\"transport\":\"%s\",\"scenario\":\"%s\",\"requests\":%lu,\"failures\":%lu,\"requests_per_second\":%.1f,\"cpu_us_per_request\":%.1f", [transportName UTF8String], [scenario UTF8String], (unsigned long)requestCount, (unsigned long)failureCount, requestCount / elapsedTime, (CPUTime * 1000000.0) / requestCount);
+    if ([transport isKindOfClass:[AFHTTPSocketTransport class]]) {
+        AFHTTPSocketTransport *socketTransport = (AFHTTPSocketTransport *)transport;
+        printf(",\"opened_connections\":%lu,\"reused_connections\":%lu", (unsigned long)socketTransport.openedConnectionCount, (unsigned long)socketTransport.reusedConnectionCount);
+    }
+    printf("}\n");
+    fflush(stdout);
+    
+    return failureCount;
+}
+
+int main(int argc, const char *argv[]) {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    NSString *host = kAFBenchmarkDefaultHost;
+    NSUInteger port = kAFBenchmarkDefaultPort;
+    NSUInteger requestCount = kAFBenchmarkDefaultRequestCount;
+    NSUInteger size = kAFBenchmarkDefaultBodySize;
+    for (int idx = 1; idx < argc; idx++) {
+        NSString *argument = [NSString stringWithUTF8String:argv[idx]];
+        if ([argument isEqualToString:@"--host"] && idx + 1 < argc) {
+            host = [NSString stringWithUTF8String:argv[++idx]];
+        } else if ([argument isEqualToString:@"--port"] && idx + 1 < argc) {
+            port = (NSUInteger)atoi(argv[++idx]);
+        } else if ([argument isEqualToString:@"--requests"] && idx + 1 < argc) {
+            requestCount = MAX((NSUInteger)atoi(argv[++idx]), (NSUInteger)1);
+        } else if ([argument isEqualToString:@"--size"] && idx + 1 < argc) {
+            size = (NSUInteger)atoi(argv[++idx]);
+        } else {
+            fprintf(stderr, "usage: %s [--host HOST] [--port PORT] [--requests N] [--size BYTES]\n", argv[0]);
+            [pool drain];
+            return 1;
+        }
+    }
+    
+    NSArray *scenarios = [NSArray arrayWithObjects:@"content-length", @"chunked", @"until-close", @"stale", @"bad-chunk", nil];
+    NSUInteger failureCount = 0;
+    for (NSString *scenario in scenarios) {
+        // Each scenario gets its own socket transport, so that its connection counts are its own
+        AFHTTPSocketTransport *socketTransport = [[[AFHTTPSocketTransport alloc] init] autorelease];
+        failureCount += AFBenchmarkRunScenario(@"socket", socketTransport, scenario, host, port, requestCount, size);
+        
+        // `NSURLConnection` reports malformed chunked bodies with errors of its own choosing, so only the socket transport's parser is checked against them
+        if (![scenario isEqualToString:@"bad-chunk"]) {
+            failureCount += AFBenchmarkRunScenario(@"urlconnection", [AFURLConnectionTransport sharedTransport], scenario, host, port, requestCount, size);
+        }
+    }
+    
+    [pool drain];
+    
+    return failureCount > 0 ? 1 : 0;
+}
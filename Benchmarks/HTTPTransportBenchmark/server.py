@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+#
+# A local HTTP/1.1 server for the HTTP transport benchmark, serving each way of framing a response body.
+#
+#   /content-length?size=N  Body framed by Content-Length, on a kept-alive connection
+#   /chunked?size=N         Body in chunks of varying sizes, some with chunk extensions, on a kept-alive connection
+#   /until-close?size=N     Body framed by closing the connection
+#   /stale?size=N           Like /content-length, but the connection is closed right after the response without
+#                           saying so, as a server does when its idle timeout expires; a later request on the kept-alive
+#                           connection finds it closed
+#   /bad-chunk              A chunked body whose chunk size line is not hex, which must be rejected
+#
+# Body byte i is i % 251, so clients can check what they received. A request whose Host header is not a valid
+# host[:port], such as an IPv6 literal without brackets, gets a 400 response.
+#
+# Usage: python3 server.py [--host HOST] [--port PORT]
+
+import argparse
+import socket
+import socketserver
+from urllib.parse import parse_qs, urlsplit
+
+DEFAULT_BODY_SIZE = 16 * 1024
+CHUNK_SIZES = (1, 7, 100, 4096, 16384)
+REASON_PHRASES = {200: "OK", 400: "Bad Request", 404: "Not Found"}
+
+
+def body_of_size(size):
+    return bytes(i % 251 for i in range(size))
+
+
+def host_is_valid(host):
+    if not host:
+        return False
+    if host.startswith("["):
+        address, bracket, port = host[1:].partition("]")
+        return bool(address) and bool(bracket) and (port == "" or (port.startswith(":") and port[1:].isdigit()))
+    name, _, port = host.partition(":")
+    return bool(name) and ":" not in port and (port == "" or port.isdigit())
+
+
+class HTTPTransportBenchmarkHandler(socketserver.StreamRequestHandler):
+    def handle(self):
+        self.request.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        while self.handle_one_request():
+            pass
+
+    def handle_one_request(self):
+        request_line = self.rfile.readline(65537)
+        if not request_line:
+            return False
+
+        content_length = 0
+        host = None
+        while True:
+            line = self.rfile.readline(65537)
+            if line in (b"\r\n", b"\n", b""):
+                break
+            name, _, value = line.decode("latin-1").partition(":")
+            if name.strip().lower() == "content-length":
+                content_length = int(value.strip())
+            elif name.strip().lower() == "host":
+                host = value.strip()
+        if content_length:
+            self.rfile.read(content_length)
+
+        if not host_is_valid(host):
+            self.write_head(400, [("Content-Length", "0")])
+            return True
+
+        method, target, _ = request_line.decode("latin-1").split(" ", 2)
+        url = urlsplit(target)
+        size = int(parse_qs(url.query).get("size", [DEFAULT_BODY_SIZE])[0])
+        body = body_of_size(size) if method != "HEAD" else b""
+
+        if url.path == "/content-length":
+            self.write_head(200, [("Content-Length", str(size))])
+            self.wfile.write(body)
+            return True
+        if url.path == "/chunked":
+            self.write_head(200, [("Transfer-Encoding", "chunked")])
+            self.write_chunks(body)
+            return True
+        if url.path == "/until-close":
+            self.write_head(200, [("Connection", "close")])
+            self.wfile.write(body)
+            return False
+        if url.path == "/stale":
+            self.write_head(200, [("Content-Length", str(size))])
+            self.wfile.write(body)
+            return False
+        if url.path == "/bad-chunk":
+            self.write_head(200, [("Transfer-Encoding", "chunked")])
+            self.wfile.write(b"zz\r\n" + body[:16] + b"\r\n0\r\n\r\n")
+            return True
+
+        self.write_head(404, [("Content-Length", "0")])
+        return True
+
+    def write_head(self, status, headers):
+        lines = ["HTTP/1.1 %d %s" % (status, REASON_PHRASES[status])]
+        lines += ["%s: %s" % header for header in headers]
+        self.wfile.write(("\r\n".join(lines) + "\r\n\r\n").encode("latin-1"))
+
+    def write_chunks(self, body):
+        offset, idx = 0, 0
+        while offset < len(body):
+            length = min(CHUNK_SIZES[idx % len(CHUNK_SIZES)], len(body) - offset)
+            extension = ";name=value" if idx % 2 else ""
+            self.wfile.write(b"%x%s\r\n" % (length, extension.encode("latin-1")))
+            self.wfile.write(body[offset:offset + length] + b"\r\n")
+            offset += length
+            idx += 1
+        self.wfile.write(b"0\r\n\r\n")
+
+
+class HTTPTransportBenchmarkServer(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+class HTTPTransportBenchmarkIPv6Server(HTTPTransportBenchmarkServer):
+    address_family = socket.AF_INET6
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8089)
+    arguments = parser.parse_args()
+
+    server_class = HTTPTransportBenchmarkIPv6Server if ":" in arguments.host else HTTPTransportBenchmarkServer
+    with server_class((arguments.host, arguments.port), HTTPTransportBenchmarkHandler) as server:
+        server.serve_forever()
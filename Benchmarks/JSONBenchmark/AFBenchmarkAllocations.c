@@ -0,0 +1,122 @@
+// AFBenchmarkAllocations.c
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include "AFBenchmarkAllocations.h"
+
+#include <stdlib.h>
+
+#if defined(__APPLE__)
+
+#include <malloc/malloc.h>
+
+size_t AFBenchmarkAllocationsInUse(void) {
+    malloc_statistics_t statistics;
+    malloc_zone_statistics(NULL, &statistics);
+    
+    return statistics.blocks_in_use;
+}
+
+#elif defined(__GLIBC__)
+
+#include <errno.h>
+
+// glibc exports its allocator under these names, so definitions of malloc and friends in the executable can count calls and forward them
+extern void * __libc_malloc(size_t size);
+extern void * __libc_calloc(size_t count, size_t size);
+extern void * __libc_realloc(void *ptr, size_t size);
+extern void * __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static volatile long af_benchmark_allocations_in_use = 0;
+
+static void * AFBenchmarkCountAllocation(void *ptr) {
+    if (ptr) {
+        __sync_fetch_and_add(&af_benchmark_allocations_in_use, 1);
+    }
+    
+    return ptr;
+}
+
+void * malloc(size_t size) {
+    return AFBenchmarkCountAllocation(__libc_malloc(size));
+}
+
+void * calloc(size_t count, size_t size) {
+    return AFBenchmarkCountAllocation(__libc_calloc(count, size));
+}
+
+void * realloc(void *ptr, size_t size) {
+    if (!ptr) {
+        return malloc(size);
+    }
+    
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+    
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr) {
+    if (ptr) {
+        __sync_fetch_and_sub(&af_benchmark_allocations_in_use, 1);
+    }
+    
+    __libc_free(ptr);
+}
+
+void * memalign(size_t alignment, size_t size) {
+    return AFBenchmarkCountAllocation(__libc_memalign(alignment, size));
+}
+
+void * aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    
+    void *allocation = memalign(alignment, size);
+    if (!allocation) {
+        return ENOMEM;
+    }
+    
+    *ptr = allocation;
+    
+    return 0;
+}
+
+size_t AFBenchmarkAllocationsInUse(void) {
+    return (size_t)__sync_fetch_and_add(&af_benchmark_allocations_in_use, 0);
+}
+
+#else
+
+size_t AFBenchmarkAllocationsInUse(void) {
+    return 0;
+}
+
+#endif
@@ -0,0 +1,294 @@
+// main.m
+//
+// Copyright (c) 2011 Gowalla (http://gowalla.com/)
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// A command-line benchmark for the JSON decoders and encoders used by AFJSONRequestOperation.
+//
+// Build and run from the root of the repository with:
+//
+//   cmake -S Benchmarks/JSONBenchmark -B build/JSONBenchmark
+//   cmake --build build/JSONBenchmark
+//   ./build/JSONBenchmark/json-benchmark [--iterations N] [--corpus NAME] [--corpus-directory PATH]
+//
+// On Linux this needs GNUstep Base and CoreBase, built with clang and libobjc2 for blocks support.
+//
+// Each result is written to stdout as a single line of JSON.
+
+#import <Foundation/Foundation.h>
+#import "JSONKit.h"
+
+#import "AFBenchmarkAllocations.h"
+
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#endif
+
+typedef id (^AFBenchmarkBlock)(NSData *data, id object);
+
+static NSUInteger const kAFBenchmarkDefaultIterations = 200;
+static NSUInteger const kAFBenchmarkSpotRecordCount = 10000;
+static NSUInteger const kAFBenchmarkNestingDepth = 256;
+
+// Returns a monotonic timestamp in nanoseconds
+static uint64_t AFBenchmarkMonotonicTime() {
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t timebase;
+    if (timebase.denom == 0) {
+        mach_timebase_info(&timebase);
+    }
+    
+    return (mach_absolute_time() * timebase.numer) / timebase.denom;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static NSTimeInterval AFBenchmarkTimeIntervalFromNanoseconds(uint64_t nanoseconds) {
+    return (NSTimeInterval)nanoseconds / 1000000000.0;
+}
+
+static int AFBenchmarkCompareLatencies(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static long long AFBenchmarkPeakResidentSetSize() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    
+    // ru_maxrss is in bytes on Darwin and in kilobytes on Linux
+#if defined(__APPLE__)
+    return (long long)usage.ru_maxrss;
+#else
+    return (long long)usage.ru_maxrss * 1024;
+#endif
+}
+
+#pragma mark - Corpora
+
+static NSDictionary * AFBenchmarkSpotRecord(NSUInteger idx) {
+    NSMutableDictionary *mutableRecord = [NSMutableDictionary dictionary];
+    [mutableRecord setValue:[NSString stringWithFormat:@"Spot #%lu", (unsigned long)idx] forKey:@"name"];
+    [mutableRecord setValue:[NSString stringWithFormat:@"http://static.gowalla.com/categories/%lu-standard.png", (unsigned long)(idx % 512)] forKey:@"image_url"];
+    [mutableRecord setValue:[NSString stringWithFormat:@"/spots/%lu", (unsigned long)idx] forKey:@"url"];
+    [mutableRecord setValue:[NSNumber numberWithDouble:30.2 + (idx % 1000) / 10000.0] forKey:@"lat"];
+    [mutableRecord setValue:[NSNumber numberWithDouble:-97.7 - (idx % 1000) / 10000.0] forKey:@"lng"];
+    [mutableRecord setValue:[NSNumber numberWithUnsignedInteger:idx * 7] forKey:@"checkins_count"];
+    [mutableRecord setValue:[NSNumber numberWithBool:(idx % 3 == 0)] forKey:@"is_featured"];
+    [mutableRecord setValue:[NSNull null] forKey:@"description"];
+    [mutableRecord setValue:[NSArray arrayWithObjects:@"coffee", @"wifi", @"outdoor seating", nil] forKey:@"tags"];
+    
+    return mutableRecord;
+}
+
+static NSDictionary * AFBenchmarkCorpora() {
+    NSMutableDictionary *mutableCorpora = [NSMutableDictionary dictionary];
+    
+    [mutableCorpora setObject:AFBenchmarkSpotRecord(9223) forKey:@"small-object"];
+    
+    NSMutableArray *mutableSpots = [NSMutableArray arrayWithCapacity:kAFBenchmarkSpotRecordCount];
+    for (NSUInteger idx = 0; idx < kAFBenchmarkSpotRecordCount; idx++) {
+        [mutableSpots addObject:AFBenchmarkSpotRecord(idx)];
+    }
+    [mutableCorpora setObject:[NSDictionary dictionaryWithObject:mutableSpots forKey:@"spots"] forKey:@"spots"];
+    
+    id nested = [NSArray arrayWithObject:@"leaf"];
+    for (NSUInteger depth = 0; depth < kAFBenchmarkNestingDepth; depth++) {
+        nested = (depth % 2 == 0) ? [NSDictionary dictionaryWithObject:nested forKey:[NSString stringWithFormat:@"level-%lu", (unsigned long)depth]] : [NSArray arrayWithObjects:nested, [NSNumber numberWithUnsignedInteger:depth], nil];
+    }
+    [mutableCorpora setObject:nested forKey:@"deeply-nested"];
+    
+    NSArray *unicodeStrings = [NSArray arrayWithObjects:@"Café Müller", @"東京タワー", @"Москва", @"\U0001F600 \U0001F389 \U0001F355", @"tab\tnewline\nquote\"backslash\\", nil];
+    NSMutableArray *mutableUnicode = [NSMutableArray arrayWithCapacity:kAFBenchmarkSpotRecordCount];
+    for (NSUInteger idx = 0; idx < kAFBenchmarkSpotRecordCount; idx++) {
+        [mutableUnicode addObject:[unicodeStrings objectAtIndex:idx % [unicodeStrings count]]];
+    }
+    [mutableCorpora setObject:mutableUnicode forKey:@"unicode-strings"];
+    
+    return mutableCorpora;
+}
+
+#pragma mark - Codecs
+
+static NSDictionary * AFBenchmarkDecoders() {
+    NSMutableDictionary *mutableDecoders = [NSMutableDictionary dictionary];
+    
+    [mutableDecoders setObject:[[^id(NSData *data, id __unused object) {
+        return [[JSONDecoder decoder] objectWithData:data];
+    } copy] autorelease] forKey:@"jsonkit-decode"];
+    
+    JSONDecoder *reusedDecoder = [[[JSONDecoder alloc] init] autorelease];
+    [mutableDecoders setObject:[[^id(NSData *data, id __unused object) {
+        return [reusedDecoder objectWithData:data];
+    } copy] autorelease] forKey:@"jsonkit-decode-reused-decoder"];
+    
+    if (NSClassFromString(@"NSJSONSerialization")) {
+        [mutableDecoders setObject:[[^id(NSData *data, id __unused object) {
+            return [NSClassFromString(@"NSJSONSerialization") JSONObjectWithData:data options:0 error:nil];
+        } copy] autorelease] forKey:@"nsjsonserialization-decode"];
+    }
+    
+    return mutableDecoders;
+}
+
+static NSDictionary * AFBenchmarkEncoders() {
+    NSMutableDictionary *mutableEncoders = [NSMutableDictionary dictionary];
+    
+    [mutableEncoders setObject:[[^id(NSData __unused *data, id object) {
+        return [object JSONData];
+    } copy] autorelease] forKey:@"jsonkit-encode"];
+    
+    if (NSClassFromString(@"NSJSONSerialization")) {
+        [mutableEncoders setObject:[[^id(NSData __unused *data, id object) {
+            return [NSClassFromString(@"NSJSONSerialization") dataWithJSONObject:object options:0 error:nil];
+        } copy] autorelease] forKey:@"nsjsonserialization-encode"];
+    }
+    
+    return mutableEncoders;
+}
+
+#pragma mark -
+
+static NSDictionary * AFBenchmarkRun(NSString *codecName, AFBenchmarkBlock block, NSString *corpusName, NSData *data, id object, NSUInteger iterations) {
+    uint64_t *latencies = calloc(iterations, sizeof(uint64_t));
+    uint64_t totalTime = 0;
+    long long totalBlocks = 0;
+    
+    // Warm up caches and lazily-initialized state before measuring
+    [block(data, object) self];
+    
+    for (NSUInteger idx = 0; idx < iterations; idx++) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        size_t blocksBefore = AFBenchmarkAllocationsInUse();
+        uint64_t startTime = AFBenchmarkMonotonicTime();
+        id result = block(data, object);
+        uint64_t endTime = AFBenchmarkMonotonicTime();
+        totalBlocks += (long long)AFBenchmarkAllocationsInUse() - (long long)blocksBefore;
+        [result self];
+        [pool drain];
+        
+        latencies[idx] = endTime - startTime;
+        totalTime += latencies[idx];
+    }
+    
+    qsort(latencies, iterations, sizeof(uint64_t), AFBenchmarkCompareLatencies);
+    
+    NSTimeInterval totalSeconds = AFBenchmarkTimeIntervalFromNanoseconds(totalTime);
+    
+    NSMutableDictionary *mutableResult = [NSMutableDictionary dictionary];
+    [mutableResult setValue:codecName forKey:@"codec"];
+    [mutableResult setValue:corpusName forKey:@"corpus"];
+    [mutableResult setValue:[NSNumber numberWithUnsignedInteger:[data length]] forKey:@"document_bytes"];
+    [mutableResult setValue:[NSNumber numberWithUnsignedInteger:iterations] forKey:@"iterations"];
+    [mutableResult setValue:[NSNumber numberWithDouble:(([data length] * iterations) / totalSeconds) / (1024.0 * 1024.0)] forKey:@"mb_per_second"];
+    [mutableResult setValue:[NSNumber numberWithDouble:AFBenchmarkTimeIntervalFromNanoseconds(latencies[iterations / 2]) * 1000.0] forKey:@"p50_ms"];
+    [mutableResult setValue:[NSNumber numberWithDouble:AFBenchmarkTimeIntervalFromNanoseconds(latencies[MIN((iterations * 99) / 100, iterations - 1)]) * 1000.0] forKey:@"p99_ms"];
+    [mutableResult setValue:[NSNumber numberWithDouble:(double)totalBlocks / iterations] forKey:@"live_allocations_per_document"];
+    [mutableResult setValue:[NSNumber numberWithLongLong:AFBenchmarkPeakResidentSetSize()] forKey:@"peak_rss"];
+    
+    free(latencies);
+    
+    return mutableResult;
+}
+
+int main(int argc, const char *argv[]) {
+    NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+    
+    NSUInteger iterations = kAFBenchmarkDefaultIterations;
+    NSString *corpusFilter = nil;
+    NSString *corpusDirectory = nil;
+    for (int idx = 1; idx < argc; idx++) {
+        NSString *argument = [NSString stringWithUTF8String:argv[idx]];
+        if ([argument isEqualToString:@"--iterations"] && idx + 1 < argc) {
+            iterations = MAX((NSUInteger)atoi(argv[++idx]), (NSUInteger)1);
+        } else if ([argument isEqualToString:@"--corpus"] && idx + 1 < argc) {
+            corpusFilter = [NSString stringWithUTF8String:argv[++idx]];
+        } else if ([argument isEqualToString:@"--corpus-directory"] && idx + 1 < argc) {
+            corpusDirectory = [NSString stringWithUTF8String:argv[++idx]];
+        } else {
+            fprintf(stderr, "usage: %s [--iterations N] [--corpus NAME] [--corpus-directory PATH]\n", argv[0]);
+            [pool drain];
+            return 1;
+        }
+    }
+    
+    // Each corpus is benchmarked both minified and pretty-printed, since whitespace handling is a significant part of decoding cost
+    NSMutableDictionary *mutableDocuments = [NSMutableDictionary dictionary];
+    NSDictionary *corpora = AFBenchmarkCorpora();
+    for (NSString *corpusName in corpora) {
+        id object = [corpora objectForKey:corpusName];
+        [mutableDocuments setObject:[object JSONData] forKey:corpusName];
+        [mutableDocuments setObject:[object JSONDataWithOptions:JKSerializeOptionPretty error:nil] forKey:[corpusName stringByAppendingString:@"-pretty"]];
+    }
+    
+    for (NSString *fileName in [[NSFileManager defaultManager] contentsOfDirectoryAtPath:corpusDirectory error:nil]) {
+        if ([[fileName pathExtension] isEqualToString:@"json"]) {
+            NSData *data = [NSData dataWithContentsOfFile:[corpusDirectory stringByAppendingPathComponent:fileName]];
+            if (data) {
+                [mutableDocuments setObject:data forKey:[fileName stringByDeletingPathExtension]];
+            }
+        }
+    }
+    
+    NSDictionary *decoders = AFBenchmarkDecoders();
+    NSDictionary *encoders = AFBenchmarkEncoders();
+    
+    for (NSString *corpusName in [[mutableDocuments allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+        if (corpusFilter && ![corpusName hasPrefix:corpusFilter]) {
+            continue;
+        }
+        
+        NSData *data = [mutableDocuments objectForKey:corpusName];
+        id object = [[JSONDecoder decoder] objectWithData:data];
+        if (!object) {
+            fprintf(stderr, "Skipping %s: not valid JSON\n", [corpusName UTF8String]);
+            continue;
+        }
+        
+        for (NSString *decoderName in [[decoders allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+            NSDictionary *result = AFBenchmarkRun(decoderName, [decoders objectForKey:decoderName], corpusName, data, object, iterations);
+            printf("%s\n", [[result JSONString] UTF8String]);
+        }
+        
+        // Encoders always produce minified output, so they are only measured against minified documents
+        if ([corpusName hasSuffix:@"-pretty"]) {
+            continue;
+        }
+        
+        for (NSString *encoderName in [[encoders allKeys] sortedArrayUsingSelector:@selector(compare:)]) {
+            NSDictionary *result = AFBenchmarkRun(encoderName, [encoders objectForKey:encoderName], corpusName, data, object, iterations);
+            printf("%s\n", [[result JSONString] UTF8String]);
+        }
+        
+        fflush(stdout);
+    }
+    
+    [pool drain];
+    
+    return 0;
+}
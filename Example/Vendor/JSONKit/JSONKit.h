@@ -147,6 +147,9 @@ extern "C" {
 + (id)decoderWithParseOptions:(JKParseOptionFlags)parseOptionFlags;
 - (id)initWithParseOptions:(JKParseOptionFlags)parseOptionFlags;
 - (void)clearCache;
+// The number of string and number tokens found in, and missing from, the decoder's cache, accumulated across every parse performed by the decoder.
+- (NSUInteger)cacheHitCount;
+- (NSUInteger)cacheMissCount;
 
 // The parse... methods were deprecated in v1.4 in favor of the v1.4 objectWith... methods.
 - (id)parseUTF8String:(const unsigned char *)string length:(size_t)length                         JK_DEPRECATED_ATTRIBUTE; // Deprecated in JSONKit v1.4.  Use objectWithUTF8String:length:        instead.
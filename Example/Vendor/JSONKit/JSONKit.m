@@ -421,6 +421,7 @@ struct JKTokenCache {
     size_t            count;
     unsigned int      prng_lfsr;
     unsigned char     age[JK_CACHE_SLOTS];
+    unsigned long     hits, misses;
 };
 
 struct JKObjCImpCache {
@@ -602,6 +603,7 @@ static int jk_encode_add_atom_to_buffer(JKEncodeState *encodeState, void *object
 JK_STATIC_INLINE size_t jk_min(size_t a, size_t b);
 JK_STATIC_INLINE size_t jk_max(size_t a, size_t b);
 JK_STATIC_INLINE JKHash calculateHash(JKHash currentHash, unsigned char c);
+JK_STATIC_INLINE JKHash calculateHashForBytes(JKHash currentHash, const unsigned char *bytes, size_t length);
 
 // JSONKit v1.4 used both a JKArray : NSArray and JKMutableArray : NSMutableArray, and the same for the dictionary collection type.
 // However, Louis Gerbarg (via cocoa-dev) pointed out that Cocoa / Core Foundation actually implements only a single class that inherits from the 
@@ -1083,6 +1085,15 @@ JK_STATIC_INLINE size_t jk_max(size_t a, size_t b) { return((a > b) ? a : b); }
 
 JK_STATIC_INLINE JKHash calculateHash(JKHash currentHash, unsigned char c) { return(((currentHash << 5) + currentHash) + c); }
 
+// Same result as calculateHash() applied to each byte in turn, but folds in four bytes per step (h * 33^4 + c0 * 33^3 + c1 * 33^2 + c2 * 33 + c3) so the multiplies are not one long dependency chain.
+JK_STATIC_INLINE JKHash calculateHashForBytes(JKHash currentHash, const unsigned char *bytes, size_t length) {
+    const JKHash pow1 = 33UL, pow2 = pow1 * 33UL, pow3 = pow2 * 33UL, pow4 = pow3 * 33UL;
+    const unsigned char *atByte = bytes, *endOfBytes = bytes + length;
+    while((atByte + 4) <= endOfBytes) { currentHash = (currentHash * pow4) + (atByte[0] * pow3) + (atByte[1] * pow2) + (atByte[2] * pow1) + atByte[3]; atByte += 4; }
+    while(atByte < endOfBytes) { currentHash = calculateHash(currentHash, *atByte++); }
+    return(currentHash);
+}
+
 static void jk_error(JKParseState *parseState, NSString *format, ...) {
     NSCParameterAssert((parseState != NULL) && (format != NULL));
     
@@ -1387,6 +1398,92 @@ JK_STATIC_INLINE int jk_string_add_unicodeCodePoint(JKParseState *parseState, ui
 #pragma mark -
 #pragma mark Decoding / parsing / deserializing functions
 
+// JK_SIMD_* fast paths scan ahead in 16 (or 32, with AVX2) byte blocks for the next byte that needs attention from the scalar parser.
+
+#if       defined(__AVX2__)
+#include <immintrin.h>
+#define JK_SIMD_AVX2
+#define JK_SIMD_SSE2
+#elif     defined(__SSE2__)
+#include <emmintrin.h>
+#define JK_SIMD_SSE2
+#elif     defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define JK_SIMD_NEON
+#endif
+
+// Returns the number of leading bytes in [ptr, endPtr) that are ' ' or '\t'.
+JK_STATIC_INLINE size_t jk_span_blanks(const unsigned char *ptr, const unsigned char *endPtr) {
+    const unsigned char *atPtr = ptr;
+#if       defined(JK_SIMD_AVX2)
+    const __m256i space32 = _mm256_set1_epi8(' '), tab32 = _mm256_set1_epi8('\t');
+    while((atPtr + 32) <= endPtr) {
+        __m256i  chunk = _mm256_loadu_si256((const __m256i *)atPtr);
+        uint32_t blank = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space32), _mm256_cmpeq_epi8(chunk, tab32)));
+        if(blank != 0xFFFFFFFFU) { return((size_t)(atPtr - ptr) + (size_t)__builtin_ctz(~blank)); }
+        atPtr += 32;
+    }
+#endif
+#if       defined(JK_SIMD_SSE2)
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+    while((atPtr + 16) <= endPtr) {
+        __m128i  chunk = _mm_loadu_si128((const __m128i *)atPtr);
+        uint32_t blank = (uint32_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)));
+        if(blank != 0xFFFFU) { return((size_t)(atPtr - ptr) + (size_t)__builtin_ctz(~blank)); }
+        atPtr += 16;
+    }
+#elif     defined(JK_SIMD_NEON)
+    const uint8x16_t space = vdupq_n_u8(' '), tab = vdupq_n_u8('\t');
+    while((atPtr + 16) <= endPtr) {
+        uint8x16_t chunk    = vld1q_u8(atPtr);
+        uint8x16_t notBlank = vmvnq_u8(vorrq_u8(vceqq_u8(chunk, space), vceqq_u8(chunk, tab)));
+        uint8x8_t  folded   = vorr_u8(vget_low_u8(notBlank), vget_high_u8(notBlank));
+        if(vget_lane_u64(vreinterpret_u64_u8(folded), 0) != 0ULL) { break; }
+        atPtr += 16;
+    }
+#endif
+    while((atPtr < endPtr) && (((*atPtr) == ' ') || ((*atPtr) == '\t'))) { atPtr++; }
+    return((size_t)(atPtr - ptr));
+}
+
+// Returns the number of leading bytes in [ptr, endPtr) that can be copied verbatim into a string: printable ASCII other than '"' and '\\'.
+JK_STATIC_INLINE size_t jk_span_simple_string_characters(const unsigned char *ptr, const unsigned char *endPtr) {
+    const unsigned char *atPtr = ptr;
+#if       defined(JK_SIMD_AVX2)
+    const __m256i quote32 = _mm256_set1_epi8('"'), backslash32 = _mm256_set1_epi8('\\'), control32 = _mm256_set1_epi8(0x20);
+    while((atPtr + 32) <= endPtr) {
+        __m256i  chunk   = _mm256_loadu_si256((const __m256i *)atPtr);
+        // A signed compare against 0x20 matches both control characters and bytes >= 0x80.
+        __m256i  special = _mm256_or_si256(_mm256_cmpgt_epi8(control32, chunk), _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote32), _mm256_cmpeq_epi8(chunk, backslash32)));
+        uint32_t mask    = (uint32_t)_mm256_movemask_epi8(special);
+        if(mask != 0U) { return((size_t)(atPtr - ptr) + (size_t)__builtin_ctz(mask)); }
+        atPtr += 32;
+    }
+#endif
+#if       defined(JK_SIMD_SSE2)
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\'), control = _mm_set1_epi8(0x20);
+    while((atPtr + 16) <= endPtr) {
+        __m128i  chunk   = _mm_loadu_si128((const __m128i *)atPtr);
+        // A signed compare against 0x20 matches both control characters and bytes >= 0x80.
+        __m128i  special = _mm_or_si128(_mm_cmplt_epi8(chunk, control), _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+        uint32_t mask    = (uint32_t)_mm_movemask_epi8(special);
+        if(mask != 0U) { return((size_t)(atPtr - ptr) + (size_t)__builtin_ctz(mask)); }
+        atPtr += 16;
+    }
+#elif     defined(JK_SIMD_NEON)
+    const uint8x16_t quote = vdupq_n_u8('"'), backslash = vdupq_n_u8('\\'), control = vdupq_n_u8(0x20), highBit = vdupq_n_u8(0x80);
+    while((atPtr + 16) <= endPtr) {
+        uint8x16_t chunk   = vld1q_u8(atPtr);
+        uint8x16_t special = vorrq_u8(vorrq_u8(vcltq_u8(chunk, control), vcgeq_u8(chunk, highBit)), vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)));
+        uint8x8_t  folded  = vorr_u8(vget_low_u8(special), vget_high_u8(special));
+        if(vget_lane_u64(vreinterpret_u64_u8(folded), 0) != 0ULL) { break; }
+        atPtr += 16;
+    }
+#endif
+    while((atPtr < endPtr) && ((*atPtr) >= 0x20U) && ((*atPtr) < 0x80U) && ((*atPtr) != '"') && ((*atPtr) != '\\')) { atPtr++; }
+    return((size_t)(atPtr - ptr));
+}
+
 static int jk_parse_string(JKParseState *parseState) {
     NSCParameterAssert((parseState != NULL) && (JK_AT_STRING_PTR(parseState) <= JK_END_STRING_PTR(parseState)));
     const unsigned char *stringStart       = JK_AT_STRING_PTR(parseState) + 1;
@@ -1404,6 +1501,9 @@ static int jk_parse_string(JKParseState *parseState) {
     while(1) {
         unsigned long currentChar;
         
+        // A simple string is hashed in one pass once its end is found, rather than byte by byte here.
+        atStringCharacter += jk_span_simple_string_characters(atStringCharacter, endOfBuffer);
+        
         if(JK_EXPECT_F(atStringCharacter == endOfBuffer)) { /* XXX Add error message */ stringState = JSONStringStateError; goto finishedParsing; }
         
         if(JK_EXPECT_F((currentChar = *atStringCharacter++) >= 0x80UL)) {
@@ -1412,8 +1512,7 @@ static int jk_parse_string(JKParseState *parseState) {
             ConversionResult     result;
             
             if(JK_EXPECT_F((result = ConvertSingleCodePointInUTF8(atStringCharacter - 1, endOfBuffer, (UTF8 const **)&nextValidCharacter, &u32ch)) != conversionOK)) { goto switchToSlowPath; }
-            stringHash = calculateHash(stringHash, currentChar);
-            while(atStringCharacter < nextValidCharacter) { NSCParameterAssert(JK_AT_STRING_PTR(parseState) <= JK_END_STRING_PTR(parseState)); stringHash = calculateHash(stringHash, *atStringCharacter++); }
+            atStringCharacter = nextValidCharacter;
             continue;
         } else {
             if(JK_EXPECT_F(currentChar == (unsigned long)'"')) { stringState = JSONStringStateFinished; goto finishedParsing; }
@@ -1423,14 +1522,13 @@ static int jk_parse_string(JKParseState *parseState) {
                 onlySimpleString = 0;
                 stringState      = JSONStringStateParsing;
                 tokenBufferIdx   = (atStringCharacter - stringStart) - 1L;
+                stringHash       = calculateHashForBytes(stringHash, stringStart, tokenBufferIdx);
                 if(JK_EXPECT_F((tokenBufferIdx + 16UL) > parseState->token.tokenBuffer.bytes.length)) { if((tokenBuffer = jk_managedBuffer_resize(&parseState->token.tokenBuffer, tokenBufferIdx + 1024UL)) == NULL) { jk_error(parseState, @"Internal error: Unable to resize temporary buffer. %@ line #%ld", [NSString stringWithUTF8String:__FILE__], (long)__LINE__); stringState = JSONStringStateError; goto finishedParsing; } }
                 memcpy(tokenBuffer, stringStart, tokenBufferIdx);
                 goto slowMatch;
             }
             
             if(JK_EXPECT_F(currentChar < 0x20UL)) { jk_error(parseState, @"Invalid character < 0x20 found in string: 0x%2.2x.", currentChar); stringState = JSONStringStateError; goto finishedParsing; }
-            
-            stringHash = calculateHash(stringHash, currentChar);
         }
     }
     
@@ -1583,6 +1681,7 @@ finishedParsing:
             NSCParameterAssert(((parseState->token.tokenPtrRange.ptr + 1) < endOfBuffer) && (parseState->token.tokenPtrRange.length >= 2UL) && (((parseState->token.tokenPtrRange.ptr + 1) + (parseState->token.tokenPtrRange.length - 2)) < endOfBuffer));
             parseState->token.value.ptrRange.ptr    = parseState->token.tokenPtrRange.ptr    + 1;
             parseState->token.value.ptrRange.length = parseState->token.tokenPtrRange.length - 2UL;
+            stringHash                              = calculateHashForBytes(stringHash, parseState->token.value.ptrRange.ptr, parseState->token.value.ptrRange.length);
         } else {
             parseState->token.value.ptrRange.ptr    = parseState->token.tokenBuffer.bytes.ptr;
             parseState->token.value.ptrRange.length = tokenBufferIdx;
@@ -1722,7 +1821,7 @@ JK_STATIC_INLINE void jk_parse_skip_whitespace(JKParseState *parseState) {
     const unsigned char *endOfStringPtr   = JK_END_STRING_PTR(parseState);
     
     for(atCharacterPtr = JK_AT_STRING_PTR(parseState); (JK_EXPECT_T((atCharacterPtr = JK_AT_STRING_PTR(parseState)) < endOfStringPtr)); parseState->atIndex++) {
-        if(((*(atCharacterPtr + 0)) == ' ') || ((*(atCharacterPtr + 0)) == '\t')) { continue; }
+        if(((*(atCharacterPtr + 0)) == ' ') || ((*(atCharacterPtr + 0)) == '\t')) { parseState->atIndex += jk_span_blanks(atCharacterPtr + 1, endOfStringPtr); continue; }
         if(jk_parse_skip_newline(parseState)) { continue; }
         if(parseState->parseOptionFlags & JKParseOptionComments) {
             if((JK_EXPECT_F((*(atCharacterPtr + 0)) == '/')) && (JK_EXPECT_T((atCharacterPtr + 1) < endOfStringPtr))) {
@@ -1977,6 +2076,7 @@ static void *jk_cachedObjects(JKParseState *parseState) {
         if((JK_EXPECT_T(parseState->cache.items[bucket].hash == parseState->token.value.hash)) && (JK_EXPECT_T(parseState->cache.items[bucket].size == parseState->token.value.ptrRange.length)) && (JK_EXPECT_T(parseState->cache.items[bucket].type == parseState->token.value.type)) && (JK_EXPECT_T(parseState->cache.items[bucket].bytes != NULL)) && (JK_EXPECT_T(strncmp((const char *)parseState->cache.items[bucket].bytes, (const char *)parseState->token.value.ptrRange.ptr, parseState->token.value.ptrRange.length) == 0U))) {
             parseState->cache.age[bucket]     = (parseState->cache.age[bucket] << 1) | 1U;
             parseState->token.value.cacheItem = &parseState->cache.items[bucket];
+            parseState->cache.hits++;
             NSCParameterAssert(parseState->cache.items[bucket].object != NULL);
             return((void *)CFRetain(parseState->cache.items[bucket].object));
         } else {
@@ -1988,6 +2088,8 @@ static void *jk_cachedObjects(JKParseState *parseState) {
         }
     }
     
+    parseState->cache.misses++;
+    
     switch(parseState->token.value.type) {
         case JKValueTypeString:           parsedAtom = (void *)CFStringCreateWithBytes(NULL, parseState->token.value.ptrRange.ptr, parseState->token.value.ptrRange.length, kCFStringEncodingUTF8, 0); break;
         case JKValueTypeLongLong:         parsedAtom = (void *)CFNumberCreate(NULL, kCFNumberLongLongType, &parseState->token.value.number.longLongValue);                                             break;
@@ -2127,6 +2229,16 @@ static void _JSONDecoderCleanup(JSONDecoder *decoder) {
     [super dealloc];
 }
 
+- (NSUInteger)cacheHitCount
+{
+    return((parseState != NULL) ? (NSUInteger)parseState->cache.hits : 0UL);
+}
+
+- (NSUInteger)cacheMissCount
+{
+    return((parseState != NULL) ? (NSUInteger)parseState->cache.misses : 0UL);
+}
+
 - (void)clearCache
 {
     if(JK_EXPECT_T(parseState != NULL)) {